@@ -0,0 +1,399 @@
+// Measures SyntaxHighlighter on an offscreen document: whole-document
+// throughput, the slowest single line to lex, and the slowest edit as seen
+// by the GUI thread. Results are compared with a stored baseline and the
+// process exits non-zero on a regression, or when a lexer state does not
+// survive being stored in a text block.
+//
+//   highlighter_bench [--runs N] [--lines N] [--tolerance F]
+//                     [--baseline FILE] [--update-baseline] [FILE...]
+//
+// Files given on the command line are measured alongside the generated
+// corpus, with the grammar their name selects.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QPlainTextDocumentLayout>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "features/grammar.hpp"
+#include "ui/syntax_highlighter.hpp"
+
+using xenon::features::Grammar;
+using xenon::features::GrammarRegistry;
+using xenon::ui::SyntaxHighlighter;
+
+namespace {
+
+constexpr int kVisibleLines = 60;
+constexpr int kEditSamples = 200;
+// Worst-case times are a few microseconds, where timer noise alone is
+// a large fraction; they only regress past this much on top of the
+// tolerance
+constexpr double kSlackMicros = 10.0;
+// A baseline figure of "-" has not been recorded yet and is not checked
+constexpr double kUnrecorded = -1.0;
+
+struct Corpus {
+    QString name;
+    std::shared_ptr<const Grammar> grammar;
+    QString text;
+};
+
+struct Result {
+    int lines = 0;
+    double linesPerSecond = 0;
+    double worstLexMicros = 0;
+    double worstEditMicros = 0;
+};
+
+// Typical library code: templates, comments, raw and escaped strings,
+// preprocessor lines and numbers with separators
+QString cppCorpus(int lines) {
+    const QString block = QStringLiteral(
+        "// Section %1 of a header in the style of a container library\n"
+        "#include <vector>\n"
+        "namespace bench_%1 {\n"
+        "/* Block comment describing\n"
+        "   the Widget%1 type and its invariants */\n"
+        "template <typename T, size_t Capacity = 64>\n"
+        "class Widget%1 : public Base<T> {\n"
+        "public:\n"
+        "    explicit Widget%1(const std::string& name) : name_(name), count_(1'000) {}\n"
+        "    int compute(int x, double y) const {\n"
+        "        auto s = R\"raw(literal with \"quotes\" and )raw\";\n"
+        "        const char* path = \"C:\\\\path\\\\to\\\\file_%1.txt\";\n"
+        "        if (x > 0x1F && y < 3.14e-2) return static_cast<int>(y * x);\n"
+        "        for (size_t i = 0; i < Capacity; ++i) { values_.push_back(i * 2); }\n"
+        "        return helper(x) + 'c'; // trailing comment\n"
+        "    }\n"
+        "#if defined(FEATURE_%1)\n"
+        "    void enabled();\n"
+        "#endif\n"
+        "private:\n"
+        "    std::string name_;\n"
+        "    std::vector<int> values_;\n"
+        "    long count_;\n"
+        "};\n"
+        "} // namespace bench_%1\n");
+
+    QString text;
+    int count = 0;
+    for (int section = 0; count < lines; ++section) {
+        const QString chunk = block.arg(section);
+        text += chunk;
+        count += static_cast<int>(chunk.count(QLatin1Char('\n')));
+    }
+    return text;
+}
+
+// A bundler's output: a few lines of a quarter megabyte each
+QString minifiedCorpus() {
+    constexpr int kLines = 20;
+    constexpr int kLineLength = 250000;
+    QString text;
+    for (int line = 0; line < kLines; ++line) {
+        QString content;
+        for (int i = 0; content.size() < kLineLength; ++i) {
+            content += QStringLiteral("function a%1(b,c){return b+c*2}var d%1=\"str\\\"ing\",e%1=[1,2.5,0x3];"
+                                      "/*c*/if(d%1){a%1(1,'x')}").arg(i);
+        }
+        text += content;
+        text += QLatin1Char('\n');
+    }
+    return text;
+}
+
+// Rust block comments nest; each section opens comments a level per line
+// and closes them again, with code and strings inside that must stay
+// comment-colored
+QString nestedCommentsCorpus(int lines) {
+    constexpr int kDepth = 64;
+    QString text;
+    int count = 0;
+    for (int section = 0; count < lines; ++section) {
+        for (int depth = 1; depth <= kDepth; ++depth) {
+            text += QStringLiteral("%1/* level %2: fn not_code() { \"no string\" }\n")
+                        .arg(QString(depth % 16, QLatin1Char(' ')))
+                        .arg(depth);
+        }
+        for (int depth = kDepth; depth >= 1; --depth) {
+            text += QStringLiteral("%1still comment %2 */\n").arg(QString(depth % 16, QLatin1Char(' '))).arg(depth);
+        }
+        text += QStringLiteral("fn section_%1(x: u32) -> u32 { x + 1 } // done\n").arg(section);
+        count += 2 * kDepth + 1;
+    }
+    return text;
+}
+
+void waitUntilIdle(const SyntaxHighlighter& highlighter) {
+    while (!highlighter.isIdle()) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+}
+
+std::u16string_view utf16View(const QString& text) {
+    return std::u16string_view(reinterpret_cast<const char16_t*>(text.utf16()), static_cast<size_t>(text.size()));
+}
+
+// Lexer states are kept in QTextBlock::userState(), where a negative value
+// means "not highlighted yet", so a state that doesn't come back unchanged
+// and non-negative has the highlighter re-lex that line forever. Raw
+// strings carry a hash of their delimiter in the upper bits, which is
+// where the sign bit gets set.
+bool checkStateRoundTrip(const QString& name, const Grammar& grammar) {
+    QTextDocument document;
+    document.setPlainText(QStringLiteral(
+        "auto a = R\"delim(\n"
+        "inside \"delim\"\n"
+        ")delim\";\n"
+        "auto b = R\"json(\n"
+        "{\"key\": 1}\n"
+        ")json\";\n"
+        "int c = 0;\n"));
+
+    bool ok = true;
+    std::vector<xenon::features::Token> tokens;
+    int state = 0;
+    for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+        const QString text = block.text();
+        const bool insideRawString = state != 0;
+        tokens.clear();
+        state = grammar.lexLine(utf16View(text), state, tokens);
+        block.setUserState(state);
+        if (state < 0 || block.userState() != state) {
+            std::printf("  STATE: %s line %d state %d did not survive userState()\n", qPrintable(name),
+                        block.blockNumber() + 1, state);
+            ok = false;
+        }
+        const bool wholeLineString = tokens.size() == 1 && tokens[0].kind == xenon::features::TokenKind::String &&
+                                     tokens[0].length == static_cast<uint32_t>(text.size());
+        if (insideRawString && !text.startsWith(QLatin1Char(')')) && !wholeLineString) {
+            std::printf("  STATE: %s line %d lost the raw string it is in\n", qPrintable(name),
+                        block.blockNumber() + 1);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+Result measureOnce(const Corpus& corpus) {
+    Result result;
+    QTextDocument document;
+    document.setDocumentLayout(new QPlainTextDocumentLayout(&document));
+    document.setUndoRedoEnabled(false);
+    document.setPlainText(corpus.text);
+    result.lines = document.blockCount();
+
+    // Whole document, as when a grammar is set on an open file
+    SyntaxHighlighter highlighter(&document);
+    highlighter.setVisibleLines(0, kVisibleLines);
+    QElapsedTimer timer;
+    timer.start();
+    highlighter.setGrammar(corpus.grammar);
+    waitUntilIdle(highlighter);
+    const double seconds = static_cast<double>(std::max<qint64>(timer.nsecsElapsed(), 1)) / 1e9;
+    result.linesPerSecond = result.lines / seconds;
+
+    // The slowest line for the worker to lex, from its true start state
+    std::vector<xenon::features::Token> tokens;
+    int state = 0;
+    for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+        const QString text = block.text();
+        tokens.clear();
+        timer.restart();
+        state = corpus.grammar->lexLine(utf16View(text), state, tokens);
+        result.worstLexMicros = std::max(result.worstLexMicros, static_cast<double>(timer.nsecsElapsed()) / 1e3);
+    }
+
+    // Typing: each edit is highlighted synchronously before insertText
+    // returns, which is what the GUI thread waits on
+    const int step = std::max(1, result.lines / kEditSamples);
+    for (int line = 0; line < result.lines; line += step) {
+        QTextCursor cursor(document.findBlockByNumber(line));
+        highlighter.setVisibleLines(line, line + kVisibleLines);
+        timer.restart();
+        cursor.insertText(QStringLiteral("x"));
+        result.worstEditMicros = std::max(result.worstEditMicros, static_cast<double>(timer.nsecsElapsed()) / 1e3);
+        waitUntilIdle(highlighter);
+    }
+    return result;
+}
+
+// Best of several runs for each figure, so a scheduling hiccup in one
+// run doesn't read as a regression
+Result measure(const Corpus& corpus, int runs) {
+    Result best;
+    for (int run = 0; run < runs; ++run) {
+        const Result result = measureOnce(corpus);
+        if (run == 0) {
+            best = result;
+            continue;
+        }
+        best.linesPerSecond = std::max(best.linesPerSecond, result.linesPerSecond);
+        best.worstLexMicros = std::min(best.worstLexMicros, result.worstLexMicros);
+        best.worstEditMicros = std::min(best.worstEditMicros, result.worstEditMicros);
+    }
+    return best;
+}
+
+double baselineFigure(const QString& field) {
+    return field == QLatin1String("-") ? kUnrecorded : field.toDouble();
+}
+
+// One line per corpus: name, lines/second, worst lex and worst edit in
+// microseconds, or - for a figure not recorded yet. Lines starting with #
+// are comments.
+std::map<QString, Result> readBaseline(const QString& path) {
+    std::map<QString, Result> baseline;
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) return baseline;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) continue;
+        const QStringList fields = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        if (fields.size() != 4) continue;
+        Result result;
+        result.linesPerSecond = baselineFigure(fields[1]);
+        result.worstLexMicros = baselineFigure(fields[2]);
+        result.worstEditMicros = baselineFigure(fields[3]);
+        baseline[fields[0]] = result;
+    }
+    return baseline;
+}
+
+bool writeBaseline(const QString& path, const std::vector<std::pair<QString, Result>>& results) {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate)) return false;
+
+    QTextStream out(&file);
+    out << "# name lines/s worst-lex-us worst-edit-us, written by highlighter_bench --update-baseline\n"
+        << "# on the reference machine from a Release build; checked with a 25% tolerance\n";
+    for (const auto& [name, result] : results) {
+        out << name << ' ' << QString::number(result.linesPerSecond, 'f', 0) << ' '
+            << QString::number(result.worstLexMicros, 'f', 1) << ' '
+            << QString::number(result.worstEditMicros, 'f', 1) << '\n';
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Extra files to measure.", "[FILE...]");
+    QCommandLineOption runsOption("runs", "Runs per corpus; the best of each figure counts.", "N", "3");
+    QCommandLineOption linesOption("lines", "Lines in the generated C++ corpus.", "N", "100000");
+    QCommandLineOption toleranceOption("tolerance", "Allowed slowdown against the baseline.", "F", "0.25");
+    QCommandLineOption baselineOption("baseline", "Baseline file.", "FILE", XENON_BENCH_BASELINE);
+    QCommandLineOption updateOption("update-baseline", "Record the results as the new baseline.");
+    parser.addOptions({runsOption, linesOption, toleranceOption, baselineOption, updateOption});
+    parser.process(app);
+
+    const int runs = std::max(1, parser.value(runsOption).toInt());
+    const int lines = std::max(1, parser.value(linesOption).toInt());
+    const double tolerance = parser.value(toleranceOption).toDouble();
+
+    GrammarRegistry grammars;
+    const QDir dir(":/grammars");
+    for (const QString& name : dir.entryList({"*.grammar"}, QDir::Files, QDir::Name)) {
+        QFile file(dir.filePath(name));
+        if (!file.open(QFile::ReadOnly)) continue;
+        const QByteArray text = file.readAll();
+        if (auto grammar = Grammar::parse(std::string_view(text.constData(), static_cast<size_t>(text.size())))) {
+            grammars.add(std::move(grammar));
+        }
+    }
+
+    std::vector<Corpus> corpora;
+    corpora.push_back({"cpp-100k", grammars.byId("cpp"), cppCorpus(lines)});
+    corpora.push_back({"minified-js", grammars.byId("javascript"), minifiedCorpus()});
+    corpora.push_back({"nested-comments", grammars.byId("rust"), nestedCommentsCorpus(lines / 5)});
+    for (const QString& path : parser.positionalArguments()) {
+        QFile file(path);
+        auto grammar = grammars.forFile(path.toStdString());
+        if (!grammar || !file.open(QFile::ReadOnly | QFile::Text)) {
+            std::fprintf(stderr, "Skipping %s: unreadable or no grammar\n", qPrintable(path));
+            continue;
+        }
+        corpora.push_back({QFileInfo(path).fileName(), std::move(grammar), QString::fromUtf8(file.readAll())});
+    }
+
+    const QString baselinePath = parser.value(baselineOption);
+    const std::map<QString, Result> baseline = readBaseline(baselinePath);
+
+    std::printf("%-20s %9s %12s %14s %15s\n", "corpus", "lines", "lines/s", "worst lex us", "worst edit us");
+    std::vector<std::pair<QString, Result>> results;
+    bool regressed = false;
+    for (const Corpus& corpus : corpora) {
+        if (!corpus.grammar) {
+            std::fprintf(stderr, "No grammar for %s\n", qPrintable(corpus.name));
+            return 1;
+        }
+        const Result result = measure(corpus, runs);
+        results.emplace_back(corpus.name, result);
+        std::printf("%-20s %9d %12.0f %14.1f %15.1f\n", qPrintable(corpus.name), result.lines,
+                    result.linesPerSecond, result.worstLexMicros, result.worstEditMicros);
+
+        const auto base = baseline.find(corpus.name);
+        if (parser.isSet(updateOption) || base == baseline.end()) continue;
+        const Result& expected = base->second;
+        if (expected.linesPerSecond == kUnrecorded || expected.worstLexMicros == kUnrecorded ||
+            expected.worstEditMicros == kUnrecorded) {
+            std::printf("  NOTE: %s has figures missing from the baseline; they are not checked\n",
+                        qPrintable(corpus.name));
+        }
+        if (expected.linesPerSecond != kUnrecorded &&
+            result.linesPerSecond < expected.linesPerSecond * (1.0 - tolerance)) {
+            std::printf("  REGRESSION: %.0f lines/s, baseline %.0f\n", result.linesPerSecond, expected.linesPerSecond);
+            regressed = true;
+        }
+        if (expected.worstLexMicros != kUnrecorded &&
+            result.worstLexMicros > expected.worstLexMicros * (1.0 + tolerance) + kSlackMicros) {
+            std::printf("  REGRESSION: worst lex %.1f us, baseline %.1f\n", result.worstLexMicros, expected.worstLexMicros);
+            regressed = true;
+        }
+        if (expected.worstEditMicros != kUnrecorded &&
+            result.worstEditMicros > expected.worstEditMicros * (1.0 + tolerance) + kSlackMicros) {
+            std::printf("  REGRESSION: worst edit %.1f us, baseline %.1f\n", result.worstEditMicros, expected.worstEditMicros);
+            regressed = true;
+        }
+    }
+
+    // Both the C++ lexer and the table-driven engine's raw-string rule
+    bool statesKept = checkStateRoundTrip("cpp", *grammars.byId("cpp"));
+    if (auto raw = Grammar::parse("id raw-string-test\nraw-string R\"\n")) {
+        statesKept = checkStateRoundTrip("raw-string-test", *raw) && statesKept;
+    }
+
+    if (parser.isSet(updateOption)) {
+        if (!writeBaseline(baselinePath, results)) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(baselinePath));
+            return 1;
+        }
+        std::printf("Baseline written to %s\n", qPrintable(baselinePath));
+    } else if (baseline.empty()) {
+        // Without one nothing above could fail, so the gate would always pass
+        std::fprintf(stderr, "No baseline at %s; record one with --update-baseline\n", qPrintable(baselinePath));
+        return 1;
+    }
+    return regressed || !statesKept ? 1 : 0;
+}
@@ -0,0 +1,394 @@
+#include "features/bracket_index.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+namespace {
+
+bool isOpen(char16_t ch) {
+    return ch == u'(' || ch == u'[' || ch == u'{';
+}
+
+bool pairs(char16_t open, char16_t close) {
+    return (open == u'(' && close == u')') || (open == u'[' && close == u']') || (open == u'{' && close == u'}');
+}
+
+// Depth offset plus a relative minimum, keeping "none" as it is
+int shifted(int offset, int value, int none) {
+    return value >= none ? none : offset + value;
+}
+
+const std::vector<Bracket> kNoBrackets;
+
+const Bracket* bracketAt(const std::vector<Bracket>& brackets, int column) {
+    const auto it = std::lower_bound(brackets.begin(), brackets.end(), column,
+                                     [](const Bracket& b, int c) { return static_cast<int>(b.column) < c; });
+    return it != brackets.end() && static_cast<int>(it->column) == column ? &*it : nullptr;
+}
+
+} // anonymous namespace
+
+void scanBrackets(std::u16string_view line, const Token* begin, const Token* end, std::vector<Bracket>& brackets) {
+    const Token* token = begin;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char16_t c = line[i];
+        if (c != u'(' && c != u')' && c != u'[' && c != u']' && c != u'{' && c != u'}') continue;
+
+        // Tokens come in order; only strings and comments hide brackets
+        while (token != end && token->start + token->length <= i) ++token;
+        if (token != end && token->start <= i &&
+            (token->kind == TokenKind::String || token->kind == TokenKind::Comment)) {
+            continue;
+        }
+        brackets.push_back(Bracket{static_cast<uint32_t>(i), c});
+    }
+}
+
+LineIndent measureIndent(std::u16string_view line, int tabWidth) {
+    LineIndent indent;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == u' ') {
+            ++indent.width;
+        } else if (line[i] == u'\t') {
+            indent.width += tabWidth - indent.width % tabWidth;
+        } else if (line[i] == u'\r' && i + 1 == line.size()) {
+            break; // a CRLF line ending left in the text
+        } else {
+            indent.column = static_cast<int>(i);
+            return indent;
+        }
+    }
+    return LineIndent();
+}
+
+void BracketIndex::clear() {
+    nodes_.clear();
+    free_.clear();
+    root_ = -1;
+}
+
+int BracketIndex::newNode() {
+    // xorshift; the priorities only need to look random to the input
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+
+    int index;
+    if (!free_.empty()) {
+        index = free_.back();
+        free_.pop_back();
+        nodes_[static_cast<size_t>(index)] = Node();
+    } else {
+        index = static_cast<int>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[static_cast<size_t>(index)].priority = seed_;
+    return index;
+}
+
+void BracketIndex::freeTree(int node) {
+    // Iterative, so a tree badly out of balance can't overflow the stack
+    std::vector<int> stack;
+    if (node >= 0) stack.push_back(node);
+    while (!stack.empty()) {
+        Node& n = nodes_[static_cast<size_t>(stack.back())];
+        free_.push_back(stack.back());
+        stack.pop_back();
+        if (n.left >= 0) stack.push_back(n.left);
+        if (n.right >= 0) stack.push_back(n.right);
+        n.brackets = std::vector<Bracket>();
+    }
+}
+
+void BracketIndex::summarize(Node& node) {
+    node.delta = 0;
+    node.minBefore = kNone;
+    node.minAfter = kNone;
+    for (const Bracket& bracket : node.brackets) {
+        node.minBefore = std::min(node.minBefore, node.delta);
+        node.delta += isOpen(bracket.ch) ? 1 : -1;
+        node.minAfter = std::min(node.minAfter, node.delta);
+    }
+}
+
+void BracketIndex::pull(int index) {
+    Node& node = nodes_[static_cast<size_t>(index)];
+    int size = 1;
+    int sum = 0;
+    int minBefore = kNone;
+    int minAfter = kNone;
+    if (node.left >= 0) {
+        const Node& left = nodes_[static_cast<size_t>(node.left)];
+        size += left.size;
+        sum = left.sum;
+        minBefore = left.subMinBefore;
+        minAfter = left.subMinAfter;
+    }
+    minBefore = std::min(minBefore, shifted(sum, node.minBefore, kNone));
+    minAfter = std::min(minAfter, shifted(sum, node.minAfter, kNone));
+    sum += node.delta;
+    if (node.right >= 0) {
+        const Node& right = nodes_[static_cast<size_t>(node.right)];
+        size += right.size;
+        minBefore = std::min(minBefore, shifted(sum, right.subMinBefore, kNone));
+        minAfter = std::min(minAfter, shifted(sum, right.subMinAfter, kNone));
+        sum += right.sum;
+    }
+    node.size = size;
+    node.sum = sum;
+    node.subMinBefore = minBefore;
+    node.subMinAfter = minAfter;
+}
+
+void BracketIndex::split(int node, int count, int& left, int& right) {
+    if (node < 0) {
+        left = right = -1;
+        return;
+    }
+    Node& n = nodes_[static_cast<size_t>(node)];
+    const int leftSize = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].size : 0;
+    if (count <= leftSize) {
+        int rest;
+        split(n.left, count, left, rest);
+        nodes_[static_cast<size_t>(node)].left = rest;
+        right = node;
+    } else {
+        int rest;
+        split(n.right, count - leftSize - 1, rest, right);
+        nodes_[static_cast<size_t>(node)].right = rest;
+        left = node;
+    }
+    pull(node);
+}
+
+int BracketIndex::merge(int left, int right) {
+    if (left < 0) return right;
+    if (right < 0) return left;
+    if (nodes_[static_cast<size_t>(left)].priority > nodes_[static_cast<size_t>(right)].priority) {
+        const int merged = merge(nodes_[static_cast<size_t>(left)].right, right);
+        nodes_[static_cast<size_t>(left)].right = merged;
+        pull(left);
+        return left;
+    }
+    const int merged = merge(left, nodes_[static_cast<size_t>(right)].left);
+    nodes_[static_cast<size_t>(right)].left = merged;
+    pull(right);
+    return right;
+}
+
+void BracketIndex::replaceLines(int first, int removed, int added) {
+    first = std::clamp(first, 0, lineCount());
+    removed = std::clamp(removed, 0, lineCount() - first);
+
+    int before;
+    int rest;
+    int gone;
+    int after;
+    split(root_, first, before, rest);
+    split(rest, removed, gone, after);
+    freeTree(gone);
+
+    // Built up as a balanced run: each new node is merged into a tree
+    // whose right spine is short
+    int inserted = -1;
+    for (int i = 0; i < added; ++i) {
+        const int node = newNode();
+        pull(node);
+        inserted = merge(inserted, node);
+    }
+    root_ = merge(merge(before, inserted), after);
+}
+
+int BracketIndex::find(int line, int* depth) const {
+    int node = root_;
+    int offset = 0;
+    while (node >= 0) {
+        const Node& n = nodes_[static_cast<size_t>(node)];
+        const int leftSize = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].size : 0;
+        const int leftSum = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].sum : 0;
+        if (line < leftSize) {
+            node = n.left;
+        } else if (line == leftSize) {
+            if (depth) *depth = offset + leftSum;
+            return node;
+        } else {
+            line -= leftSize + 1;
+            offset += leftSum + n.delta;
+            node = n.right;
+        }
+    }
+    return -1;
+}
+
+void BracketIndex::setLine(int line, std::vector<Bracket> brackets, LineIndent indent) {
+    // The path down, to update the subtrees on the way back
+    std::vector<int> path;
+    int node = root_;
+    while (node >= 0) {
+        path.push_back(node);
+        const Node& n = nodes_[static_cast<size_t>(node)];
+        const int leftSize = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].size : 0;
+        if (line < leftSize) {
+            node = n.left;
+        } else if (line == leftSize) {
+            break;
+        } else {
+            line -= leftSize + 1;
+            node = n.right;
+        }
+    }
+    if (node < 0) return;
+
+    Node& n = nodes_[static_cast<size_t>(node)];
+    n.brackets = std::move(brackets);
+    n.indent = indent;
+    summarize(n);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) pull(*it);
+}
+
+const std::vector<Bracket>& BracketIndex::lineBrackets(int line) const {
+    const int node = line >= 0 ? find(line, nullptr) : -1;
+    return node >= 0 ? nodes_[static_cast<size_t>(node)].brackets : kNoBrackets;
+}
+
+void BracketIndex::forEachLine(const LineVisitor& visit) const {
+    // In order without recursion, like freeTree
+    std::vector<int> stack;
+    int node = root_;
+    int line = 0;
+    while (node >= 0 || !stack.empty()) {
+        while (node >= 0) {
+            stack.push_back(node);
+            node = nodes_[static_cast<size_t>(node)].left;
+        }
+        const Node& n = nodes_[static_cast<size_t>(stack.back())];
+        stack.pop_back();
+        visit(line++, n.brackets, n.indent);
+        node = n.right;
+    }
+}
+
+int BracketIndex::depthAt(int line, int column) const {
+    int depth = 0;
+    const int node = find(line, &depth);
+    if (node < 0) return root_ < 0 ? 0 : nodes_[static_cast<size_t>(root_)].sum;
+    for (const Bracket& bracket : nodes_[static_cast<size_t>(node)].brackets) {
+        if (static_cast<int>(bracket.column) >= column) break;
+        depth += isOpen(bracket.ch) ? 1 : -1;
+    }
+    return depth;
+}
+
+int BracketIndex::firstLineReaching(int node, int base, int offset, int from, int threshold) const {
+    if (node < 0) return -1;
+    const Node& n = nodes_[static_cast<size_t>(node)];
+    if (base + n.size <= from || shifted(offset, n.subMinAfter, kNone) > threshold) return -1;
+
+    const int leftSize = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].size : 0;
+    const int leftSum = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].sum : 0;
+    const int found = firstLineReaching(n.left, base, offset, from, threshold);
+    if (found >= 0) return found;
+
+    const int line = base + leftSize;
+    if (line >= from && shifted(offset + leftSum, n.minAfter, kNone) <= threshold) return line;
+    return firstLineReaching(n.right, line + 1, offset + leftSum + n.delta, from, threshold);
+}
+
+int BracketIndex::lastLineReaching(int node, int base, int offset, int to, int threshold) const {
+    if (node < 0) return -1;
+    const Node& n = nodes_[static_cast<size_t>(node)];
+    if (base > to || shifted(offset, n.subMinBefore, kNone) > threshold) return -1;
+
+    const int leftSize = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].size : 0;
+    const int leftSum = n.left >= 0 ? nodes_[static_cast<size_t>(n.left)].sum : 0;
+    const int line = base + leftSize;
+    const int found = lastLineReaching(n.right, line + 1, offset + leftSum + n.delta, to, threshold);
+    if (found >= 0) return found;
+
+    if (line <= to && shifted(offset + leftSum, n.minBefore, kNone) <= threshold) return line;
+    return lastLineReaching(n.left, base, offset, to, threshold);
+}
+
+int BracketIndex::firstLineReaching(int from, int threshold) const {
+    return firstLineReaching(root_, 0, 0, from, threshold);
+}
+
+int BracketIndex::lastLineReaching(int to, int threshold) const {
+    return lastLineReaching(root_, 0, 0, to, threshold);
+}
+
+BracketPosition BracketIndex::firstAfter(int line, int column, int threshold) const {
+    int depth = 0;
+    int node = find(line, &depth);
+    if (node < 0) return {};
+    for (const Bracket& bracket : nodes_[static_cast<size_t>(node)].brackets) {
+        depth += isOpen(bracket.ch) ? 1 : -1;
+        if (static_cast<int>(bracket.column) > column && depth <= threshold) {
+            return {line, static_cast<int>(bracket.column)};
+        }
+    }
+
+    line = firstLineReaching(line + 1, threshold);
+    if (line < 0) return {};
+    node = find(line, &depth);
+    for (const Bracket& bracket : nodes_[static_cast<size_t>(node)].brackets) {
+        depth += isOpen(bracket.ch) ? 1 : -1;
+        if (depth <= threshold) return {line, static_cast<int>(bracket.column)};
+    }
+    return {};
+}
+
+BracketPosition BracketIndex::lastBefore(int line, int column, int threshold) const {
+    int depth = 0;
+    int node = find(line, &depth);
+    if (node < 0) return {};
+    BracketPosition found;
+    for (const Bracket& bracket : nodes_[static_cast<size_t>(node)].brackets) {
+        if (static_cast<int>(bracket.column) >= column) break;
+        if (depth <= threshold) found = {line, static_cast<int>(bracket.column)};
+        depth += isOpen(bracket.ch) ? 1 : -1;
+    }
+    if (found.valid()) return found;
+
+    line = lastLineReaching(line - 1, threshold);
+    if (line < 0) return {};
+    node = find(line, &depth);
+    for (const Bracket& bracket : nodes_[static_cast<size_t>(node)].brackets) {
+        if (depth <= threshold) found = {line, static_cast<int>(bracket.column)};
+        depth += isOpen(bracket.ch) ? 1 : -1;
+    }
+    return found;
+}
+
+BracketPosition BracketIndex::match(int line, int column) const {
+    const Bracket* bracket = bracketAt(lineBrackets(line), column);
+    if (!bracket) return {};
+
+    // An open bracket is closed by the first one after it to return below
+    // its depth; a closing one opened by the last one before it to start
+    // from below its depth
+    const int depth = depthAt(line, column);
+    const bool open = isOpen(bracket->ch);
+    const BracketPosition other = open ? firstAfter(line, column, depth) : lastBefore(line, column, depth - 1);
+    if (!other.valid()) return {};
+    const Bracket* partner = bracketAt(lineBrackets(other.line), other.column);
+    return pairs(open ? bracket->ch : partner->ch, open ? partner->ch : bracket->ch) ? other : BracketPosition{};
+}
+
+std::vector<BracketPair> BracketIndex::enclosing(int line, int column, size_t limit) const {
+    std::vector<BracketPair> result;
+    int depth = depthAt(line, column);
+    while (result.size() < limit) {
+        // The last bracket before the position entered from below its
+        // depth opens the innermost scope around it
+        const BracketPosition open = lastBefore(line, column, depth - 1);
+        if (!open.valid()) break;
+        depth = depthAt(open.line, open.column);
+        result.push_back({open, firstAfter(open.line, open.column, depth)});
+        line = open.line;
+        column = open.column;
+    }
+    return result;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "features/grammar.hpp"
+
+namespace xenon::features {
+
+// One of ( ) [ ] { } outside strings and comments
+struct Bracket {
+    uint32_t column; // UTF-16 offset in the line
+    char16_t ch;
+};
+
+struct BracketPosition {
+    int line = -1;
+    int column = -1;
+
+    bool valid() const { return line >= 0; }
+    bool operator==(const BracketPosition& other) const { return line == other.line && column == other.column; }
+    bool operator!=(const BracketPosition& other) const { return !(*this == other); }
+};
+
+// An open bracket and its closing one; close is invalid while unclosed
+struct BracketPair {
+    BracketPosition open;
+    BracketPosition close;
+};
+
+// The whitespace a line starts with
+struct LineIndent {
+    int column = -1; // of the first other character, -1 for a blank line
+    int width = 0;   // with tabs advancing to the next tab stop
+};
+
+// Appends the brackets of line that are not inside the given tokens'
+// strings and comments
+void scanBrackets(std::u16string_view line, const Token* begin, const Token* end, std::vector<Bracket>& brackets);
+// The indent of line, with a tab stop every tabWidth columns
+LineIndent measureIndent(std::u16string_view line, int tabWidth = 4);
+
+// The brackets of a document by line, for matching them and finding the
+// scopes around a position without rescanning. All kinds nest as one, so
+// the depth at a position is the count of open brackets before it minus
+// the closing ones; a pair whose kinds disagree is reported as unmatched.
+//
+// Lines are the nodes of a treap ordered by line number. Each subtree keeps
+// its lines' net change in depth and the lowest depth, relative to its
+// start, just before and just after any of its brackets. The depth at a
+// line is a descent from the root, and the nearest bracket on either side
+// reaching a given depth (which is what matching and the enclosing scopes
+// need) is a descent that skips every subtree staying above it, so each
+// query is O(log n) in the number of lines, plus the brackets of the lines
+// it ends on. An edit replaces its lines in O(log n) as well.
+//
+// Each line also keeps its indent, so folding can read both in one walk
+// over the lines instead of lexing the document again.
+class BracketIndex {
+public:
+    using LineVisitor = std::function<void(int line, const std::vector<Bracket>& brackets, LineIndent indent)>;
+
+    BracketIndex() = default;
+
+    int lineCount() const { return root_ < 0 ? 0 : nodes_[static_cast<size_t>(root_)].size; }
+    void clear();
+    // Lines first..first + removed - 1 become added blank lines
+    void replaceLines(int first, int removed, int added);
+    void setLine(int line, std::vector<Bracket> brackets, LineIndent indent);
+    // Sorted by column; empty past the last line
+    const std::vector<Bracket>& lineBrackets(int line) const;
+    // Every line in order, in O(n)
+    void forEachLine(const LineVisitor& visit) const;
+
+    // Open brackets before column of line, less the closed ones
+    int depthAt(int line, int column) const;
+    // The bracket closing or opened by the one at line and column; invalid
+    // when there is no bracket there or it is unmatched
+    BracketPosition match(int line, int column) const;
+    // The pairs around line and column, innermost first, up to limit
+    std::vector<BracketPair> enclosing(int line, int column,
+                                       size_t limit = std::numeric_limits<size_t>::max()) const;
+
+private:
+    static constexpr int kNone = std::numeric_limits<int>::max() / 2;
+
+    struct Node {
+        int left = -1;
+        int right = -1;
+        uint32_t priority = 0;
+        std::vector<Bracket> brackets;
+        LineIndent indent;
+        // This line: the net change in depth and the lowest depth just
+        // before and just after a bracket, from the line's start
+        int delta = 0;
+        int minBefore = kNone;
+        int minAfter = kNone;
+        // The subtree, lines in order
+        int size = 1;
+        int sum = 0;
+        int subMinBefore = kNone;
+        int subMinAfter = kNone;
+    };
+
+    int newNode();
+    void freeTree(int node);
+    void pull(int node);
+    static void summarize(Node& node);
+    void split(int node, int count, int& left, int& right);
+    int merge(int left, int right);
+
+    // The node of line and the depth at its start, -1 when out of range
+    int find(int line, int* depth) const;
+    // First line from `from` whose lowest depth after a bracket is at most
+    // threshold, and the last up to `to` by the depth before one
+    int firstLineReaching(int from, int threshold) const;
+    int lastLineReaching(int to, int threshold) const;
+    // The same within the subtree at node, whose first line is base and
+    // starts at depth offset
+    int firstLineReaching(int node, int base, int offset, int from, int threshold) const;
+    int lastLineReaching(int node, int base, int offset, int to, int threshold) const;
+    // The first bracket after column of line leaving the depth at most
+    // threshold, and the last before it entered at depth at most threshold
+    BracketPosition firstAfter(int line, int column, int threshold) const;
+    BracketPosition lastBefore(int line, int column, int threshold) const;
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_;
+    int root_ = -1;
+    uint32_t seed_ = 0x9e3779b9u;
+};
+
+} // namespace xenon::features
@@ -0,0 +1,287 @@
+#include "features/cpp_lexer.hpp"
+#include "features/lexer_support.hpp"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <string_view>
+
+namespace xenon::features {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+constexpr std::string_view kKeywords[] = {
+    "alignas"sv, "alignof"sv, "and"sv, "and_eq"sv, "asm"sv, "auto"sv, "bitand"sv, "bitor"sv, "bool"sv,
+    "break"sv, "case"sv, "catch"sv, "char"sv, "char8_t"sv, "char16_t"sv, "char32_t"sv, "class"sv,
+    "compl"sv, "concept"sv, "const"sv, "consteval"sv, "constexpr"sv, "constinit"sv, "const_cast"sv,
+    "continue"sv, "co_await"sv, "co_return"sv, "co_yield"sv, "decltype"sv, "default"sv, "delete"sv,
+    "do"sv, "double"sv, "dynamic_cast"sv, "else"sv, "emit"sv, "enum"sv, "explicit"sv, "export"sv,
+    "extern"sv, "false"sv, "final"sv, "float"sv, "for"sv, "friend"sv, "goto"sv, "if"sv, "inline"sv,
+    "int"sv, "long"sv, "mutable"sv, "namespace"sv, "new"sv, "noexcept"sv, "not"sv, "not_eq"sv,
+    "nullptr"sv, "operator"sv, "or"sv, "or_eq"sv, "override"sv, "private"sv, "protected"sv,
+    "public"sv, "register"sv, "reinterpret_cast"sv, "requires"sv, "return"sv, "short"sv,
+    "signals"sv, "signed"sv, "sizeof"sv, "slots"sv, "static"sv, "static_assert"sv, "static_cast"sv,
+    "struct"sv, "switch"sv, "template"sv, "this"sv, "thread_local"sv, "throw"sv, "true"sv, "try"sv,
+    "typedef"sv, "typeid"sv, "typename"sv, "union"sv, "unsigned"sv, "using"sv, "virtual"sv,
+    "void"sv, "volatile"sv, "wchar_t"sv, "while"sv, "xor"sv, "xor_eq"sv,
+};
+constexpr size_t kKeywordCount = std::size(kKeywords);
+constexpr size_t kKeywordSlots = 2048;
+static_assert(kKeywordCount < 255, "keyword slots store index + 1 in a byte");
+
+template <typename Char>
+constexpr uint32_t keywordHash(const Char* text, size_t length, uint32_t seed) {
+    uint32_t hash = seed;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<uint32_t>(text[i])) * 16777619u;
+    }
+    return (hash ^ (hash >> 15)) & (kKeywordSlots - 1);
+}
+
+struct KeywordTable {
+    uint32_t seed = 0;
+    uint8_t slots[kKeywordSlots] = {}; // keyword index + 1, 0 when empty
+};
+
+// Tries seeds until every keyword lands in its own slot, so a lookup is
+// one hash and at most one comparison
+constexpr KeywordTable buildKeywordTable() {
+    for (uint32_t seed = 2166136261u; seed != 2166136261u + 4096; ++seed) {
+        KeywordTable table;
+        table.seed = seed;
+        bool collision = false;
+        for (size_t i = 0; i < kKeywordCount && !collision; ++i) {
+            const uint32_t slot = keywordHash(kKeywords[i].data(), kKeywords[i].size(), seed);
+            collision = table.slots[slot] != 0;
+            table.slots[slot] = static_cast<uint8_t>(i + 1);
+        }
+        if (!collision) return table;
+    }
+    return KeywordTable{};
+}
+
+constexpr KeywordTable kKeywordTable = buildKeywordTable();
+static_assert(kKeywordTable.seed != 0, "no perfect hash seed found for the keyword set");
+
+enum CharClass : uint8_t {
+    kOther,
+    kSpace,
+    kIdentifier,
+    kDigit,
+    kDoubleQuote,
+    kSingleQuote,
+    kSlash,
+    kHash,
+    kDot,
+};
+
+constexpr std::array<CharClass, 128> buildCharClasses() {
+    std::array<CharClass, 128> classes {};
+    for (auto& c : classes) c = kOther;
+    classes[' '] = classes['\t'] = classes['\r'] = classes['\f'] = classes['\v'] = kSpace;
+    for (char c = 'a'; c <= 'z'; ++c) classes[static_cast<size_t>(c)] = kIdentifier;
+    for (char c = 'A'; c <= 'Z'; ++c) classes[static_cast<size_t>(c)] = kIdentifier;
+    classes['_'] = classes['$'] = kIdentifier;
+    for (char c = '0'; c <= '9'; ++c) classes[static_cast<size_t>(c)] = kDigit;
+    classes['"'] = kDoubleQuote;
+    classes['\''] = kSingleQuote;
+    classes['/'] = kSlash;
+    classes['#'] = kHash;
+    classes['.'] = kDot;
+    return classes;
+}
+
+constexpr std::array<CharClass, 128> kCharClasses = buildCharClasses();
+
+// Non-ASCII units are taken to be part of identifiers
+inline CharClass classOf(char16_t c) {
+    return c < 128 ? kCharClasses[c] : kIdentifier;
+}
+
+inline bool isIdentifierChar(char16_t c) {
+    const CharClass cls = classOf(c);
+    return cls == kIdentifier || cls == kDigit;
+}
+
+int rawStringState(uint32_t hash) {
+    return static_cast<int>((hash << 8) | static_cast<uint32_t>(CppLexer::kStateRawString));
+}
+
+// Offset just past the closing quote, or the end of the line
+size_t skipQuoted(std::u16string_view line, size_t from, char16_t quote) {
+    size_t i = from;
+    while (i < line.size()) {
+        const char16_t c = line[i++];
+        if (c == u'\\') {
+            ++i;
+        } else if (c == quote) {
+            return i;
+        }
+    }
+    return line.size();
+}
+
+bool isStringPrefix(std::u16string_view word) {
+    return word == u"L" || word == u"u" || word == u"U" || word == u"u8" || word == u"R" || word == u"LR" ||
+           word == u"uR" || word == u"UR" || word == u"u8R";
+}
+
+} // anonymous namespace
+
+bool CppLexer::isKeyword(std::u16string_view word) {
+    if (word.size() < 2 || word.size() > 16) return false;
+    const uint8_t slot = kKeywordTable.slots[keywordHash(word.data(), word.size(), kKeywordTable.seed)];
+    if (slot == 0) return false;
+
+    const std::string_view keyword = kKeywords[slot - 1];
+    if (keyword.size() != word.size()) return false;
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (word[i] != static_cast<char16_t>(keyword[i])) return false;
+    }
+    return true;
+}
+
+int CppLexer::lexLine(std::u16string_view line, int state, std::vector<Token>& tokens) {
+    const size_t n = line.size();
+    size_t i = 0;
+
+    // Finish whatever the previous line left open
+    switch (state & kStateModeMask) {
+        case kStateBlockComment: {
+            const size_t end = line.find(u"*/");
+            if (end == std::u16string_view::npos) {
+                if (n > 0) pushToken(tokens, 0, n, TokenKind::Comment);
+                return state;
+            }
+            pushToken(tokens, 0, end + 2, TokenKind::Comment);
+            i = end + 2;
+            break;
+        }
+        case kStateRawString: {
+            const size_t end = findRawStringEnd(line, 0, static_cast<uint32_t>(state) >> 8);
+            if (end == std::u16string_view::npos) {
+                if (n > 0) pushToken(tokens, 0, n, TokenKind::String);
+                return state;
+            }
+            pushToken(tokens, 0, end, TokenKind::String);
+            i = end;
+            break;
+        }
+        default:
+            break;
+    }
+
+    bool lineStart = i == 0;
+    while (i < n) {
+        const char16_t c = line[i];
+        const CharClass cls = classOf(c);
+        if (cls == kSpace) {
+            ++i;
+            continue;
+        }
+
+        const size_t start = i;
+        switch (cls) {
+            case kIdentifier: {
+                while (i < n && isIdentifierChar(line[i])) ++i;
+                const std::u16string_view word = line.substr(start, i - start);
+
+                // String and character literals with an encoding prefix
+                if (i < n && (line[i] == u'"' || line[i] == u'\'') && isStringPrefix(word)) {
+                    if (word.back() == u'R' && line[i] == u'"') {
+                        const size_t open = line.find(u'(', i + 1);
+                        if (open != std::u16string_view::npos && open - i - 1 <= kMaxRawDelimiter) {
+                            const uint32_t hash = delimiterHash(line.substr(i + 1, open - i - 1));
+                            const size_t end = findRawStringEnd(line, open + 1, hash);
+                            if (end == std::u16string_view::npos) {
+                                pushToken(tokens, start, n, TokenKind::String);
+                                return rawStringState(hash);
+                            }
+                            pushToken(tokens, start, end, TokenKind::String);
+                            i = end;
+                            break;
+                        }
+                    }
+                    i = skipQuoted(line, i + 1, line[i]);
+                    pushToken(tokens, start, i, TokenKind::String);
+                    break;
+                }
+
+                if (isKeyword(word)) {
+                    pushToken(tokens, start, i, TokenKind::Keyword);
+                    break;
+                }
+                size_t next = i;
+                while (next < n && classOf(line[next]) == kSpace) ++next;
+                if (next < n && line[next] == u'(') {
+                    pushToken(tokens, start, i, TokenKind::Function);
+                } else if (c >= u'A' && c <= u'Z') {
+                    pushToken(tokens, start, i, TokenKind::Type);
+                }
+                break;
+            }
+            case kDot:
+                if (i + 1 >= n || classOf(line[i + 1]) != kDigit) {
+                    ++i;
+                    break;
+                }
+                [[fallthrough]];
+            case kDigit: {
+                i = scanPpNumber(line, i + 1, u'\'', isIdentifierChar);
+                pushToken(tokens, start, i, TokenKind::Number);
+                break;
+            }
+            case kDoubleQuote:
+            case kSingleQuote:
+                i = skipQuoted(line, i + 1, c);
+                pushToken(tokens, start, i, TokenKind::String);
+                break;
+            case kSlash:
+                if (i + 1 < n && line[i + 1] == u'/') {
+                    pushToken(tokens, start, n, TokenKind::Comment);
+                    return kStateNormal;
+                }
+                if (i + 1 < n && line[i + 1] == u'*') {
+                    const size_t end = line.find(u"*/", i + 2);
+                    if (end == std::u16string_view::npos) {
+                        pushToken(tokens, start, n, TokenKind::Comment);
+                        return kStateBlockComment;
+                    }
+                    i = end + 2;
+                    pushToken(tokens, start, i, TokenKind::Comment);
+                    break;
+                }
+                ++i;
+                break;
+            case kHash: {
+                ++i;
+                if (!lineStart) break;
+                while (i < n && classOf(line[i]) == kSpace) ++i;
+                const size_t nameStart = i;
+                while (i < n && isIdentifierChar(line[i])) ++i;
+                pushToken(tokens, start, i, TokenKind::Preprocessor);
+
+                // <header> in an include reads as a string
+                const std::u16string_view directive = line.substr(nameStart, i - nameStart);
+                if (directive == u"include" || directive == u"include_next" || directive == u"import") {
+                    while (i < n && classOf(line[i]) == kSpace) ++i;
+                    if (i < n && line[i] == u'<') {
+                        const size_t close = line.find(u'>', i + 1);
+                        const size_t end = close == std::u16string_view::npos ? n : close + 1;
+                        pushToken(tokens, i, end, TokenKind::String);
+                        i = end;
+                    }
+                }
+                break;
+            }
+            default:
+                ++i;
+                break;
+        }
+        lineStart = false;
+    }
+    return kStateNormal;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include "features/grammar.hpp"
+
+namespace xenon::features {
+
+// Classifies C++ source one line at a time in a single left-to-right pass.
+// Each character's class comes from a lookup table and keywords from a
+// perfect hash built at compile time. Constructs that span lines (block
+// comments, raw strings) are carried in the integer state returned for
+// each line and passed in for the next, so the lexer itself is stateless
+// and safe to share between threads. Grammars hand C++ to it with the
+// `lexer cpp` directive.
+class CppLexer {
+public:
+    // Low bits of a line state; a raw string also stores a hash of its
+    // delimiter in the upper bits so the closing )delim" can be recognised.
+    // A packed state always fits in a non-negative int: SyntaxHighlighter
+    // stores it as the block's userState, where negative means not lexed
+    // yet, and the async lexer starts from 0 in place of a negative state.
+    static constexpr int kStateNormal = 0;
+    static constexpr int kStateBlockComment = 1;
+    static constexpr int kStateRawString = 2;
+    static constexpr int kStateModeMask = 0xff;
+
+    // Appends the tokens of line (plain text and operators are not
+    // reported) and returns the state at its end.
+    static int lexLine(std::u16string_view line, int state, std::vector<Token>& tokens);
+
+    static bool isKeyword(std::u16string_view word);
+};
+
+} // namespace xenon::features
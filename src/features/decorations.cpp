@@ -0,0 +1,66 @@
+#include "features/decorations.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+void DecorationSet::assign(std::vector<DecorationRange> ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const DecorationRange& a, const DecorationRange& b) {
+        return a.start < b.start;
+    });
+
+    ranges_.clear();
+    ranges_.reserve(ranges.size());
+    for (const DecorationRange& range : ranges) {
+        if (range.end <= range.start) continue;
+        if (!ranges_.empty() && range.start <= ranges_.back().end) {
+            ranges_.back().end = std::max(ranges_.back().end, range.end);
+            continue;
+        }
+        ranges_.push_back(range);
+    }
+}
+
+std::pair<size_t, size_t> DecorationSet::overlapping(int start, int end) const {
+    // Disjoint and sorted, so the ends are sorted as well
+    const auto first = std::partition_point(ranges_.begin(), ranges_.end(),
+                                            [start](const DecorationRange& r) { return r.end <= start; });
+    const auto last = std::partition_point(first, ranges_.end(),
+                                           [end](const DecorationRange& r) { return r.start < end; });
+    return {static_cast<size_t>(first - ranges_.begin()), static_cast<size_t>(last - ranges_.begin())};
+}
+
+void DecorationSet::applyChange(int position, int removed, int added) {
+    if (ranges_.empty()) return;
+    const int changeEnd = position + removed;
+    const int delta = added - removed;
+    // Text typed at a range's start pushes it along, at its end leaves it
+    auto moveStart = [&](int offset) {
+        if (offset < position) return offset;
+        return offset >= changeEnd ? offset + delta : position + added;
+    };
+    auto moveEnd = [&](int offset) {
+        if (offset <= position) return offset;
+        return offset >= changeEnd ? offset + delta : position;
+    };
+
+    // Both moves keep the order, and a range never passes the next one's
+    // start, so the set stays sorted and disjoint
+    const auto begin = std::partition_point(ranges_.begin(), ranges_.end(),
+                                            [position](const DecorationRange& r) { return r.end < position; });
+    auto out = begin;
+    for (auto it = begin; it != ranges_.end(); ++it) {
+        const DecorationRange moved{moveStart(it->start), moveEnd(it->end)};
+        if (moved.end > moved.start) *out++ = moved;
+    }
+    ranges_.erase(out, ranges_.end());
+}
+
+bool DecorationLayer::empty() const {
+    return std::all_of(sets_.begin(), sets_.end(), [](const DecorationSet& set) { return set.empty(); });
+}
+
+void DecorationLayer::applyChange(int position, int removed, int added) {
+    for (DecorationSet& set : sets_) set.applyChange(position, removed, added);
+}
+
+} // namespace xenon::features
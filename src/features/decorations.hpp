@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace xenon::features {
+
+// What a decoration marks; they are painted in this order, so later kinds
+// end up on top
+enum class DecorationKind {
+    // The symbol under the cursor, and where it is written to
+    Occurrence,
+    WriteOccurrence,
+    SearchMatch,
+    BracketMatch,
+    Count,
+};
+
+// Positions start..end (exclusive) of the document, as UTF-16 offsets
+struct DecorationRange {
+    int start = 0;
+    int end = 0;
+};
+
+// Ranges of one kind, sorted and disjoint. The ones in view are found by a
+// binary search, so painting costs about the number on screen however many
+// there are.
+class DecorationSet {
+public:
+    // Sorts, merges the ones that overlap and drops empty ones
+    void assign(std::vector<DecorationRange> ranges);
+    void clear() { ranges_.clear(); }
+
+    const std::vector<DecorationRange>& ranges() const { return ranges_; }
+    bool empty() const { return ranges_.empty(); }
+
+    // Indices first..last (exclusive) of the ranges touching start..end
+    std::pair<size_t, size_t> overlapping(int start, int end) const;
+
+    // Follows removed characters at position being replaced by added ones.
+    // Ranges after the change move with it, ones inside it shrink and the
+    // ones it swallows whole are dropped.
+    void applyChange(int position, int removed, int added);
+
+private:
+    std::vector<DecorationRange> ranges_;
+};
+
+// The decorations of a document, one set per kind, looked up at paint time
+// for the area being painted rather than handed to the view as a list of
+// selections on every change.
+class DecorationLayer {
+public:
+    static constexpr size_t kKindCount = static_cast<size_t>(DecorationKind::Count);
+
+    void set(DecorationKind kind, std::vector<DecorationRange> ranges) { at(kind).assign(std::move(ranges)); }
+    void clear(DecorationKind kind) { at(kind).clear(); }
+    const DecorationSet& get(DecorationKind kind) const { return sets_[static_cast<size_t>(kind)]; }
+    bool empty() const;
+
+    void applyChange(int position, int removed, int added);
+
+private:
+    DecorationSet& at(DecorationKind kind) { return sets_[static_cast<size_t>(kind)]; }
+
+    std::array<DecorationSet, kKindCount> sets_;
+};
+
+} // namespace xenon::features
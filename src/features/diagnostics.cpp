@@ -0,0 +1,80 @@
+#include "features/diagnostics.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+void DiagnosticSet::assign(std::vector<Diagnostic> diagnostics) {
+    diagnostics_ = std::move(diagnostics);
+    for (Diagnostic& d : diagnostics_) {
+        // Servers do send ranges that end before they start
+        if (d.endLine < d.line || (d.endLine == d.line && d.endCol < d.col)) {
+            d.endLine = d.line;
+            d.endCol = d.col;
+        }
+        d.severity = static_cast<DiagnosticSeverity>(std::clamp(static_cast<int>(d.severity), 1, 4));
+    }
+    std::stable_sort(diagnostics_.begin(), diagnostics_.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        return a.line != b.line ? a.line < b.line : a.col < b.col;
+    });
+    reindex();
+}
+
+void DiagnosticSet::clear() {
+    diagnostics_.clear();
+    reindex();
+}
+
+void DiagnosticSet::reindex() {
+    std::fill(std::begin(counts_), std::end(counts_), 0);
+    leaves_ = 1;
+    while (leaves_ < diagnostics_.size()) leaves_ *= 2;
+    max_end_.assign(2 * leaves_, -1);
+    for (size_t i = 0; i < diagnostics_.size(); ++i) {
+        max_end_[leaves_ + i] = diagnostics_[i].endLine;
+        counts_[static_cast<size_t>(diagnostics_[i].severity) - 1]++;
+    }
+    for (size_t node = leaves_ - 1; node > 0; --node) {
+        max_end_[node] = std::max(max_end_[2 * node], max_end_[2 * node + 1]);
+    }
+}
+
+void DiagnosticSet::collect(size_t node, size_t begin, size_t end, size_t limit, int firstLine,
+                            std::vector<size_t>& result) const {
+    if (begin >= limit || max_end_[node] < firstLine) return;
+    if (node >= leaves_) {
+        result.push_back(begin);
+        return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    collect(2 * node, begin, middle, limit, firstLine, result);
+    collect(2 * node + 1, middle, end, limit, firstLine, result);
+}
+
+std::vector<size_t> DiagnosticSet::overlapping(int firstLine, int lastLine) const {
+    std::vector<size_t> result;
+    const auto end = std::upper_bound(diagnostics_.begin(), diagnostics_.end(), lastLine,
+                                      [](int line, const Diagnostic& d) { return line < d.line; });
+    collect(1, 0, leaves_, static_cast<size_t>(end - diagnostics_.begin()), firstLine, result);
+    return result;
+}
+
+void DiagnosticSet::applyEdit(int firstLine, int oldLastLine, int lineDelta) {
+    if (lineDelta == 0 || diagnostics_.empty()) return;
+    // Keeps the order: lines after the edit stay after the new lines
+    const int newLastLine = std::max(firstLine, oldLastLine + lineDelta);
+    auto move = [&](int line) {
+        if (line > oldLastLine) return line + lineDelta;
+        if (line >= firstLine) return std::min(line, newLastLine);
+        return line;
+    };
+
+    // Lines before the edit stay where they are; the tree is rebuilt
+    // anyway, so there is nothing to gain from skipping them
+    for (Diagnostic& d : diagnostics_) {
+        d.line = move(d.line);
+        d.endLine = move(d.endLine);
+    }
+    reindex();
+}
+
+} // namespace xenon::features
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace xenon::features {
+
+// LSP severities; lower is more severe
+enum class DiagnosticSeverity {
+    Error = 1,
+    Warning = 2,
+    Information = 3,
+    Hint = 4,
+};
+
+struct Diagnostic {
+    int line = 0;
+    int col = 0;    // UTF-16 offset in the line
+    int endLine = 0;
+    int endCol = 0; // exclusive
+    DiagnosticSeverity severity = DiagnosticSeverity::Error;
+    std::string message;
+    std::string source;
+};
+
+// The diagnostics of one file, sorted by start, over an implicit binary
+// tree keeping the largest end line under each node. The ones touching a
+// run of lines start no later than its last line, found by a binary
+// search, and among those the tree is only descended where some end line
+// reaches the run. Painting the visible lines costs O(log n) per
+// diagnostic on them, however many the file has and however far the ones
+// above them span.
+class DiagnosticSet {
+public:
+    void assign(std::vector<Diagnostic> diagnostics);
+    void clear();
+
+    const std::vector<Diagnostic>& all() const { return diagnostics_; }
+    bool empty() const { return diagnostics_.empty(); }
+    size_t count(DiagnosticSeverity severity) const {
+        return counts_[static_cast<size_t>(severity) - 1];
+    }
+
+    // Indices of the diagnostics touching lines firstLine..lastLine, in order
+    std::vector<size_t> overlapping(int firstLine, int lastLine) const;
+
+    // Lines firstLine..oldLastLine were replaced, leaving lineDelta more
+    // lines. Diagnostics after them move with their lines; ones in them are
+    // pulled inside the new lines until the server sends fresh ones.
+    void applyEdit(int firstLine, int oldLastLine, int lineDelta);
+
+private:
+    void reindex();
+    // Appends the diagnostics under node, which covers indices
+    // begin..end - 1, that come before limit and end on firstLine or later
+    void collect(size_t node, size_t begin, size_t end, size_t limit, int firstLine,
+                 std::vector<size_t>& result) const;
+
+    std::vector<Diagnostic> diagnostics_;
+    // Node 1 is the root and node k has children 2k and 2k + 1; the
+    // leaves, from leaves_ on, are the diagnostics' end lines, padded with -1
+    std::vector<int> max_end_;
+    size_t leaves_ = 0;
+    size_t counts_[4] = {};
+};
+
+} // namespace xenon::features
@@ -0,0 +1,341 @@
+#include "features/file_index.hpp"
+#include "features/workspace_walker.hpp"
+#include <mutex>
+#include <sys/stat.h>
+
+namespace xenon::features {
+
+namespace {
+
+struct Listing {
+    std::mutex mutex;
+    std::vector<std::string> files;
+    std::vector<std::string> directories;
+};
+
+void list(const std::string& root, const std::string& start, bool recursive, const std::atomic<bool>& cancelled,
+          Listing& listing) {
+    WalkOptions options;
+    options.startDirectory = start;
+    options.recursive = recursive;
+    WorkspaceWalker::walk(root, [&listing](const std::string& relativePath, const std::string&) {
+        std::lock_guard<std::mutex> lock(listing.mutex);
+        listing.files.push_back(relativePath);
+    }, cancelled, options, [&listing](const std::string& relativePath) {
+        std::lock_guard<std::mutex> lock(listing.mutex);
+        listing.directories.push_back(relativePath);
+    });
+}
+
+std::string_view lastComponent(std::string_view path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+} // anonymous namespace
+
+FileIndex::FileIndex() {
+    reset();
+}
+
+void FileIndex::reset() {
+    nodes_.clear();
+    free_nodes_.clear();
+    children_.clear();
+    names_.clear();
+    name_ids_.clear();
+    file_count_ = 0;
+
+    intern(""); // the root's name
+    Node root;
+    root.isDirectory = true;
+    nodes_.push_back(root);
+}
+
+void FileIndex::build(const std::string& root, const std::atomic<bool>& cancelled) {
+    Listing listing;
+    list(root, "", true, cancelled, listing);
+    if (cancelled) return;
+
+    // Assemble off-lock, then swap in so readers only ever wait for the swap
+    FileIndex fresh;
+    for (const auto& directory : listing.directories) fresh.ensureDirectory(directory);
+    for (const auto& file : listing.files) fresh.insertFile(file);
+    swapIn(fresh);
+}
+
+void FileIndex::assign(const std::vector<std::string>& files) {
+    FileIndex fresh;
+    for (const auto& file : files) fresh.insertFile(file);
+    swapIn(fresh);
+}
+
+void FileIndex::swapIn(FileIndex& fresh) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    nodes_.swap(fresh.nodes_);
+    free_nodes_.swap(fresh.free_nodes_);
+    children_.swap(fresh.children_);
+    names_.swap(fresh.names_);
+    name_ids_.swap(fresh.name_ids_);
+    file_count_ = fresh.file_count_;
+    generation_++;
+}
+
+FileIndex::DirectoryChanges FileIndex::rescanDirectory(const std::string& root,
+                                                       const std::string& relativeDirectory) {
+    DirectoryChanges changes;
+    const std::atomic<bool> cancelled{false};
+
+    struct stat st {};
+    const std::string absolute = relativeDirectory.empty() ? root : root + "/" + relativeDirectory;
+    if (::stat(absolute.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        const NodeId id = findPath(relativeDirectory);
+        if (id != kNone && id != kRoot) {
+            changes.removedDirectories.push_back(relativeDirectory);
+            removeNode(id);
+            changes.changed = true;
+            generation_++;
+        }
+        return changes;
+    }
+
+    Listing listing;
+    list(root, relativeDirectory, false, cancelled, listing);
+
+    std::vector<std::string> newDirectories;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        const NodeId dir = ensureDirectory(relativeDirectory);
+
+        std::unordered_map<std::string_view, bool> listed; // name -> isDirectory
+        for (const auto& file : listing.files) listed.emplace(lastComponent(file), false);
+        for (const auto& directory : listing.directories) listed.emplace(lastComponent(directory), true);
+
+        // Drop children that vanished (or changed between file and directory)
+        for (NodeId child = nodes_[dir].firstChild; child != kNone;) {
+            const NodeId next = nodes_[child].nextSibling;
+            auto it = listed.find(names_[nodes_[child].name]);
+            if (it == listed.end() || it->second != nodes_[child].isDirectory) {
+                if (nodes_[child].isDirectory) changes.removedDirectories.push_back(pathOf(child));
+                removeNode(child);
+                changes.changed = true;
+            }
+            child = next;
+        }
+
+        for (const auto& file : listing.files) {
+            if (findChild(dir, lastComponent(file)) == kNone) {
+                insertFile(file);
+                changes.changed = true;
+            }
+        }
+        for (const auto& directory : listing.directories) {
+            if (findChild(dir, lastComponent(directory)) == kNone) {
+                ensureDirectory(directory);
+                newDirectories.push_back(directory);
+                changes.changed = true;
+            }
+        }
+    }
+
+    // New subtrees (e.g. a checkout or an unpacked archive) are walked
+    // without holding the lock
+    for (const auto& directory : newDirectories) {
+        Listing subtree;
+        list(root, directory, true, cancelled, subtree);
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        changes.addedDirectories.push_back(directory);
+        for (const auto& sub : subtree.directories) {
+            ensureDirectory(sub);
+            changes.addedDirectories.push_back(sub);
+        }
+        for (const auto& file : subtree.files) insertFile(file);
+    }
+
+    if (changes.changed) generation_++;
+    return changes;
+}
+
+void FileIndex::addFile(const std::string& relativePath) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    const size_t before = file_count_;
+    insertFile(relativePath);
+    if (file_count_ != before) generation_++;
+}
+
+bool FileIndex::removePath(const std::string& relativePath) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    const NodeId id = findPath(relativePath);
+    if (id == kNone || id == kRoot) return false;
+    removeNode(id);
+    generation_++;
+    return true;
+}
+
+size_t FileIndex::fileCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return file_count_;
+}
+
+size_t FileIndex::nameCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return names_.size();
+}
+
+void FileIndex::forEachFile(const std::function<void(const std::string& relativePath)>& visit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // Depth-first with one path buffer: entering a node appends its name,
+    // leaving truncates back to the parent's length
+    std::string path;
+    std::vector<std::pair<NodeId, size_t>> stack; // node, parent path length
+    for (NodeId child = nodes_[kRoot].firstChild; child != kNone; child = nodes_[child].nextSibling) {
+        stack.emplace_back(child, 0);
+    }
+    while (!stack.empty()) {
+        const auto [id, parentLength] = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes_[id];
+        path.resize(parentLength);
+        if (parentLength > 0) path += '/';
+        path += names_[node.name];
+
+        if (node.isDirectory) {
+            for (NodeId child = node.firstChild; child != kNone; child = nodes_[child].nextSibling) {
+                stack.emplace_back(child, path.size());
+            }
+        } else {
+            visit(path);
+        }
+    }
+}
+
+std::vector<std::string> FileIndex::directories() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // Breadth-first, so a caller that can only follow some of them gets
+    // the shallow ones
+    std::vector<std::string> result;
+    std::vector<NodeId> queue{kRoot};
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const NodeId id = queue[i];
+        if (id != kRoot) result.push_back(pathOf(id));
+        for (NodeId child = nodes_[id].firstChild; child != kNone; child = nodes_[child].nextSibling) {
+            if (nodes_[child].isDirectory) queue.push_back(child);
+        }
+    }
+    return result;
+}
+
+uint32_t FileIndex::intern(std::string_view name) {
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end()) return it->second;
+
+    const auto id = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(name);
+    name_ids_.emplace(names_.back(), id);
+    return id;
+}
+
+FileIndex::NodeId FileIndex::findChild(NodeId parent, std::string_view name) const {
+    auto nameIt = name_ids_.find(name);
+    if (nameIt == name_ids_.end()) return kNone;
+    auto it = children_.find(childKey(parent, nameIt->second));
+    return it == children_.end() ? kNone : it->second;
+}
+
+FileIndex::NodeId FileIndex::findPath(std::string_view relativePath) const {
+    NodeId id = kRoot;
+    while (!relativePath.empty() && id != kNone) {
+        const size_t slash = relativePath.find('/');
+        id = findChild(id, relativePath.substr(0, slash));
+        relativePath = slash == std::string_view::npos ? std::string_view() : relativePath.substr(slash + 1);
+    }
+    return id;
+}
+
+FileIndex::NodeId FileIndex::ensureChild(NodeId parent, std::string_view name, bool isDirectory) {
+    const uint32_t nameId = intern(name);
+    auto it = children_.find(childKey(parent, nameId));
+    if (it != children_.end()) return it->second;
+
+    NodeId id;
+    if (!free_nodes_.empty()) {
+        id = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        id = static_cast<NodeId>(nodes_.size());
+        nodes_.emplace_back();
+    }
+
+    Node& node = nodes_[id];
+    node = Node{};
+    node.name = nameId;
+    node.parent = parent;
+    node.isDirectory = isDirectory;
+    node.nextSibling = nodes_[parent].firstChild;
+    if (node.nextSibling != kNone) nodes_[node.nextSibling].prevSibling = id;
+    nodes_[parent].firstChild = id;
+
+    children_.emplace(childKey(parent, nameId), id);
+    if (!isDirectory) file_count_++;
+    return id;
+}
+
+FileIndex::NodeId FileIndex::ensureDirectory(std::string_view relativePath) {
+    NodeId id = kRoot;
+    while (!relativePath.empty()) {
+        const size_t slash = relativePath.find('/');
+        id = ensureChild(id, relativePath.substr(0, slash), true);
+        relativePath = slash == std::string_view::npos ? std::string_view() : relativePath.substr(slash + 1);
+    }
+    return id;
+}
+
+void FileIndex::insertFile(std::string_view relativePath) {
+    const size_t slash = relativePath.rfind('/');
+    const NodeId parent = slash == std::string_view::npos ? kRoot : ensureDirectory(relativePath.substr(0, slash));
+    ensureChild(parent, slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1), false);
+}
+
+void FileIndex::removeNode(NodeId id) {
+    // Unlink from the parent first, then free the whole subtree
+    Node& node = nodes_[id];
+    if (node.prevSibling != kNone) {
+        nodes_[node.prevSibling].nextSibling = node.nextSibling;
+    } else {
+        nodes_[node.parent].firstChild = node.nextSibling;
+    }
+    if (node.nextSibling != kNone) nodes_[node.nextSibling].prevSibling = node.prevSibling;
+
+    std::vector<NodeId> stack{id};
+    while (!stack.empty()) {
+        const NodeId current = stack.back();
+        stack.pop_back();
+        const Node& n = nodes_[current];
+        for (NodeId child = n.firstChild; child != kNone; child = nodes_[child].nextSibling) {
+            stack.push_back(child);
+        }
+        children_.erase(childKey(n.parent, n.name));
+        if (!n.isDirectory) file_count_--;
+        free_nodes_.push_back(current);
+    }
+}
+
+std::string FileIndex::pathOf(NodeId id) const {
+    std::vector<NodeId> chain;
+    for (NodeId current = id; current != kRoot && current != kNone; current = nodes_[current].parent) {
+        chain.push_back(current);
+    }
+    std::string path;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if (!path.empty()) path += '/';
+        path += names_[nodes_[*it].name];
+    }
+    return path;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xenon::features {
+
+// The workspace's file list as a tree of interned path components. Each
+// node stores a name id and links to its parent and siblings, and each
+// distinct name is stored once, so memory grows with the number of unique
+// components rather than with full path strings. Readers and writers may
+// be on different threads.
+class FileIndex {
+public:
+    struct DirectoryChanges {
+        std::vector<std::string> addedDirectories;
+        std::vector<std::string> removedDirectories;
+        bool changed = false;
+    };
+
+    FileIndex();
+
+    FileIndex(const FileIndex&) = delete;
+    FileIndex& operator=(const FileIndex&) = delete;
+
+    // Replaces the contents with a full walk of root. Blocks; on
+    // cancellation the index is left unchanged.
+    void build(const std::string& root, const std::atomic<bool>& cancelled);
+    // Replaces the contents with a ready-made file list, e.g. from the git
+    // index. Directories are derived from the file paths.
+    void assign(const std::vector<std::string>& files);
+
+    // Re-lists one directory (not its subtree) and applies the difference.
+    // New subdirectories are walked in full.
+    DirectoryChanges rescanDirectory(const std::string& root, const std::string& relativeDirectory);
+
+    void addFile(const std::string& relativePath);
+    // Removes a file or a directory with everything below it.
+    bool removePath(const std::string& relativePath);
+
+    size_t fileCount() const;
+    size_t nameCount() const;
+    // Bumped by every change, so consumers can tell whether to re-read
+    uint64_t generation() const { return generation_; }
+
+    // Visits every file path. The path buffer is reused between calls.
+    void forEachFile(const std::function<void(const std::string& relativePath)>& visit) const;
+    std::vector<std::string> directories() const;
+
+private:
+    using NodeId = uint32_t;
+    static constexpr NodeId kNone = UINT32_MAX;
+    static constexpr NodeId kRoot = 0;
+
+    struct Node {
+        uint32_t name = 0;
+        NodeId parent = kNone;
+        NodeId firstChild = kNone;
+        NodeId prevSibling = kNone;
+        NodeId nextSibling = kNone;
+        bool isDirectory = false;
+    };
+
+    void reset();
+    void swapIn(FileIndex& fresh);
+    uint32_t intern(std::string_view name);
+    NodeId findChild(NodeId parent, std::string_view name) const;
+    NodeId findPath(std::string_view relativePath) const;
+    NodeId ensureChild(NodeId parent, std::string_view name, bool isDirectory);
+    NodeId ensureDirectory(std::string_view relativePath);
+    void insertFile(std::string_view relativePath);
+    void removeNode(NodeId id);
+    std::string pathOf(NodeId id) const;
+
+    static uint64_t childKey(NodeId parent, uint32_t name) { return (uint64_t{parent} << 32) | name; }
+
+    std::vector<Node> nodes_;
+    std::vector<NodeId> free_nodes_;
+    std::unordered_map<uint64_t, NodeId> children_;
+    size_t file_count_ = 0;
+
+    // Interned names; the deque keeps views into it stable
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, uint32_t> name_ids_;
+
+    mutable std::shared_mutex mutex_;
+    std::atomic<uint64_t> generation_{0};
+};
+
+} // namespace xenon::features
@@ -0,0 +1,292 @@
+#include "features/folding.hpp"
+#include "features/bracket_index.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace xenon::features {
+
+namespace {
+
+struct OpenBracket {
+    char16_t close;
+    int line;
+};
+
+char16_t closerOf(char16_t c) {
+    switch (c) {
+    case u'{': return u'}';
+    case u'[': return u']';
+    case u'(': return u')';
+    default: return 0;
+    }
+}
+
+} // anonymous namespace
+
+std::vector<FoldRange> computeFoldRanges(const BracketIndex& brackets) {
+    // End line of the range starting on each line, bracket ranges first
+    std::vector<int> ends;
+    ends.reserve(static_cast<size_t>(brackets.lineCount()));
+    std::vector<OpenBracket> open;
+
+    // Indented blocks still open: start line and its indent
+    std::vector<std::pair<int, int>> indents;
+    std::vector<std::pair<int, int>> indentRanges;
+    int lastNonBlank = -1;
+
+    auto closeIndents = [&](int indent) {
+        while (!indents.empty() && indents.back().second >= indent) {
+            if (lastNonBlank > indents.back().first) indentRanges.emplace_back(indents.back().first, lastNonBlank);
+            indents.pop_back();
+        }
+    };
+
+    brackets.forEachLine([&](int lineNumber, const std::vector<Bracket>& lineBrackets, LineIndent indent) {
+        ends.push_back(-1);
+        if (indent.column >= 0) {
+            closeIndents(indent.width);
+            indents.emplace_back(lineNumber, indent.width);
+            lastNonBlank = lineNumber;
+        }
+
+        for (const Bracket& bracket : lineBrackets) {
+            if (const char16_t close = closerOf(bracket.ch)) {
+                open.push_back({close, lineNumber});
+                continue;
+            }
+            auto match = std::find_if(open.rbegin(), open.rend(),
+                                      [&](const OpenBracket& b) { return b.close == bracket.ch; });
+            if (match == open.rend()) continue;
+            const int startLine = match->line;
+            open.erase(std::next(match).base(), open.end());
+
+            const int endLine = static_cast<int>(bracket.column) == indent.column ? lineNumber - 1 : lineNumber;
+            int& current = ends[static_cast<size_t>(startLine)];
+            if (endLine > startLine) current = std::max(current, endLine);
+        }
+    });
+    closeIndents(0);
+
+    for (const auto& [start, end] : indentRanges) {
+        int& current = ends[static_cast<size_t>(start)];
+        if (current < 0) current = end;
+    }
+
+    std::vector<FoldRange> ranges;
+    for (size_t line = 0; line < ends.size(); ++line) {
+        if (ends[line] >= 0) ranges.push_back({static_cast<int>(line), ends[line]});
+    }
+    return ranges;
+}
+
+void FoldingModel::setRanges(std::vector<FoldRange> ranges) {
+    std::vector<int> collapsedStarts;
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        if (collapsed_[i]) collapsedStarts.push_back(ranges_[i].startLine);
+    }
+
+    ranges_ = std::move(ranges);
+    collapsed_.assign(ranges_.size(), false);
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        collapsed_[i] = std::binary_search(collapsedStarts.begin(), collapsedStarts.end(), ranges_[i].startLine);
+    }
+    normalize();
+    rebuildHidden();
+}
+
+void FoldingModel::normalize() {
+    std::vector<size_t> order(ranges_.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        if (ranges_[a].startLine != ranges_[b].startLine) return ranges_[a].startLine < ranges_[b].startLine;
+        return ranges_[a].endLine > ranges_[b].endLine;
+    });
+
+    std::vector<FoldRange> ranges;
+    std::vector<bool> collapsed;
+    std::vector<int> parents;
+    std::vector<int> stack;
+    ranges.reserve(order.size());
+    for (size_t i : order) {
+        FoldRange range = ranges_[i];
+        if (range.startLine < 0) continue;
+        if (!ranges.empty() && ranges.back().startLine == range.startLine) {
+            // The widest range on a line wins; collapsing either collapses it
+            if (collapsed_[i]) collapsed.back() = true;
+            continue;
+        }
+
+        while (!stack.empty() && ranges[static_cast<size_t>(stack.back())].endLine < range.startLine) stack.pop_back();
+        const int parent = stack.empty() ? -1 : stack.back();
+        if (parent >= 0) range.endLine = std::min(range.endLine, ranges[static_cast<size_t>(parent)].endLine);
+        if (range.endLine <= range.startLine) continue;
+
+        stack.push_back(static_cast<int>(ranges.size()));
+        ranges.push_back(range);
+        collapsed.push_back(collapsed_[i]);
+        parents.push_back(parent);
+    }
+
+    ranges_ = std::move(ranges);
+    collapsed_ = std::move(collapsed);
+    parents_ = std::move(parents);
+}
+
+void FoldingModel::rebuildHidden() {
+    hidden_.clear();
+    hidden_before_.assign(1, 0);
+    // Ranges come outermost first, so a collapsed range inside a hidden
+    // span adds nothing
+    int coveredUntil = -1;
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        const FoldRange& range = ranges_[i];
+        if (!collapsed_[i] || range.startLine <= coveredUntil) continue;
+        hidden_.push_back({range.startLine + 1, range.endLine});
+        hidden_before_.push_back(hidden_before_.back() + range.endLine - range.startLine);
+        coveredUntil = range.endLine;
+    }
+}
+
+int FoldingModel::rangeAt(int line) const {
+    auto it = std::lower_bound(ranges_.begin(), ranges_.end(), line,
+                               [](const FoldRange& range, int l) { return range.startLine < l; });
+    return it != ranges_.end() && it->startLine == line ? static_cast<int>(it - ranges_.begin()) : -1;
+}
+
+int FoldingModel::rangeContaining(int line) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), line,
+                               [](int l, const FoldRange& range) { return l < range.startLine; });
+    int index = static_cast<int>(it - ranges_.begin()) - 1;
+    // Only the ranges enclosing the last one to start can reach further
+    while (index >= 0 && ranges_[static_cast<size_t>(index)].endLine < line) index = parents_[static_cast<size_t>(index)];
+    return index;
+}
+
+void FoldingModel::setCollapsed(int index, bool collapsed) {
+    if (collapsed_[static_cast<size_t>(index)] == collapsed) return;
+    collapsed_[static_cast<size_t>(index)] = collapsed;
+    rebuildHidden();
+}
+
+void FoldingModel::setAllCollapsed(bool collapsed) {
+    collapsed_.assign(ranges_.size(), collapsed);
+    rebuildHidden();
+}
+
+bool FoldingModel::reveal(int line) {
+    bool changed = false;
+    for (int index = rangeContaining(line); index >= 0; index = parents_[static_cast<size_t>(index)]) {
+        if (ranges_[static_cast<size_t>(index)].startLine < line && collapsed_[static_cast<size_t>(index)]) {
+            collapsed_[static_cast<size_t>(index)] = false;
+            changed = true;
+        }
+    }
+    if (changed) rebuildHidden();
+    return changed;
+}
+
+std::vector<LineSpan> FoldingModel::applyEdit(int firstLine, int oldLastLine, int lineDelta) {
+    const int newLastLine = oldLastLine + lineDelta;
+    std::vector<LineSpan> changed;
+    if (lineDelta != 0) {
+        // Where the applied spans are now, less the edited lines
+        std::vector<LineSpan> shifted;
+        for (const LineSpan& span : hidden_) {
+            if (span.first < firstLine) shifted.push_back({span.first, std::min(span.last, firstLine - 1)});
+            if (span.last > oldLastLine) {
+                shifted.push_back({std::max(span.first, oldLastLine + 1) + lineDelta, span.last + lineDelta});
+            }
+        }
+
+        for (FoldRange& range : ranges_) {
+            if (range.startLine > oldLastLine) {
+                range.startLine += lineDelta;
+            } else if (range.startLine > newLastLine) {
+                range.startLine = -1; // its line is gone
+            }
+            if (range.endLine > oldLastLine) {
+                range.endLine += lineDelta;
+            } else if (range.endLine >= firstLine) {
+                range.endLine = std::min(range.endLine, newLastLine);
+            }
+        }
+        normalize();
+        rebuildHidden();
+        changed = difference(shifted, hidden_);
+    }
+    changed.push_back({firstLine, newLastLine});
+    return changed;
+}
+
+int FoldingModel::spanAt(int line) const {
+    auto it = std::upper_bound(hidden_.begin(), hidden_.end(), line,
+                               [](int l, const LineSpan& span) { return l < span.first; });
+    if (it == hidden_.begin() || std::prev(it)->last < line) return -1;
+    return static_cast<int>(it - hidden_.begin()) - 1;
+}
+
+bool FoldingModel::isHidden(int line) const {
+    return spanAt(line) >= 0;
+}
+
+int FoldingModel::nextVisibleLine(int line) const {
+    const int span = spanAt(line);
+    return span < 0 ? line : hidden_[static_cast<size_t>(span)].last + 1;
+}
+
+int FoldingModel::visibleLine(int line) const {
+    auto it = std::upper_bound(hidden_.begin(), hidden_.end(), line,
+                               [](int l, const LineSpan& span) { return l < span.first; });
+    const size_t before = static_cast<size_t>(it - hidden_.begin());
+    if (before > 0 && hidden_[before - 1].last >= line) {
+        return hidden_[before - 1].first - 1 - hidden_before_[before - 1];
+    }
+    return line - hidden_before_[before];
+}
+
+int FoldingModel::lineAtVisible(int visibleLine) const {
+    // The line after span i sits at hidden_[i].first - hidden_before_[i]
+    // among visible lines; find how many spans come before visibleLine
+    size_t low = 0;
+    size_t high = hidden_.size();
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (hidden_[mid].first - hidden_before_[mid] <= visibleLine) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return visibleLine + hidden_before_[low];
+}
+
+std::vector<LineSpan> FoldingModel::difference(const std::vector<LineSpan>& a, const std::vector<LineSpan>& b) {
+    // Spans within each list are disjoint, so a line is in both lists or
+    // in one of them exactly when two or one spans cover it
+    std::vector<std::pair<int, int>> events;
+    events.reserve(2 * (a.size() + b.size()));
+    for (const auto* list : {&a, &b}) {
+        for (const LineSpan& span : *list) {
+            if (span.last < span.first) continue;
+            events.emplace_back(span.first, 1);
+            events.emplace_back(span.last + 1, -1);
+        }
+    }
+    std::sort(events.begin(), events.end());
+
+    std::vector<LineSpan> result;
+    int depth = 0;
+    for (size_t i = 0; i < events.size();) {
+        const int line = events[i].first;
+        const int before = depth;
+        for (; i < events.size() && events[i].first == line; ++i) depth += events[i].second;
+        if (before != 1 && depth == 1) {
+            result.push_back({line, line});
+        } else if (before == 1 && depth != 1) {
+            result.back().last = line - 1;
+        }
+    }
+    return result;
+}
+
+} // namespace xenon::features
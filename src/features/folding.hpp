@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace xenon::features {
+
+class BracketIndex;
+
+// Lines startLine + 1..endLine fold into startLine
+struct FoldRange {
+    int startLine;
+    int endLine;
+};
+
+// Inclusive run of lines
+struct LineSpan {
+    int first;
+    int last;
+};
+
+// Fold ranges for documents no language server covers, from the brackets
+// and indents the highlighter keeps: one per bracket pair ({}, [] and ())
+// spanning lines, and one per indented block. A closing bracket that
+// starts its line stays visible. The result is sorted by start line, with
+// one range per start line.
+std::vector<FoldRange> computeFoldRanges(const BracketIndex& brackets);
+
+// The fold ranges of a document, which of them are collapsed, and the map
+// between buffer lines and the lines left visible. Ranges are kept
+// properly nested (one crossing its enclosing range is cut to fit it), each
+// with its parent, so the innermost range around a line is a binary search
+// and a walk up the nesting.
+//
+// The lines hidden by collapsed ranges are kept as sorted, disjoint spans
+// with running counts of the lines hidden before each one, so mapping a
+// line either way is a binary search over the spans. They are rebuilt when
+// a range is collapsed or expanded, or when an edit changes the line count.
+class FoldingModel {
+public:
+    // Replaces the ranges. New ranges starting on the line of a collapsed
+    // one stay collapsed.
+    void setRanges(std::vector<FoldRange> ranges);
+    const std::vector<FoldRange>& ranges() const { return ranges_; }
+
+    // The range starting on line, -1 when none does
+    int rangeAt(int line) const;
+    // The innermost range whose lines include line, -1 when none do
+    int rangeContaining(int line) const;
+    // The innermost range around the one at index, -1 when none is
+    int parent(int index) const { return parents_[static_cast<size_t>(index)]; }
+    bool isCollapsed(int index) const { return collapsed_[static_cast<size_t>(index)]; }
+    void setCollapsed(int index, bool collapsed);
+    void setAllCollapsed(bool collapsed);
+    // Expands the collapsed ranges hiding line. Returns whether there were any.
+    bool reveal(int line);
+
+    // Lines firstLine..oldLastLine were replaced, leaving lineDelta more
+    // lines. Returns the lines (in the edited buffer) whose hidden state
+    // may no longer match what was applied.
+    std::vector<LineSpan> applyEdit(int firstLine, int oldLastLine, int lineDelta);
+
+    // Hidden lines as sorted, disjoint spans
+    const std::vector<LineSpan>& hiddenSpans() const { return hidden_; }
+    bool isHidden(int line) const;
+    // The first line from line on that isn't hidden
+    int nextVisibleLine(int line) const;
+    // The position of line among visible lines; a hidden line maps to the
+    // line its fold starts on
+    int visibleLine(int line) const;
+    // The buffer line at a position among visible lines
+    int lineAtVisible(int visibleLine) const;
+
+    // Lines hidden in exactly one of a and b
+    static std::vector<LineSpan> difference(const std::vector<LineSpan>& a, const std::vector<LineSpan>& b);
+
+private:
+    // Sorts, drops empty and duplicate ranges, cuts crossing ones and finds
+    // the parents; collapsed_ follows the ranges
+    void normalize();
+    void rebuildHidden();
+    // Index of the span containing line, or -1
+    int spanAt(int line) const;
+
+    std::vector<FoldRange> ranges_;
+    std::vector<bool> collapsed_;
+    std::vector<int> parents_; // -1 for top-level ranges
+
+    std::vector<LineSpan> hidden_;
+    std::vector<int> hidden_before_; // lines hidden in the spans before each
+};
+
+} // namespace xenon::features
@@ -0,0 +1,165 @@
+#include "features/frecency_store.hpp"
+#include "features/mapped_file.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr char kMagic[8] = {'X', 'E', 'F', 'R', 'E', 'C', '0', '1'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Boost = kBoostScale * log2(1 + score), at most kMaxBoost: one use is
+// worth about a consecutive-match bonus, and no history outweighs three
+// matched characters
+constexpr double kBoostScale = 8.0;
+constexpr int kMaxBoost = 48;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t count;
+};
+
+// Followed by keyLength bytes of key
+struct EntryRecord {
+    int64_t updated;
+    double score;
+    uint32_t keyLength;
+    uint32_t reserved;
+};
+
+} // anonymous namespace
+
+FrecencyStore::FrecencyStore(std::string path, int64_t halfLife, size_t capacity)
+    : path_(std::move(path)), half_life_(halfLife), capacity_(capacity) {}
+
+int64_t FrecencyStore::currentTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void FrecencyStore::ensureLoaded() const {
+    if (loaded_) return;
+    loaded_ = true;
+
+    MappedFile file(path_);
+    if (!file.isOpen() || file.size() < sizeof(FileHeader)) return;
+
+    const std::string_view data = file.view();
+    FileHeader header {};
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.byteOrder != kByteOrderMark) {
+        return;
+    }
+
+    size_t offset = sizeof(FileHeader);
+    entries_.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        EntryRecord record {};
+        if (data.size() - offset < sizeof(record)) break;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (data.size() - offset < record.keyLength) break;
+        entries_[std::string(data.substr(offset, record.keyLength))] = Entry{record.score, record.updated};
+        offset += record.keyLength;
+    }
+}
+
+double FrecencyStore::decayed(const Entry& entry, int64_t now) const {
+    const auto age = static_cast<double>(std::max<int64_t>(0, now - entry.updated));
+    return entry.score * std::exp2(-age / static_cast<double>(half_life_));
+}
+
+void FrecencyStore::record(const std::string& key, int64_t now) {
+    ensureLoaded();
+    Entry& entry = entries_[key];
+    entry.score = decayed(entry, now) + 1.0;
+    entry.updated = now;
+    dirty_ = true;
+    generation_++;
+
+    if (entries_.size() > capacity_) {
+        prune(now);
+    }
+}
+
+void FrecencyStore::prune(int64_t now) {
+    // Drop the weakest tenth at once so pruning is not paid on every record
+    std::vector<std::pair<double, const std::string*>> ranked;
+    ranked.reserve(entries_.size());
+    for (const auto& [key, entry] : entries_) {
+        ranked.emplace_back(decayed(entry, now), &key);
+    }
+    const size_t drop = entries_.size() - capacity_ + capacity_ / 10;
+    std::nth_element(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(drop), ranked.end());
+
+    std::vector<std::string> victims;
+    victims.reserve(drop);
+    for (size_t i = 0; i < drop; ++i) victims.push_back(*ranked[i].second);
+    for (const auto& key : victims) entries_.erase(key);
+}
+
+double FrecencyStore::score(const std::string& key, int64_t now) const {
+    ensureLoaded();
+    auto it = entries_.find(key);
+    return it == entries_.end() ? 0.0 : decayed(it->second, now);
+}
+
+int FrecencyStore::boost(const std::string& key, int64_t now) const {
+    const double value = score(key, now);
+    if (value <= 0) return 0;
+    return std::min(kMaxBoost, static_cast<int>(std::lround(kBoostScale * std::log2(1.0 + value))));
+}
+
+std::unordered_map<std::string, int> FrecencyStore::boosts(std::string_view prefix, int64_t now) const {
+    ensureLoaded();
+    std::unordered_map<std::string, int> result;
+    for (const auto& [key, entry] : entries_) {
+        if (key.size() <= prefix.size() || key.compare(0, prefix.size(), prefix) != 0) continue;
+        const int value = boost(key, now);
+        if (value > 0) result.emplace(key.substr(prefix.size()), value);
+    }
+    return result;
+}
+
+bool FrecencyStore::save() {
+    if (!dirty_) return true;
+
+    const std::string tempPath = path_ + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        FileHeader header {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.byteOrder = kByteOrderMark;
+        header.count = static_cast<uint32_t>(entries_.size());
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& [key, entry] : entries_) {
+            const EntryRecord record{entry.updated, entry.score, static_cast<uint32_t>(key.size()), 0};
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            out.write(key.data(), static_cast<std::streamsize>(key.size()));
+        }
+        if (!out.good()) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), path_.c_str()) != 0) {
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+} // namespace xenon::features
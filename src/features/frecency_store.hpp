@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace xenon::features {
+
+// Remembers how often and how recently keys (file paths, command names)
+// were used. Each use adds one to a score that halves every `halfLife`
+// seconds, so an entry's weight is the sum of its uses decayed by age.
+// Only the score and the time it was last brought up to date are kept per
+// key. The file is read on first use and written back by save(). Not
+// thread-safe.
+class FrecencyStore {
+public:
+    static constexpr int64_t kDefaultHalfLife = 7 * 24 * 60 * 60;
+    static constexpr size_t kDefaultCapacity = 2000;
+
+    explicit FrecencyStore(std::string path, int64_t halfLife = kDefaultHalfLife,
+                           size_t capacity = kDefaultCapacity);
+
+    void record(const std::string& key, int64_t now = currentTime());
+    double score(const std::string& key, int64_t now = currentTime()) const;
+
+    // Score bonus for the fuzzy matcher: grows with the log of the decayed
+    // score and is capped so frecency reorders close matches without
+    // overriding much better ones.
+    int boost(const std::string& key, int64_t now = currentTime()) const;
+    // Boosts for every key starting with prefix, keyed by the remainder
+    std::unordered_map<std::string, int> boosts(std::string_view prefix, int64_t now = currentTime()) const;
+
+    // Bumped by every record(), so consumers can tell when boosts are stale
+    uint64_t generation() const { return generation_; }
+
+    // Writes the store if it changed since it was loaded. Returns false on
+    // a write error.
+    bool save();
+
+    static int64_t currentTime();
+
+private:
+    struct Entry {
+        double score = 0;
+        int64_t updated = 0;
+    };
+
+    void ensureLoaded() const;
+    double decayed(const Entry& entry, int64_t now) const;
+    void prune(int64_t now);
+
+    std::string path_;
+    int64_t half_life_;
+    size_t capacity_;
+
+    mutable std::unordered_map<std::string, Entry> entries_;
+    mutable bool loaded_ = false;
+    bool dirty_ = false;
+    uint64_t generation_ = 0;
+};
+
+} // namespace xenon::features
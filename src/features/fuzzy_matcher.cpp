@@ -0,0 +1,410 @@
+#include "features/fuzzy_matcher.hpp"
+#include "features/thread_pool.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace xenon::features {
+
+namespace {
+
+// fzf's scoring constants: a boundary bonus is worth half a match, a camel
+// case bonus slightly less, and a consecutive run at least cancels the gap
+// it avoids.
+constexpr int kScoreMatch = 16;
+constexpr int kScoreGapStart = -3;
+constexpr int kScoreGapExtension = -1;
+constexpr int kBonusBoundary = kScoreMatch / 2;
+constexpr int kBonusPathSeparator = kBonusBoundary + 1;
+constexpr int kBonusCamel = kBonusBoundary + kScoreGapExtension;
+constexpr int kBonusConsecutive = -(kScoreGapStart + kScoreGapExtension);
+constexpr int kBonusFirstCharMultiplier = 2;
+
+constexpr int kNegative = INT_MIN / 4;
+
+constexpr size_t kChunkSize = 16384;
+
+enum CharClass : uint8_t { Lower, Upper, Digit, Delimiter, Separator, Other, ClassCount };
+
+constexpr CharClass classify(unsigned char c) {
+    if (c >= 'a' && c <= 'z') return Lower;
+    if (c >= 'A' && c <= 'Z') return Upper;
+    if (c >= '0' && c <= '9') return Digit;
+    if (c == '/' || c == '\\') return Separator;
+    if (c == ' ' || c == '_' || c == '-' || c == '.' || c == ':' || c == ',') return Delimiter;
+    // Non-ASCII bytes count as word characters
+    return c >= 0x80 ? Lower : Other;
+}
+
+constexpr int boundaryBonus(CharClass previous, CharClass current) {
+    if (current != Lower && current != Upper && current != Digit) return 0;
+    if (previous == Separator) return kBonusPathSeparator;
+    if (previous == Delimiter || previous == Other) return kBonusBoundary;
+    if (previous == Lower && (current == Upper || current == Digit)) return kBonusCamel;
+    return 0;
+}
+
+// Per-byte lookups keep the per-candidate setup branch-free
+struct Tables {
+    CharClass charClass[256] = {};
+    char folded[256] = {};
+    int bonus[ClassCount][ClassCount] = {};
+
+    constexpr Tables() {
+        for (int c = 0; c < 256; ++c) {
+            charClass[c] = classify(static_cast<unsigned char>(c));
+            folded[c] = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+        }
+        for (int p = 0; p < ClassCount; ++p) {
+            for (int c = 0; c < ClassCount; ++c) {
+                bonus[p][c] = boundaryBonus(static_cast<CharClass>(p), static_cast<CharClass>(c));
+            }
+        }
+    }
+};
+
+constexpr Tables kTables;
+
+char fold(char c) {
+    return kTables.folded[static_cast<unsigned char>(c)];
+}
+
+// Score and traceback matrices, reused across calls on a thread
+struct Scratch {
+    std::vector<int> match;      // best score with query[i] at text[j]
+    std::vector<int> gap;        // best score with query[i] before j, gap open at j
+    std::vector<int> chunkBonus; // bonus of the first char of the consecutive run
+    std::vector<uint8_t> fromDiagonal;
+    std::vector<size_t> earliest;
+    std::vector<size_t> latest;
+};
+
+thread_local Scratch scratch;
+
+} // anonymous namespace
+
+FuzzyMatcher::FuzzyMatcher(std::string_view query) {
+    for (char c : query) {
+        if (c == ' ') continue;
+        if (c >= 'A' && c <= 'Z') case_sensitive_ = true;
+        query_ += c;
+    }
+    if (!case_sensitive_) {
+        std::transform(query_.begin(), query_.end(), query_.begin(), fold);
+    }
+    mask_ = charMask(query_);
+}
+
+uint64_t FuzzyMatcher::charMask(std::string_view text) {
+    uint64_t mask = 0;
+    for (char c : text) {
+        const auto u = static_cast<unsigned char>(fold(c));
+        unsigned bit;
+        if (u >= 'a' && u <= 'z') {
+            bit = u - 'a';
+        } else if (u >= '0' && u <= '9') {
+            bit = 26u + (u - '0');
+        } else if (u < 0x80) {
+            bit = 36u + u % 27u;
+        } else {
+            bit = 63;
+        }
+        mask |= uint64_t{1} << bit;
+    }
+    return mask;
+}
+
+std::optional<int> FuzzyMatcher::score(std::string_view text) const {
+    return align(text, nullptr);
+}
+
+std::vector<size_t> FuzzyMatcher::positions(std::string_view text) const {
+    std::vector<size_t> result;
+    align(text, &result);
+    return result;
+}
+
+std::optional<int> FuzzyMatcher::align(std::string_view text, std::vector<size_t>* positions) const {
+    const size_t m = query_.size();
+    if (m == 0) return 0;
+    if (m > text.size()) return std::nullopt;
+
+    const char* data = text.data();
+    const size_t size = text.size();
+    auto at = [this, data](size_t j) { return case_sensitive_ ? data[j] : fold(data[j]); };
+
+    Scratch& s = scratch;
+    s.earliest.resize(m);
+    s.latest.resize(m);
+
+    // Greedy forward pass: rejects non-subsequences cheaply and gives the
+    // earliest column each query char can occupy
+    size_t qi = 0;
+    for (size_t j = 0; j < size && qi < m; ++j) {
+        if (at(j) == query_[qi]) s.earliest[qi++] = j;
+    }
+    if (qi < m) return std::nullopt;
+
+    // Greedy backward pass gives the latest
+    size_t j = size;
+    for (size_t i = m; i-- > 0;) {
+        while (at(--j) != query_[i]) {}
+        s.latest[i] = j;
+    }
+
+    const size_t first = s.earliest[0];
+    const size_t n = s.latest[m - 1] - first + 1;
+
+    auto bonusAt = [&](size_t column) {
+        const size_t k = first + column;
+        const CharClass previous = k == 0 ? Separator : kTables.charClass[static_cast<unsigned char>(data[k - 1])];
+        return kTables.bonus[previous][kTables.charClass[static_cast<unsigned char>(data[k])]];
+    };
+
+    // Scoring alone keeps two rows; the traceback for positions needs the
+    // whole matrix. Row i only spans the columns query[i] can occupy (plus
+    // the gap run up to the next row's last column), so rows never read
+    // cells their predecessor did not write.
+    const size_t rows = positions ? m : 2;
+    if (positions) {
+        s.match.assign(rows * n, kNegative);
+        s.gap.assign(rows * n, kNegative);
+        s.chunkBonus.assign(rows * n, 0);
+        s.fromDiagonal.assign(m * n, 0);
+    } else {
+        s.match.resize(rows * n);
+        s.gap.resize(rows * n);
+        s.chunkBonus.resize(rows * n);
+    }
+
+    int best = kNegative;
+    size_t bestEnd = 0;
+    for (size_t i = 0; i < m; ++i) {
+        const size_t row = positions ? i : i % 2;
+        const size_t prevRow = positions ? i - 1 : (i + 1) % 2;
+        int* match = &s.match[row * n];
+        int* gap = &s.gap[row * n];
+        int* chunk = &s.chunkBonus[row * n];
+        const int* prevMatch = i > 0 ? &s.match[prevRow * n] : nullptr;
+        const int* prevGap = i > 0 ? &s.gap[prevRow * n] : nullptr;
+        const int* prevChunk = i > 0 ? &s.chunkBonus[prevRow * n] : nullptr;
+        const char q = query_[i];
+
+        const size_t begin = s.earliest[i] - first;
+        const size_t end = (i + 1 < m ? s.latest[i + 1] - 1 : s.latest[i]) - first;
+
+        int running = kNegative; // gap score carried along the row
+        for (size_t column = begin; column <= end; ++column) {
+            gap[column] = running;
+            int score = kNegative;
+            if (at(first + column) == q) {
+                const int bonus = bonusAt(column);
+                if (i == 0) {
+                    score = kScoreMatch + bonus * kBonusFirstCharMultiplier;
+                    chunk[column] = bonus;
+                } else {
+                    int consecutive = kNegative;
+                    int runBonus = 0;
+                    if (prevMatch[column - 1] > kNegative) {
+                        runBonus = std::max({bonus, prevChunk[column - 1], kBonusConsecutive});
+                        consecutive = prevMatch[column - 1] + kScoreMatch + runBonus;
+                    }
+                    const int gapped = prevGap[column - 1] > kNegative
+                        ? prevGap[column - 1] + kScoreMatch + bonus : kNegative;
+                    if (consecutive > kNegative && consecutive >= gapped) {
+                        score = consecutive;
+                        chunk[column] = runBonus;
+                        if (positions) s.fromDiagonal[i * n + column] = 1;
+                    } else if (gapped > kNegative) {
+                        score = gapped;
+                        chunk[column] = bonus;
+                    }
+                }
+            }
+            match[column] = score;
+            if (i == m - 1 && score > best) {
+                best = score;
+                bestEnd = column;
+            }
+            running = std::max(score > kNegative ? score + kScoreGapStart : kNegative,
+                               running > kNegative ? running + kScoreGapExtension : kNegative);
+        }
+    }
+
+    if (best <= kNegative) return std::nullopt;
+
+    if (positions) {
+        positions->assign(m, 0);
+        size_t column = bestEnd;
+        for (size_t i = m; i-- > 0;) {
+            (*positions)[i] = first + column;
+            if (i == 0) break;
+            if (s.fromDiagonal[i * n + column]) {
+                column--;
+                continue;
+            }
+            // Find the earlier match the gap score came from, searching no
+            // further left than row i - 1 begins. Should no cell add up
+            // exactly, the best-scoring one stands in for it.
+            const int target = s.gap[(i - 1) * n + column - 1];
+            const size_t lowest = s.earliest[i - 1] - first;
+            size_t source = column;
+            int sourceScore = kNegative;
+            int penalty = kScoreGapStart;
+            for (size_t k = column - 1; k > lowest;) {
+                --k;
+                const int previous = s.match[(i - 1) * n + k];
+                if (previous > kNegative && previous + penalty > sourceScore) {
+                    source = k;
+                    sourceScore = previous + penalty;
+                    if (sourceScore == target) break;
+                }
+                penalty += kScoreGapExtension;
+            }
+            if (source == column) {
+                positions->clear(); // no predecessor; the matrix is inconsistent
+                break;
+            }
+            column = source;
+        }
+    }
+    return best;
+}
+
+void FuzzyIndex::clear() {
+    blob_.clear();
+    offsets_.clear();
+    masks_.clear();
+    boosts_.clear();
+    survivors_.clear();
+    survivors_valid_ = false;
+}
+
+void FuzzyIndex::reserve(size_t count, size_t bytes) {
+    blob_.reserve(bytes);
+    offsets_.reserve(count + 1);
+    masks_.reserve(count);
+}
+
+void FuzzyIndex::add(std::string_view candidate) {
+    if (offsets_.empty()) offsets_.push_back(0);
+    blob_.append(candidate);
+    offsets_.push_back(static_cast<uint32_t>(blob_.size()));
+    masks_.push_back(FuzzyMatcher::charMask(candidate));
+    survivors_valid_ = false;
+}
+
+void FuzzyIndex::setCandidates(const std::vector<std::string>& candidates) {
+    clear();
+    size_t bytes = 0;
+    for (const auto& candidate : candidates) bytes += candidate.size();
+    reserve(candidates.size(), bytes);
+    for (const auto& candidate : candidates) add(candidate);
+}
+
+std::vector<FuzzyMatch> FuzzyIndex::rank(std::string_view query, size_t limit) {
+    const FuzzyMatcher matcher(query);
+    const size_t total = size();
+
+    std::vector<FuzzyMatch> results;
+    if (matcher.isEmpty() || limit == 0) {
+        survivors_valid_ = false;
+        for (const auto& [index, boost] : boosts_) {
+            if (index < total) results.push_back(FuzzyMatch{index, boost});
+        }
+        std::sort(results.begin(), results.end(), [](const FuzzyMatch& a, const FuzzyMatch& b) {
+            return a.score != b.score ? a.score > b.score : a.index < b.index;
+        });
+        if (results.size() > limit) results.resize(limit);
+        for (size_t i = 0; i < total && results.size() < limit; ++i) {
+            if (!boosts_.count(static_cast<uint32_t>(i))) {
+                results.push_back(FuzzyMatch{static_cast<uint32_t>(i), 0});
+            }
+        }
+        return results;
+    }
+
+    // Extending the query can only shrink the match set
+    const bool narrowing = survivors_valid_ && query.substr(0, last_query_.size()) == last_query_;
+    const size_t count = narrowing ? survivors_.size() : total;
+
+    auto better = [this](const FuzzyMatch& a, const FuzzyMatch& b) {
+        if (a.score != b.score) return a.score > b.score;
+        const uint32_t lengthA = offsets_[a.index + 1] - offsets_[a.index];
+        const uint32_t lengthB = offsets_[b.index + 1] - offsets_[b.index];
+        if (lengthA != lengthB) return lengthA < lengthB;
+        return a.index < b.index;
+    };
+
+    struct ChunkResult {
+        std::vector<uint32_t> matched;
+        std::vector<FuzzyMatch> heap; // worst of the best `limit` at the front
+    };
+    const size_t chunks = (count + kChunkSize - 1) / kChunkSize;
+    std::vector<ChunkResult> chunkResults(chunks);
+    const uint64_t queryMask = matcher.mask();
+
+    ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+        ChunkResult& out = chunkResults[chunk];
+        const size_t begin = chunk * kChunkSize;
+        const size_t end = std::min(count, begin + kChunkSize);
+
+        // On a full scan the mask test is its own pass over the contiguous
+        // masks, plain and/andnot that a Release (-O3) build vectorises;
+        // scoring then skips every candidate missing a query character.
+        // Survivors are few and scattered, so they are tested one by one.
+        thread_local std::vector<uint64_t> missing;
+        missing.resize(end - begin);
+        uint64_t* absent = missing.data();
+        if (!narrowing) {
+            const uint64_t* masks = masks_.data() + begin;
+            const uint64_t wanted = queryMask;
+            const size_t length = end - begin;
+            for (size_t k = 0; k < length; ++k) {
+                absent[k] = wanted & ~masks[k];
+            }
+        } else {
+            for (size_t k = begin; k < end; ++k) {
+                absent[k - begin] = queryMask & ~masks_[survivors_[k]];
+            }
+        }
+
+        for (size_t k = begin; k < end; ++k) {
+            if (absent[k - begin]) continue;
+            const uint32_t index = narrowing ? survivors_[k] : static_cast<uint32_t>(k);
+
+            const auto score = matcher.score(candidate(index));
+            if (!score) continue;
+            out.matched.push_back(index);
+
+            FuzzyMatch match{index, *score};
+            if (!boosts_.empty()) {
+                auto boost = boosts_.find(index);
+                if (boost != boosts_.end()) match.score += boost->second;
+            }
+            if (out.heap.size() < limit) {
+                out.heap.push_back(match);
+                std::push_heap(out.heap.begin(), out.heap.end(), better);
+            } else if (better(match, out.heap.front())) {
+                std::pop_heap(out.heap.begin(), out.heap.end(), better);
+                out.heap.back() = match;
+                std::push_heap(out.heap.begin(), out.heap.end(), better);
+            }
+        }
+    });
+
+    std::vector<uint32_t> survivors;
+    for (auto& chunk : chunkResults) {
+        survivors.insert(survivors.end(), chunk.matched.begin(), chunk.matched.end());
+        results.insert(results.end(), chunk.heap.begin(), chunk.heap.end());
+    }
+    survivors_ = std::move(survivors);
+    survivors_valid_ = true;
+    last_query_ = std::string(query);
+
+    const size_t keep = std::min(limit, results.size());
+    std::partial_sort(results.begin(), results.begin() + static_cast<std::ptrdiff_t>(keep), results.end(), better);
+    results.resize(keep);
+    return results;
+}
+
+} // namespace xenon::features
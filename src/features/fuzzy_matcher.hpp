@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xenon::features {
+
+struct FuzzyMatch {
+    uint32_t index; // into the candidate list
+    int score;
+};
+
+// A fuzzy query compiled once. Scoring follows fzf: query characters must
+// appear in order, matches at word and path boundaries and consecutive runs
+// earn bonuses, gaps cost an affine penalty, and the best alignment is found
+// with a Smith-Waterman style dynamic program. Matching is case-insensitive
+// unless the query contains an uppercase letter.
+class FuzzyMatcher {
+public:
+    explicit FuzzyMatcher(std::string_view query);
+
+    bool isEmpty() const { return query_.empty(); }
+    uint64_t mask() const { return mask_; }
+
+    // nullopt when the query is not a subsequence of text
+    std::optional<int> score(std::string_view text) const;
+    // Byte offsets of the matched characters in the best alignment, for
+    // highlighting; empty when there is no match.
+    std::vector<size_t> positions(std::string_view text) const;
+
+    // Set of (case-folded) characters in text, bucketed into 64 bits. A
+    // candidate can only match if its mask covers the query's mask.
+    static uint64_t charMask(std::string_view text);
+
+private:
+    // Runs the alignment over text, optionally recording the traceback.
+    std::optional<int> align(std::string_view text, std::vector<size_t>* positions) const;
+
+    std::string query_;
+    bool case_sensitive_ = false;
+    uint64_t mask_ = 0;
+};
+
+// A candidate list prepared for ranking: strings are packed into one buffer
+// next to their character masks so a keystroke first rejects most
+// candidates with a linear mask scan before any scoring. Scoring runs on
+// the shared thread pool; each worker keeps only its best `limit` matches
+// in a heap and the heaps are merged at the end.
+class FuzzyIndex {
+public:
+    void clear();
+    void reserve(size_t count, size_t bytes);
+    void add(std::string_view candidate);
+    void setCandidates(const std::vector<std::string>& candidates);
+
+    // Extra score per candidate index (e.g. frecency), added to every match
+    // of that candidate. Cleared with the candidates.
+    void setBoosts(std::unordered_map<uint32_t, int> boosts) { boosts_ = std::move(boosts); }
+    void setBoost(uint32_t index, int boost) { boosts_[index] = boost; }
+
+    size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+    std::string_view candidate(uint32_t index) const {
+        return std::string_view(blob_).substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+    }
+
+    // Best `limit` matches, highest score first; ties go to the shorter
+    // candidate. An empty query returns the boosted candidates, strongest
+    // first, followed by the rest in order, up to `limit`.
+    // When the query extends the previous one only the previous survivors
+    // are rescored.
+    std::vector<FuzzyMatch> rank(std::string_view query, size_t limit);
+
+private:
+    std::string blob_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint64_t> masks_;
+    std::unordered_map<uint32_t, int> boosts_;
+
+    // Candidates that matched last_query_, for incremental narrowing
+    std::string last_query_;
+    std::vector<uint32_t> survivors_;
+    bool survivors_valid_ = false;
+};
+
+} // namespace xenon::features
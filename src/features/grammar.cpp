@@ -0,0 +1,500 @@
+#include "features/grammar.hpp"
+#include "features/cpp_lexer.hpp"
+#include "features/lexer_support.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr int kStateModeMask = 0xff;
+constexpr uint32_t kStateExtraMask = kDelimiterHashMask;
+
+std::u16string toUtf16(std::string_view text) {
+    std::u16string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        const auto byte = static_cast<unsigned char>(text[i]);
+        uint32_t code = byte;
+        size_t extra = 0;
+        if (byte >= 0xf0) {
+            code = byte & 0x07u;
+            extra = 3;
+        } else if (byte >= 0xe0) {
+            code = byte & 0x0fu;
+            extra = 2;
+        } else if (byte >= 0xc0) {
+            code = byte & 0x1fu;
+            extra = 1;
+        }
+        ++i;
+        for (size_t k = 0; k < extra && i < text.size(); ++k, ++i) {
+            code = (code << 6) | (static_cast<unsigned char>(text[i]) & 0x3fu);
+        }
+        if (code >= 0x10000) {
+            code -= 0x10000;
+            result.push_back(static_cast<char16_t>(0xd800 + (code >> 10)));
+            result.push_back(static_cast<char16_t>(0xdc00 + (code & 0x3ff)));
+        } else {
+            result.push_back(static_cast<char16_t>(code));
+        }
+    }
+    return result;
+}
+
+char16_t foldCase(char16_t c) {
+    return c >= u'A' && c <= u'Z' ? static_cast<char16_t>(c + (u'a' - u'A')) : c;
+}
+
+uint32_t keywordHash(std::u16string_view word, uint32_t seed, bool fold) {
+    uint32_t hash = seed;
+    for (char16_t c : word) {
+        hash = (hash ^ (fold ? foldCase(c) : c)) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Must fit in a non-negative int. SyntaxHighlighter keeps each line's end
+// state in QTextBlock::userState, where Qt's default of -1 marks a line not
+// lexed yet: a negative state would read as unlexed, and the async lexer,
+// which clamps its start state to 0, would resume as if nothing were open.
+int packState(size_t rule, uint32_t extra) {
+    return static_cast<int>(((extra & kStateExtraMask) << 8) | static_cast<uint32_t>(rule + 1));
+}
+
+std::vector<std::string_view> splitWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r')) ++i;
+        const size_t start = i;
+        while (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '\r') ++i;
+        if (i > start) words.push_back(text.substr(start, i - start));
+    }
+    return words;
+}
+
+bool isYes(std::string_view value) {
+    return value == "yes" || value == "true" || value == "on";
+}
+
+} // anonymous namespace
+
+std::shared_ptr<const Grammar> Grammar::parse(std::string_view text, std::string* error) {
+    std::shared_ptr<Grammar> grammar(new Grammar());
+
+    auto fail = [error](size_t lineNumber, const std::string& message) {
+        if (error) *error = "line " + std::to_string(lineNumber) + ": " + message;
+        return nullptr;
+    };
+
+    size_t lineNumber = 0;
+    for (size_t pos = 0; pos <= text.size();) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        const std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        ++lineNumber;
+
+        const auto words = splitWords(line);
+        if (words.empty() || words[0][0] == '#') continue;
+
+        const std::string_view key = words[0];
+        const size_t argc = words.size() - 1;
+        auto arg = [&words](size_t index) { return words[index + 1]; };
+
+        if (key == "id" && argc == 1) {
+            grammar->id_ = std::string(arg(0));
+        } else if (key == "name" && argc >= 1) {
+            const size_t start = static_cast<size_t>(words[1].data() - line.data());
+            grammar->name_ = std::string(line.substr(start));
+            while (!grammar->name_.empty() && (grammar->name_.back() == ' ' || grammar->name_.back() == '\r')) {
+                grammar->name_.pop_back();
+            }
+        } else if (key == "extensions") {
+            for (size_t i = 0; i < argc; ++i) grammar->extensions_.emplace_back(arg(i));
+        } else if (key == "filenames") {
+            for (size_t i = 0; i < argc; ++i) grammar->file_names_.emplace_back(arg(i));
+        } else if (key == "keywords" || key == "types") {
+            const TokenKind kind = key == "types" ? TokenKind::Type : TokenKind::Keyword;
+            for (size_t i = 0; i < argc; ++i) grammar->addKeyword(arg(i), kind);
+        } else if (key == "line-comment" && argc == 1) {
+            Rule rule;
+            rule.type = RuleType::LineComment;
+            rule.kind = TokenKind::Comment;
+            rule.open = toUtf16(arg(0));
+            grammar->rules_.push_back(rule);
+        } else if (key == "block-comment" && (argc == 2 || argc == 3)) {
+            Rule rule;
+            rule.kind = TokenKind::Comment;
+            rule.open = toUtf16(arg(0));
+            rule.close = toUtf16(arg(1));
+            rule.multiline = true;
+            rule.nested = argc == 3 && arg(2) == "nested";
+            grammar->rules_.push_back(rule);
+        } else if ((key == "string" || key == "multiline-string") && (argc == 2 || argc == 3)) {
+            Rule rule;
+            rule.open = toUtf16(arg(0));
+            rule.close = toUtf16(arg(1));
+            rule.escape = argc == 3 ? toUtf16(arg(2)).front() : 0;
+            rule.multiline = key == "multiline-string";
+            grammar->rules_.push_back(rule);
+        } else if (key == "raw-string" && argc == 1) {
+            Rule rule;
+            rule.type = RuleType::RawString;
+            rule.open = toUtf16(arg(0));
+            rule.multiline = true;
+            grammar->rules_.push_back(rule);
+        } else if (key == "preprocessor" && argc >= 1 && arg(0).size() == 1) {
+            grammar->preprocessor_ = static_cast<char16_t>(arg(0)[0]);
+            for (size_t i = 1; i < argc; ++i) grammar->include_directives_.push_back(toUtf16(arg(i)));
+        } else if (key == "lexer" && argc == 1) {
+            if (arg(0) != "cpp") return fail(lineNumber, "unknown lexer '" + std::string(arg(0)) + "'");
+            grammar->lexer_ = Lexer::Cpp;
+        } else if (key == "functions" && argc == 1) {
+            grammar->functions_ = isYes(arg(0));
+        } else if (key == "capitalized-types" && argc == 1) {
+            grammar->capitalized_types_ = isYes(arg(0));
+        } else if (key == "case-insensitive" && argc == 1) {
+            grammar->case_insensitive_ = isYes(arg(0));
+        } else if (key == "digit-separator" && argc == 1 && arg(0).size() == 1) {
+            grammar->digit_separator_ = static_cast<char16_t>(arg(0)[0]);
+        } else if (key == "identifier-chars" && argc == 1) {
+            for (char c : arg(0)) {
+                if (static_cast<unsigned char>(c) < 128) {
+                    grammar->classes_[static_cast<size_t>(c)] |= kIdentifierStart | kIdentifierPart;
+                }
+            }
+        } else {
+            return fail(lineNumber, "unknown or malformed directive '" + std::string(key) + "'");
+        }
+    }
+
+    if (grammar->id_.empty()) return fail(lineNumber, "missing id");
+    if (grammar->name_.empty()) grammar->name_ = grammar->id_;
+    if (!grammar->compile(error)) return nullptr;
+    return grammar;
+}
+
+void Grammar::addKeyword(std::string_view word, TokenKind kind) {
+    std::u16string key = toUtf16(word);
+    if (case_insensitive_) {
+        std::transform(key.begin(), key.end(), key.begin(), foldCase);
+    }
+    max_keyword_length_ = std::max(max_keyword_length_, key.size());
+    keywords_.emplace_back(std::move(key), kind);
+}
+
+bool Grammar::compile(std::string* error) {
+    if (lexer_ != Lexer::Table) {
+        if (!rules_.empty() || !keywords_.empty()) {
+            if (error) *error = "a built-in lexer takes no keyword, comment or string directives";
+            return false;
+        }
+        return true;
+    }
+
+    // A keyword list may precede the case-insensitive directive
+    if (case_insensitive_) {
+        for (auto& keyword : keywords_) {
+            std::transform(keyword.first.begin(), keyword.first.end(), keyword.first.begin(), foldCase);
+        }
+    }
+    std::sort(keywords_.begin(), keywords_.end());
+    keywords_.erase(std::unique(keywords_.begin(), keywords_.end(),
+                                [](const auto& a, const auto& b) { return a.first == b.first; }),
+                    keywords_.end());
+
+    for (char16_t c = u'a'; c <= u'z'; ++c) classes_[c] |= kIdentifierStart | kIdentifierPart;
+    for (char16_t c = u'A'; c <= u'Z'; ++c) classes_[c] |= kIdentifierStart | kIdentifierPart;
+    for (char16_t c = u'0'; c <= u'9'; ++c) classes_[c] |= kDigit | kIdentifierPart;
+    classes_[u'_'] |= kIdentifierStart | kIdentifierPart;
+    for (char16_t c : {u' ', u'\t', u'\r', u'\f', u'\v'}) classes_[c] = kSpace;
+
+    if (rules_.size() >= kStateModeMask) {
+        if (error) *error = "too many comment and string rules";
+        return false;
+    }
+
+    // Build the opener trie directly as a DFA table; with literal openers
+    // the trie is already deterministic
+    transitions_.assign(128, 0);
+    accepts_.assign(1, -1);
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        const std::u16string& open = rules_[r].open;
+        if (open.empty() || std::any_of(open.begin(), open.end(), [](char16_t c) { return c >= 128; })) {
+            if (error) *error = "comment and string delimiters must be ASCII";
+            return false;
+        }
+        classes_[open[0]] |= kOpenerStart;
+
+        size_t state = 0;
+        for (char16_t c : open) {
+            // Adding a row reallocates the table, so no reference into it
+            // is held across that
+            const size_t slot = state * 128 + c;
+            if (transitions_[slot] == 0) {
+                transitions_[slot] = static_cast<uint16_t>(accepts_.size());
+                accepts_.push_back(-1);
+                transitions_.resize(transitions_.size() + 128, 0);
+            }
+            state = transitions_[slot];
+        }
+        if (accepts_[state] < 0) accepts_[state] = static_cast<int16_t>(r); // first definition wins
+    }
+
+    return buildKeywordTable(error);
+}
+
+bool Grammar::buildKeywordTable(std::string* error) {
+    if (keywords_.empty()) return true;
+
+    // Grow the table until some seed separates every keyword; a sparse
+    // table finds one within a few tries
+    for (size_t slots = 64; slots <= (1u << 16); slots *= 2) {
+        if (slots < keywords_.size() * 8) continue;
+        for (uint32_t seed = 2166136261u; seed != 2166136261u + 256; ++seed) {
+            std::vector<uint16_t> table(slots, 0);
+            bool collision = false;
+            for (size_t i = 0; i < keywords_.size() && !collision; ++i) {
+                uint16_t& slot = table[keywordHash(keywords_[i].first, seed, false) & (slots - 1)];
+                collision = slot != 0;
+                slot = static_cast<uint16_t>(i + 1);
+            }
+            if (!collision) {
+                keyword_slots_ = std::move(table);
+                keyword_seed_ = seed;
+                return true;
+            }
+        }
+    }
+    if (error) *error = "no perfect hash found for " + std::to_string(keywords_.size()) + " keywords";
+    return false;
+}
+
+const TokenKind* Grammar::findKeyword(std::u16string_view word) const {
+    if (keyword_slots_.empty() || word.size() > max_keyword_length_) return nullptr;
+    const uint32_t hash = keywordHash(word, keyword_seed_, case_insensitive_);
+    const uint16_t slot = keyword_slots_[hash & (keyword_slots_.size() - 1)];
+    if (slot == 0) return nullptr;
+
+    const auto& [keyword, kind] = keywords_[slot - 1];
+    if (keyword.size() != word.size()) return nullptr;
+    for (size_t i = 0; i < word.size(); ++i) {
+        if ((case_insensitive_ ? foldCase(word[i]) : word[i]) != keyword[i]) return nullptr;
+    }
+    return &kind;
+}
+
+bool Grammar::matchesFile(std::string_view fileName) const {
+    const size_t slash = fileName.find_last_of("/\\");
+    if (slash != std::string_view::npos) fileName = fileName.substr(slash + 1);
+    for (const auto& name : file_names_) {
+        if (fileName == name) return true;
+    }
+    const size_t dot = fileName.rfind('.');
+    if (dot == std::string_view::npos) return false;
+    const std::string_view extension = fileName.substr(dot + 1);
+    for (const auto& candidate : extensions_) {
+        if (extension == candidate) return true;
+    }
+    return false;
+}
+
+uint8_t Grammar::classOf(char16_t c) const {
+    // Non-ASCII units are taken to be part of identifiers
+    return c < 128 ? classes_[c] : static_cast<uint8_t>(kIdentifierStart | kIdentifierPart);
+}
+
+int Grammar::matchOpener(std::u16string_view line, size_t at, size_t* length) const {
+    int best = -1;
+    size_t state = 0;
+    for (size_t i = at; i < line.size() && line[i] < 128; ++i) {
+        state = transitions_[state * 128 + line[i]];
+        if (state == 0) break;
+        if (accepts_[state] >= 0) {
+            best = accepts_[state];
+            *length = i - at + 1;
+        }
+    }
+    return best;
+}
+
+size_t Grammar::closeDelimited(const Rule& rule, std::u16string_view line, size_t from, int& depth) const {
+    if (!rule.escape && !rule.nested) {
+        const size_t end = line.find(rule.close, from);
+        return end == std::u16string_view::npos ? end : end + rule.close.size();
+    }
+
+    const char16_t closeFirst = rule.close.front();
+    const char16_t openFirst = rule.open.front();
+    for (size_t i = from; i < line.size();) {
+        const char16_t c = line[i];
+        if (c == rule.escape) {
+            i += 2;
+        } else if (rule.nested && c == openFirst && line.compare(i, rule.open.size(), rule.open) == 0) {
+            ++depth;
+            i += rule.open.size();
+        } else if (c == closeFirst && line.compare(i, rule.close.size(), rule.close) == 0) {
+            i += rule.close.size();
+            if (!rule.nested || --depth == 0) return i;
+        } else {
+            ++i;
+        }
+    }
+    return std::u16string_view::npos;
+}
+
+int Grammar::lexLine(std::u16string_view line, int state, std::vector<Token>& tokens) const {
+    if (lexer_ == Lexer::Cpp) {
+        return CppLexer::lexLine(line, state, tokens);
+    }
+
+    const size_t n = line.size();
+    size_t i = 0;
+
+    // Finish whatever the previous line left open
+    const auto mode = static_cast<size_t>(state & kStateModeMask);
+    if (mode > 0 && mode <= rules_.size()) {
+        const Rule& rule = rules_[mode - 1];
+        const uint32_t extra = static_cast<uint32_t>(state) >> 8;
+        size_t end;
+        int depth = static_cast<int>(extra);
+        if (rule.type == RuleType::RawString) {
+            end = findRawStringEnd(line, 0, extra);
+        } else {
+            end = closeDelimited(rule, line, 0, depth);
+        }
+        if (end == std::u16string_view::npos) {
+            if (n > 0) pushToken(tokens, 0, n, rule.kind);
+            return rule.nested ? packState(mode - 1, static_cast<uint32_t>(depth)) : state;
+        }
+        pushToken(tokens, 0, end, rule.kind);
+        i = end;
+    }
+
+    bool lineStart = i == 0;
+    while (i < n) {
+        const char16_t c = line[i];
+        const uint8_t cls = classOf(c);
+        if (cls & kSpace) {
+            ++i;
+            continue;
+        }
+        const size_t start = i;
+
+        size_t openLength = 0;
+        const int ruleIndex = (cls & kOpenerStart) ? matchOpener(line, i, &openLength) : -1;
+        if (ruleIndex >= 0) {
+            const Rule& rule = rules_[static_cast<size_t>(ruleIndex)];
+            i += openLength;
+            switch (rule.type) {
+                case RuleType::LineComment:
+                    pushToken(tokens, start, n, rule.kind);
+                    return 0;
+                case RuleType::RawString: {
+                    const size_t paren = line.find(u'(', i);
+                    if (paren != std::u16string_view::npos && paren - i <= kMaxRawDelimiter) {
+                        const uint32_t hash = delimiterHash(line.substr(i, paren - i));
+                        const size_t end = findRawStringEnd(line, paren + 1, hash);
+                        if (end == std::u16string_view::npos) {
+                            pushToken(tokens, start, n, rule.kind);
+                            return packState(static_cast<size_t>(ruleIndex), hash);
+                        }
+                        i = end;
+                    } else {
+                        // Not a valid raw string; read it as an ordinary one
+                        const size_t end = line.find(u'"', i);
+                        i = end == std::u16string_view::npos ? n : end + 1;
+                    }
+                    pushToken(tokens, start, i, rule.kind);
+                    break;
+                }
+                case RuleType::Delimited: {
+                    int depth = 1;
+                    const size_t end = closeDelimited(rule, line, i, depth);
+                    if (end == std::u16string_view::npos) {
+                        pushToken(tokens, start, n, rule.kind);
+                        if (rule.multiline) {
+                            return packState(static_cast<size_t>(ruleIndex), rule.nested ? static_cast<uint32_t>(depth) : 0);
+                        }
+                        i = n; // unterminated on this line
+                    } else {
+                        pushToken(tokens, start, end, rule.kind);
+                        i = end;
+                    }
+                    break;
+                }
+            }
+            lineStart = false;
+            continue;
+        }
+
+        if (cls & kIdentifierStart) {
+            while (i < n && (classOf(line[i]) & kIdentifierPart)) ++i;
+            if (const TokenKind* kind = findKeyword(line.substr(start, i - start))) {
+                pushToken(tokens, start, i, *kind);
+            } else {
+                size_t next = i;
+                while (next < n && (classOf(line[next]) & kSpace)) ++next;
+                if (functions_ && next < n && line[next] == u'(') {
+                    pushToken(tokens, start, i, TokenKind::Function);
+                } else if (capitalized_types_ && c >= u'A' && c <= u'Z') {
+                    pushToken(tokens, start, i, TokenKind::Type);
+                }
+            }
+        } else if ((cls & kDigit) || (c == u'.' && i + 1 < n && (classOf(line[i + 1]) & kDigit))) {
+            i = scanPpNumber(line, i + 1, digit_separator_,
+                             [this](char16_t d) { return (classOf(d) & kIdentifierPart) != 0; });
+            pushToken(tokens, start, i, TokenKind::Number);
+        } else if (c == preprocessor_ && lineStart) {
+            ++i;
+            while (i < n && (classOf(line[i]) & kSpace)) ++i;
+            const size_t nameStart = i;
+            while (i < n && (classOf(line[i]) & kIdentifierPart)) ++i;
+            pushToken(tokens, start, i, TokenKind::Preprocessor);
+
+            // <header> after an include directive reads as a string
+            const std::u16string_view directive = line.substr(nameStart, i - nameStart);
+            if (std::find(include_directives_.begin(), include_directives_.end(), directive) !=
+                include_directives_.end()) {
+                while (i < n && (classOf(line[i]) & kSpace)) ++i;
+                if (i < n && line[i] == u'<') {
+                    const size_t close = line.find(u'>', i + 1);
+                    const size_t end = close == std::u16string_view::npos ? n : close + 1;
+                    pushToken(tokens, i, end, TokenKind::String);
+                    i = end;
+                }
+            }
+        } else {
+            ++i;
+        }
+        lineStart = false;
+    }
+    return 0;
+}
+
+void GrammarRegistry::add(std::shared_ptr<const Grammar> grammar) {
+    if (!grammar) return;
+    grammars_.erase(std::remove_if(grammars_.begin(), grammars_.end(),
+                                   [&grammar](const auto& existing) { return existing->id() == grammar->id(); }),
+                    grammars_.end());
+    grammars_.push_back(std::move(grammar));
+}
+
+std::shared_ptr<const Grammar> GrammarRegistry::byId(std::string_view id) const {
+    for (const auto& grammar : grammars_) {
+        if (grammar->id() == id) return grammar;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const Grammar> GrammarRegistry::forFile(std::string_view path) const {
+    // Most recently added first, so overrides win
+    for (auto it = grammars_.rbegin(); it != grammars_.rend(); ++it) {
+        if ((*it)->matchesFile(path)) return *it;
+    }
+    return nullptr;
+}
+
+} // namespace xenon::features
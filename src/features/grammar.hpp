@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xenon::features {
+
+enum class TokenKind : uint8_t {
+    Keyword,
+    Type,
+    Function,
+    String,
+    Number,
+    Comment,
+    Preprocessor,
+};
+
+struct Token {
+    uint32_t start;  // UTF-16 offset in the line
+    uint32_t length;
+    TokenKind kind;
+};
+
+// A language definition compiled for lexing. Grammars are written as small
+// text files, one directive per line:
+//
+//   id cpp                          language id, also sent to the LSP server
+//   name C++
+//   extensions c cc cpp h hpp       file name suffixes, without the dot
+//   filenames CMakeLists.txt        exact file names
+//   keywords if else for ...        may repeat
+//   types int char ...              highlighted as types
+//   line-comment //
+//   block-comment /* */ [nested]
+//   string " " [escape]             open, close, escape character
+//   multiline-string """ """ [escape]
+//   raw-string R"                   C++ raw string: R"delim( ... )delim"
+//   preprocessor # [include ...]    line-start directives; <path> after the
+//                                   listed directives reads as a string
+//   functions yes                   identifier followed by ( is a call
+//   capitalized-types yes           Capitalized identifiers are types
+//   identifier-chars $-             extra identifier characters
+//   digit-separator '
+//   case-insensitive yes            keywords match in any case
+//   lexer cpp                       lex with the built-in CppLexer instead;
+//                                   the keyword, comment and string
+//                                   directives are then not allowed
+//
+// At load time the comment and string openers are compiled into a DFA
+// over ASCII, characters into a class table and the keywords into a
+// perfect hash, so lexing a line is a single left-to-right pass. Like the
+// lexer state, a Grammar is immutable once built and may be shared across
+// threads.
+class Grammar {
+public:
+    // Returns null and sets error (with a line number) on a malformed file
+    static std::shared_ptr<const Grammar> parse(std::string_view text, std::string* error = nullptr);
+
+    const std::string& id() const { return id_; }
+    const std::string& name() const { return name_; }
+    bool matchesFile(std::string_view fileName) const;
+
+    // Appends the tokens of line (plain text and operators are not
+    // reported) and returns the state to pass in for the next line. The
+    // state of the first line is 0.
+    int lexLine(std::u16string_view line, int state, std::vector<Token>& tokens) const;
+
+private:
+    enum class Lexer : uint8_t { Table, Cpp };
+    enum class RuleType : uint8_t { LineComment, Delimited, RawString };
+
+    struct Rule {
+        RuleType type = RuleType::Delimited;
+        TokenKind kind = TokenKind::String;
+        std::u16string open;
+        std::u16string close;
+        char16_t escape = 0;
+        bool multiline = false;
+        bool nested = false;
+    };
+
+    // Character class bits
+    static constexpr uint8_t kSpace = 1;
+    static constexpr uint8_t kIdentifierStart = 2;
+    static constexpr uint8_t kIdentifierPart = 4;
+    static constexpr uint8_t kDigit = 8;
+    static constexpr uint8_t kOpenerStart = 16;
+
+    Grammar() = default;
+    bool compile(std::string* error);
+    void addKeyword(std::string_view word, TokenKind kind);
+    bool buildKeywordTable(std::string* error);
+    int matchOpener(std::u16string_view line, size_t at, size_t* length) const;
+    const TokenKind* findKeyword(std::u16string_view word) const;
+    size_t closeDelimited(const Rule& rule, std::u16string_view line, size_t from, int& depth) const;
+    uint8_t classOf(char16_t c) const;
+
+    std::string id_;
+    std::string name_;
+    std::vector<std::string> extensions_;
+    std::vector<std::string> file_names_;
+
+    Lexer lexer_ = Lexer::Table;
+    std::vector<Rule> rules_;
+    char16_t preprocessor_ = 0;
+    std::vector<std::u16string> include_directives_;
+    bool functions_ = false;
+    bool capitalized_types_ = false;
+    bool case_insensitive_ = false;
+    char16_t digit_separator_ = 0;
+
+    uint8_t classes_[128] = {};
+
+    // Opener DFA: 128 transitions per state, 0 meaning none (state 0 is
+    // the start and never a target); accepting states map to a rule
+    std::vector<uint16_t> transitions_;
+    std::vector<int16_t> accepts_;
+
+    // Keywords in a perfect hash: one hash, at most one comparison
+    std::vector<std::pair<std::u16string, TokenKind>> keywords_;
+    std::vector<uint16_t> keyword_slots_; // keyword index + 1, 0 when empty
+    uint32_t keyword_seed_ = 0;
+    size_t max_keyword_length_ = 0;
+};
+
+// Grammars by language id, with lookup by file name. Later additions
+// replace earlier ones with the same id, so user grammars can override the
+// built-in ones.
+class GrammarRegistry {
+public:
+    void add(std::shared_ptr<const Grammar> grammar);
+    std::shared_ptr<const Grammar> byId(std::string_view id) const;
+    // Null for files no grammar claims
+    std::shared_ptr<const Grammar> forFile(std::string_view path) const;
+    size_t size() const { return grammars_.size(); }
+
+private:
+    std::vector<std::shared_ptr<const Grammar>> grammars_;
+};
+
+} // namespace xenon::features
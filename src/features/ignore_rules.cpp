@@ -0,0 +1,177 @@
+#include "features/ignore_rules.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace xenon::features {
+
+namespace {
+
+bool matchClass(std::string_view pattern, size_t& p, char c) {
+    // pattern[p] is '['; on success p points past the closing ']'
+    size_t i = p + 1;
+    bool negate = false;
+    if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) {
+        negate = true;
+        ++i;
+    }
+    bool matched = false;
+    bool first = true;
+    while (i < pattern.size() && (first || pattern[i] != ']')) {
+        first = false;
+        char lo = pattern[i];
+        if (lo == '\\' && i + 1 < pattern.size()) lo = pattern[++i];
+        char hi = lo;
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            hi = pattern[i + 2];
+            i += 2;
+        }
+        if (c >= lo && c <= hi) matched = true;
+        ++i;
+    }
+    if (i >= pattern.size()) {
+        return false;
+    }
+    p = i + 1;
+    return matched != negate;
+}
+
+bool globMatchImpl(std::string_view pattern, size_t p, std::string_view path, size_t s) {
+    while (p < pattern.size()) {
+        char c = pattern[p];
+        if (c == '*') {
+            if (p + 1 < pattern.size() && pattern[p + 1] == '*') {
+                // "**" crosses directory boundaries; "**/" also matches zero directories
+                p += 2;
+                const bool slash = p < pattern.size() && pattern[p] == '/';
+                if (slash) ++p;
+                if (p == pattern.size()) return true;
+                for (size_t t = s; t <= path.size(); ++t) {
+                    if ((!slash || t == s || path[t - 1] == '/') && globMatchImpl(pattern, p, path, t)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            ++p;
+            for (size_t t = s; t <= path.size(); ++t) {
+                if (globMatchImpl(pattern, p, path, t)) return true;
+                if (t < path.size() && path[t] == '/') return false;
+            }
+            return false;
+        }
+
+        if (s == path.size()) return false;
+
+        if (c == '?') {
+            if (path[s] == '/') return false;
+        } else if (c == '[' && pattern.find(']', p + 2) != std::string_view::npos) {
+            if (path[s] == '/' || !matchClass(pattern, p, path[s])) return false;
+            ++s;
+            continue;
+        } else {
+            if (c == '\\' && p + 1 < pattern.size()) c = pattern[++p];
+            if (c != path[s]) return false;
+        }
+        ++p;
+        ++s;
+    }
+    return s == path.size();
+}
+
+} // anonymous namespace
+
+bool IgnoreRules::globMatch(std::string_view pattern, std::string_view path) {
+    return globMatchImpl(pattern, 0, path, 0);
+}
+
+void IgnoreRules::addRules(std::string_view text, const std::string& base) {
+    size_t lineStart = 0;
+    while (lineStart <= text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        while (!line.empty() && line.back() == ' ' &&
+               !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#') continue;
+
+        Rule rule;
+        rule.base = base;
+        if (line.front() == '!') {
+            rule.negated = true;
+            line.remove_prefix(1);
+        } else if (line.size() >= 2 && line[0] == '\\' && (line[1] == '!' || line[1] == '#')) {
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.directoryOnly = true;
+            line.remove_suffix(1);
+        }
+        if (line.empty()) continue;
+
+        // A slash anywhere but the end anchors the pattern to its base directory
+        rule.anchored = line.find('/') != std::string_view::npos;
+        if (line.front() == '/') line.remove_prefix(1);
+        rule.glob = std::string(line);
+        rules_.push_back(std::move(rule));
+    }
+}
+
+bool IgnoreRules::loadFile(const std::string& path, const std::string& base) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    addRules(buffer.str(), base);
+    return true;
+}
+
+IgnoreRules::Match IgnoreRules::match(std::string_view relativePath, bool isDirectory) const {
+    for (auto it = rules_.rbegin(); it != rules_.rend(); ++it) {
+        const Rule& rule = *it;
+        if (rule.directoryOnly && !isDirectory) continue;
+
+        std::string_view path = relativePath;
+        if (!rule.base.empty()) {
+            if (path.size() <= rule.base.size() || path.compare(0, rule.base.size(), rule.base) != 0 ||
+                path[rule.base.size()] != '/') {
+                continue;
+            }
+            path.remove_prefix(rule.base.size() + 1);
+        }
+
+        if (!rule.anchored) {
+            const size_t slash = path.rfind('/');
+            if (slash != std::string_view::npos) path.remove_prefix(slash + 1);
+        }
+
+        if (globMatch(rule.glob, path)) {
+            return rule.negated ? Match::Whitelisted : Match::Ignored;
+        }
+    }
+    return Match::None;
+}
+
+bool IgnoreRules::isIgnored(std::string_view relativePath, bool isDirectory) const {
+    for (size_t slash = relativePath.find('/'); slash != std::string_view::npos;
+         slash = relativePath.find('/', slash + 1)) {
+        if (match(relativePath.substr(0, slash), true) == Match::Ignored) {
+            return true;
+        }
+    }
+    return match(relativePath, isDirectory) == Match::Ignored;
+}
+
+IgnoreRules IgnoreRules::defaults() {
+    IgnoreRules rules;
+    rules.addRules(".git/\n.hg/\n.svn/\n");
+    return rules;
+}
+
+} // namespace xenon::features
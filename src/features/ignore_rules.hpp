@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xenon::features {
+
+// gitignore-style exclusion rules. Rules from nested .gitignore files are
+// appended after their parents' with the directory they came from as base,
+// so a single ordered list gives git's "last matching rule wins" semantics.
+// Paths are workspace-relative and '/'-separated.
+class IgnoreRules {
+public:
+    enum class Match { None, Ignored, Whitelisted };
+
+    IgnoreRules() = default;
+
+    void addRules(std::string_view text, const std::string& base = "");
+    bool loadFile(const std::string& path, const std::string& base = "");
+
+    // Evaluates only the entry itself; walkers that never descend into
+    // ignored directories need nothing more.
+    Match match(std::string_view relativePath, bool isDirectory) const;
+    // Also treats the path as ignored when any parent directory is.
+    bool isIgnored(std::string_view relativePath, bool isDirectory) const;
+
+    bool empty() const { return rules_.empty(); }
+
+    // Rules applied to every workspace regardless of .gitignore contents.
+    static IgnoreRules defaults();
+
+    static bool globMatch(std::string_view pattern, std::string_view path);
+
+private:
+    struct Rule {
+        std::string base;
+        std::string glob;
+        bool negated = false;
+        bool directoryOnly = false;
+        bool anchored = false;
+    };
+
+    std::vector<Rule> rules_;
+};
+
+} // namespace xenon::features
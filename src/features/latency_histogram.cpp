@@ -0,0 +1,65 @@
+#include "features/latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace xenon::features {
+
+namespace {
+
+int highestBit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+}
+
+} // anonymous namespace
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+    if (micros < kSubBuckets) return static_cast<size_t>(micros);
+    const int exponent = std::min(highestBit(micros), kMaxExponent);
+    const uint64_t sub = exponent == kMaxExponent && micros >> kMaxExponent > 1
+                             ? kSubBuckets - 1
+                             : (micros >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>(kSubBuckets * static_cast<uint64_t>(exponent - kSubBits + 1) + sub);
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const int exponent = static_cast<int>(bucket / kSubBuckets) + kSubBits - 1;
+    const uint64_t sub = bucket % kSubBuckets;
+    // Values (16 + sub) << (exponent - 4) up to the next bucket's start
+    return ((kSubBuckets + sub + 1) << (exponent - kSubBits)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    counts_[bucketOf(micros)]++;
+    count_++;
+    max_ = std::max(max_, micros);
+}
+
+void LatencyHistogram::clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    max_ = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * static_cast<double>(count_))));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts_.size(); ++bucket) {
+        seen += counts_[bucket];
+        if (seen >= rank) return std::min(upperBound(bucket), max_);
+    }
+    return max_;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> LatencyHistogram::buckets() const {
+    std::vector<std::pair<uint64_t, uint64_t>> result;
+    for (size_t bucket = 0; bucket < counts_.size(); ++bucket) {
+        if (counts_[bucket] != 0) result.emplace_back(upperBound(bucket), counts_[bucket]);
+    }
+    return result;
+}
+
+} // namespace xenon::features
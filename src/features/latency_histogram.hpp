@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace xenon::features {
+
+// Counts durations in microseconds in log-linear buckets: exact below 16,
+// then 16 buckets per power of two, so a percentile is within 1/16 of the
+// true value. Recording is a few shifts and an increment; a percentile is
+// one pass over the buckets. Covers up to 2^40 us (about 12 days).
+class LatencyHistogram {
+public:
+    void record(uint64_t micros);
+    void clear();
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    // The upper end of the bucket holding the p-th fraction (0..1) of the
+    // samples, capped at the largest sample; 0 when there are none
+    uint64_t percentile(double p) const;
+    // Upper end and count of each non-empty bucket, in order
+    std::vector<std::pair<uint64_t, uint64_t>> buckets() const;
+
+private:
+    static constexpr int kSubBits = 4;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr size_t kBucketCount = kSubBuckets + (kMaxExponent - kSubBits + 1) * kSubBuckets;
+
+    static size_t bucketOf(uint64_t micros);
+    static uint64_t upperBound(size_t bucket);
+
+    std::vector<uint64_t> counts_ = std::vector<uint64_t>(kBucketCount);
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+} // namespace xenon::features
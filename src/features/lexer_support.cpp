@@ -0,0 +1,26 @@
+#include "features/lexer_support.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+uint32_t delimiterHash(std::u16string_view delimiter) {
+    uint32_t hash = 2166136261u;
+    for (char16_t c : delimiter) hash = (hash ^ c) * 16777619u;
+    return hash & kDelimiterHashMask;
+}
+
+size_t findRawStringEnd(std::u16string_view line, size_t from, uint32_t hash) {
+    for (size_t paren = line.find(u')', from); paren != std::u16string_view::npos;
+         paren = line.find(u')', paren + 1)) {
+        const size_t limit = std::min(line.size(), paren + 2 + kMaxRawDelimiter);
+        for (size_t quote = paren + 1; quote < limit; ++quote) {
+            if (line[quote] == u'"') {
+                if (delimiterHash(line.substr(paren + 1, quote - paren - 1)) == hash) return quote + 1;
+                break;
+            }
+        }
+    }
+    return std::u16string_view::npos;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "features/grammar.hpp"
+
+namespace xenon::features {
+
+// Pieces shared by the table-driven Grammar lexer and CppLexer, so that
+// raw strings, numbers and tokens are read the same way by both.
+
+// Longest raw string delimiter, as in the C++ standard
+constexpr size_t kMaxRawDelimiter = 16;
+// Bits a raw string delimiter hash keeps; shifted above a line state's mode
+// byte they leave its sign bit clear
+constexpr uint32_t kDelimiterHashMask = 0x7fffff;
+
+uint32_t delimiterHash(std::u16string_view delimiter);
+
+// Offset just past the )delim" that closes a raw string whose delimiter
+// hashes to `hash`, or npos
+size_t findRawStringEnd(std::u16string_view line, size_t from, uint32_t hash);
+
+inline void pushToken(std::vector<Token>& tokens, size_t start, size_t end, TokenKind kind) {
+    tokens.push_back(Token{static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), kind});
+}
+
+// End of the pp-number whose first character is at i - 1: digits, letters,
+// dots, digit separators followed by an identifier character, and signs
+// after an exponent letter. A separator of 0 disables separators.
+template <typename IsIdentifierPart>
+size_t scanPpNumber(std::u16string_view line, size_t i, char16_t separator, IsIdentifierPart isIdentifierPart) {
+    const size_t n = line.size();
+    while (i < n) {
+        const char16_t d = line[i];
+        if (isIdentifierPart(d) || d == u'.') {
+            ++i;
+        } else if (separator && d == separator && i + 1 < n && isIdentifierPart(line[i + 1])) {
+            i += 2;
+        } else if ((d == u'+' || d == u'-') &&
+                   (line[i - 1] == u'e' || line[i - 1] == u'E' || line[i - 1] == u'p' || line[i - 1] == u'P')) {
+            ++i;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+} // namespace xenon::features
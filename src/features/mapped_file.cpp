@@ -0,0 +1,77 @@
+#include "features/mapped_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xenon::features {
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return;
+        }
+        data_ = static_cast<const char*>(mapping);
+    }
+
+    ::close(fd);
+    open_ = true;
+}
+
+MappedFile::~MappedFile() {
+    reset();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_), open_(other.open_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.open_ = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = other.data_;
+        size_ = other.size_;
+        open_ = other.open_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+    }
+    return *this;
+}
+
+void MappedFile::reset() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+bool MappedFile::looksBinary(std::string_view data) {
+    if (data.empty()) return false;
+    const size_t probe = std::min<size_t>(data.size(), 8192);
+    return std::memchr(data.data(), '\0', probe) != nullptr;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace xenon::features {
+
+// Read-only memory mapping of a whole file. Empty files and files that fail
+// to open yield an empty view.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool isOpen() const { return open_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+    // Heuristic used by search and indexing: a NUL byte in the first few
+    // kilobytes marks the file as binary.
+    static bool looksBinary(std::string_view data);
+
+private:
+    void reset();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // namespace xenon::features
@@ -0,0 +1,152 @@
+#include "features/multi_cursor.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace xenon::features {
+
+void CursorSet::set(std::vector<CursorRange> ranges, size_t primary) {
+    ranges_ = std::move(ranges);
+    primary_ = std::min(primary, ranges_.empty() ? 0 : ranges_.size() - 1);
+    normalize();
+}
+
+void CursorSet::clear() {
+    ranges_.clear();
+    primary_ = 0;
+}
+
+void CursorSet::setPrimaryRange(const CursorRange& range) {
+    if (ranges_.empty()) {
+        ranges_.push_back(range);
+        primary_ = 0;
+        return;
+    }
+    ranges_[primary_] = range;
+    normalize();
+}
+
+void CursorSet::add(const CursorRange& range) {
+    ranges_.push_back(range);
+    primary_ = ranges_.size() - 1;
+    normalize();
+}
+
+void CursorSet::normalize() {
+    if (ranges_.empty()) return;
+
+    std::vector<size_t> order(ranges_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return ranges_[a].start() < ranges_[b].start();
+    });
+
+    std::vector<CursorRange> merged;
+    merged.reserve(ranges_.size());
+    size_t primary = 0;
+    for (const size_t index : order) {
+        const CursorRange& range = ranges_[index];
+        if (!merged.empty()) {
+            CursorRange& last = merged.back();
+            // Overlapping, starting together, or an empty cursor at the end
+            // of a selection
+            if (range.start() < last.end() || range.start() == last.start() ||
+                (range.empty() && range.start() == last.end())) {
+                const int start = last.start();
+                const int end = std::max(last.end(), range.end());
+                const bool backward = last.position < last.anchor;
+                last.anchor = backward ? end : start;
+                last.position = backward ? start : end;
+                if (index == primary_) primary = merged.size() - 1;
+                continue;
+            }
+        }
+        if (index == primary_) primary = merged.size();
+        merged.push_back(range);
+    }
+    ranges_ = std::move(merged);
+    primary_ = primary;
+}
+
+std::vector<TextEdit> CursorSet::replace(const std::vector<std::u16string>& texts) {
+    std::vector<TextEdit> edits;
+    if (ranges_.empty() || texts.empty()) return edits;
+    const bool each = texts.size() == ranges_.size();
+
+    edits.reserve(ranges_.size());
+    int delta = 0;
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        CursorRange& range = ranges_[i];
+        const std::u16string& text = texts[each ? i : 0];
+        edits.push_back(TextEdit{range.start(), range.end(), text});
+
+        const int length = static_cast<int>(text.size());
+        const int position = range.start() + delta + length;
+        delta += length - (range.end() - range.start());
+        range.anchor = range.position = position;
+    }
+    normalize();
+    return edits;
+}
+
+std::vector<TextEdit> CursorSet::erase(int before, int after, int length) {
+    std::vector<TextEdit> edits;
+    if (ranges_.empty()) return edits;
+
+    // Spans of neighbouring cursors can overlap (two cursors a character
+    // apart both deleting towards each other); they become one edit
+    int delta = 0;
+    size_t first = 0; // the cursors of the span being grown
+    int spanStart = -1;
+    int spanEnd = -1;
+    auto flush = [&](size_t last) {
+        if (spanStart < 0) return;
+        for (size_t j = first; j < last; ++j) {
+            ranges_[j].anchor = ranges_[j].position = spanStart + delta;
+        }
+        if (spanEnd > spanStart) edits.push_back(TextEdit{spanStart, spanEnd, {}});
+        delta -= spanEnd - spanStart;
+    };
+
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        const CursorRange& range = ranges_[i];
+        int start = range.start();
+        int end = range.end();
+        if (range.empty()) {
+            start = std::max(0, start - before);
+            end = std::min(length, end + after);
+        }
+        if (spanStart >= 0 && start <= spanEnd) {
+            spanEnd = std::max(spanEnd, end);
+            continue;
+        }
+        flush(i);
+        first = i;
+        spanStart = start;
+        spanEnd = end;
+    }
+    flush(ranges_.size());
+    normalize();
+    return edits;
+}
+
+void CursorSet::applyChange(int position, int removed, int added) {
+    if (ranges_.empty()) return;
+    auto move = [&](int offset) {
+        if (offset >= position + removed) return offset + added - removed;
+        if (offset > position) return position;
+        return offset;
+    };
+    for (size_t i = lowerBound(position); i < ranges_.size(); ++i) {
+        ranges_[i].anchor = move(ranges_[i].anchor);
+        ranges_[i].position = move(ranges_[i].position);
+    }
+    normalize();
+}
+
+size_t CursorSet::lowerBound(int position) const {
+    const auto it = std::partition_point(ranges_.begin(), ranges_.end(),
+                                         [position](const CursorRange& range) { return range.end() < position; });
+    return static_cast<size_t>(it - ranges_.begin());
+}
+
+} // namespace xenon::features
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xenon::features {
+
+// A cursor with its selection, as UTF-16 offsets into the document
+struct CursorRange {
+    int anchor = 0;
+    int position = 0;
+
+    int start() const { return anchor < position ? anchor : position; }
+    int end() const { return anchor < position ? position : anchor; }
+    bool empty() const { return anchor == position; }
+};
+
+// Replaces start..end of the document with text
+struct TextEdit {
+    int start = 0;
+    int end = 0;
+    std::u16string text;
+};
+
+// The cursors of a multi-cursor session, sorted by position with
+// overlapping ones merged, and which of them is the primary one.
+//
+// An edit at every cursor is worked out here as one list of edits, sorted
+// and disjoint, together with where each cursor ends up, in a single pass:
+// each cursor moves by the change in length of the edits before it. The
+// caller applies the list back to front in one undoable step, so however
+// many cursors there are the document reports a single change.
+class CursorSet {
+public:
+    // Sorts and merges ranges; primary indexes ranges as given
+    void set(std::vector<CursorRange> ranges, size_t primary);
+    void clear();
+
+    const std::vector<CursorRange>& ranges() const { return ranges_; }
+    size_t size() const { return ranges_.size(); }
+    bool empty() const { return ranges_.empty(); }
+    size_t primary() const { return primary_; }
+    const CursorRange& primaryRange() const { return ranges_[primary_]; }
+    void setPrimaryRange(const CursorRange& range);
+
+    // Adds a cursor, merging it with any it overlaps, and makes it primary
+    void add(const CursorRange& range);
+
+    // Replaces every selection, or inserts at every cursor, with text; or
+    // with texts[i] at cursor i when there is one text per cursor. The
+    // cursors end up after what they inserted.
+    std::vector<TextEdit> replace(const std::vector<std::u16string>& texts);
+    // Deletes every selection; an empty one takes `before` characters
+    // before the cursor and `after` after it, within 0..length
+    std::vector<TextEdit> erase(int before, int after, int length);
+
+    // Follows a change made to the document some other way
+    void applyChange(int position, int removed, int added);
+
+    // The first range ending at or after position, for finding the ones in
+    // view
+    size_t lowerBound(int position) const;
+
+private:
+    // Sorts, merges ranges that overlap (or empty ones at the same
+    // position) and keeps primary_ on the range it was in
+    void normalize();
+
+    std::vector<CursorRange> ranges_;
+    size_t primary_ = 0;
+};
+
+} // namespace xenon::features
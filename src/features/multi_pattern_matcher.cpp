@@ -0,0 +1,165 @@
+#include "features/multi_pattern_matcher.hpp"
+#include <cctype>
+#include <deque>
+#include <type_traits>
+
+namespace xenon::features {
+
+namespace {
+
+bool isWordUnit(uint32_t unit) {
+    if (unit >= 128) return true;
+    return std::isalnum(static_cast<int>(unit)) || unit == '_';
+}
+
+} // anonymous namespace
+
+MultiPatternMatcher::MultiPatternMatcher(const std::vector<std::string>& patterns, bool caseSensitive) {
+    auto fold = [caseSensitive](unsigned char c) {
+        return caseSensitive ? c : static_cast<unsigned char>(std::tolower(c));
+    };
+
+    // Only bytes that occur in some pattern get their own class; everything
+    // else shares class 0, which keeps the DFA rows short.
+    for (const auto& pattern : patterns) {
+        for (unsigned char c : pattern) {
+            const unsigned char folded = fold(c);
+            if (byte_classes_[folded] == 0) {
+                byte_classes_[folded] = static_cast<uint16_t>(class_count_++);
+            }
+        }
+    }
+    if (!caseSensitive) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            byte_classes_[c] = byte_classes_[std::tolower(c)];
+        }
+    }
+
+    // Build the trie. State 0 is the root; 0 in a transition slot means
+    // "no edge yet" until the failure pass fills it in.
+    std::vector<std::vector<uint32_t>> ownOutputs(1);
+    transitions_.assign(class_count_, 0);
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        const std::string& pattern = patterns[id];
+        pattern_lengths_.push_back(pattern.size());
+        if (pattern.empty()) continue;
+
+        uint32_t state = 0;
+        for (unsigned char c : pattern) {
+            const size_t slot = state * class_count_ + byte_classes_[fold(c)];
+            if (transitions_[slot] == 0) {
+                transitions_[slot] = static_cast<uint32_t>(ownOutputs.size());
+                ownOutputs.emplace_back();
+                transitions_.resize(transitions_.size() + class_count_, 0);
+            }
+            state = transitions_[slot];
+        }
+        ownOutputs[state].push_back(static_cast<uint32_t>(id));
+    }
+
+    // Breadth-first failure computation, completing the goto function into a
+    // full DFA and merging each state's outputs with those of its failure.
+    const size_t stateCount = ownOutputs.size();
+    std::vector<uint32_t> failure(stateCount, 0);
+    std::vector<uint32_t> order;
+    order.reserve(stateCount);
+    std::deque<uint32_t> queue;
+    for (size_t cls = 0; cls < class_count_; ++cls) {
+        const uint32_t next = transitions_[cls];
+        if (next != 0) {
+            queue.push_back(next);
+        }
+    }
+    while (!queue.empty()) {
+        const uint32_t state = queue.front();
+        queue.pop_front();
+        order.push_back(state);
+        for (size_t cls = 0; cls < class_count_; ++cls) {
+            const size_t slot = state * class_count_ + cls;
+            const uint32_t fallback = transitions_[failure[state] * class_count_ + cls];
+            if (transitions_[slot] != 0) {
+                failure[transitions_[slot]] = fallback;
+                queue.push_back(transitions_[slot]);
+            } else {
+                transitions_[slot] = fallback;
+            }
+        }
+    }
+
+    output_starts_.assign(stateCount + 1, 0);
+    std::vector<std::vector<uint32_t>> merged(stateCount);
+    merged[0] = ownOutputs[0];
+    for (uint32_t state : order) {
+        merged[state] = ownOutputs[state];
+        const auto& inherited = merged[failure[state]];
+        merged[state].insert(merged[state].end(), inherited.begin(), inherited.end());
+    }
+    for (size_t state = 0; state < stateCount; ++state) {
+        output_starts_[state] = static_cast<uint32_t>(outputs_.size());
+        outputs_.insert(outputs_.end(), merged[state].begin(), merged[state].end());
+    }
+    output_starts_[stateCount] = static_cast<uint32_t>(outputs_.size());
+}
+
+std::vector<PatternMatch> MultiPatternMatcher::findAll(std::string_view text, bool wholeWord) const {
+    return scan(text.data(), text.size(), wholeWord);
+}
+
+std::vector<PatternMatch> MultiPatternMatcher::findAll(std::u16string_view text, bool wholeWord) const {
+    return scan(text.data(), text.size(), wholeWord);
+}
+
+bool MultiPatternMatcher::containsAll(std::string_view text) const {
+    // The empty pattern occurs everywhere
+    std::vector<uint8_t> seen(pattern_lengths_.size(), 0);
+    size_t remaining = 0;
+    for (size_t id = 0; id < pattern_lengths_.size(); ++id) {
+        if (pattern_lengths_[id] == 0) {
+            seen[id] = 1;
+        } else {
+            remaining++;
+        }
+    }
+    if (remaining == 0) {
+        return true;
+    }
+
+    uint32_t state = 0;
+    for (char c : text) {
+        state = transitions_[state * class_count_ + classOf(static_cast<unsigned char>(c))];
+        for (uint32_t o = output_starts_[state]; o < output_starts_[state + 1]; ++o) {
+            if (seen[outputs_[o]]) continue;
+            seen[outputs_[o]] = 1;
+            if (--remaining == 0) return true;
+        }
+    }
+    return false;
+}
+
+template <typename CharT>
+std::vector<PatternMatch> MultiPatternMatcher::scan(const CharT* text, size_t length, bool wholeWord) const {
+    using Unit = std::make_unsigned_t<CharT>;
+    std::vector<PatternMatch> results;
+    if (transitions_.empty() || outputs_.empty()) {
+        return results;
+    }
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < length; ++i) {
+        state = transitions_[state * class_count_ + classOf(static_cast<Unit>(text[i]))];
+        const uint32_t begin = output_starts_[state];
+        const uint32_t end = output_starts_[state + 1];
+        for (uint32_t o = begin; o < end; ++o) {
+            const size_t patternLength = pattern_lengths_[outputs_[o]];
+            const size_t start = i + 1 - patternLength;
+            if (wholeWord) {
+                if (start > 0 && isWordUnit(static_cast<Unit>(text[start - 1]))) continue;
+                if (i + 1 < length && isWordUnit(static_cast<Unit>(text[i + 1]))) continue;
+            }
+            results.push_back(PatternMatch{start, patternLength, outputs_[o]});
+        }
+    }
+    return results;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xenon::features {
+
+struct PatternMatch {
+    size_t offset;
+    size_t length;
+    size_t pattern; // index into the pattern list the matcher was built from
+};
+
+// Aho-Corasick automaton over a fixed set of literal patterns. The trie is
+// compiled into a dense DFA over byte equivalence classes, so a scan is one
+// table lookup per input unit regardless of how many patterns there are.
+class MultiPatternMatcher {
+public:
+    MultiPatternMatcher() = default;
+    explicit MultiPatternMatcher(const std::vector<std::string>& patterns, bool caseSensitive = true);
+
+    size_t patternCount() const { return pattern_lengths_.size(); }
+    bool empty() const { return pattern_lengths_.empty(); }
+
+    // Returns every (possibly overlapping) occurrence, ordered by end offset.
+    // With wholeWord set, matches touching a word character on either side
+    // are dropped. Case folding is ASCII-only; UTF-16 units above 0xFF never
+    // match a pattern byte and count as word characters.
+    std::vector<PatternMatch> findAll(std::string_view text, bool wholeWord = false) const;
+    std::vector<PatternMatch> findAll(std::u16string_view text, bool wholeWord = false) const;
+
+    // True when every pattern occurs somewhere in text. Stops at the point
+    // the last one is seen instead of collecting matches.
+    bool containsAll(std::string_view text) const;
+
+private:
+    template <typename CharT>
+    std::vector<PatternMatch> scan(const CharT* text, size_t length, bool wholeWord) const;
+
+    uint16_t classOf(uint32_t unit) const { return unit < 256 ? byte_classes_[unit] : 0; }
+
+    uint16_t byte_classes_[256] = {};
+    size_t class_count_ = 1;
+    std::vector<uint32_t> transitions_;   // state * class_count_ + class -> state
+    std::vector<uint32_t> output_starts_; // state -> range in outputs_
+    std::vector<uint32_t> outputs_;       // pattern ids, own and inherited via failure links
+    std::vector<size_t> pattern_lengths_;
+};
+
+} // namespace xenon::features
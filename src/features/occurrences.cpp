@@ -0,0 +1,38 @@
+#include "features/occurrences.hpp"
+
+namespace xenon::features {
+
+bool isWordChar(char16_t c) {
+    if (c < 0x80) {
+        return (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z') || (c >= u'0' && c <= u'9') || c == u'_';
+    }
+    // Spaces and separators, among them the one a document's selected text
+    // puts between lines
+    return c != 0x00a0 && c != 0x1680 && !(c >= 0x2000 && c <= 0x200a) && c != 0x2028 && c != 0x2029 &&
+           c != 0x202f && c != 0x205f && c != 0x3000 && c != 0xfeff;
+}
+
+std::pair<size_t, size_t> wordAt(std::u16string_view line, size_t column) {
+    if (column > line.size()) column = line.size();
+    size_t start = column;
+    size_t end = column;
+    while (start > 0 && isWordChar(line[start - 1])) --start;
+    while (end < line.size() && isWordChar(line[end])) ++end;
+    return {start, end};
+}
+
+std::vector<DecorationRange> findWordOccurrences(std::u16string_view text, int base, std::u16string_view word) {
+    std::vector<DecorationRange> ranges;
+    if (word.empty()) return ranges;
+
+    for (size_t at = text.find(word); at != std::u16string_view::npos; at = text.find(word, at + 1)) {
+        const size_t end = at + word.size();
+        if (at > 0 && isWordChar(text[at - 1])) continue;
+        if (end < text.size() && isWordChar(text[end])) continue;
+        ranges.push_back({base + static_cast<int>(at), base + static_cast<int>(end)});
+        at = end - 1;
+    }
+    return ranges;
+}
+
+} // namespace xenon::features
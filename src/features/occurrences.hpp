@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "features/decorations.hpp"
+
+namespace xenon::features {
+
+// Letters, digits and underscores, and anything outside ASCII but spaces
+// and line separators, which is taken to be part of an identifier
+bool isWordChar(char16_t c);
+
+// The word around column of line, touching it on either side, as start and
+// end columns; start == end when there is none
+std::pair<size_t, size_t> wordAt(std::u16string_view line, size_t column);
+
+// Where word occurs in text as a whole word, i.e. not next to another word
+// character, as positions offset by base. For the document lines around
+// the view when no language server says which occurrences are the same
+// symbol; a literal scan, linear in the text.
+std::vector<DecorationRange> findWordOccurrences(std::u16string_view text, int base, std::u16string_view word);
+
+} // namespace xenon::features
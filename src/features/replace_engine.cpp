@@ -0,0 +1,285 @@
+#include "features/replace_engine.hpp"
+#include "features/search_engine.hpp"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <regex>
+#include <unordered_map>
+#include <vector>
+
+namespace xenon::features {
+
+namespace {
+
+// std::regex has no named groups, so (?<name>...) is rewritten to a plain
+// capturing group and the name is remembered for ${name} substitutions.
+struct TranslatedPattern {
+    std::string pattern;
+    std::unordered_map<std::string, size_t> groupNames;
+    size_t groupCount = 0;
+};
+
+TranslatedPattern translatePattern(const std::string& pattern) {
+    TranslatedPattern result;
+    result.pattern.reserve(pattern.size());
+
+    bool inClass = false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '\\' && i + 1 < pattern.size()) {
+            result.pattern += c;
+            result.pattern += pattern[++i];
+            continue;
+        }
+        if (inClass) {
+            if (c == ']') inClass = false;
+            result.pattern += c;
+            continue;
+        }
+        if (c == '[') {
+            inClass = true;
+            result.pattern += c;
+            continue;
+        }
+        if (c == '(') {
+            const bool special = i + 1 < pattern.size() && pattern[i + 1] == '?';
+            if (!special) {
+                result.groupCount++;
+            } else if (i + 2 < pattern.size() && pattern[i + 2] == '<' &&
+                       i + 3 < pattern.size() && pattern[i + 3] != '=' && pattern[i + 3] != '!') {
+                const size_t close = pattern.find('>', i + 3);
+                if (close != std::string::npos) {
+                    result.groupCount++;
+                    result.groupNames[pattern.substr(i + 3, close - i - 3)] = result.groupCount;
+                    result.pattern += '(';
+                    i = close;
+                    continue;
+                }
+            }
+        }
+        result.pattern += c;
+    }
+    return result;
+}
+
+// The replacement is parsed once into literal runs and group references so
+// that expanding it per match is a plain append loop.
+struct ReplacementPart {
+    std::string literal;
+    size_t group = 0;
+    bool isGroup = false;
+};
+
+void appendLiteral(std::vector<ReplacementPart>& parts, char c) {
+    if (parts.empty() || parts.back().isGroup) {
+        parts.push_back(ReplacementPart{});
+    }
+    parts.back().literal += c;
+}
+
+std::vector<ReplacementPart> parseReplacement(const std::string& replacement,
+                                              const TranslatedPattern& pattern) {
+    std::vector<ReplacementPart> parts;
+    auto pushGroup = [&parts](size_t group) {
+        ReplacementPart part;
+        part.group = group;
+        part.isGroup = true;
+        parts.push_back(std::move(part));
+    };
+
+    for (size_t i = 0; i < replacement.size(); ++i) {
+        const char c = replacement[i];
+        const char next = i + 1 < replacement.size() ? replacement[i + 1] : '\0';
+
+        if (c == '\\' && (next == 'n' || next == 't' || next == '\\')) {
+            appendLiteral(parts, next == 'n' ? '\n' : next == 't' ? '\t' : '\\');
+            ++i;
+            continue;
+        }
+        if (c != '$' || next == '\0') {
+            appendLiteral(parts, c);
+            continue;
+        }
+
+        if (next == '$') {
+            appendLiteral(parts, '$');
+            ++i;
+        } else if (next == '&') {
+            pushGroup(0);
+            ++i;
+        } else if (std::isdigit(static_cast<unsigned char>(next))) {
+            size_t group = static_cast<size_t>(next - '0');
+            size_t consumed = 1;
+            // Prefer a two-digit reference only when that group exists.
+            if (i + 2 < replacement.size() &&
+                std::isdigit(static_cast<unsigned char>(replacement[i + 2]))) {
+                const size_t twoDigit = group * 10 + static_cast<size_t>(replacement[i + 2] - '0');
+                if (twoDigit <= pattern.groupCount) {
+                    group = twoDigit;
+                    consumed = 2;
+                }
+            }
+            if (group <= pattern.groupCount) {
+                pushGroup(group);
+                i += consumed;
+            } else {
+                appendLiteral(parts, c);
+            }
+        } else if (next == '{' || next == '<') {
+            const char closer = next == '{' ? '}' : '>';
+            const size_t close = replacement.find(closer, i + 2);
+            if (close == std::string::npos) {
+                appendLiteral(parts, c);
+                continue;
+            }
+            // Unknown names expand to nothing, matching common editors.
+            const std::string name = replacement.substr(i + 2, close - i - 2);
+            auto it = pattern.groupNames.find(name);
+            if (it != pattern.groupNames.end()) {
+                pushGroup(it->second);
+            } else if (!name.empty() && name.size() < 3 &&
+                       std::all_of(name.begin(), name.end(),
+                                   [](unsigned char ch) { return std::isdigit(ch); }) &&
+                       std::stoul(name) <= pattern.groupCount) {
+                pushGroup(std::stoul(name));
+            }
+            i = close;
+        } else {
+            appendLiteral(parts, c);
+        }
+    }
+    return parts;
+}
+
+} // anonymous namespace
+
+struct Replacer::Compiled {
+    std::string pattern;
+    std::string replacement;
+    bool caseSensitive = true;
+    bool useRegex = false;
+    std::regex regex;
+    std::vector<ReplacementPart> parts;
+};
+
+Replacer::Replacer(
+    const std::string& pattern,
+    const std::string& replacement,
+    bool caseSensitive,
+    bool useRegex) {
+    if (pattern.empty()) {
+        return;
+    }
+
+    auto compiled = std::make_shared<Compiled>();
+    compiled->pattern = pattern;
+    compiled->replacement = replacement;
+    compiled->caseSensitive = caseSensitive;
+    compiled->useRegex = useRegex;
+
+    if (useRegex) {
+        const TranslatedPattern translated = translatePattern(pattern);
+        try {
+            auto flags = std::regex_constants::ECMAScript;
+            if (!caseSensitive) {
+                flags |= std::regex_constants::icase;
+            }
+            compiled->regex = std::regex(translated.pattern, flags);
+        } catch (const std::regex_error&) {
+            // Invalid regex pattern, nothing to replace
+            return;
+        }
+        compiled->parts = parseReplacement(replacement, translated);
+    }
+    compiled_ = std::move(compiled);
+}
+
+size_t Replacer::forEachEdit(std::string_view text, const EditCallback& onEdit, size_t* skippedLines) const {
+    if (skippedLines) *skippedLines = 0;
+    if (!compiled_ || text.empty()) {
+        return 0;
+    }
+    const Compiled& c = *compiled_;
+    size_t count = 0;
+
+    if (c.useRegex) {
+        std::string expanded;
+        forEachLineMatch(text, c.regex, [&](const std::cmatch& match, size_t lineStart) {
+            expanded.clear();
+            for (const auto& part : c.parts) {
+                if (!part.isGroup) {
+                    expanded.append(part.literal);
+                } else if (part.group < match.size() && match[part.group].matched) {
+                    expanded.append(match[part.group].first, match[part.group].second);
+                }
+            }
+            onEdit(lineStart + static_cast<size_t>(match.position()), static_cast<size_t>(match.length()), expanded);
+            count++;
+        }, skippedLines);
+        return count;
+    }
+
+    if (c.pattern.size() > text.size()) {
+        return 0;
+    }
+
+    if (c.caseSensitive) {
+        size_t pos = 0;
+        while ((pos = text.find(c.pattern, pos)) != std::string_view::npos) {
+            onEdit(pos, c.pattern.size(), c.replacement);
+            count++;
+            pos += c.pattern.size();
+        }
+        return count;
+    }
+
+    // Case-insensitive search folds bytes on the fly instead of copying the text
+    auto fold = [](char ch) { return static_cast<char>(std::tolower(static_cast<unsigned char>(ch))); };
+    auto hash = [fold](char ch) { return std::hash<char>()(fold(ch)); };
+    auto equal = [fold](char a, char b) { return fold(a) == fold(b); };
+    const std::boyer_moore_horspool_searcher searcher(c.pattern.begin(), c.pattern.end(), hash, equal);
+
+    auto it = text.begin();
+    while (true) {
+        auto found = searcher(it, text.end()).first;
+        if (found == text.end()) break;
+        onEdit(static_cast<size_t>(found - text.begin()), c.pattern.size(), c.replacement);
+        count++;
+        it = found + static_cast<std::ptrdiff_t>(c.pattern.size());
+    }
+    return count;
+}
+
+ReplaceResult Replacer::replaceAll(std::string_view text) const {
+    ReplaceResult result;
+    size_t copied = std::string_view::npos;
+    result.count = forEachEdit(text, [&](size_t offset, size_t length, std::string_view replacement) {
+        if (copied == std::string_view::npos) {
+            result.spanStart = offset;
+        } else {
+            result.text.append(text.substr(copied, offset - copied));
+        }
+        result.text.append(replacement);
+        copied = offset + length;
+    }, &result.skippedLines);
+
+    if (result.count > 0) {
+        result.spanEnd = copied;
+    }
+    return result;
+}
+
+ReplaceResult ReplaceEngine::replaceAll(
+    const std::string& text,
+    const std::string& pattern,
+    const std::string& replacement,
+    bool caseSensitive,
+    bool useRegex) {
+    if (pattern.empty() || text.empty()) {
+        return ReplaceResult{};
+    }
+
+    return Replacer(pattern, replacement, caseSensitive, useRegex).replaceAll(text);
+}
+
+} // namespace xenon::features
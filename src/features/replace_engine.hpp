@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace xenon::features {
+
+struct ReplaceResult {
+    // Replacement text for the byte span [spanStart, spanEnd) of the input.
+    // Everything outside the span is untouched, so callers can commit the
+    // result as a single edit instead of one edit per match.
+    std::string text;
+    size_t spanStart = 0;
+    size_t spanEnd = 0;
+    size_t count = 0;
+    size_t skippedLines = 0; // lines the regex could not be matched on
+};
+
+// A pattern and replacement compiled once and reusable across many texts.
+// Matching is const and safe to share between threads, which lets workspace
+// replace run one replacer over every file. Regexes are matched line by line
+// exactly as SearchMatcher matches them, so a replace changes what the
+// search showed and nothing else.
+class Replacer {
+public:
+    // Called once per match, in order, with the expanded replacement.
+    using EditCallback = std::function<void(size_t offset, size_t length, std::string_view replacement)>;
+
+    Replacer(
+        const std::string& pattern,
+        const std::string& replacement,
+        bool caseSensitive = true,
+        bool useRegex = false
+    );
+
+    bool isValid() const { return compiled_ != nullptr; }
+
+    // Visits every non-overlapping match without building the output, so a
+    // caller can stream the result or only count. Returns the match count;
+    // skippedLines, if given, receives the lines a regex was not run on.
+    size_t forEachEdit(std::string_view text, const EditCallback& onEdit, size_t* skippedLines = nullptr) const;
+
+    ReplaceResult replaceAll(std::string_view text) const;
+
+private:
+    struct Compiled;
+    std::shared_ptr<const Compiled> compiled_;
+};
+
+class ReplaceEngine {
+public:
+    // Replaces every match of `pattern` in one linear pass. In regex mode the
+    // replacement may reference capture groups with $1..$99, ${name} or
+    // $<name> (for (?<name>...) groups), $& / $0 for the whole match and $$
+    // for a literal dollar; \n, \t and \\ are expanded as well.
+    static ReplaceResult replaceAll(
+        const std::string& text,
+        const std::string& pattern,
+        const std::string& replacement,
+        bool caseSensitive = true,
+        bool useRegex = false
+    );
+};
+
+} // namespace xenon::features
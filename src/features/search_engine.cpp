@@ -1,67 +1,126 @@
 #include "features/search_engine.hpp"
 #include <algorithm>
 #include <cctype>
-#include <regex>
+#include <functional>
 
 namespace xenon::features {
 
-std::vector<SearchResult> SearchEngine::findAll(
-    const std::string& text,
-    const std::string& pattern,
-    bool caseSensitive,
-    bool useRegex) {
-    std::vector<SearchResult> results;
+void forEachLineMatch(std::string_view text, const std::regex& regex, const LineMatchCallback& onMatch,
+                      size_t* skippedLines) {
+    if (skippedLines) *skippedLines = 0;
+
+    // ECMAScript has no multiline mode, so lines are matched one at a time
+    // for ^ and $ to mean line start and end. It also keeps the backtracking
+    // matcher's recursion bounded by the line length.
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        const size_t next = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        if (lineEnd > lineStart && text[lineEnd - 1] == '\r') lineEnd--;
+
+        if (lineEnd - lineStart > SearchMatcher::kMaxRegexLineLength) {
+            if (skippedLines) ++*skippedLines;
+        } else {
+            try {
+                auto begin = std::cregex_iterator(text.data() + lineStart, text.data() + lineEnd, regex);
+                auto end = std::cregex_iterator();
+                for (auto it = begin; it != end; ++it) {
+                    if (it->length() == 0) continue; // nothing to highlight or replace
+                    onMatch(*it, lineStart);
+                }
+            } catch (const std::regex_error&) {
+                // Too complex to match on this line (error_complexity or
+                // error_stack); move on to the next one
+                if (skippedLines) ++*skippedLines;
+            }
+        }
+        lineStart = next;
+    }
+}
 
-    if (pattern.empty() || text.empty()) {
-        return results;
+SearchMatcher::SearchMatcher(const std::string& pattern, bool caseSensitive, bool useRegex)
+    : pattern_(pattern), case_sensitive_(caseSensitive), use_regex_(useRegex) {
+    if (pattern_.empty()) {
+        return;
     }
 
-    if (useRegex) {
+    if (use_regex_) {
         try {
             auto flags = std::regex_constants::ECMAScript;
-            if (!caseSensitive) {
+            if (!case_sensitive_) {
                 flags |= std::regex_constants::icase;
             }
-            std::regex re(pattern, flags);
-            auto begin = std::sregex_iterator(text.begin(), text.end(), re);
-            auto end = std::sregex_iterator();
-
-            for (auto it = begin; it != end; ++it) {
-                auto matchOffset = static_cast<size_t>(it->position());
-                auto matchLength = static_cast<size_t>(it->length());
-                if (matchLength == 0) break; // Avoid infinite loop on zero-length matches
-                results.emplace_back(SearchResult{matchOffset, matchLength});
-            }
+            regex_ = std::regex(pattern_, flags);
         } catch (const std::regex_error&) {
-            // Invalid regex pattern, return empty results
+            // Invalid regex pattern, matcher never matches
+            return;
         }
+    }
+    valid_ = true;
+}
+
+std::vector<SearchResult> SearchMatcher::findAll(std::string_view text, size_t* skippedLines) const {
+    std::vector<SearchResult> results;
+    if (skippedLines) *skippedLines = 0;
+
+    if (!valid_ || text.empty()) {
         return results;
     }
 
-    // Literal search
-    if (pattern.length() > text.length()) {
+    if (use_regex_) {
+        forEachLineMatch(text, regex_, [&results](const std::cmatch& match, size_t lineStart) {
+            results.push_back(SearchResult{lineStart + static_cast<size_t>(match.position()),
+                                           static_cast<size_t>(match.length())});
+        }, skippedLines);
         return results;
     }
 
-    std::string searchText = text;
-    std::string searchPattern = pattern;
+    // Literal search
+    if (pattern_.length() > text.length()) {
+        return results;
+    }
 
-    if (!caseSensitive) {
-        std::transform(searchText.begin(), searchText.end(), searchText.begin(),
-                      [](unsigned char c) { return std::tolower(c); });
-        std::transform(searchPattern.begin(), searchPattern.end(), searchPattern.begin(),
-                      [](unsigned char c) { return std::tolower(c); });
+    if (case_sensitive_) {
+        size_t pos = 0;
+        while ((pos = text.find(pattern_, pos)) != std::string_view::npos) {
+            results.emplace_back(SearchResult{pos, pattern_.length()});
+            pos++;
+        }
+        return results;
     }
 
-    size_t pos = 0;
-    while ((pos = searchText.find(searchPattern, pos)) != std::string::npos) {
-        results.emplace_back(SearchResult{pos, searchPattern.length()});
-        pos++;
+    // Case-insensitive search folds bytes on the fly instead of copying the text
+    auto fold = [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); };
+    auto hash = [fold](char c) { return std::hash<char>()(fold(c)); };
+    auto equal = [fold](char a, char b) { return fold(a) == fold(b); };
+    const std::boyer_moore_horspool_searcher searcher(pattern_.begin(), pattern_.end(), hash, equal);
+
+    auto it = text.begin();
+    while (true) {
+        auto found = searcher(it, text.end()).first;
+        if (found == text.end()) break;
+        results.emplace_back(SearchResult{static_cast<size_t>(found - text.begin()), pattern_.length()});
+        it = found + 1;
     }
 
     return results;
 }
 
+std::vector<SearchResult> SearchEngine::findAll(
+    std::string_view text,
+    const std::string& pattern,
+    bool caseSensitive,
+    bool useRegex,
+    size_t* skippedLines) {
+    if (skippedLines) *skippedLines = 0;
+    if (pattern.empty() || text.empty()) {
+        return {};
+    }
+
+    return SearchMatcher(pattern, caseSensitive, useRegex).findAll(text, skippedLines);
+}
+
 SearchResult SearchEngine::findNext(
     const std::string& text,
     const std::string& pattern,
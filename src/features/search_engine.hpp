@@ -1,6 +1,9 @@
 #pragma once
 
+#include <functional>
+#include <regex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "core/text_range.hpp"
 
@@ -11,13 +14,50 @@ struct SearchResult {
     size_t length;
 };
 
+// Runs a regex over text one line at a time: ^ and $ anchor at line
+// boundaries, a match never spans lines and empty matches are dropped.
+// Lines longer than SearchMatcher::kMaxRegexLineLength, or too complex for
+// the matcher, are counted in skippedLines instead. onMatch receives each
+// match, positioned relative to the offset of its line. Search and replace
+// both match through here so that they always agree.
+using LineMatchCallback = std::function<void(const std::cmatch& match, size_t lineStart)>;
+void forEachLineMatch(std::string_view text, const std::regex& regex, const LineMatchCallback& onMatch,
+                      size_t* skippedLines = nullptr);
+
+// A pattern compiled once and reusable across many texts. Matching is const
+// and safe to share between threads, which lets workspace search run one
+// matcher over every file. Regexes are matched line by line, so ^ and $
+// anchor at line boundaries and a match never spans lines.
+class SearchMatcher {
+public:
+    // Longer lines (minified bundles, data dumps) are not matched against a
+    // regex, whose recursive matcher could exhaust the stack on them
+    static constexpr size_t kMaxRegexLineLength = 64 * 1024;
+
+    SearchMatcher(const std::string& pattern, bool caseSensitive = true, bool useRegex = false);
+
+    bool isValid() const { return valid_; }
+    // skippedLines, if given, receives the number of lines a regex could
+    // not be matched on: too long, or too complex for the matcher. Callers
+    // tell the user, since a match there is missing from the results.
+    std::vector<SearchResult> findAll(std::string_view text, size_t* skippedLines = nullptr) const;
+
+private:
+    std::string pattern_;
+    bool case_sensitive_;
+    bool use_regex_;
+    bool valid_ = false;
+    std::regex regex_;
+};
+
 class SearchEngine {
 public:
     static std::vector<SearchResult> findAll(
-        const std::string& text,
+        std::string_view text,
         const std::string& pattern,
         bool caseSensitive = true,
-        bool useRegex = false
+        bool useRegex = false,
+        size_t* skippedLines = nullptr
     );
 
     static SearchResult findNext(
@@ -0,0 +1,174 @@
+#include "features/semantic_tokens.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr size_t kIntsPerToken = 5;
+
+// Decodes count packed tokens, each relative to the one before; a token
+// on a new line restarts its column from zero
+void decode(const uint32_t* data, size_t count, uint32_t line, uint32_t start, std::vector<SemanticToken>& out) {
+    for (size_t i = 0; i < count; ++i, data += kIntsPerToken) {
+        if (data[0] != 0) {
+            line += data[0];
+            start = data[1];
+        } else {
+            start += data[1];
+        }
+        out.push_back({line, start, data[2], data[3], data[4]});
+    }
+}
+
+struct ByLine {
+    bool operator()(const SemanticToken& token, uint32_t line) const { return token.line < line; }
+    bool operator()(uint32_t line, const SemanticToken& token) const { return line < token.line; }
+};
+
+// Adds the lines of tokens first..last, clamped to the tokens there are
+void addLines(const std::vector<SemanticToken>& tokens, size_t first, size_t last, SemanticTokensUpdate& update) {
+    if (tokens.empty()) return;
+    const int from = static_cast<int>(tokens[std::min(first, tokens.size() - 1)].line);
+    const int to = static_cast<int>(tokens[std::min(last, tokens.size() - 1)].line);
+    update.firstLine = update.empty() ? from : std::min(update.firstLine, from);
+    update.lastLine = std::max(update.lastLine, to);
+}
+
+} // anonymous namespace
+
+SemanticTokensUpdate SemanticTokenCache::setFull(std::string resultId, std::vector<uint32_t> data) {
+    data.resize(data.size() - data.size() % kIntsPerToken);
+
+    // Servers that don't do deltas still mostly resend what they sent
+    // before, so the full result is applied as a single edit between the
+    // common prefix and suffix of the two arrays
+    const size_t common = std::min(data.size(), data_.size());
+    size_t prefix = 0;
+    while (prefix < common && data[prefix] == data_[prefix]) ++prefix;
+    size_t suffix = 0;
+    while (suffix < common - prefix && data[data.size() - 1 - suffix] == data_[data_.size() - 1 - suffix]) ++suffix;
+
+    SemanticTokensEdit edit;
+    edit.start = static_cast<uint32_t>(prefix);
+    edit.deleteCount = static_cast<uint32_t>(data_.size() - prefix - suffix);
+    edit.data.assign(data.begin() + static_cast<std::ptrdiff_t>(prefix),
+                     data.end() - static_cast<std::ptrdiff_t>(suffix));
+
+    SemanticTokensUpdate update;
+    if (edit.deleteCount == 0 && edit.data.empty()) {
+        result_id_ = std::move(resultId);
+        if (range_first_ >= 0) {
+            update.firstLine = range_first_;
+            update.lastLine = range_last_;
+            range_first_ = range_last_ = -1;
+            range_tokens_.clear();
+        }
+        return update;
+    }
+    std::vector<SemanticTokensEdit> edits;
+    edits.push_back(std::move(edit));
+    applyEdits(std::move(resultId), std::move(edits), &update);
+    return update;
+}
+
+bool SemanticTokenCache::applyEdits(std::string resultId, std::vector<SemanticTokensEdit> edits,
+                                    SemanticTokensUpdate* update) {
+    std::sort(edits.begin(), edits.end(),
+              [](const SemanticTokensEdit& a, const SemanticTokensEdit& b) { return a.start < b.start; });
+
+    size_t end = 0;
+    size_t size = data_.size();
+    for (const SemanticTokensEdit& edit : edits) {
+        if (edit.start < end || edit.start + static_cast<size_t>(edit.deleteCount) > data_.size()) return false;
+        end = edit.start + static_cast<size_t>(edit.deleteCount);
+        size = size - edit.deleteCount + edit.data.size();
+    }
+    if (size % kIntsPerToken != 0) return false;
+
+    SemanticTokensUpdate changed;
+    if (range_first_ >= 0) {
+        changed.firstLine = range_first_;
+        changed.lastLine = range_last_;
+        range_first_ = range_last_ = -1;
+        range_tokens_.clear();
+    }
+    result_id_ = std::move(resultId);
+
+    if (!edits.empty()) {
+        std::vector<uint32_t> data;
+        data.reserve(size);
+        size_t copied = 0;
+        for (const SemanticTokensEdit& edit : edits) {
+            data.insert(data.end(), data_.begin() + static_cast<std::ptrdiff_t>(copied),
+                        data_.begin() + static_cast<std::ptrdiff_t>(edit.start));
+            data.insert(data.end(), edit.data.begin(), edit.data.end());
+            copied = edit.start + static_cast<size_t>(edit.deleteCount);
+        }
+        const size_t changeEnd = data.size();
+        data.insert(data.end(), data_.begin() + static_cast<std::ptrdiff_t>(copied), data_.end());
+
+        // Tokens before the first edit are unchanged. The token after the
+        // last one is relative to an edited token, so its line is redrawn
+        // too; past that, tokens differ at most by a whole-line shift.
+        const size_t from = edits.front().start / kIntsPerToken;
+        addLines(tokens_, from, (copied + kIntsPerToken - 1) / kIntsPerToken, changed);
+
+        data_ = std::move(data);
+        decodeFrom(from);
+        addLines(tokens_, from, (changeEnd + kIntsPerToken - 1) / kIntsPerToken, changed);
+    }
+
+    if (update) *update = changed;
+    return true;
+}
+
+SemanticTokensUpdate SemanticTokenCache::setRange(int firstLine, int lastLine, const std::vector<uint32_t>& data) {
+    range_tokens_.clear();
+    decode(data.data(), data.size() / kIntsPerToken, 0, 0, range_tokens_);
+    range_first_ = firstLine;
+    range_last_ = lastLine;
+
+    SemanticTokensUpdate update;
+    update.firstLine = firstLine;
+    update.lastLine = lastLine;
+    return update;
+}
+
+void SemanticTokenCache::clear() {
+    result_id_.clear();
+    data_.clear();
+    tokens_.clear();
+    range_first_ = range_last_ = -1;
+    range_tokens_.clear();
+}
+
+std::pair<const SemanticToken*, const SemanticToken*> SemanticTokenCache::lineTokens(int line) const {
+    if (line < 0) return {nullptr, nullptr};
+    const std::vector<SemanticToken>& tokens =
+        line >= range_first_ && line <= range_last_ ? range_tokens_ : tokens_;
+    const auto [begin, end] = std::equal_range(tokens.begin(), tokens.end(), static_cast<uint32_t>(line), ByLine{});
+    return {tokens.data() + (begin - tokens.begin()), tokens.data() + (end - tokens.begin())};
+}
+
+int SemanticTokenCache::lastLine() const {
+    int line = tokens_.empty() ? -1 : static_cast<int>(tokens_.back().line);
+    if (!range_tokens_.empty()) line = std::max(line, static_cast<int>(range_tokens_.back().line));
+    return line;
+}
+
+void SemanticTokenCache::decodeFrom(size_t from) {
+    from = std::min(from, tokens_.size());
+    tokens_.resize(from);
+    uint32_t line = 0;
+    uint32_t start = 0;
+    if (from > 0) {
+        line = tokens_[from - 1].line;
+        start = tokens_[from - 1].start;
+    }
+    const size_t count = data_.size() / kIntsPerToken;
+    tokens_.reserve(count);
+    decode(data_.data() + from * kIntsPerToken, count - from, line, start, tokens_);
+}
+
+} // namespace xenon::features
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xenon::features {
+
+struct SemanticToken {
+    uint32_t line;
+    uint32_t start;     // UTF-16 offset in the line
+    uint32_t length;
+    uint32_t type;      // index into the server's token type legend
+    uint32_t modifiers; // bit set over the legend's modifiers
+};
+
+// One edit of a semantic tokens delta: replaces deleteCount integers of
+// the packed array at start with data
+struct SemanticTokensEdit {
+    uint32_t start = 0;
+    uint32_t deleteCount = 0;
+    std::vector<uint32_t> data;
+};
+
+// Lines whose tokens changed, inclusive. Tokens past lastLine are as
+// before but may have moved up or down by whole lines.
+struct SemanticTokensUpdate {
+    int firstLine = -1;
+    int lastLine = -1;
+
+    bool empty() const { return firstLine < 0; }
+};
+
+// The semantic tokens of one document as the LSP server last sent them.
+// The server's packed array (five integers per token, each position
+// relative to the previous token) is kept for applying deltas, and decoded
+// into absolute tokens sorted by position so a line's tokens are found by
+// binary search. A delta only decodes again from the first edited token.
+// A range response covers a few lines until the next full or delta result
+// replaces it.
+class SemanticTokenCache {
+public:
+    const std::string& resultId() const { return result_id_; }
+    bool empty() const { return tokens_.empty() && range_tokens_.empty(); }
+
+    SemanticTokensUpdate setFull(std::string resultId, std::vector<uint32_t> data);
+    // Applies the edits of a delta computed against resultId(). Returns
+    // false, leaving the cache as it was, when they don't fit the array;
+    // the caller should then ask for the full set again.
+    bool applyEdits(std::string resultId, std::vector<SemanticTokensEdit> edits, SemanticTokensUpdate* update);
+    // Tokens for lines firstLine..lastLine only
+    SemanticTokensUpdate setRange(int firstLine, int lastLine, const std::vector<uint32_t>& data);
+    void clear();
+
+    // The tokens of line, sorted by start
+    std::pair<const SemanticToken*, const SemanticToken*> lineTokens(int line) const;
+    // The line of the last token, -1 when there are none
+    int lastLine() const;
+
+private:
+    // Decodes data_ from token index `from` on, reusing the tokens before it
+    void decodeFrom(size_t from);
+
+    std::string result_id_;
+    std::vector<uint32_t> data_;
+    std::vector<SemanticToken> tokens_;
+
+    int range_first_ = -1;
+    int range_last_ = -1;
+    std::vector<SemanticToken> range_tokens_;
+};
+
+} // namespace xenon::features
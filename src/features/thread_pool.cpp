@@ -0,0 +1,87 @@
+#include "features/thread_pool.hpp"
+#include <algorithm>
+
+namespace xenon::features {
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // The caller of parallelFor works too, so one thread fewer is spawned
+    workers_.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index)>& task) {
+    if (count == 0) return;
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> jobLock(job_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        active_ = workers_.size();
+        generation_++;
+    }
+    wake_.notify_all();
+
+    runTasks();
+
+    // Workers still hold a pointer to task until they check out
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_--;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::runTasks() {
+    for (size_t i = next_++; i < count_; i = next_++) {
+        (*task_)(i);
+    }
+}
+
+} // namespace xenon::features
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xenon::features {
+
+// Fixed set of worker threads for short data-parallel jobs such as scoring
+// every Quick Open candidate on a keystroke. Spawning threads per keystroke
+// costs more than the work itself, so the workers are kept parked between
+// jobs.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = 0); // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs task(0) .. task(count - 1) across the workers and the calling
+    // thread and returns when all have finished. Jobs are serialised, and a
+    // task must not call parallelFor on the same pool.
+    void parallelFor(size_t count, const std::function<void(size_t index)>& task);
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // Process-wide pool for UI-triggered jobs.
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex job_mutex_; // serialises parallelFor callers
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t active_ = 0;
+    size_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace xenon::features
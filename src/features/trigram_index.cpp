@@ -0,0 +1,639 @@
+#include "features/trigram_index.hpp"
+#include "features/workspace_walker.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unordered_set>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr char kMagic[8] = {'X', 'E', 'T', 'R', 'I', 'G', '0', '1'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kMaxIndexedFileSize = 16 * 1024 * 1024;
+
+uint8_t foldByte(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c - 'A' + 'a') : c;
+}
+
+uint32_t makeTrigram(unsigned char a, unsigned char b, unsigned char c) {
+    return (static_cast<uint32_t>(foldByte(a)) << 16) | (static_cast<uint32_t>(foldByte(b)) << 8) | foldByte(c);
+}
+
+size_t alignTo8(size_t offset) {
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+// Whether count records of T starting at offset lie within a file of size
+// bytes and are aligned for T, without overflowing on hostile values
+template <typename T>
+bool sectionFits(uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % alignof(T) == 0 && offset <= size && count <= (size - offset) / sizeof(T);
+}
+
+// Reads one varint of at most five bytes that ends before end; false if it
+// is truncated or too long for a uint32_t
+bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Length of the escape sequence starting with the backslash at i, so that
+// none of its digits or letters are mistaken for literal text
+size_t escapeLength(const std::string& pattern, size_t i) {
+    auto isHex = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+    auto isDigit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+    auto run = [&pattern](size_t from, size_t limit, auto accept) {
+        size_t end = from;
+        while (end < pattern.size() && end - from < limit && accept(pattern[end])) ++end;
+        return end;
+    };
+
+    if (i + 1 >= pattern.size()) {
+        return 1;
+    }
+    const char kind = pattern[i + 1];
+    if (kind == 'x') {
+        return run(i + 2, 2, isHex) - i;
+    }
+    if (kind == 'u') {
+        if (i + 2 < pattern.size() && pattern[i + 2] == '{') {
+            const size_t close = pattern.find('}', i + 3);
+            return close == std::string::npos ? pattern.size() - i : close + 1 - i;
+        }
+        return run(i + 2, 4, isHex) - i;
+    }
+    if (kind == 'c') {
+        return std::min<size_t>(3, pattern.size() - i);
+    }
+    if (isDigit(kind)) {
+        return run(i + 1, pattern.size(), isDigit) - i;
+    }
+    return 2;
+}
+
+bool statFile(const std::string& path, int64_t& mtime, uint64_t& size) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    mtime = static_cast<int64_t>(st.st_mtime);
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+// Reads and trigram-splits one file; false for unreadable, binary or
+// oversized files, which are never searched either.
+bool indexFile(const std::string& absolutePath, std::vector<uint32_t>& trigrams) {
+    MappedFile file(absolutePath);
+    if (!file.isOpen() || file.size() > kMaxIndexedFileSize || MappedFile::looksBinary(file.view())) {
+        return false;
+    }
+    trigrams = TrigramIndex::extractTrigrams(file.view());
+    return true;
+}
+
+std::vector<uint32_t> intersectSorted(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    std::vector<uint32_t> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+} // anonymous namespace
+
+struct TrigramIndex::IndexHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t fileCount;
+    uint32_t trigramCount;
+    uint32_t reserved;
+    uint64_t filesOffset;
+    uint64_t pathOrderOffset;
+    uint64_t trigramsOffset;
+    uint64_t postingsOffset;
+    uint64_t pathsOffset;
+    uint64_t totalSize;
+};
+
+struct TrigramIndex::FileRecord {
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t reserved;
+    int64_t mtime;
+    uint64_t size;
+};
+
+struct TrigramIndex::TrigramRecord {
+    uint32_t trigram;
+    uint32_t count;
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct TrigramIndex::FileInfo {
+    std::string path;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+};
+
+// File ids are appended in increasing order, so each list is stored as
+// varint-encoded deltas.
+struct TrigramIndex::PostingList {
+    std::vector<uint8_t> bytes;
+    uint32_t count = 0;
+    uint32_t last = 0;
+
+    void add(uint32_t id) {
+        uint32_t delta = count == 0 ? id : id - last;
+        while (delta >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(delta));
+        last = id;
+        count++;
+    }
+};
+
+std::vector<uint32_t> TrigramIndex::extractTrigrams(std::string_view text) {
+    // A per-thread 2^24-bit set de-duplicates without sorting every position
+    thread_local std::vector<uint64_t> seen(size_t{1} << 18, 0);
+
+    std::vector<uint32_t> trigrams;
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    for (size_t i = 2; i < text.size(); ++i) {
+        const uint32_t trigram = makeTrigram(data[i - 2], data[i - 1], data[i]);
+        uint64_t& word = seen[trigram >> 6];
+        const uint64_t bit = uint64_t{1} << (trigram & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            trigrams.push_back(trigram);
+        }
+    }
+    for (uint32_t trigram : trigrams) {
+        seen[trigram >> 6] = 0;
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    return trigrams;
+}
+
+bool TrigramIndex::build(const std::string& root, const std::string& indexPath, const std::atomic<bool>& cancelled) {
+    std::mutex mutex;
+    std::vector<FileInfo> files;
+    std::unordered_map<uint32_t, PostingList> postings;
+
+    WorkspaceWalker::walk(root, [&](const std::string& relativePath, const std::string& absolutePath) {
+        FileInfo info;
+        std::vector<uint32_t> trigrams;
+        if (!statFile(absolutePath, info.mtime, info.size) || !indexFile(absolutePath, trigrams)) {
+            return;
+        }
+        info.path = relativePath;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto id = static_cast<uint32_t>(files.size());
+        files.push_back(std::move(info));
+        for (uint32_t trigram : trigrams) {
+            postings[trigram].add(id);
+        }
+    }, cancelled);
+
+    if (cancelled) {
+        return false;
+    }
+    return writeIndex(indexPath, files, postings);
+}
+
+bool TrigramIndex::writeIndex(const std::string& indexPath, const std::vector<FileInfo>& files,
+                              const std::unordered_map<uint32_t, PostingList>& postings) {
+    std::vector<uint32_t> keys;
+    keys.reserve(postings.size());
+    size_t postingBytes = 0;
+    for (const auto& [trigram, list] : postings) {
+        keys.push_back(trigram);
+        postingBytes += list.bytes.size();
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint32_t> pathOrder(files.size());
+    for (size_t i = 0; i < files.size(); ++i) pathOrder[i] = static_cast<uint32_t>(i);
+    std::sort(pathOrder.begin(), pathOrder.end(),
+              [&files](uint32_t a, uint32_t b) { return files[a].path < files[b].path; });
+
+    IndexHeader header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.byteOrder = kByteOrderMark;
+    header.fileCount = static_cast<uint32_t>(files.size());
+    header.trigramCount = static_cast<uint32_t>(keys.size());
+    header.filesOffset = sizeof(IndexHeader);
+    header.pathOrderOffset = header.filesOffset + files.size() * sizeof(FileRecord);
+    header.trigramsOffset = alignTo8(header.pathOrderOffset + files.size() * sizeof(uint32_t));
+    header.postingsOffset = header.trigramsOffset + keys.size() * sizeof(TrigramRecord);
+    header.pathsOffset = alignTo8(header.postingsOffset + postingBytes);
+
+    std::vector<FileRecord> fileRecords(files.size());
+    uint64_t pathOffset = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        fileRecords[i] = FileRecord{pathOffset, static_cast<uint32_t>(files[i].path.size()), 0,
+                                    files[i].mtime, files[i].size};
+        pathOffset += files[i].path.size();
+    }
+    header.totalSize = header.pathsOffset + pathOffset;
+
+    std::vector<TrigramRecord> trigramRecords(keys.size());
+    uint64_t postingOffset = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const PostingList& list = postings.at(keys[i]);
+        trigramRecords[i] = TrigramRecord{keys[i], list.count, postingOffset, list.bytes.size()};
+        postingOffset += list.bytes.size();
+    }
+
+    const std::string tempPath = indexPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        auto pad = [&out](uint64_t target) {
+            static const char zeros[8] = {};
+            const auto position = static_cast<uint64_t>(out.tellp());
+            if (target > position) out.write(zeros, static_cast<std::streamsize>(target - position));
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(fileRecords.data()),
+                  static_cast<std::streamsize>(fileRecords.size() * sizeof(FileRecord)));
+        out.write(reinterpret_cast<const char*>(pathOrder.data()),
+                  static_cast<std::streamsize>(pathOrder.size() * sizeof(uint32_t)));
+        pad(header.trigramsOffset);
+        out.write(reinterpret_cast<const char*>(trigramRecords.data()),
+                  static_cast<std::streamsize>(trigramRecords.size() * sizeof(TrigramRecord)));
+        for (uint32_t key : keys) {
+            const auto& bytes = postings.at(key).bytes;
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+        pad(header.pathsOffset);
+        for (const auto& file : files) {
+            out.write(file.path.data(), static_cast<std::streamsize>(file.path.size()));
+        }
+        if (!out.good()) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // Readers that still map the previous file keep their (unlinked) copy
+    return std::rename(tempPath.c_str(), indexPath.c_str()) == 0;
+}
+
+bool TrigramIndex::open(const std::string& indexPath) {
+    MappedFile file(indexPath);
+    if (!file.isOpen() || file.size() < sizeof(IndexHeader)) {
+        return false;
+    }
+
+    const char* base = file.view().data();
+    const auto* header = reinterpret_cast<const IndexHeader*>(base);
+    const uint64_t size = file.size();
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->byteOrder != kByteOrderMark ||
+        header->totalSize != size) {
+        return false;
+    }
+    if (!sectionFits<FileRecord>(header->filesOffset, header->fileCount, size) ||
+        !sectionFits<uint32_t>(header->pathOrderOffset, header->fileCount, size) ||
+        !sectionFits<TrigramRecord>(header->trigramsOffset, header->trigramCount, size) ||
+        header->postingsOffset > header->pathsOffset || header->pathsOffset > size) {
+        return false;
+    }
+
+    // Records point into the postings and path sections; one bad offset
+    // would otherwise be read far past the mapping on the first query
+    const auto* files = reinterpret_cast<const FileRecord*>(base + header->filesOffset);
+    const auto* pathOrder = reinterpret_cast<const uint32_t*>(base + header->pathOrderOffset);
+    const auto* trigrams = reinterpret_cast<const TrigramRecord*>(base + header->trigramsOffset);
+    const uint64_t pathsSize = size - header->pathsOffset;
+    const uint64_t postingsSize = header->pathsOffset - header->postingsOffset;
+    for (uint32_t i = 0; i < header->fileCount; ++i) {
+        if (files[i].pathOffset > pathsSize || files[i].pathLength > pathsSize - files[i].pathOffset ||
+            pathOrder[i] >= header->fileCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->trigramCount; ++i) {
+        const TrigramRecord& record = trigrams[i];
+        if (record.offset > postingsSize || record.length > postingsSize - record.offset ||
+            record.count > record.length || record.count > header->fileCount ||
+            (i > 0 && trigrams[i - 1].trigram >= record.trigram)) {
+            return false;
+        }
+    }
+
+    file_ = std::move(file);
+    header_ = header;
+    files_ = reinterpret_cast<const FileRecord*>(base + header->filesOffset);
+    path_order_ = reinterpret_cast<const uint32_t*>(base + header->pathOrderOffset);
+    trigrams_ = reinterpret_cast<const TrigramRecord*>(base + header->trigramsOffset);
+    postings_ = reinterpret_cast<const uint8_t*>(base + header->postingsOffset);
+    paths_ = base + header->pathsOffset;
+    return true;
+}
+
+std::string_view TrigramIndex::filePath(uint32_t id) const {
+    const FileRecord& record = files_[id];
+    return std::string_view(paths_ + record.pathOffset, record.pathLength);
+}
+
+std::optional<uint32_t> TrigramIndex::findFile(std::string_view relativePath) const {
+    if (!header_) return std::nullopt;
+
+    const uint32_t* end = path_order_ + header_->fileCount;
+    const uint32_t* it = std::lower_bound(path_order_, end, relativePath,
+        [this](uint32_t id, std::string_view path) { return filePath(id) < path; });
+    if (it != end && filePath(*it) == relativePath) {
+        return *it;
+    }
+    return std::nullopt;
+}
+
+std::vector<uint32_t> TrigramIndex::decodePostings(uint32_t trigram) const {
+    std::vector<uint32_t> ids;
+    const TrigramRecord* end = trigrams_ + header_->trigramCount;
+    const TrigramRecord* it = std::lower_bound(trigrams_, end, trigram,
+        [](const TrigramRecord& record, uint32_t value) { return record.trigram < value; });
+    if (it == end || it->trigram != trigram) {
+        return ids;
+    }
+
+    // open() checked that the list lies within the postings section; its
+    // bytes are still decoded defensively, stopping at the first bad one
+    ids.reserve(it->count);
+    const uint8_t* p = postings_ + it->offset;
+    const uint8_t* listEnd = p + it->length;
+    uint32_t current = 0;
+    for (uint32_t i = 0; i < it->count; ++i) {
+        uint32_t delta = 0;
+        if (!readVarint(p, listEnd, delta)) break;
+        current = i == 0 ? delta : current + delta;
+        if (current >= header_->fileCount || (i > 0 && delta == 0)) break;
+        ids.push_back(current);
+    }
+    return ids;
+}
+
+void TrigramIndex::updateFile(const std::string& root, const std::string& relativePath) {
+    OverlayEntry entry;
+    const std::string absolutePath = root + "/" + relativePath;
+    if (!statFile(absolutePath, entry.mtime, entry.size) || !indexFile(absolutePath, entry.trigrams)) {
+        entry.removed = true;
+        entry.trigrams.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    overlay_[relativePath] = std::move(entry);
+}
+
+void TrigramIndex::refresh(const std::string& root, const std::atomic<bool>& cancelled) {
+    const size_t baseCount = header_ ? header_->fileCount : 0;
+    std::vector<uint8_t> seenBase(baseCount, 0);
+    std::unordered_set<std::string> seenOverlay;
+    std::mutex seenMutex;
+
+    WorkspaceWalker::walk(root, [&](const std::string& relativePath, const std::string& absolutePath) {
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        if (!statFile(absolutePath, mtime, size)) return;
+
+        bool known = false;
+        bool inOverlay = false;
+        int64_t knownMtime = 0;
+        uint64_t knownSize = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = overlay_.find(relativePath);
+            if (it != overlay_.end()) {
+                inOverlay = true;
+                known = !it->second.removed;
+                knownMtime = it->second.mtime;
+                knownSize = it->second.size;
+            }
+        }
+        if (inOverlay) {
+            std::lock_guard<std::mutex> seenLock(seenMutex);
+            seenOverlay.insert(relativePath);
+        } else {
+            if (auto id = findFile(relativePath)) {
+                known = true;
+                knownMtime = files_[*id].mtime;
+                knownSize = files_[*id].size;
+                std::lock_guard<std::mutex> seenLock(seenMutex);
+                seenBase[*id] = 1;
+            }
+        }
+
+        if (!known || knownMtime != mtime || knownSize != size) {
+            updateFile(root, relativePath);
+            std::lock_guard<std::mutex> seenLock(seenMutex);
+            seenOverlay.insert(relativePath);
+        }
+    }, cancelled);
+
+    if (cancelled) return;
+
+    // Anything not seen during the walk has been deleted or is now ignored
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t id = 0; id < baseCount; ++id) {
+        if (seenBase[id]) continue;
+        std::string path(filePath(id));
+        if (overlay_.count(path) == 0) {
+            OverlayEntry removed;
+            removed.removed = true;
+            overlay_[path] = std::move(removed);
+        }
+    }
+    for (auto& [path, entry] : overlay_) {
+        if (!entry.removed && seenOverlay.count(path) == 0) {
+            entry.removed = true;
+            entry.trigrams.clear();
+        }
+    }
+}
+
+size_t TrigramIndex::overlaySize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overlay_.size();
+}
+
+bool TrigramIndex::writeMerged(const std::string& indexPath) const {
+    std::vector<FileInfo> files;
+    std::unordered_map<uint32_t, PostingList> postings;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Keep base files the overlay doesn't supersede, renumbered in order so
+    // that every posting list stays sorted.
+    const size_t baseCount = header_ ? header_->fileCount : 0;
+    std::vector<int64_t> remap(baseCount, -1);
+    for (uint32_t id = 0; id < baseCount; ++id) {
+        const std::string path(filePath(id));
+        if (overlay_.count(path)) continue;
+        remap[id] = static_cast<int64_t>(files.size());
+        files.push_back(FileInfo{path, files_[id].mtime, files_[id].size});
+    }
+    for (uint32_t i = 0; header_ && i < header_->trigramCount; ++i) {
+        const uint32_t trigram = trigrams_[i].trigram;
+        for (uint32_t id : decodePostings(trigram)) {
+            if (remap[id] >= 0) postings[trigram].add(static_cast<uint32_t>(remap[id]));
+        }
+    }
+
+    for (const auto& [path, entry] : overlay_) {
+        if (entry.removed) continue;
+        const auto id = static_cast<uint32_t>(files.size());
+        files.push_back(FileInfo{path, entry.mtime, entry.size});
+        for (uint32_t trigram : entry.trigrams) {
+            postings[trigram].add(id);
+        }
+    }
+
+    return writeIndex(indexPath, files, postings);
+}
+
+std::vector<std::string> TrigramIndex::requiredLiterals(const std::string& pattern, bool useRegex) {
+    if (!useRegex) {
+        return {pattern};
+    }
+
+    std::vector<std::string> literals;
+    std::string current;
+    auto flush = [&literals, &current]() {
+        if (!current.empty()) literals.push_back(current);
+        current.clear();
+    };
+
+    int groupDepth = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        const char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+
+        if (c == '|') {
+            return {}; // any branch may match, nothing is required
+        }
+        if (c == '(') {
+            flush();
+            groupDepth++;
+            continue;
+        }
+        if (c == ')') {
+            groupDepth = std::max(0, groupDepth - 1);
+            continue;
+        }
+        if (c == '[') {
+            flush();
+            const size_t close = pattern.find(']', i + 2);
+            if (close == std::string::npos) return {};
+            i = close;
+            continue;
+        }
+
+        char literal = '\0';
+        if (c == '\\') {
+            if (next != '\0' && std::strchr("\\.^$*+?()[]{}|/-", next)) {
+                literal = next;
+                ++i;
+            } else {
+                // Class escapes like \d and \b, character codes like \x41
+                // and \n, and backreferences end the literal
+                flush();
+                i += escapeLength(pattern, i) - 1;
+                continue;
+            }
+        } else if (c == '{') {
+            flush();
+            const size_t close = pattern.find('}', i + 1);
+            if (close == std::string::npos) return {};
+            i = close;
+            continue;
+        } else if (std::strchr(".^$*+?}", c)) {
+            flush();
+            continue;
+        } else {
+            literal = c;
+        }
+
+        if (groupDepth > 0) {
+            continue;
+        }
+
+        // A quantifier that allows zero repetitions makes the char optional
+        const char after = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+        if (after == '?' || after == '*' || (after == '{' && i + 2 < pattern.size() && pattern[i + 2] == '0')) {
+            flush();
+            continue;
+        }
+        current += literal;
+        if (after == '+' || after == '{') {
+            flush();
+        }
+    }
+    flush();
+    return literals;
+}
+
+std::optional<std::vector<std::string>> TrigramIndex::candidates(const std::string& pattern, bool useRegex) const {
+    std::vector<uint32_t> query;
+    for (const auto& literal : requiredLiterals(pattern, useRegex)) {
+        for (size_t i = 2; i < literal.size(); ++i) {
+            query.push_back(makeTrigram(static_cast<unsigned char>(literal[i - 2]),
+                                        static_cast<unsigned char>(literal[i - 1]),
+                                        static_cast<unsigned char>(literal[i])));
+        }
+    }
+    if (query.empty() || !header_) {
+        return std::nullopt;
+    }
+    std::sort(query.begin(), query.end());
+    query.erase(std::unique(query.begin(), query.end()), query.end());
+
+    // Intersect the rarest lists first so the working set shrinks quickly
+    std::vector<std::vector<uint32_t>> lists;
+    lists.reserve(query.size());
+    for (uint32_t trigram : query) {
+        lists.push_back(decodePostings(trigram));
+        if (lists.back().empty()) break;
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const auto& a, const auto& b) { return a.size() < b.size(); });
+    std::vector<uint32_t> ids = lists.front();
+    for (size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+        ids = intersectSorted(ids, lists[i]);
+    }
+
+    std::vector<std::string> result;
+    std::lock_guard<std::mutex> lock(mutex_);
+    result.reserve(ids.size());
+    for (uint32_t id : ids) {
+        std::string path(filePath(id));
+        if (overlay_.count(path) == 0) {
+            result.push_back(std::move(path));
+        }
+    }
+    for (const auto& [path, entry] : overlay_) {
+        if (entry.removed) continue;
+        const bool all = std::all_of(query.begin(), query.end(), [&entry](uint32_t trigram) {
+            return std::binary_search(entry.trigrams.begin(), entry.trigrams.end(), trigram);
+        });
+        if (all) result.push_back(path);
+    }
+    return result;
+}
+
+} // namespace xenon::features
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "features/mapped_file.hpp"
+
+namespace xenon::features {
+
+// Persistent trigram index over the text files of a workspace.
+//
+// The on-disk file is memory-mapped and never modified in place: a header,
+// fixed-size file and trigram records, a path-sorted id table for lookups,
+// delta/varint encoded posting lists and a path blob. Trigrams are built
+// from ASCII-lowercased bytes so one index serves case-sensitive and
+// case-insensitive queries alike.
+//
+// Changes after the file was written live in an in-memory overlay that
+// supersedes the on-disk entry for the same path; writeMerged() folds the
+// overlay back into a fresh file. Queries never touch the file system: the
+// owner keeps the index current with updateFile() for files it knows were
+// written and refresh() for changes made behind its back.
+class TrigramIndex {
+public:
+    TrigramIndex() = default;
+
+    TrigramIndex(const TrigramIndex&) = delete;
+    TrigramIndex& operator=(const TrigramIndex&) = delete;
+
+    // Indexes every searchable file under root in parallel and writes the
+    // result to indexPath (via a temp file and rename).
+    static bool build(const std::string& root, const std::string& indexPath, const std::atomic<bool>& cancelled);
+
+    // Maps an index written by build() or writeMerged(). Every section and
+    // record is bounds-checked first; false for a missing, truncated or
+    // corrupt file, which the caller rebuilds.
+    bool open(const std::string& indexPath);
+    bool isOpen() const { return header_ != nullptr; }
+
+    // Re-reads one file into the overlay, or records its removal.
+    void updateFile(const std::string& root, const std::string& relativePath);
+    // Stats the workspace and updates the overlay for every added, changed
+    // or removed file. Only changed files are read.
+    void refresh(const std::string& root, const std::atomic<bool>& cancelled);
+
+    size_t overlaySize() const;
+    bool writeMerged(const std::string& indexPath) const;
+
+    // Files that may contain a match, or nullopt when the pattern yields no
+    // trigram to narrow by and every file has to be scanned.
+    std::optional<std::vector<std::string>> candidates(const std::string& pattern, bool useRegex) const;
+
+    // Literal substrings every match must contain. Conservative for regexes:
+    // alternations yield nothing and optional or grouped parts are dropped.
+    static std::vector<std::string> requiredLiterals(const std::string& pattern, bool useRegex);
+
+    // Sorted, de-duplicated trigrams of a buffer.
+    static std::vector<uint32_t> extractTrigrams(std::string_view text);
+
+private:
+    struct IndexHeader;
+    struct FileRecord;
+    struct TrigramRecord;
+    struct FileInfo;
+    struct PostingList;
+
+    struct OverlayEntry {
+        bool removed = false;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        std::vector<uint32_t> trigrams;
+    };
+
+    static bool writeIndex(const std::string& indexPath, const std::vector<FileInfo>& files,
+                           const std::unordered_map<uint32_t, PostingList>& postings);
+
+    std::optional<uint32_t> findFile(std::string_view relativePath) const;
+    std::string_view filePath(uint32_t id) const;
+    std::vector<uint32_t> decodePostings(uint32_t trigram) const;
+
+    MappedFile file_;
+    const IndexHeader* header_ = nullptr;
+    const FileRecord* files_ = nullptr;
+    const uint32_t* path_order_ = nullptr;
+    const TrigramRecord* trigrams_ = nullptr;
+    const uint8_t* postings_ = nullptr;
+    const char* paths_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, OverlayEntry> overlay_;
+};
+
+} // namespace xenon::features
@@ -0,0 +1,396 @@
+#include "features/workspace_replace.hpp"
+#include "features/mapped_file.hpp"
+#include "features/workspace_walker.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr size_t kMaxPreviewLength = 300;
+constexpr size_t kPreviewContextBefore = 100;
+constexpr size_t kWriteBufferSize = 64 * 1024;
+
+bool isUtf8Continuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+bool statFile(const std::string& path, int64_t& mtime, uint64_t& size, struct stat* info = nullptr) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    mtime = static_cast<int64_t>(st.st_mtime);
+    size = static_cast<uint64_t>(st.st_size);
+    if (info) {
+        *info = st;
+    }
+    return true;
+}
+
+
+// Clips a preview line to a window starting shortly before `anchor`, backing
+// off to a UTF-8 boundary.
+std::string clipPreview(std::string_view line, size_t anchor) {
+    if (line.size() <= kMaxPreviewLength) {
+        return std::string(line);
+    }
+    size_t start = anchor > kPreviewContextBefore ? anchor - kPreviewContextBefore : 0;
+    while (start > 0 && isUtf8Continuation(line[start])) start--;
+    size_t end = std::min(line.size(), start + kMaxPreviewLength);
+    while (end < line.size() && isUtf8Continuation(line[end])) end++;
+    return std::string(line.substr(start, end - start));
+}
+
+// Buffered writer over a raw descriptor; the mapped source is copied through
+// in slices so a rewrite never materialises the whole output.
+class StreamWriter {
+public:
+    explicit StreamWriter(int fd) : fd_(fd) { buffer_.reserve(kWriteBufferSize); }
+
+    void write(std::string_view data) {
+        if (!ok_) return;
+        if (buffer_.size() + data.size() > kWriteBufferSize) {
+            flush();
+            if (data.size() >= kWriteBufferSize) {
+                writeAll(data);
+                return;
+            }
+        }
+        buffer_.append(data);
+    }
+
+    bool flush() {
+        if (ok_ && !buffer_.empty()) {
+            writeAll(buffer_);
+            buffer_.clear();
+        }
+        return ok_;
+    }
+
+private:
+    void writeAll(std::string_view data) {
+        while (ok_ && !data.empty()) {
+            const ssize_t written = ::write(fd_, data.data(), data.size());
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                ok_ = false;
+                return;
+            }
+            data.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+
+    int fd_;
+    bool ok_ = true;
+    std::string buffer_;
+};
+
+// Copies the finished temp file over the original through its own inode,
+// for files a rename would split from their other hard links or hand to
+// a different owner
+bool copyInto(const std::string& tempPath, const std::string& path, std::string& error) {
+    MappedFile replaced(tempPath);
+    if (!replaced.isOpen()) {
+        error = std::strerror(errno);
+        return false;
+    }
+    const int fd = ::open(path.c_str(), O_WRONLY | O_TRUNC);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    StreamWriter writer(fd);
+    writer.write(replaced.view());
+    bool ok = writer.flush() && ::fsync(fd) == 0;
+    if (!ok) {
+        error = std::strerror(errno);
+    }
+    if (::close(fd) != 0 && ok) {
+        error = std::strerror(errno);
+        ok = false;
+    }
+    return ok;
+}
+
+} // anonymous namespace
+
+WorkspaceReplace::~WorkspaceReplace() {
+    cancel();
+}
+
+void WorkspaceReplace::plan(
+    const std::string& root,
+    const WorkspaceReplaceOptions& options,
+    PlanCallback onFile,
+    FinishedCallback onFinished) {
+    cancel();
+
+    cancelled_ = false;
+    running_ = true;
+    thread_ = std::thread([this, root, options, onFile = std::move(onFile),
+                           onFinished = std::move(onFinished)]() {
+        const Replacer replacer(options.pattern, options.replacement, options.caseSensitive, options.useRegex);
+
+        auto planFile = [&](const std::string& relativePath, const std::string& absolutePath) {
+            if (options.excluded.count(relativePath)) return;
+
+            FileReplacement result;
+            if (!statFile(absolutePath, result.mtime, result.size)) return;
+            if (result.size == 0 || result.size > options.maxFileSize) return;
+
+            MappedFile file(absolutePath);
+            if (!file.isOpen() || MappedFile::looksBinary(file.view())) return;
+
+            FileReplacement planned = planBuffer(file.view(), replacer, options.maxPreviewLines);
+            if (planned.count == 0 && planned.skippedLines == 0) return;
+
+            result.relativePath = relativePath;
+            result.count = planned.count;
+            result.skippedLines = planned.skippedLines;
+            result.preview = std::move(planned.preview);
+            onFile(std::move(result));
+        };
+
+        if (replacer.isValid()) {
+            std::optional<std::vector<std::string>> candidates;
+            if (options.index) {
+                candidates = options.index->candidates(options.pattern, options.useRegex);
+            }
+
+            WalkOptions walkOptions;
+            walkOptions.threads = options.threads;
+            if (candidates) {
+                WorkspaceWalker::visit(root, *candidates, planFile, cancelled_, walkOptions);
+            } else {
+                WorkspaceWalker::walk(root, planFile, cancelled_, walkOptions);
+            }
+        }
+
+        running_ = false;
+        if (onFinished) {
+            onFinished(cancelled_);
+        }
+    });
+}
+
+void WorkspaceReplace::cancel() {
+    cancelled_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+}
+
+std::vector<ReplaceFailure> WorkspaceReplace::apply(
+    const std::string& root,
+    const WorkspaceReplaceOptions& options,
+    const std::vector<FileReplacement>& files,
+    const std::atomic<bool>& cancelled) {
+    const Replacer replacer(options.pattern, options.replacement, options.caseSensitive, options.useRegex);
+
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, const FileReplacement*> byPath;
+    paths.reserve(files.size());
+    for (const auto& file : files) {
+        paths.push_back(file.relativePath);
+        byPath[file.relativePath] = &file;
+    }
+
+    std::mutex failuresMutex;
+    std::vector<ReplaceFailure> failures;
+
+    WalkOptions walkOptions;
+    walkOptions.threads = options.threads;
+    WorkspaceWalker::visit(root, paths, [&](const std::string& relativePath, const std::string& absolutePath) {
+        std::string error;
+        if (!rewriteFile(absolutePath, replacer, *byPath.at(relativePath), error)) {
+            std::lock_guard<std::mutex> lock(failuresMutex);
+            failures.push_back(ReplaceFailure{relativePath, error});
+        }
+    }, cancelled, walkOptions);
+
+    return failures;
+}
+
+FileReplacement WorkspaceReplace::planBuffer(std::string_view text, const Replacer& replacer,
+                                             size_t maxPreviewLines) {
+    FileReplacement result;
+
+    // Edits are grouped by the lines they touch; a group is closed and
+    // rendered once an edit starts past its last line.
+    struct Edit {
+        size_t offset;
+        size_t length;
+        std::string replacement;
+    };
+    std::vector<Edit> group;
+    size_t groupStart = 0;
+    size_t groupEnd = 0;
+    size_t groupLine = 0;
+
+    size_t line = 0;
+    size_t lineStart = 0;
+    size_t scanned = 0;
+
+    // End of the last line an edit touches; a match ending in a newline
+    // pulls in the following line too
+    auto editLineEnd = [&text](size_t offset, size_t length) {
+        const size_t last = length > 0 ? offset + length - 1 : offset;
+        const size_t from = last < text.size() && text[last] == '\n' ? last + 1 : last;
+        const size_t end = text.find('\n', from);
+        return end == std::string_view::npos ? text.size() : end;
+    };
+
+    auto closeGroup = [&]() {
+        if (group.empty()) return;
+
+        std::string_view before = text.substr(groupStart, groupEnd - groupStart);
+        if (!before.empty() && before.back() == '\r') before.remove_suffix(1);
+        const size_t beforeEnd = groupStart + before.size();
+
+        std::string after;
+        size_t copied = groupStart;
+        for (const auto& edit : group) {
+            after.append(text.substr(copied, edit.offset - copied));
+            after.append(edit.replacement);
+            copied = edit.offset + edit.length;
+        }
+        if (copied < beforeEnd) {
+            after.append(text.substr(copied, beforeEnd - copied));
+        }
+
+        const size_t anchor = group.front().offset - groupStart;
+        result.preview.push_back(ReplacePreviewLine{groupLine, clipPreview(before, anchor),
+                                                    clipPreview(after, anchor)});
+        group.clear();
+    };
+
+    result.count = replacer.forEachEdit(text, [&](size_t offset, size_t length, std::string_view replacement) {
+        if (!group.empty() && offset > groupEnd) {
+            closeGroup();
+        }
+        if (result.preview.size() >= maxPreviewLines) return;
+
+        if (group.empty()) {
+            // Advance the line counter incrementally from the previous group
+            while (scanned < offset) {
+                const void* nl = std::memchr(text.data() + scanned, '\n', offset - scanned);
+                if (!nl) {
+                    scanned = offset;
+                    break;
+                }
+                scanned = static_cast<size_t>(static_cast<const char*>(nl) - text.data()) + 1;
+                lineStart = scanned;
+                line++;
+            }
+            groupStart = lineStart;
+            groupEnd = 0;
+            groupLine = line;
+        }
+        groupEnd = std::max(groupEnd, editLineEnd(offset, length));
+        group.push_back(Edit{offset, length, std::string(replacement)});
+    }, &result.skippedLines);
+    closeGroup();
+
+    return result;
+}
+
+bool WorkspaceReplace::rewriteFile(const std::string& linkPath, const Replacer& replacer,
+                                   const FileReplacement& expected, std::string& error) {
+    // Replace the file a symlink points at, not the link itself
+    char* resolved = ::realpath(linkPath.c_str(), nullptr);
+    if (!resolved) {
+        error = errno == ENOENT ? "file no longer exists" : std::strerror(errno);
+        return false;
+    }
+    const std::string path(resolved);
+    std::free(resolved);
+
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    struct stat info {};
+    if (!statFile(path, mtime, size, &info)) {
+        error = "file no longer exists";
+        return false;
+    }
+    if (mtime != expected.mtime || size != expected.size) {
+        error = "file changed since the preview";
+        return false;
+    }
+
+    MappedFile source(path);
+    if (!source.isOpen()) {
+        error = std::strerror(errno);
+        return false;
+    }
+
+    const size_t slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    std::string tempPath = dir + "/." + name + ".xenon-XXXXXX";
+
+    const int fd = ::mkstemp(tempPath.data());
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+
+    const std::string_view text = source.view();
+    StreamWriter writer(fd);
+    size_t copied = 0;
+    const size_t count = replacer.forEachEdit(text, [&](size_t offset, size_t length, std::string_view replacement) {
+        writer.write(text.substr(copied, offset - copied));
+        writer.write(replacement);
+        copied = offset + length;
+    });
+    writer.write(text.substr(copied));
+
+    bool ok = writer.flush();
+    if (!ok) {
+        error = std::strerror(errno);
+    } else if (count != expected.count) {
+        error = "file changed since the preview";
+        ok = false;
+    }
+    if (ok && (::fchmod(fd, info.st_mode & 07777) != 0 || ::fsync(fd) != 0)) {
+        error = std::strerror(errno);
+        ok = false;
+    }
+
+    // A rename gives the path a new inode: other hard links keep the old
+    // contents, and the owner becomes whoever runs the editor unless the
+    // temp file can be handed over first. Either way, write in place.
+    const bool inPlace = info.st_nlink > 1 ||
+        ((info.st_uid != ::geteuid() || info.st_gid != ::getegid()) &&
+         ::fchown(fd, info.st_uid, info.st_gid) != 0);
+
+    if (::close(fd) != 0 && ok) {
+        error = std::strerror(errno);
+        ok = false;
+    }
+    if (ok) {
+        if (inPlace) {
+            ok = copyInto(tempPath, path, error);
+        } else if (::rename(tempPath.c_str(), path.c_str()) != 0) {
+            error = std::strerror(errno);
+            ok = false;
+        }
+    }
+    if (!ok || inPlace) {
+        ::unlink(tempPath.c_str());
+    }
+    return ok;
+}
+
+} // namespace xenon::features
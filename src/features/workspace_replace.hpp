@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "features/replace_engine.hpp"
+#include "features/trigram_index.hpp"
+
+namespace xenon::features {
+
+struct WorkspaceReplaceOptions {
+    std::string pattern;
+    std::string replacement;
+    bool caseSensitive = true;
+    bool useRegex = false;
+    size_t maxFileSize = 16 * 1024 * 1024;
+    size_t maxPreviewLines = 50; // per file
+    size_t threads = 0;          // 0 = one per hardware thread
+    std::shared_ptr<const TrigramIndex> index;
+    // Paths handled elsewhere, e.g. files open in the editor
+    std::unordered_set<std::string> excluded;
+};
+
+struct ReplacePreviewLine {
+    size_t line;        // 0-based
+    std::string before; // the line, clipped around the first edit when very long
+    std::string after;
+};
+
+struct FileReplacement {
+    std::string relativePath;
+    size_t count = 0;
+    size_t skippedLines = 0; // lines the regex could not be matched on
+    // The file as planned; apply() leaves it alone if it changed since
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    std::vector<ReplacePreviewLine> preview;
+};
+
+struct ReplaceFailure {
+    std::string relativePath;
+    std::string reason;
+};
+
+// Replace across a workspace in two phases. plan() reads every candidate
+// file in parallel and reports the match count and a line preview per file;
+// apply() rewrites the accepted files in parallel, streaming each one from
+// its mapping into a temp file that is renamed over the original. Neither
+// phase holds more than one file per worker in memory.
+class WorkspaceReplace {
+public:
+    // Both callbacks run on background threads.
+    using PlanCallback = std::function<void(FileReplacement&& file)>;
+    using FinishedCallback = std::function<void(bool cancelled)>;
+
+    WorkspaceReplace() = default;
+    ~WorkspaceReplace();
+
+    WorkspaceReplace(const WorkspaceReplace&) = delete;
+    WorkspaceReplace& operator=(const WorkspaceReplace&) = delete;
+
+    // Cancels any plan in progress, then starts a new one and returns
+    // immediately. Files are delivered one at a time as they are read.
+    void plan(
+        const std::string& root,
+        const WorkspaceReplaceOptions& options,
+        PlanCallback onFile,
+        FinishedCallback onFinished = nullptr
+    );
+    void cancel();
+    bool isRunning() const { return running_; }
+
+    // Blocks until every file is rewritten; returns the files left untouched.
+    static std::vector<ReplaceFailure> apply(
+        const std::string& root,
+        const WorkspaceReplaceOptions& options,
+        const std::vector<FileReplacement>& files,
+        const std::atomic<bool>& cancelled
+    );
+
+    // Count and preview for one buffer; count is 0 when nothing matches.
+    // Files with lines the regex skipped are still reported by plan().
+    static FileReplacement planBuffer(std::string_view text, const Replacer& replacer, size_t maxPreviewLines);
+
+    // Streams the replaced contents of path into a sibling temp file and
+    // renames it into place, keeping the original permissions and owner.
+    // Symlinks are followed to their target; files with other hard links,
+    // or whose owner can't be kept, are overwritten in place instead.
+    static bool rewriteFile(const std::string& path, const Replacer& replacer, const FileReplacement& expected,
+                            std::string& error);
+
+private:
+    std::thread thread_;
+    std::atomic<bool> cancelled_{false};
+    std::atomic<bool> running_{false};
+};
+
+} // namespace xenon::features
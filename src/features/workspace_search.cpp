@@ -0,0 +1,189 @@
+#include "features/workspace_search.hpp"
+#include "features/mapped_file.hpp"
+#include "features/multi_pattern_matcher.hpp"
+#include "features/workspace_walker.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace xenon::features {
+
+namespace {
+
+constexpr size_t kMaxPreviewLength = 300;
+constexpr size_t kPreviewContextBefore = 100;
+
+bool isUtf8Continuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+} // anonymous namespace
+
+WorkspaceSearch::~WorkspaceSearch() {
+    cancel();
+    // Cancelled workers stop after the file in hand, so this is brief
+    reapRetired(true);
+}
+
+void WorkspaceSearch::reapRetired(bool wait) {
+    auto it = retired_.begin();
+    while (it != retired_.end()) {
+        if (wait || !it->first->running) {
+            it->second.join();
+            it = retired_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WorkspaceSearch::start(
+    const std::string& root,
+    const WorkspaceSearchOptions& options,
+    ResultCallback onResult,
+    FinishedCallback onFinished) {
+    cancel();
+    reapRetired(false);
+
+    auto run = std::make_shared<Run>();
+    run->on_finished = std::move(onFinished);
+    run_ = run;
+
+    // The worker only touches run, never this, so it can outlive a cancel
+    worker_ = std::thread([run, root, options, onResult = std::move(onResult)]() {
+        auto matcher = std::make_shared<const SearchMatcher>(options.pattern, options.caseSensitive,
+                                                             options.useRegex);
+        std::atomic<size_t> total{0};
+
+        // A regex match has to contain its required literals, and one
+        // Aho-Corasick pass over the file is far cheaper than running the
+        // regex over a file that lacks one of them.
+        std::shared_ptr<const MultiPatternMatcher> prefilter;
+        if (options.useRegex) {
+            const auto literals = TrigramIndex::requiredLiterals(options.pattern, true);
+            if (!literals.empty()) {
+                prefilter = std::make_shared<const MultiPatternMatcher>(literals, options.caseSensitive);
+            }
+        }
+
+        auto searchFile = [&](const std::string& relativePath, const std::string& absolutePath) {
+            const size_t found = total.load();
+            if (found >= options.maxResults) {
+                run->cancelled = true;
+                return;
+            }
+
+            MappedFile file(absolutePath);
+            if (!file.isOpen() || file.size() == 0 || file.size() > options.maxFileSize) return;
+            if (MappedFile::looksBinary(file.view())) return;
+            if (prefilter && !prefilter->containsAll(file.view())) return;
+
+            FileMatches result;
+            result.matches = collectLineMatches(file.view(), *matcher, options.maxResults - found,
+                                                &result.skippedLines);
+            if (result.matches.empty() && result.skippedLines == 0) return;
+
+            total += result.matches.size();
+            result.relativePath = relativePath;
+
+            std::lock_guard<std::mutex> lock(run->callback_mutex);
+            if (!run->detached) {
+                onResult(std::move(result));
+            }
+        };
+
+        if (matcher->isValid()) {
+            std::optional<std::vector<std::string>> candidates;
+            if (options.index) {
+                candidates = options.index->candidates(options.pattern, options.useRegex);
+            }
+
+            WalkOptions walkOptions;
+            walkOptions.threads = options.threads;
+            if (candidates) {
+                WorkspaceWalker::visit(root, *candidates, searchFile, run->cancelled, walkOptions);
+            } else {
+                WorkspaceWalker::walk(root, searchFile, run->cancelled, walkOptions);
+            }
+        }
+
+        const bool limitReached = total.load() >= options.maxResults;
+        run->running = false;
+        std::lock_guard<std::mutex> lock(run->callback_mutex);
+        if (!run->finished) {
+            run->finished = true;
+            if (run->on_finished) {
+                run->on_finished(run->cancelled && !limitReached);
+            }
+        }
+    });
+}
+
+void WorkspaceSearch::cancel() {
+    if (!run_) {
+        return;
+    }
+
+    run_->cancelled = true;
+    {
+        // Waits out a callback already in progress, which is brief, but
+        // never the file being scanned
+        std::lock_guard<std::mutex> lock(run_->callback_mutex);
+        run_->detached = true;
+        if (!run_->finished) {
+            run_->finished = true;
+            if (run_->on_finished) {
+                run_->on_finished(true);
+            }
+        }
+    }
+    retired_.emplace_back(std::move(run_), std::move(worker_));
+}
+
+std::vector<LineMatch> WorkspaceSearch::collectLineMatches(std::string_view text, const SearchMatcher& matcher,
+                                                           size_t maxMatches, size_t* skippedLines) {
+    std::vector<LineMatch> lines;
+    const auto hits = matcher.findAll(text, skippedLines);
+
+    size_t line = 0;
+    size_t lineStart = 0;
+    size_t scanned = 0;
+    for (const auto& hit : hits) {
+        if (lines.size() >= maxMatches) break;
+
+        // Advance the line counter incrementally from the previous hit
+        while (scanned < hit.offset) {
+            const void* nl = std::memchr(text.data() + scanned, '\n', hit.offset - scanned);
+            if (!nl) {
+                scanned = hit.offset;
+                break;
+            }
+            scanned = static_cast<size_t>(static_cast<const char*>(nl) - text.data()) + 1;
+            lineStart = scanned;
+            line++;
+        }
+
+        size_t lineEnd = text.find('\n', hit.offset);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        if (lineEnd > lineStart && text[lineEnd - 1] == '\r') lineEnd--;
+
+        size_t previewStart = lineStart;
+        size_t previewEnd = lineEnd;
+        if (previewEnd - previewStart > kMaxPreviewLength) {
+            previewStart = std::max(lineStart, hit.offset - std::min(hit.offset, kPreviewContextBefore));
+            previewEnd = std::min(lineEnd, std::max(hit.offset + hit.length, previewStart + kMaxPreviewLength));
+            while (previewStart > lineStart && isUtf8Continuation(text[previewStart])) previewStart--;
+            while (previewEnd < lineEnd && isUtf8Continuation(text[previewEnd])) previewEnd++;
+        }
+
+        LineMatch match;
+        match.line = line;
+        match.column = hit.offset - lineStart;
+        match.previewColumn = hit.offset - previewStart;
+        match.length = std::min(hit.length, previewEnd > hit.offset ? previewEnd - hit.offset : 0);
+        match.lineText = std::string(text.substr(previewStart, previewEnd - previewStart));
+        lines.push_back(std::move(match));
+    }
+    return lines;
+}
+
+} // namespace xenon::features
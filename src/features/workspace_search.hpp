@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "features/search_engine.hpp"
+#include "features/trigram_index.hpp"
+
+namespace xenon::features {
+
+struct WorkspaceSearchOptions {
+    std::string pattern;
+    bool caseSensitive = true;
+    bool useRegex = false;
+    size_t maxFileSize = 16 * 1024 * 1024;
+    size_t maxResults = 20000;
+    size_t threads = 0; // 0 = one per hardware thread
+    // When set, only the files the index cannot rule out are read. It is
+    // as fresh as its owner keeps it; nothing is stat-ed per search.
+    std::shared_ptr<const TrigramIndex> index;
+};
+
+struct LineMatch {
+    size_t line;          // 0-based
+    size_t column;        // byte offset into the full line
+    size_t length;        // bytes
+    size_t previewColumn; // byte offset into lineText
+    std::string lineText; // the line, clipped around the match when very long
+};
+
+struct FileMatches {
+    std::string relativePath;
+    std::vector<LineMatch> matches;
+    size_t skippedLines = 0; // lines the regex could not be matched on
+};
+
+// Searches every non-ignored, non-binary file under a root in parallel.
+// Files are memory-mapped and matched with a single shared SearchMatcher.
+// A trigram index, when given, narrows the files read to its candidates;
+// regex searches also skip files that lack one of the pattern's required
+// literals. Files with lines a regex had to skip are reported even without
+// matches, so the caller can say the results are incomplete.
+//
+// Cancelling never waits for the worker: it is told to stop, no callback of
+// that search runs after cancel() returns, and its thread is joined once it
+// has wound down, by a later start() or at the latest by the destructor.
+class WorkspaceSearch {
+public:
+    // Results arrive on background threads. onFinished runs once per search,
+    // on the worker, or inside cancel() when the search is cancelled first.
+    using ResultCallback = std::function<void(FileMatches&& file)>;
+    using FinishedCallback = std::function<void(bool cancelled)>;
+
+    WorkspaceSearch() = default;
+    ~WorkspaceSearch();
+
+    WorkspaceSearch(const WorkspaceSearch&) = delete;
+    WorkspaceSearch& operator=(const WorkspaceSearch&) = delete;
+
+    // Cancels any search in progress, then starts a new one and returns
+    // immediately. Results are delivered one file at a time as found.
+    void start(
+        const std::string& root,
+        const WorkspaceSearchOptions& options,
+        ResultCallback onResult,
+        FinishedCallback onFinished = nullptr
+    );
+    void cancel();
+    bool isRunning() const { return run_ && run_->running; }
+
+    // Splits the matches of one buffer into per-line results. Long lines are
+    // clipped around the match so minified files don't bloat the results.
+    static std::vector<LineMatch> collectLineMatches(std::string_view text, const SearchMatcher& matcher,
+                                                     size_t maxMatches, size_t* skippedLines = nullptr);
+
+private:
+    // What one search shares with its worker, which keeps it alive after
+    // the search object has moved on or been destroyed
+    struct Run {
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> running{true};
+        std::mutex callback_mutex; // held while a callback runs
+        bool detached = false;     // guarded by callback_mutex
+        bool finished = false;     // guarded by callback_mutex
+        FinishedCallback on_finished;
+    };
+
+    // Joins the threads of cancelled searches that have finished; with
+    // wait set, joins all of them
+    void reapRetired(bool wait);
+
+    std::shared_ptr<Run> run_;
+    std::thread worker_;
+    std::vector<std::pair<std::shared_ptr<Run>, std::thread>> retired_;
+};
+
+} // namespace xenon::features
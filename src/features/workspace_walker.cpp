@@ -0,0 +1,212 @@
+#include "features/workspace_walker.hpp"
+#include "features/ignore_rules.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <dirent.h>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+namespace xenon::features {
+
+namespace {
+
+struct DirectoryTask {
+    std::string relativePath; // empty for the root
+    std::shared_ptr<const IgnoreRules> rules;
+};
+
+class WalkState {
+public:
+    WalkState(const std::string& root, const WorkspaceWalker::FileCallback& onFile,
+              const WorkspaceWalker::DirectoryCallback& onDirectory,
+              const std::atomic<bool>& cancelled, const WalkOptions& options)
+        : root_(root), on_file_(onFile), on_directory_(onDirectory), cancelled_(cancelled), options_(options) {}
+
+    void push(DirectoryTask task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+            pending_++;
+        }
+        cv_.notify_one();
+    }
+
+    void run() {
+        while (true) {
+            DirectoryTask task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return !tasks_.empty() || pending_ == 0 || cancelled_; });
+                if (cancelled_ || (tasks_.empty() && pending_ == 0)) {
+                    break;
+                }
+                task = std::move(tasks_.back());
+                tasks_.pop_back();
+            }
+
+            processDirectory(task);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_--;
+            }
+            cv_.notify_all();
+        }
+        cv_.notify_all();
+    }
+
+private:
+    void processDirectory(const DirectoryTask& task) {
+        const std::string absoluteDir = task.relativePath.empty() ? root_ : root_ + "/" + task.relativePath;
+
+        std::shared_ptr<const IgnoreRules> rules = task.rules;
+        if (options_.respectIgnoreFiles) {
+            // Only copy the inherited rules when this directory adds its own
+            const std::string ignoreFile = absoluteDir + "/.gitignore";
+            struct stat st {};
+            if (task.relativePath.empty() || ::stat(ignoreFile.c_str(), &st) == 0) {
+                IgnoreRules local = *rules;
+                local.loadFile(ignoreFile, task.relativePath);
+                if (task.relativePath.empty()) {
+                    local.loadFile(root_ + "/.git/info/exclude");
+                }
+                rules = std::make_shared<const IgnoreRules>(std::move(local));
+            }
+        }
+
+        DIR* dir = ::opendir(absoluteDir.c_str());
+        if (!dir) {
+            return;
+        }
+
+        std::vector<std::pair<std::string, std::string>> files;
+        while (dirent* entry = ::readdir(dir)) {
+            if (cancelled_) break;
+
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+
+            const std::string relative = task.relativePath.empty() ? name : task.relativePath + "/" + name;
+            const std::string absolute = absoluteDir + "/" + name;
+
+            bool isDirectory = false;
+            bool isFile = false;
+            if (entry->d_type == DT_DIR) {
+                isDirectory = true;
+            } else if (entry->d_type == DT_REG) {
+                isFile = true;
+            } else if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) {
+                // Symlinked directories are skipped to avoid cycles
+                struct stat st {};
+                if (::stat(absolute.c_str(), &st) == 0) {
+                    isFile = S_ISREG(st.st_mode);
+                    isDirectory = S_ISDIR(st.st_mode) && entry->d_type == DT_UNKNOWN;
+                }
+            }
+            if (!isDirectory && !isFile) continue;
+
+            if (rules->match(relative, isDirectory) == IgnoreRules::Match::Ignored) continue;
+
+            if (isDirectory) {
+                if (on_directory_) on_directory_(relative);
+                if (options_.recursive) push(DirectoryTask{relative, rules});
+            } else {
+                files.emplace_back(relative, absolute);
+            }
+        }
+        ::closedir(dir);
+
+        for (const auto& [relative, absolute] : files) {
+            if (cancelled_) break;
+            on_file_(relative, absolute);
+        }
+    }
+
+    const std::string& root_;
+    const WorkspaceWalker::FileCallback& on_file_;
+    const WorkspaceWalker::DirectoryCallback& on_directory_;
+    const std::atomic<bool>& cancelled_;
+    const WalkOptions& options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<DirectoryTask> tasks_;
+    size_t pending_ = 0;
+};
+
+} // anonymous namespace
+
+void WorkspaceWalker::walk(
+    const std::string& root,
+    const FileCallback& onFile,
+    const std::atomic<bool>& cancelled,
+    const WalkOptions& options,
+    const DirectoryCallback& onDirectory) {
+    size_t threadCount = options.threads;
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!options.recursive) {
+        threadCount = 1;
+    }
+
+    // A subtree walk starts with the rules its ancestors would have passed
+    // down; the start directory loads its own .gitignore as usual
+    IgnoreRules rules = IgnoreRules::defaults();
+    if (!options.startDirectory.empty() && options.respectIgnoreFiles) {
+        rules.loadFile(root + "/.gitignore");
+        rules.loadFile(root + "/.git/info/exclude");
+        for (size_t slash = options.startDirectory.find('/'); slash != std::string::npos;
+             slash = options.startDirectory.find('/', slash + 1)) {
+            const std::string ancestor = options.startDirectory.substr(0, slash);
+            rules.loadFile(root + "/" + ancestor + "/.gitignore", ancestor);
+        }
+    }
+
+    WalkState state(root, onFile, onDirectory, cancelled, options);
+    state.push(DirectoryTask{options.startDirectory, std::make_shared<const IgnoreRules>(std::move(rules))});
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back([&state] { state.run(); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkspaceWalker::visit(
+    const std::string& root,
+    const std::vector<std::string>& relativePaths,
+    const FileCallback& onFile,
+    const std::atomic<bool>& cancelled,
+    const WalkOptions& options) {
+    size_t threadCount = options.threads;
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min(threadCount, std::max<size_t>(1, relativePaths.size()));
+
+    const std::string prefix = root.empty() || root.back() == '/' ? root : root + "/";
+    std::atomic<size_t> next{0};
+    auto run = [&]() {
+        for (size_t i = next++; i < relativePaths.size() && !cancelled; i = next++) {
+            onFile(relativePaths[i], prefix + relativePaths[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(run);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace xenon::features
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace xenon::features {
+
+struct WalkOptions {
+    size_t threads = 0; // 0 = one per hardware thread
+    bool respectIgnoreFiles = true;
+    // Walk only this subtree (relative to root); ignore files of its
+    // ancestors still apply
+    std::string startDirectory;
+    // When false only the start directory itself is listed
+    bool recursive = true;
+};
+
+// Parallel directory walker. Worker threads share a stack of directories;
+// each one lists a directory, queues its subdirectories and reports its
+// files, so file callbacks (e.g. searching the file) run in parallel too.
+// Ignored directories are never entered, symlinked directories are not
+// followed.
+class WorkspaceWalker {
+public:
+    // Called concurrently from worker threads.
+    using FileCallback = std::function<void(const std::string& relativePath, const std::string& absolutePath)>;
+    using DirectoryCallback = std::function<void(const std::string& relativePath)>;
+
+    // Blocks until the tree has been walked or `cancelled` becomes true.
+    // onDirectory, if given, sees every non-ignored subdirectory found.
+    static void walk(
+        const std::string& root,
+        const FileCallback& onFile,
+        const std::atomic<bool>& cancelled,
+        const WalkOptions& options = WalkOptions{},
+        const DirectoryCallback& onDirectory = nullptr
+    );
+
+    // Runs onFile over a known list of files (e.g. index candidates) with the
+    // same thread pool semantics as walk(). No ignore rules are applied.
+    static void visit(
+        const std::string& root,
+        const std::vector<std::string>& relativePaths,
+        const FileCallback& onFile,
+        const std::atomic<bool>& cancelled,
+        const WalkOptions& options = WalkOptions{}
+    );
+};
+
+} // namespace xenon::features
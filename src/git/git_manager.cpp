@@ -1,6 +1,10 @@
 #include "git/git_manager.hpp"
 #include <QDir>
 #include <QDebug>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
 
 #ifdef HAVE_LIBGIT2
 #include <git2.h>
@@ -93,4 +97,106 @@ QString GitManager::statusSummary(const QString& filepath, const QString& fileCo
     return "";
 }
 
+bool GitManager::listFiles(const QString& workingDirectory, std::vector<std::string>& files,
+                           const std::atomic<bool>& cancelled) {
+    files.clear();
+
+    // libgit2's init is reference counted; hold it for the duration in case
+    // this runs while no GitManager exists
+    git_libgit2_init();
+    git_repository* repo = nullptr;
+    if (git_repository_open_ext(&repo, workingDirectory.toUtf8().constData(), 0, nullptr) != 0) {
+        git_libgit2_shutdown();
+        return false;
+    }
+    const char* workdir = git_repository_workdir(repo);
+    if (!workdir) {
+        git_repository_free(repo); // bare repository
+        git_libgit2_shutdown();
+        return false;
+    }
+
+    // The workspace may be a subdirectory of the repository; index paths are
+    // relative to the repository root
+    QString prefix = QDir(QFileInfo(QString::fromUtf8(workdir)).canonicalFilePath())
+        .relativeFilePath(QFileInfo(workingDirectory).canonicalFilePath());
+    prefix = prefix == "." ? QString() : prefix + "/";
+    const std::string pathPrefix = prefix.toStdString();
+
+    auto addPath = [&](const char* path, std::vector<std::string>& out) {
+        const std::string_view view(path);
+        if (view.compare(0, pathPrefix.size(), pathPrefix) != 0) return;
+        out.emplace_back(view.substr(pathPrefix.size()));
+    };
+
+    // Tracked files come straight from the index entries, without touching
+    // the work tree
+    git_index* index = nullptr;
+    if (git_repository_index(&index, repo) == 0) {
+        const size_t count = git_index_entrycount(index);
+        files.reserve(count);
+        const char* previous = nullptr;
+        for (size_t i = 0; i < count && !cancelled; ++i) {
+            const git_index_entry* entry = git_index_get_byindex(index, i);
+            // Submodules are directories; conflicted paths appear once per stage
+            if (entry->mode == GIT_FILEMODE_COMMIT) continue;
+            if (previous && std::strcmp(previous, entry->path) == 0) continue;
+            previous = entry->path;
+            addPath(entry->path, files);
+        }
+    }
+
+    // Untracked files and deleted tracked ones need the work tree. An index
+    // to work tree diff finds both, and unlike git_status_list_new it
+    // reports progress per file, which lets a cancellation stop it.
+    std::vector<std::string> untracked;
+    std::vector<std::string> removed;
+    if (index && !cancelled) {
+        git_diff_options options = GIT_DIFF_OPTIONS_INIT;
+        options.flags = GIT_DIFF_INCLUDE_UNTRACKED | GIT_DIFF_RECURSE_UNTRACKED_DIRS |
+                        GIT_DIFF_SKIP_BINARY_CHECK;
+        options.ignore_submodules = GIT_SUBMODULE_IGNORE_ALL;
+        options.progress_cb = [](const git_diff*, const char*, const char*, void* payload) {
+            return static_cast<const std::atomic<bool>*>(payload)->load() ? GIT_EUSER : 0;
+        };
+        options.payload = const_cast<std::atomic<bool>*>(&cancelled);
+        std::string pathspec = pathPrefix;
+        char* pathspecs[] = {pathspec.data()};
+        if (!pathPrefix.empty()) {
+            options.pathspec.strings = pathspecs;
+            options.pathspec.count = 1;
+        }
+
+        git_diff* diff = nullptr;
+        if (git_diff_index_to_workdir(&diff, repo, index, &options) == 0) {
+            const size_t count = git_diff_num_deltas(diff);
+            for (size_t i = 0; i < count; ++i) {
+                const git_diff_delta* delta = git_diff_get_delta(diff, i);
+                if (delta->status == GIT_DELTA_UNTRACKED) {
+                    addPath(delta->new_file.path, untracked);
+                } else if (delta->status == GIT_DELTA_DELETED) {
+                    addPath(delta->old_file.path, removed);
+                }
+            }
+            git_diff_free(diff);
+        }
+    }
+    git_index_free(index);
+    git_repository_free(repo);
+    git_libgit2_shutdown();
+
+    if (cancelled) {
+        files.clear();
+        return false;
+    }
+    if (!removed.empty()) {
+        const std::unordered_set<std::string> deleted(removed.begin(), removed.end());
+        files.erase(std::remove_if(files.begin(), files.end(),
+                                   [&deleted](const std::string& path) { return deleted.count(path) > 0; }),
+                    files.end());
+    }
+    files.insert(files.end(), std::make_move_iterator(untracked.begin()), std::make_move_iterator(untracked.end()));
+    return true;
+}
+
 } // namespace xenon::git
@@ -4,6 +4,8 @@
 #include <QString>
 #include <QStringList>
 #include <QProcess>
+#include <atomic>
+#include <string>
 #include <vector>
 
 #ifdef HAVE_LIBGIT2
@@ -39,6 +41,15 @@ public:
     std::vector<DiffHunk> getFileDiff(const QString& filepath, const QString& fileContent) const;
     QString statusSummary(const QString& filepath, const QString& fileContent) const;
 
+    // Lists the files under workingDirectory (relative to it) from the git
+    // index plus untracked, non-ignored files, without walking ignored
+    // directories. Tracked files deleted from the work tree are left out.
+    // Opens its own repository handle, so it is safe to call from a worker
+    // thread. Returns false outside a git repository or once cancelled,
+    // which is checked between files of the work tree scan.
+    static bool listFiles(const QString& workingDirectory, std::vector<std::string>& files,
+                          const std::atomic<bool>& cancelled);
+
 signals:
     void branchChanged(const QString& newBranch);
 
@@ -5,6 +5,19 @@
 
 namespace xenon::lsp {
 
+namespace {
+
+std::vector<uint32_t> toUIntegers(const QJsonArray& array) {
+    std::vector<uint32_t> values;
+    values.reserve(static_cast<size_t>(array.size()));
+    for (const auto& v : array) {
+        values.push_back(static_cast<uint32_t>(v.toInteger()));
+    }
+    return values;
+}
+
+} // anonymous namespace
+
 LspClient::LspClient(QObject* parent) : QObject(parent) {
     connect(&process_, &QProcess::readyReadStandardOutput, this, &LspClient::onReadyRead);
     connect(&process_, &QProcess::errorOccurred, this, &LspClient::onProcessError);
@@ -13,6 +26,8 @@ LspClient::LspClient(QObject* parent) : QObject(parent) {
 }
 
 LspClient::~LspClient() {
+    // Owners are usually being torn down too; stopped() must not reach them
+    blockSignals(true);
     stop();
 }
 
@@ -21,12 +36,31 @@ bool LspClient::start(const QStringList& command, const QString& rootUri) {
 
     process_.start(command.first(), command.mid(1));
     if (!process_.waitForStarted()) return false;
+    semantic_tokens_provider_ = SemanticTokensProvider();
+    folding_range_provider_ = false;
 
     // Initialize
     QJsonObject params;
     params["processId"] = QCoreApplication::applicationPid();
     params["rootUri"] = rootUri;
-    params["capabilities"] = QJsonObject(); // Basic empty capabilities
+
+    // Token types the highlighter has colors for; servers may send others
+    // in their legend, which are left to the grammar
+    QJsonObject semanticTokens;
+    semanticTokens["requests"] = QJsonObject{{"range", true}, {"full", QJsonObject{{"delta", true}}}};
+    semanticTokens["tokenTypes"] = QJsonArray{
+        "namespace", "type", "class", "enum", "interface", "struct", "typeParameter", "parameter",
+        "variable", "property", "enumMember", "function", "method", "macro", "keyword", "comment",
+        "string", "number", "operator"};
+    semanticTokens["tokenModifiers"] = QJsonArray{
+        "declaration", "definition", "readonly", "static", "deprecated", "defaultLibrary"};
+    semanticTokens["formats"] = QJsonArray{"relative"};
+    semanticTokens["multilineTokenSupport"] = false;
+    semanticTokens["overlappingTokenSupport"] = false;
+    params["capabilities"] = QJsonObject{{"textDocument", QJsonObject{
+        {"semanticTokens", semanticTokens},
+        {"foldingRange", QJsonObject{{"lineFoldingOnly", true}}},
+        {"documentHighlight", QJsonObject()}}}};
 
     QJsonObject init_msg;
     int id = next_id_++;
@@ -102,10 +136,16 @@ void LspClient::handleNotification(const QString& method, const QJsonValue& para
             QJsonObject d = d_val.toObject();
             Diagnostic diag;
             QJsonObject range = d["range"].toObject();
-            diag.line = range["start"].toObject()["line"].toInt();
-            diag.col = range["start"].toObject()["character"].toInt();
+            const QJsonObject start = range["start"].toObject();
+            const QJsonObject end = range["end"].toObject();
+            diag.line = start["line"].toInt();
+            diag.col = start["character"].toInt();
+            diag.endLine = end["line"].toInt();
+            diag.endCol = end["character"].toInt();
             diag.message = d["message"].toString();
-            diag.severity = d["severity"].toInt();
+            diag.source = d["source"].toString();
+            // Left to the client when missing; shown as an error
+            diag.severity = d["severity"].toInt(1);
             result.append(diag);
         }
         emit diagnosticsReceived(uri, result);
@@ -119,12 +159,37 @@ void LspClient::handleResponse(int id, const QJsonValue& result, const QJsonValu
 
     if (!error.isNull()) {
         qDebug() << "LSP Error (id" << id << "):" << error;
+        emit requestFailed(id, error.toObject()["code"].toInt());
         return;
     }
 
     if (type == RequestType::Initialize) {
+        const QJsonObject capabilities = result.toObject()["capabilities"].toObject();
+        const QJsonValue provider = capabilities["semanticTokensProvider"];
+        if (provider.isObject()) {
+            const QJsonObject p = provider.toObject();
+            const QJsonObject legend = p["legend"].toObject();
+            for (const auto& v : legend["tokenTypes"].toArray()) {
+                semantic_tokens_provider_.tokenTypes.append(v.toString());
+            }
+            for (const auto& v : legend["tokenModifiers"].toArray()) {
+                semantic_tokens_provider_.tokenModifiers.append(v.toString());
+            }
+            // "full" and "range" are either booleans or option objects
+            const QJsonValue full = p["full"];
+            semantic_tokens_provider_.full = full.isObject() || full.toBool();
+            semantic_tokens_provider_.delta = full.toObject()["delta"].toBool();
+            semantic_tokens_provider_.range = p["range"].isObject() || p["range"].toBool();
+        }
+
+        const QJsonValue folding = capabilities["foldingRangeProvider"];
+        folding_range_provider_ = folding.isObject() || folding.toBool();
+        const QJsonValue highlight = capabilities["documentHighlightProvider"];
+        document_highlight_provider_ = highlight.isObject() || highlight.toBool();
+
         initialized_ = true;
         sendMessage(QJsonObject{{"jsonrpc", "2.0"}, {"method", "initialized"}, {"params", QJsonObject()}});
+        emit initialized();
     } else if (type == RequestType::Completion) {
         QList<CompletionItem> items;
         QJsonArray list;
@@ -160,43 +225,106 @@ void LspClient::handleResponse(int id, const QJsonValue& result, const QJsonValu
             int col = range["start"].toObject()["character"].toInt();
             emit definitionReceived(id, uri, line, col);
         }
+    } else if (type == RequestType::SemanticTokensFull || type == RequestType::SemanticTokensDelta ||
+               type == RequestType::SemanticTokensRange) {
+        const QJsonObject obj = result.toObject();
+        const QString resultId = obj["resultId"].toString();
+        if (obj.contains("edits")) {
+            std::vector<SemanticTokensEdit> edits;
+            for (const auto& v : obj["edits"].toArray()) {
+                const QJsonObject e = v.toObject();
+                SemanticTokensEdit edit;
+                edit.start = static_cast<uint32_t>(e["start"].toInteger());
+                edit.deleteCount = static_cast<uint32_t>(e["deleteCount"].toInteger());
+                edit.data = toUIntegers(e["data"].toArray());
+                edits.push_back(std::move(edit));
+            }
+            emit semanticTokensDeltaReceived(id, resultId, edits);
+        } else {
+            emit semanticTokensReceived(id, resultId, toUIntegers(obj["data"].toArray()));
+        }
+    } else if (type == RequestType::FoldingRange) {
+        std::vector<FoldingRange> ranges;
+        for (const auto& v : result.toArray()) {
+            const QJsonObject r = v.toObject();
+            ranges.push_back({r["startLine"].toInt(), r["endLine"].toInt()});
+        }
+        emit foldingRangesReceived(id, ranges);
+    } else if (type == RequestType::DocumentHighlight) {
+        std::vector<DocumentHighlight> highlights;
+        for (const auto& v : result.toArray()) {
+            const QJsonObject h = v.toObject();
+            const QJsonObject range = h["range"].toObject();
+            const QJsonObject start = range["start"].toObject();
+            const QJsonObject end = range["end"].toObject();
+            highlights.push_back({start["line"].toInt(), start["character"].toInt(),
+                                  end["line"].toInt(), end["character"].toInt(), h["kind"].toInt(1)});
+        }
+        emit documentHighlightsReceived(id, highlights);
     }
 }
 
-int LspClient::completion(const QString& uri, int line, int col) {
+int LspClient::sendRequest(RequestType type, const QString& method, const QJsonObject& params) {
     int id = next_id_++;
-    pending_requests_[id] = RequestType::Completion;
-
-    QJsonObject params;
-    params["textDocument"] = QJsonObject{{"uri", uri}};
-    params["position"] = QJsonObject{{"line", line}, {"character", col}};
+    pending_requests_[id] = type;
 
     QJsonObject msg;
     msg["jsonrpc"] = "2.0";
     msg["id"] = id;
-    msg["method"] = "textDocument/completion";
+    msg["method"] = method;
     msg["params"] = params;
 
     sendMessage(msg);
     return id;
 }
 
-int LspClient::definition(const QString& uri, int line, int col) {
-    int id = next_id_++;
-    pending_requests_[id] = RequestType::Definition;
+int LspClient::completion(const QString& uri, int line, int col) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    params["position"] = QJsonObject{{"line", line}, {"character", col}};
+    return sendRequest(RequestType::Completion, "textDocument/completion", params);
+}
 
+int LspClient::definition(const QString& uri, int line, int col) {
     QJsonObject params;
     params["textDocument"] = QJsonObject{{"uri", uri}};
     params["position"] = QJsonObject{{"line", line}, {"character", col}};
+    return sendRequest(RequestType::Definition, "textDocument/definition", params);
+}
 
-    QJsonObject msg;
-    msg["jsonrpc"] = "2.0";
-    msg["id"] = id;
-    msg["method"] = "textDocument/definition";
-    msg["params"] = params;
+int LspClient::semanticTokensFull(const QString& uri) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    return sendRequest(RequestType::SemanticTokensFull, "textDocument/semanticTokens/full", params);
+}
 
-    sendMessage(msg);
-    return id;
+int LspClient::semanticTokensDelta(const QString& uri, const QString& previousResultId) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    params["previousResultId"] = previousResultId;
+    return sendRequest(RequestType::SemanticTokensDelta, "textDocument/semanticTokens/full/delta", params);
+}
+
+int LspClient::semanticTokensRange(const QString& uri, int firstLine, int lastLine) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    params["range"] = QJsonObject{
+        {"start", QJsonObject{{"line", firstLine}, {"character", 0}}},
+        {"end", QJsonObject{{"line", lastLine + 1}, {"character", 0}}}};
+    return sendRequest(RequestType::SemanticTokensRange, "textDocument/semanticTokens/range", params);
+}
+
+int LspClient::foldingRanges(const QString& uri) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    return sendRequest(RequestType::FoldingRange, "textDocument/foldingRange", params);
+}
+
+int LspClient::documentHighlight(const QString& uri, int line, int col) {
+    QJsonObject params;
+    params["textDocument"] = QJsonObject{{"uri", uri}};
+    params["position"] = QJsonObject{{"line", line}, {"character", col}};
+    return sendRequest(RequestType::DocumentHighlight, "textDocument/documentHighlight", params);
 }
 
 void LspClient::didOpen(const QString& uri, const QString& languageId, const QString& text, int version) {
@@ -247,11 +375,17 @@ void LspClient::didSave(const QString& uri) {
 
 void LspClient::onProcessError(QProcess::ProcessError error) {
     qDebug() << "LSP Process Error:" << error;
+    // A server that never started doesn't report finishing
+    if (error == QProcess::FailedToStart) {
+        initialized_ = false;
+        emit stopped();
+    }
 }
 
 void LspClient::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
     qDebug() << "LSP Process Finished:" << exitCode << exitStatus;
     initialized_ = false;
+    emit stopped();
 }
 
 } // namespace xenon::lsp
@@ -18,6 +18,7 @@ struct Diagnostic {
     int endLine = 0;
     int endCol = 0;
     QString message;
+    QString source;
     int severity = 1;
 };
 
@@ -28,6 +29,40 @@ struct CompletionItem {
     int kind = 0;
 };
 
+// What the server offers for textDocument/semanticTokens, from its
+// initialize result. Token types and modifiers are indexed by the integers
+// in the token data.
+struct SemanticTokensProvider {
+    QStringList tokenTypes;
+    QStringList tokenModifiers;
+    bool full = false;
+    bool delta = false;
+    bool range = false;
+};
+
+// Replaces deleteCount integers of the previous result's data at start
+struct SemanticTokensEdit {
+    uint32_t start = 0;
+    uint32_t deleteCount = 0;
+    std::vector<uint32_t> data;
+};
+
+// Lines startLine + 1..endLine can fold into startLine
+struct FoldingRange {
+    int startLine = 0;
+    int endLine = 0;
+};
+
+// A use of the symbol at a position; kind is 1 for text, 2 for a read and
+// 3 for a write
+struct DocumentHighlight {
+    int line = 0;
+    int col = 0;
+    int endLine = 0;
+    int endCol = 0;
+    int kind = 1;
+};
+
 class LspClient : public QObject {
     Q_OBJECT
 
@@ -50,11 +85,34 @@ public:
     int completion(const QString& uri, int line, int col);
     int definition(const QString& uri, int line, int col);
 
+    const SemanticTokensProvider& semanticTokensProvider() const { return semantic_tokens_provider_; }
+    int semanticTokensFull(const QString& uri);
+    // Answered by semanticTokensDeltaReceived, or by semanticTokensReceived
+    // when the server sends everything again
+    int semanticTokensDelta(const QString& uri, const QString& previousResultId);
+    // Lines firstLine..lastLine, inclusive
+    int semanticTokensRange(const QString& uri, int firstLine, int lastLine);
+
+    bool hasFoldingRangeProvider() const { return folding_range_provider_; }
+    int foldingRanges(const QString& uri);
+
+    bool hasDocumentHighlightProvider() const { return document_highlight_provider_; }
+    int documentHighlight(const QString& uri, int line, int col);
+
 signals:
     void diagnosticsReceived(const QString& uri, const QList<Diagnostic>& diagnostics);
     void completionReceived(int id, const QList<CompletionItem>& items);
     void hoverReceived(int id, const QString& content);
     void definitionReceived(int id, const QString& uri, int line, int col);
+    void semanticTokensReceived(int id, const QString& resultId, const std::vector<uint32_t>& data);
+    void semanticTokensDeltaReceived(int id, const QString& resultId, const std::vector<SemanticTokensEdit>& edits);
+    void foldingRangesReceived(int id, const std::vector<FoldingRange>& ranges);
+    void documentHighlightsReceived(int id, const std::vector<DocumentHighlight>& highlights);
+    void requestFailed(int id, int code);
+    // The server answered initialize, or went away; either way whatever it
+    // said about open documents before no longer holds
+    void initialized();
+    void stopped();
 
 private slots:
     void onReadyRead();
@@ -62,21 +120,31 @@ private slots:
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
 
 private:
+    enum class RequestType {
+        Initialize,
+        Completion,
+        Definition,
+        SemanticTokensFull,
+        SemanticTokensDelta,
+        SemanticTokensRange,
+        FoldingRange,
+        DocumentHighlight
+    };
+
     void sendMessage(const QJsonObject& msg);
     void processMessage(const QByteArray& data);
     void handleNotification(const QString& method, const QJsonValue& params);
     void handleResponse(int id, const QJsonValue& result, const QJsonValue& error);
+    int sendRequest(RequestType type, const QString& method, const QJsonObject& params);
 
     QProcess process_;
     QByteArray read_buffer_;
     int next_id_ = 1;
     bool initialized_ = false;
+    SemanticTokensProvider semantic_tokens_provider_;
+    bool folding_range_provider_ = false;
+    bool document_highlight_provider_ = false;
 
-    enum class RequestType {
-        Initialize,
-        Completion,
-        Definition
-    };
     std::unordered_map<int, RequestType> pending_requests_;
 };
 
@@ -0,0 +1,203 @@
+#include "services/file_index_service.hpp"
+#include <QDir>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QtConcurrent>
+
+namespace xenon::services {
+
+namespace {
+
+constexpr int kMaxWatchedDirectories = 8192;
+constexpr int kRescanDelayMs = 100;
+constexpr int kUnwatchedRescanIntervalMs = 30000;
+
+} // anonymous namespace
+
+FileIndexService::FileIndexService(QObject* parent)
+    : QObject(parent), cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+    // Editors and build tools touch a directory many times in a burst
+    rescan_timer_.setSingleShot(true);
+    rescan_timer_.setInterval(kRescanDelayMs);
+    connect(&rescan_timer_, &QTimer::timeout, this, &FileIndexService::rescanPendingDirectories);
+    connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, &FileIndexService::onDirectoryChanged);
+
+    unwatched_timer_.setInterval(kUnwatchedRescanIntervalMs);
+    connect(&unwatched_timer_, &QTimer::timeout, this, &FileIndexService::rescanUnwatchedDirectories);
+}
+
+FileIndexService::~FileIndexService() {
+    cancelJob();
+}
+
+void FileIndexService::cancelJob() {
+    // The job keeps its own flag and winds down on its own
+    *cancelled_ = true;
+    cancelled_ = std::make_shared<std::atomic<bool>>(false);
+    generation_++;
+    rescan_running_ = false;
+}
+
+void FileIndexService::setRootPath(const QString& path) {
+    cancelJob();
+    rescan_timer_.stop();
+    unwatched_timer_.stop();
+    pending_directories_.clear();
+    unwatched_directories_.clear();
+    if (!watcher_.directories().isEmpty()) {
+        watcher_.removePaths(watcher_.directories());
+    }
+
+    root_path_ = QDir(path).absolutePath();
+    index_.reset();
+
+    const std::string root = root_path_.toStdString();
+    const uint64_t generation = generation_;
+    auto index = std::make_shared<xenon::features::FileIndex>();
+    auto* watcher = new QFutureWatcher<std::vector<std::string>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation, index]() {
+        const auto directories = watcher->result();
+        watcher->deleteLater();
+        if (generation != generation_) return;
+
+        index_ = index;
+        watchDirectories({""});
+        watchDirectories(directories);
+        emit filesChanged();
+    });
+    watcher->setFuture(QtConcurrent::run([root, index, source = file_list_source_, cancelled = cancelled_]() {
+        std::vector<std::string> files;
+        if (source && source(root, files, *cancelled)) {
+            index->assign(files);
+        } else {
+            index->build(root, *cancelled);
+        }
+        return *cancelled ? std::vector<std::string>{} : index->directories();
+    }));
+}
+
+void FileIndexService::onDirectoryChanged(const QString& path) {
+    QString relative = QDir(root_path_).relativeFilePath(path);
+    if (relative == ".") relative.clear();
+    pending_directories_.insert(relative);
+    rescan_timer_.start();
+}
+
+void FileIndexService::rescanUnwatchedDirectories() {
+    for (const auto& directory : unwatched_directories_) {
+        pending_directories_.insert(directory);
+    }
+    rescanPendingDirectories();
+}
+
+void FileIndexService::rescanPendingDirectories() {
+    if (!index_ || pending_directories_.isEmpty()) return;
+    if (rescan_running_) {
+        rescan_timer_.start();
+        return;
+    }
+
+    std::vector<std::string> directories;
+    for (const auto& directory : pending_directories_) {
+        directories.push_back(directory.toStdString());
+    }
+    pending_directories_.clear();
+
+    using DirectoryChanges = xenon::features::FileIndex::DirectoryChanges;
+    const std::string root = root_path_.toStdString();
+    const uint64_t generation = generation_;
+    rescan_running_ = true;
+    auto* watcher = new QFutureWatcher<DirectoryChanges>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        const DirectoryChanges changes = watcher->result();
+        watcher->deleteLater();
+        if (generation != generation_) return;
+
+        rescan_running_ = false;
+        if (changes.changed) {
+            unwatchDirectories(changes.removedDirectories);
+            watchDirectories(changes.addedDirectories);
+            emit filesChanged();
+        }
+        // Changes that arrived while this rescan ran
+        if (!pending_directories_.isEmpty()) rescan_timer_.start();
+    });
+    watcher->setFuture(QtConcurrent::run([root, index = index_, directories, cancelled = cancelled_]() {
+        DirectoryChanges all;
+        for (const auto& directory : directories) {
+            if (*cancelled) break;
+            auto changes = index->rescanDirectory(root, directory);
+            all.changed = all.changed || changes.changed;
+            all.addedDirectories.insert(all.addedDirectories.end(), changes.addedDirectories.begin(),
+                                        changes.addedDirectories.end());
+            all.removedDirectories.insert(all.removedDirectories.end(), changes.removedDirectories.begin(),
+                                          changes.removedDirectories.end());
+        }
+        return all;
+    }));
+}
+
+void FileIndexService::watchDirectories(const std::vector<std::string>& relativePaths) {
+    const QDir root(root_path_);
+    const int room = kMaxWatchedDirectories - static_cast<int>(watcher_.directories().size());
+
+    QStringList paths;
+    for (const auto& relative : relativePaths) {
+        const QString directory = QString::fromStdString(relative);
+        if (paths.size() >= room) {
+            unwatched_directories_.insert(directory);
+        } else {
+            paths << (relative.empty() ? root_path_ : root.filePath(directory));
+        }
+    }
+    if (!paths.isEmpty()) {
+        // The OS may refuse some even below our limit
+        for (const auto& failed : watcher_.addPaths(paths)) {
+            QString relative = root.relativeFilePath(failed);
+            unwatched_directories_.insert(relative == "." ? QString() : relative);
+        }
+    }
+    if (!unwatched_directories_.isEmpty() && !unwatched_timer_.isActive()) {
+        unwatched_timer_.start();
+    }
+}
+
+void FileIndexService::unwatchDirectories(const std::vector<std::string>& relativePaths) {
+    if (relativePaths.empty()) return;
+
+    const QDir root(root_path_);
+    QStringList removed;
+    for (const auto& relative : relativePaths) {
+        removed << root.filePath(QString::fromStdString(relative));
+    }
+
+    for (const auto& relative : relativePaths) {
+        const QString directory = QString::fromStdString(relative);
+        for (auto it = unwatched_directories_.begin(); it != unwatched_directories_.end();) {
+            if (*it == directory || it->startsWith(directory + "/")) {
+                it = unwatched_directories_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (unwatched_directories_.isEmpty()) {
+        unwatched_timer_.stop();
+    }
+
+    // A removed directory takes its watched subdirectories with it
+    QStringList paths;
+    for (const auto& watched : watcher_.directories()) {
+        for (const auto& directory : removed) {
+            if (watched == directory || watched.startsWith(directory + "/")) {
+                paths << watched;
+                break;
+            }
+        }
+    }
+    if (!paths.isEmpty()) {
+        watcher_.removePaths(paths);
+    }
+}
+
+} // namespace xenon::services
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "features/file_index.hpp"
+
+namespace xenon::services {
+
+// Owns the workspace FileIndex: builds it on a worker thread when the root
+// changes and keeps it current from directory change notifications, which
+// are batched and rescanned off the GUI thread. Only the shallowest
+// kMaxWatchedDirectories directories are watched to stay within the OS
+// watch limit; the rest, and any the OS refuses, are rescanned on a timer.
+//
+// Nothing here waits for a worker. Changing the root cancels the running
+// job and drops its result by generation, and jobs only touch state they
+// share by value, so they may outlive the service.
+class FileIndexService : public QObject {
+    Q_OBJECT
+
+public:
+    // Lists the files under root (relative to it) from some cheaper source
+    // than a directory walk. Called on a worker thread; returning false
+    // falls back to the walk. Should give up soon after cancelled is set.
+    using FileListSource = std::function<bool(const std::string& root, std::vector<std::string>& files,
+                                              const std::atomic<bool>& cancelled)>;
+
+    explicit FileIndexService(QObject* parent = nullptr);
+    ~FileIndexService() override;
+
+    void setRootPath(const QString& path);
+    QString rootPath() const { return root_path_; }
+    // Takes effect from the next setRootPath
+    void setFileListSource(FileListSource source) { file_list_source_ = std::move(source); }
+
+    // Null until the first build for the current root has finished
+    std::shared_ptr<const xenon::features::FileIndex> index() const { return index_; }
+
+signals:
+    void filesChanged();
+
+private slots:
+    void onDirectoryChanged(const QString& path);
+    void rescanPendingDirectories();
+    void rescanUnwatchedDirectories();
+
+private:
+    void cancelJob();
+    void watchDirectories(const std::vector<std::string>& relativePaths);
+    void unwatchDirectories(const std::vector<std::string>& relativePaths);
+
+    QString root_path_;
+    FileListSource file_list_source_;
+    std::shared_ptr<xenon::features::FileIndex> index_;
+
+    QFileSystemWatcher watcher_;
+    QTimer rescan_timer_;
+    QSet<QString> pending_directories_;
+    // Directories past the watch limit, polled by unwatched_timer_
+    QSet<QString> unwatched_directories_;
+    QTimer unwatched_timer_;
+
+    // Bumped by every root change; results of older jobs are dropped
+    uint64_t generation_ = 0;
+    bool rescan_running_ = false;
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+} // namespace xenon::services
@@ -12,9 +12,9 @@ CommandPalette::CommandPalette(QWidget* parent)
     setStyleSheet(
         "QDialog { background-color: #252526; border: 1px solid #454545; border-radius: 6px; }"
         "QLineEdit { background-color: #3c3c3c; color: #ffffff; border: none; padding: 10px; font-size: 14pt; border-radius: 4px; margin: 5px; }"
-        "QListWidget { background-color: transparent; border: none; color: #cccccc; font-size: 12pt; outline: none; }"
-        "QListWidget::item { padding: 10px; border-bottom: 1px solid #2d2d2d; }"
-        "QListWidget::item:selected { background-color: #094771; color: #ffffff; }"
+        "QListView { background-color: transparent; border: none; color: #cccccc; font-size: 12pt; outline: none; }"
+        "QListView::item { padding: 10px; border-bottom: 1px solid #2d2d2d; }"
+        "QListView::item:selected { background-color: #094771; color: #ffffff; }"
     );
 
     auto* layout = new QVBoxLayout(this);
@@ -25,23 +25,50 @@ CommandPalette::CommandPalette(QWidget* parent)
     search_edit_->setPlaceholderText("Type a command...");
     layout->addWidget(search_edit_);
 
-    list_widget_ = new QListWidget(this);
-    list_widget_->setMinimumHeight(300);
-    layout->addWidget(list_widget_);
-
     // Initial commands
-    QStringList commands = {"File: New File", "File: Open File", "File: Save", "View: Toggle Sidebar", "View: Toggle Terminal", "Git: Pull", "Git: Push"};
-    list_widget_->addItems(commands);
-    list_widget_->setCurrentRow(0);
+    commands_ = {"File: New File", "File: Open File", "File: Save", "View: Toggle Sidebar", "View: Toggle Terminal", "Git: Pull", "Git: Push"};
+    for (const auto& command : commands_) {
+        candidates_.add(command.toStdString());
+    }
+
+    model_ = new ResultListModel(this);
+    model_->setDataProvider([this](uint32_t index, int role) -> QVariant {
+        return role == Qt::DisplayRole ? QVariant(commands_.at(static_cast<qsizetype>(index))) : QVariant();
+    });
+    model_->setAllResults(static_cast<size_t>(commands_.size()));
+
+    list_view_ = new QListView(this);
+    list_view_->setModel(model_);
+    list_view_->setUniformItemSizes(true);
+    list_view_->setMinimumHeight(300);
+    list_view_->setCurrentIndex(model_->index(0));
+    layout->addWidget(list_view_);
 
     connect(search_edit_, &QLineEdit::textChanged, this, &CommandPalette::onTextChanged);
-    connect(list_widget_, &QListWidget::itemDoubleClicked, this, &CommandPalette::onItemSelected);
+    connect(list_view_, &QListView::doubleClicked, this, &CommandPalette::onItemSelected);
     
     search_edit_->installEventFilter(this);
 }
 
+void CommandPalette::setFrecencyStore(xenon::features::FrecencyStore* store) {
+    frecency_ = store;
+}
+
 void CommandPalette::showPalette() {
+    // A handful of commands: refreshing every boost is cheaper than tracking
+    // which ones changed
+    if (frecency_) {
+        std::unordered_map<uint32_t, int> boosts;
+        for (qsizetype i = 0; i < commands_.size(); ++i) {
+            if (int boost = frecency_->boost(commands_.at(i).toStdString())) {
+                boosts.emplace(static_cast<uint32_t>(i), boost);
+            }
+        }
+        candidates_.setBoosts(std::move(boosts));
+    }
+
     search_edit_->clear();
+    onTextChanged(QString());
     
     // Position in top-center of parent or screen
     QWidget* p = parentWidget();
@@ -57,13 +84,13 @@ bool CommandPalette::eventFilter(QObject* obj, QEvent* event) {
     if (obj == search_edit_ && event->type() == QEvent::KeyPress) {
         auto* keyEvent = static_cast<QKeyEvent*>(event);
         if (keyEvent->key() == Qt::Key_Down) {
-            list_widget_->setCurrentRow((list_widget_->currentRow() + 1) % list_widget_->count());
+            moveSelection(1);
             return true;
         } else if (keyEvent->key() == Qt::Key_Up) {
-            list_widget_->setCurrentRow((list_widget_->currentRow() - 1 + list_widget_->count()) % list_widget_->count());
+            moveSelection(-1);
             return true;
         } else if (keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) {
-            onItemSelected(list_widget_->currentItem());
+            onItemSelected(list_view_->currentIndex());
             return true;
         } else if (keyEvent->key() == Qt::Key_Escape) {
             hide();
@@ -73,16 +100,29 @@ bool CommandPalette::eventFilter(QObject* obj, QEvent* event) {
     return QDialog::eventFilter(obj, event);
 }
 
+void CommandPalette::moveSelection(int delta) {
+    const int count = model_->rowCount();
+    if (count == 0) return;
+    const int row = (list_view_->currentIndex().row() + delta + count) % count;
+    list_view_->setCurrentIndex(model_->index(row));
+}
+
 void CommandPalette::onTextChanged(const QString& text) {
-    for (int i = 0; i < list_widget_->count(); ++i) {
-        auto* item = list_widget_->item(i);
-        item->setHidden(!item->text().contains(text, Qt::CaseInsensitive));
+    const auto matches = candidates_.rank(text.toStdString(), candidates_.size());
+    std::vector<uint32_t> results;
+    results.reserve(matches.size());
+    for (const auto& match : matches) {
+        results.push_back(match.index);
     }
-    list_widget_->setCurrentRow(0);
+    model_->setResults(std::move(results));
+    list_view_->setCurrentIndex(model_->index(0));
 }
 
-void CommandPalette::onItemSelected(QListWidgetItem* item) {
-    if (item) {
+void CommandPalette::onItemSelected(const QModelIndex& index) {
+    if (index.isValid()) {
+        if (frecency_) {
+            frecency_->record(index.data().toString().toStdString());
+        }
         // TODO: Execute command
         hide();
     }
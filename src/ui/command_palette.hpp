@@ -2,8 +2,12 @@
 
 #include <QDialog>
 #include <QLineEdit>
-#include <QListWidget>
+#include <QListView>
+#include <QStringList>
 #include <QVBoxLayout>
+#include "features/frecency_store.hpp"
+#include "features/fuzzy_matcher.hpp"
+#include "ui/result_list_model.hpp"
 
 namespace xenon::ui {
 
@@ -14,6 +18,9 @@ public:
     explicit CommandPalette(QWidget* parent = nullptr);
     ~CommandPalette() override = default;
 
+    // Frequently and recently executed commands rank higher. The store
+    // must outlive the palette.
+    void setFrecencyStore(xenon::features::FrecencyStore* store);
     void showPalette();
 
 protected:
@@ -21,11 +28,17 @@ protected:
 
 private slots:
     void onTextChanged(const QString& text);
-    void onItemSelected(QListWidgetItem* item);
+    void onItemSelected(const QModelIndex& index);
 
 private:
+    void moveSelection(int delta);
+
     QLineEdit* search_edit_;
-    QListWidget* list_widget_;
+    QListView* list_view_;
+    ResultListModel* model_;
+    QStringList commands_;
+    xenon::features::FuzzyIndex candidates_;
+    xenon::features::FrecencyStore* frecency_ = nullptr;
 };
 
 } // namespace xenon::ui
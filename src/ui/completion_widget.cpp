@@ -4,30 +4,45 @@
 namespace xenon::ui {
 
 CompletionWidget::CompletionWidget(QWidget* parent)
-    : QListWidget(parent) {
+    : QListView(parent) {
     
     setWindowFlags(Qt::Popup | Qt::FramelessWindowHint);
     setFixedWidth(300);
     setMaximumHeight(200);
     setStyleSheet(
-        "QListWidget { background-color: #252526; color: #cccccc; border: 1px solid #454545; outline: none; }"
-        "QListWidget::item { padding: 4px; border-bottom: 1px solid #2d2d2d; }"
-        "QListWidget::item:selected { background-color: #094771; color: #ffffff; }"
+        "QListView { background-color: #252526; color: #cccccc; border: 1px solid #454545; outline: none; }"
+        "QListView::item { padding: 4px; border-bottom: 1px solid #2d2d2d; }"
+        "QListView::item:selected { background-color: #094771; color: #ffffff; }"
     );
 
-    connect(this, &QListWidget::itemDoubleClicked, this, &CompletionWidget::onItemSelected);
+    model_ = new ResultListModel(this);
+    model_->setDataProvider([this](uint32_t index, int role) -> QVariant {
+        const auto& item = items_.at(static_cast<qsizetype>(index));
+        switch (role) {
+            case Qt::DisplayRole:
+                return item.label;
+            case Qt::ToolTipRole:
+                return item.detail;
+            case Qt::UserRole:
+                return item.insertText.isEmpty() ? item.label : item.insertText;
+            default:
+                return QVariant();
+        }
+    });
+    setModel(model_);
+    setUniformItemSizes(true);
+
+    connect(this, &QListView::doubleClicked, this, &CompletionWidget::onItemSelected);
 }
 
 void CompletionWidget::showCompletions(const QPoint& pos, const QList<xenon::lsp::CompletionItem>& items) {
-    clear();
-    for (const auto& item : items) {
-        auto* listItem = new QListWidgetItem(item.label, this);
-        listItem->setData(Qt::UserRole, item.insertText.isEmpty() ? item.label : item.insertText);
-        listItem->setToolTip(item.detail);
-    }
+    // Drop the old rows before the list they index into changes
+    model_->clear();
+    items_ = items;
+    model_->setAllResults(static_cast<size_t>(items_.size()));
     
-    if (count() > 0) {
-        setCurrentRow(0);
+    if (model_->rowCount() > 0) {
+        setCurrentIndex(model_->index(0));
         move(pos);
         show();
         setFocus();
@@ -36,19 +51,19 @@ void CompletionWidget::showCompletions(const QPoint& pos, const QList<xenon::lsp
 
 void CompletionWidget::keyPressEvent(QKeyEvent* event) {
     if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
-        onItemSelected(currentItem());
+        onItemSelected(currentIndex());
         event->accept();
     } else if (event->key() == Qt::Key_Escape) {
         hide();
         event->accept();
     } else {
-        QListWidget::keyPressEvent(event);
+        QListView::keyPressEvent(event);
     }
 }
 
-void CompletionWidget::onItemSelected(QListWidgetItem* item) {
-    if (item) {
-        emit completionSelected(item->data(Qt::UserRole).toString());
+void CompletionWidget::onItemSelected(const QModelIndex& index) {
+    if (index.isValid()) {
+        emit completionSelected(index.data(Qt::UserRole).toString());
         hide();
     }
 }
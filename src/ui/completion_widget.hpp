@@ -1,12 +1,13 @@
 #pragma once
 
-#include <QListWidget>
+#include <QListView>
 #include <QPoint>
 #include "lsp/lsp_client.hpp"
+#include "ui/result_list_model.hpp"
 
 namespace xenon::ui {
 
-class CompletionWidget : public QListWidget {
+class CompletionWidget : public QListView {
     Q_OBJECT
 
 public:
@@ -21,7 +22,12 @@ protected:
     void keyPressEvent(QKeyEvent* event) override;
 
 private slots:
-    void onItemSelected(QListWidgetItem* item);
+    void onItemSelected(const QModelIndex& index);
+
+private:
+    // Shared with the LSP reply; rows read from it on demand
+    QList<xenon::lsp::CompletionItem> items_;
+    ResultListModel* model_;
 };
 
 } // namespace xenon::ui
@@ -0,0 +1,48 @@
+#include "ui/digit_atlas.hpp"
+#include <QFontMetrics>
+#include <algorithm>
+#include <cmath>
+
+namespace xenon::ui {
+
+void DigitAtlas::prepare(const QFont& font, const QColor& color, qreal devicePixelRatio) {
+    if (!pixmap_.isNull() && font == font_ && color == color_ && devicePixelRatio == device_pixel_ratio_) return;
+    font_ = font;
+    color_ = color;
+    device_pixel_ratio_ = devicePixelRatio;
+
+    const QFontMetrics metrics(font);
+    digit_width_ = 0;
+    for (char digit = '0'; digit <= '9'; ++digit) {
+        digit_width_ = std::max(digit_width_, metrics.horizontalAdvance(QLatin1Char(digit)));
+    }
+    height_ = metrics.height();
+
+    pixmap_ = QPixmap(static_cast<int>(std::ceil(10 * digit_width_ * devicePixelRatio)),
+                      static_cast<int>(std::ceil(height_ * devicePixelRatio)));
+    pixmap_.setDevicePixelRatio(devicePixelRatio);
+    pixmap_.fill(Qt::transparent);
+
+    QPainter painter(&pixmap_);
+    painter.setFont(font);
+    painter.setPen(color);
+    for (int digit = 0; digit < 10; ++digit) {
+        painter.drawText(QRect(digit * digit_width_, 0, digit_width_, height_), Qt::AlignRight | Qt::AlignTop,
+                         QString(QLatin1Char(static_cast<char>('0' + digit))));
+    }
+}
+
+void DigitAtlas::drawNumber(QPainter& painter, int right, int top, int number) const {
+    // The source rectangle is in the pixmap's device pixels
+    const qreal cellWidth = digit_width_ * device_pixel_ratio_;
+    const qreal cellHeight = height_ * device_pixel_ratio_;
+    int x = right;
+    do {
+        x -= digit_width_;
+        const int digit = number % 10;
+        painter.drawPixmap(QPointF(x, top), pixmap_, QRectF(digit * cellWidth, 0, cellWidth, cellHeight));
+        number /= 10;
+    } while (number > 0);
+}
+
+} // namespace xenon::ui
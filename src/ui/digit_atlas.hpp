@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QColor>
+#include <QFont>
+#include <QPainter>
+#include <QPixmap>
+
+namespace xenon::ui {
+
+// The digits 0-9 rendered once into a pixmap, so numbers (line numbers in
+// the gutter) are drawn by copying glyph cells instead of building and
+// shaping a string each time. Every digit gets a cell as wide as the
+// widest one, which for the fixed-pitch editor fonts is all of them.
+class DigitAtlas {
+public:
+    // Renders the atlas again if the font, color or pixel ratio changed
+    void prepare(const QFont& font, const QColor& color, qreal devicePixelRatio);
+
+    int digitWidth() const { return digit_width_; }
+    int height() const { return height_; }
+
+    // Draws number with its last digit ending at x = right
+    void drawNumber(QPainter& painter, int right, int top, int number) const;
+
+private:
+    QPixmap pixmap_;
+    QFont font_;
+    QColor color_;
+    qreal device_pixel_ratio_ = 0;
+    int digit_width_ = 0;
+    int height_ = 0;
+};
+
+} // namespace xenon::ui
@@ -1,16 +1,144 @@
 #include "ui/editor_widget.hpp"
+#include "features/occurrences.hpp"
+#include "ui/minimap.hpp"
+#include "ui/problems_panel.hpp"
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainterPath>
 #include <QPainter>
+#include <QResizeEvent>
+#include <QScrollBar>
 #include <QTextBlock>
+#include <QTextLayout>
+#include <QToolTip>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
 
 namespace xenon::ui {
 
+using xenon::features::CursorRange;
+using xenon::features::DecorationKind;
+using xenon::features::DecorationLayer;
+using xenon::features::DecorationRange;
+using xenon::features::Diagnostic;
+using xenon::features::DiagnosticSeverity;
+using xenon::features::FoldingModel;
+using xenon::features::FoldRange;
+using xenon::features::LineSpan;
+using xenon::features::TextEdit;
+
+namespace {
+
+constexpr int kFoldColumnWidth = 14;
+// Left of the line numbers, for the mark of the worst diagnostic on a line
+constexpr int kDiagnosticColumnWidth = 10;
+// Quiet time after an edit before folds are guessed again
+constexpr int kFoldDelay = 300;
+// Quiet time after the cursor stops before occurrences are looked for
+constexpr int kOccurrenceDelay = 150;
+// Lines scanned for occurrences above and below the view
+constexpr int kOccurrenceMargin = 100;
+
+const QColor kCurrentLineColor(255, 255, 255, 15);
+
+QColor decorationColor(DecorationKind kind) {
+    switch (kind) {
+    case DecorationKind::Occurrence: return QColor(87, 87, 87, 110);
+    case DecorationKind::WriteOccurrence: return QColor(0, 73, 114, 140);
+    case DecorationKind::SearchMatch: return QColor(234, 92, 0, 85);
+    case DecorationKind::BracketMatch: return QColor(255, 255, 255, 45);
+    case DecorationKind::Count: break;
+    }
+    return {};
+}
+
+// The cursor movements applied at every cursor
+struct CursorKey {
+    QKeySequence::StandardKey key;
+    QTextCursor::MoveOperation operation;
+    QTextCursor::MoveMode mode;
+};
+
+const CursorKey kCursorKeys[] = {
+    {QKeySequence::MoveToNextChar, QTextCursor::Right, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToPreviousChar, QTextCursor::Left, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToNextWord, QTextCursor::WordRight, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToPreviousWord, QTextCursor::WordLeft, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToNextLine, QTextCursor::Down, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToPreviousLine, QTextCursor::Up, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToStartOfLine, QTextCursor::StartOfLine, QTextCursor::MoveAnchor},
+    {QKeySequence::MoveToEndOfLine, QTextCursor::EndOfLine, QTextCursor::MoveAnchor},
+    {QKeySequence::SelectNextChar, QTextCursor::Right, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectPreviousChar, QTextCursor::Left, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectNextWord, QTextCursor::WordRight, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectPreviousWord, QTextCursor::WordLeft, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectNextLine, QTextCursor::Down, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectPreviousLine, QTextCursor::Up, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectStartOfLine, QTextCursor::StartOfLine, QTextCursor::KeepAnchor},
+    {QKeySequence::SelectEndOfLine, QTextCursor::EndOfLine, QTextCursor::KeepAnchor},
+};
+
+std::u16string_view toU16View(const QString& text) {
+    return {reinterpret_cast<const char16_t*>(text.utf16()), static_cast<size_t>(text.size())};
+}
+
+std::u16string toU16String(const QString& text) {
+    return std::u16string(reinterpret_cast<const char16_t*>(text.utf16()), static_cast<size_t>(text.size()));
+}
+
+// Whether a match between before and after (null at the ends of the text)
+// is a word of its own rather than part of a longer one
+bool isWholeWord(QChar before, QChar after) {
+    return (before.isNull() || !xenon::features::isWordChar(before.unicode())) &&
+           (after.isNull() || !xenon::features::isWordChar(after.unicode()));
+}
+
+} // anonymous namespace
+
 CodeEditor::CodeEditor(QWidget* parent) : QPlainTextEdit(parent) {
     line_number_area_ = new LineNumberArea(this);
+    // Slots run in the order they were connected, so these stamps fall
+    // on either side of the highlighter's
+    connect(document(), &QTextDocument::contentsChange, this, [this]() {
+        if (latency_) latency_->mark(LatencyMonitor::Stage::Input);
+    });
     highlighter_ = new SyntaxHighlighter(document());
+    connect(document(), &QTextDocument::contentsChange, this, [this]() {
+        if (latency_) latency_->mark(LatencyMonitor::Stage::Highlight);
+    });
+    connect(document(), &QTextDocument::contentsChanged, this, [this]() {
+        if (latency_) latency_->mark(LatencyMonitor::Stage::Document);
+    });
+    wrap_layout_ = new WrapLayout(document());
+    minimap_ = new Minimap(this);
 
     connect(this, &CodeEditor::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
     connect(this, &CodeEditor::updateRequest, this, &CodeEditor::updateLineNumberArea);
+    connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::revealCursor);
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
+    // Lexing further down can turn brackets into string or comment text
+    connect(highlighter_, &SyntaxHighlighter::linesHighlighted, this, &CodeEditor::highlightCurrentLine);
+    connect(document(), &QTextDocument::contentsChange, this, &CodeEditor::onContentsChange);
+
+    fold_timer_.setSingleShot(true);
+    fold_timer_.setInterval(kFoldDelay);
+    connect(&fold_timer_, &QTimer::timeout, this, &CodeEditor::computeFolds);
+
+    occurrence_timer_.setSingleShot(true);
+    occurrence_timer_.setInterval(kOccurrenceDelay);
+    connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::scheduleOccurrences);
+    connect(&occurrence_timer_, &QTimer::timeout, this, &CodeEditor::computeOccurrences);
+    connect(&occurrence_watcher_, &QFutureWatcherBase::finished, this, &CodeEditor::onOccurrencesComputed);
+    // The scan covers the lines around the view; scrolling past them
+    // scans again
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() {
+        if (server_occurrences_) return;
+        const auto [first, last] = positionsIn(viewport()->rect());
+        if (first < occurrence_first_ || last > occurrence_last_) occurrence_timer_.start();
+    });
 
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
@@ -31,12 +159,72 @@ int CodeEditor::lineNumberAreaWidth() {
         digits++;
     }
 
-    int space = 15 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+    int space = 15 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits + kFoldColumnWidth +
+                kDiagnosticColumnWidth;
     return space;
 }
 
 void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */) {
-    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    setViewportMargins(lineNumberAreaWidth(), 0, minimap_->isHidden() ? 0 : Minimap::kWidth, 0);
+}
+
+void CodeEditor::setMinimapVisible(bool visible) {
+    minimap_->setVisible(visible);
+    updateLineNumberAreaWidth(0);
+    layoutMinimap();
+}
+
+bool CodeEditor::isMinimapVisible() const {
+    return !minimap_->isHidden();
+}
+
+void CodeEditor::setSoftWrap(bool wrap) {
+    if (wrap == softWrap()) return;
+    wrap_layout_->setEnabled(wrap);
+    setLineWrapMode(wrap ? QPlainTextEdit::WidgetWidth : QPlainTextEdit::NoWrap);
+    if (wrap) {
+        const auto* layout = qobject_cast<QPlainTextDocumentLayout*>(document()->documentLayout());
+        wrap_layout_->setWidth(layout->textWidth(), firstVisibleBlock().blockNumber());
+    }
+    updateVisibleLines();
+}
+
+int CodeEditor::rowForLine(int line) const {
+    const QTextBlock block = document()->findBlockByNumber(line);
+    return block.isValid() ? block.firstLineNumber() : document()->lineCount();
+}
+
+int CodeEditor::lineForRow(int row) const {
+    const QTextBlock block = document()->findBlockByLineNumber(row);
+    return block.isValid() ? block.blockNumber() : document()->blockCount() - 1;
+}
+
+void CodeEditor::layoutMinimap() {
+    // Between the text and the vertical scroll bar
+    const QRect cr = contentsRect();
+    minimap_->setGeometry(QRect(viewport()->geometry().right() + 1, cr.top(), Minimap::kWidth, cr.height()));
+    if (latency_overlay_) {
+        const QSize size = latency_overlay_->sizeHint();
+        const QRect view = viewport()->geometry();
+        latency_overlay_->setGeometry(QRect(QPoint(view.right() - size.width() - 8, view.top() + 8), size));
+    }
+}
+
+void CodeEditor::setLatencyMonitor(LatencyMonitor* monitor) {
+    latency_ = monitor;
+    if (!monitor && latency_overlay_) {
+        delete latency_overlay_;
+        latency_overlay_ = nullptr;
+    }
+}
+
+void CodeEditor::setLatencyOverlayVisible(bool visible) {
+    if (!latency_) return;
+    if (visible && !latency_overlay_) {
+        latency_overlay_ = new LatencyOverlay(latency_, this);
+        layoutMinimap();
+    }
+    if (latency_overlay_) latency_overlay_->setVisible(visible);
 }
 
 void CodeEditor::updateLineNumberArea(const QRect& rect, int dy) {
@@ -47,56 +235,931 @@ void CodeEditor::updateLineNumberArea(const QRect& rect, int dy) {
 
     if (rect.contains(viewport()->rect()))
         updateLineNumberAreaWidth(0);
+
+    updateVisibleLines();
+}
+
+void CodeEditor::updateVisibleLines() {
+    // Every row is one font height tall
+    const QTextBlock first = firstVisibleBlock();
+    const int rows = viewport()->height() / qMax(1, fontMetrics().height()) + 1;
+    highlighter_->setVisibleLines(first.blockNumber(), lineForRow(first.firstLineNumber() + rows));
+}
+
+void CodeEditor::onContentsChange(int position, int charsRemoved, int charsAdded) {
+    // A batched edit has already placed the cursors
+    if (!applying_edits_ && !cursors_.empty()) {
+        cursors_.applyChange(position, charsRemoved, charsAdded);
+        if (cursors_.size() <= 1) cursors_.clear();
+    }
+    decorations_.applyChange(position, charsRemoved, charsAdded);
+
+    const int count = document()->blockCount();
+    const int delta = count - line_count_;
+    line_count_ = count;
+
+    const QTextBlock first = document()->findBlock(position);
+    QTextBlock last = document()->findBlock(position + charsAdded);
+    if (!last.isValid()) last = document()->lastBlock();
+    const int firstLine = first.isValid() ? first.blockNumber() : 0;
+    applyHidden(folding_.applyEdit(firstLine, last.blockNumber() - delta, delta));
+    diagnostics_.applyEdit(firstLine, last.blockNumber() - delta, delta);
+
+    if (!server_folds_) fold_timer_.start();
+}
+
+void CodeEditor::computeFolds() {
+    if (server_folds_) return;
+    // Lines still waiting to be lexed have no brackets yet
+    if (!highlighter_->isIdle()) {
+        fold_timer_.start();
+        return;
+    }
+    // A walk over the brackets and indents the highlighter already keeps,
+    // so nothing is copied or lexed again
+    updateFoldRanges(xenon::features::computeFoldRanges(highlighter_->brackets()));
+}
+
+void CodeEditor::scheduleOccurrences() {
+    // Stale ones go at once when the cursor leaves them
+    const int position = textCursor().position();
+    auto touches = [&](DecorationKind kind) {
+        const auto [first, last] = decorations_.get(kind).overlapping(position - 1, position + 1);
+        return first != last;
+    };
+    if (!touches(DecorationKind::Occurrence) && !touches(DecorationKind::WriteOccurrence)) clearOccurrences();
+    occurrence_timer_.start();
+}
+
+void CodeEditor::computeOccurrences() {
+    if (occurrence_watcher_.isRunning()) {
+        occurrence_timer_.start();
+        return;
+    }
+    emit occurrencesRequested();
+    if (!server_occurrences_) scanOccurrences();
+}
+
+void CodeEditor::scanOccurrences() {
+    // Nothing to rescan on scrolling until the next word
+    occurrence_first_ = 0;
+    occurrence_last_ = std::numeric_limits<int>::max();
+    const QTextCursor cursor = textCursor();
+    const QString line = cursor.block().text();
+    const auto [start, end] = xenon::features::wordAt(toU16View(line), static_cast<size_t>(cursor.positionInBlock()));
+    if (cursor.hasSelection() || hasMultipleCursors() || start == end) {
+        clearOccurrences();
+        return;
+    }
+
+    // A copy of the lines in view and a margin around them, scanned off the
+    // UI thread, so the cost is the same however long the document is
+    const int firstLine = std::max(0, firstVisibleBlock().blockNumber() - kOccurrenceMargin);
+    const int lastLine = std::min(blockCount() - 1,
+                                  cursorForPosition(QPoint(0, viewport()->height())).blockNumber() + kOccurrenceMargin);
+    const QTextBlock first = document()->findBlockByNumber(firstLine);
+    const QTextBlock last = document()->findBlockByNumber(lastLine);
+    QTextCursor window(document());
+    window.setPosition(first.position());
+    window.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+    occurrence_first_ = first.position();
+    occurrence_last_ = last.position() + last.length();
+    QString word = line.mid(static_cast<qsizetype>(start), static_cast<qsizetype>(end - start));
+
+    occurrence_watcher_.setFuture(QtConcurrent::run(
+        [revision = document()->revision(), position = cursor.position(), base = first.position(),
+         text = window.selectedText(), word = std::move(word)]() {
+            OccurrenceResult result;
+            result.revision = revision;
+            result.position = position;
+            result.ranges = xenon::features::findWordOccurrences(toU16View(text), base, toU16View(word));
+            return result;
+        }));
+}
+
+void CodeEditor::onOccurrencesComputed() {
+    OccurrenceResult result = occurrence_watcher_.future().takeResult();
+    // The cursor or the text has moved on, which has scheduled another run
+    if (server_occurrences_ || result.revision != document()->revision() ||
+        result.position != textCursor().position()) {
+        return;
+    }
+    setDecorations(DecorationKind::WriteOccurrence, {});
+    setDecorations(DecorationKind::Occurrence, std::move(result.ranges));
+}
+
+void CodeEditor::setServerOccurrences(int revision, int position, std::vector<DecorationRange> reads,
+                                      std::vector<DecorationRange> writes) {
+    if (revision != document()->revision() || position != textCursor().position()) return;
+    // A server that finds nothing may not know the file; the scan stays
+    // until it answers with something
+    if (!reads.empty() || !writes.empty()) server_occurrences_ = true;
+    if (!server_occurrences_) return;
+    setDecorations(DecorationKind::Occurrence, std::move(reads));
+    setDecorations(DecorationKind::WriteOccurrence, std::move(writes));
+}
+
+void CodeEditor::resetServerOccurrences() {
+    if (!server_occurrences_) return;
+    server_occurrences_ = false;
+    clearOccurrences();
+    // Without asking the server again, which may be what just failed
+    if (!occurrence_watcher_.isRunning()) scanOccurrences();
+}
+
+void CodeEditor::clearOccurrences() {
+    setDecorations(DecorationKind::Occurrence, {});
+    setDecorations(DecorationKind::WriteOccurrence, {});
+}
+
+void CodeEditor::setFoldRanges(int revision, std::vector<FoldRange> ranges) {
+    if (revision != document()->revision()) return;
+    // A server that finds nothing may not know the file; the guessed folds
+    // are kept or come back
+    if (ranges.empty()) {
+        resetServerFolds();
+        return;
+    }
+    server_folds_ = true;
+    fold_timer_.stop();
+    updateFoldRanges(std::move(ranges));
+}
+
+void CodeEditor::resetServerFolds() {
+    if (!server_folds_) return;
+    server_folds_ = false;
+    computeFolds();
+}
+
+void CodeEditor::updateFoldRanges(std::vector<FoldRange> ranges) {
+    const std::vector<LineSpan> before = folding_.hiddenSpans();
+    folding_.setRanges(std::move(ranges));
+    applyFolds(before);
+    moveCursorOutOfFolds();
+}
+
+void CodeEditor::foldAt(int line) {
+    int index = folding_.rangeContaining(line);
+    while (index >= 0 && folding_.isCollapsed(index)) index = folding_.parent(index);
+    if (index >= 0) setFoldCollapsed(index, true);
+}
+
+void CodeEditor::unfoldAt(int line) {
+    const int index = folding_.rangeAt(line);
+    if (index >= 0) setFoldCollapsed(index, false);
+}
+
+void CodeEditor::setAllFolded(bool folded) {
+    const std::vector<LineSpan> before = folding_.hiddenSpans();
+    folding_.setAllCollapsed(folded);
+    applyFolds(before);
+    moveCursorOutOfFolds();
+}
+
+void CodeEditor::setFoldCollapsed(int index, bool collapsed) {
+    const std::vector<LineSpan> before = folding_.hiddenSpans();
+    folding_.setCollapsed(index, collapsed);
+    applyFolds(before);
+    moveCursorOutOfFolds();
+}
+
+void CodeEditor::revealCursor() {
+    // Moving into folded lines, by search or go to line, unfolds them
+    const std::vector<LineSpan> before = folding_.hiddenSpans();
+    if (folding_.reveal(textCursor().blockNumber())) applyFolds(before);
+}
+
+void CodeEditor::moveCursorOutOfFolds() {
+    const int line = textCursor().blockNumber();
+    if (!folding_.isHidden(line)) return;
+    // To the end of the line the fold starts on
+    QTextCursor cursor(document()->findBlockByNumber(folding_.lineAtVisible(folding_.visibleLine(line))));
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    setTextCursor(cursor);
+}
+
+void CodeEditor::applyFolds(const std::vector<LineSpan>& before) {
+    applyHidden(FoldingModel::difference(before, folding_.hiddenSpans()));
+}
+
+void CodeEditor::applyHidden(const std::vector<LineSpan>& spans) {
+    bool changed = false;
+    for (const LineSpan& span : spans) {
+        QTextBlock block = document()->findBlockByNumber(span.first);
+        int from = -1;
+        int to = -1;
+        for (int line = span.first; block.isValid() && line <= span.last; ++line, block = block.next()) {
+            const bool visible = !folding_.isHidden(line);
+            if (block.isVisible() == visible) continue;
+            block.setVisible(visible);
+            if (from < 0) from = block.position();
+            to = block.position() + block.length();
+        }
+        // The layout gives hidden blocks no height and the document's line
+        // counts, which scrolling goes by, skip them
+        if (from >= 0) {
+            document()->markContentsDirty(from, to - from);
+            wrap_layout_->markDirty(span.first, span.last);
+            changed = true;
+        }
+    }
+    if (changed) {
+        viewport()->update();
+        line_number_area_->update();
+        updateVisibleLines();
+    }
+}
+
+QTextBlock CodeEditor::nextShownBlock(const QTextBlock& block) const {
+    const int line = block.blockNumber() + 1;
+    const int next = folding_.nextVisibleLine(line);
+    return next == line ? block.next() : document()->findBlockByNumber(next);
 }
 
 void CodeEditor::resizeEvent(QResizeEvent* e) {
     QPlainTextEdit::resizeEvent(e);
+    // The view has dropped every block's row count, as it does on any
+    // change of width; it lays out what it shows, the rest is counted in
+    // the background
+    if (softWrap() && e->oldSize().width() != e->size().width()) {
+        const auto* layout = qobject_cast<QPlainTextDocumentLayout*>(document()->documentLayout());
+        wrap_layout_->setWidth(layout->textWidth(), firstVisibleBlock().blockNumber());
+    }
 
     QRect cr = contentsRect();
     line_number_area_->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    layoutMinimap();
+    updateVisibleLines();
 }
 
 void CodeEditor::highlightCurrentLine() {
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    // The highlight is painted from the cursor; only the rows it leaves and
+    // enters are repainted, and nothing when it stays on its row
+    const int position = textCursor().position();
+    const QRect before = rowRect(current_line_position_);
+    const QRect after = rowRect(position);
+    if (before != after) {
+        viewport()->update(before);
+        viewport()->update(after);
+    }
+    current_line_position_ = position;
+
+    const xenon::features::BracketPair match = bracketMatchAtCursor();
+    if (match.open == bracket_match_.open && match.close == bracket_match_.close) return;
+    bracket_match_ = match;
+    std::vector<DecorationRange> ranges;
+    if (match.open.valid()) {
+        for (const auto& bracket : {match.open, match.close}) {
+            if (!bracket.valid()) continue;
+            const int at = document()->findBlockByNumber(bracket.line).position() + bracket.column;
+            ranges.push_back({at, at + 1});
+        }
+    }
+    setDecorations(DecorationKind::BracketMatch, std::move(ranges));
+}
+
+xenon::features::BracketPair CodeEditor::bracketMatchAtCursor() const {
+    const QTextCursor cursor = textCursor();
+    if (cursor.hasSelection()) return {};
+
+    // The bracket after the cursor first, then the one before it; each is
+    // an O(log n) lookup in the highlighter's index, whatever the file size
+    const xenon::features::BracketIndex& brackets = highlighter_->brackets();
+    const int line = cursor.blockNumber();
+    for (const int column : {cursor.positionInBlock(), cursor.positionInBlock() - 1}) {
+        if (column < 0) continue;
+        const xenon::features::BracketPosition match = brackets.match(line, column);
+        if (match.valid()) return {{line, column}, match};
+    }
+    return {};
+}
+
+void CodeEditor::keyPressEvent(QKeyEvent* event) {
+    auto press = [this, event]() {
+        if (!hasMultipleCursors() || !multiCursorKeyPress(event)) QPlainTextEdit::keyPressEvent(event);
+    };
+    if (!latency_) {
+        press();
+        return;
+    }
+
+    const int revision = document()->revision();
+    const QTextCursor before = textCursor();
+    latency_->keyPressed();
+    press();
+    // Modifiers and keys the editor ignores would wait for an unrelated paint
+    const QTextCursor after = textCursor();
+    if (document()->revision() == revision && after.position() == before.position() &&
+        after.anchor() == before.anchor()) {
+        latency_->cancelKey();
+    }
+}
+
+bool CodeEditor::multiCursorKeyPress(QKeyEvent* event) {
+    syncPrimaryCursor();
+    if (!hasMultipleCursors()) {
+        cursors_.clear();
+        return false;
+    }
+
+    if (event->key() == Qt::Key_Escape) {
+        clearExtraCursors();
+        return true;
+    }
+    if (event->matches(QKeySequence::Copy) || event->matches(QKeySequence::Cut)) {
+        QGuiApplication::clipboard()->setText(selectedTexts());
+        if (event->matches(QKeySequence::Cut) && !isReadOnly()) applyEdits(cursors_.erase(0, 0, document()->characterCount() - 1));
+        return true;
+    }
+    for (const CursorKey& key : kCursorKeys) {
+        if (event->matches(key.key)) {
+            moveCursors(key.operation, key.mode);
+            return true;
+        }
+    }
+    if (isReadOnly()) return false;
+
+    if (event->matches(QKeySequence::Paste)) {
+        QString text = QGuiApplication::clipboard()->text();
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        // One line per cursor, as copied from as many cursors
+        std::vector<std::u16string> texts;
+        const QStringList lines = text.split(QLatin1Char('\n'));
+        if (static_cast<size_t>(lines.size()) == cursors_.size()) {
+            for (const QString& line : lines) texts.push_back(toU16String(line));
+        } else {
+            texts.push_back(toU16String(text));
+        }
+        applyEdits(cursors_.replace(texts));
+        return true;
+    }
+
+    const int length = document()->characterCount() - 1;
+    switch (event->key()) {
+    case Qt::Key_Backspace:
+        applyEdits(cursors_.erase(1, 0, length));
+        return true;
+    case Qt::Key_Delete:
+        applyEdits(cursors_.erase(0, 1, length));
+        return true;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        applyEdits(cursors_.replace({u"\n"}));
+        return true;
+    case Qt::Key_Tab:
+        applyEdits(cursors_.replace({u"\t"}));
+        return true;
+    default:
+        break;
+    }
+
+    const QString text = event->text();
+    if (text.isEmpty() || !text.at(0).isPrint() || (event->modifiers() & (Qt::ControlModifier | Qt::MetaModifier))) {
+        return false;
+    }
+    applyEdits(cursors_.replace({toU16String(text)}));
+    return true;
+}
+
+void CodeEditor::syncPrimaryCursor() {
+    const QTextCursor cursor = textCursor();
+    const CursorRange range{cursor.anchor(), cursor.position()};
+    if (cursors_.empty()) {
+        cursors_.set({range}, 0);
+    } else {
+        cursors_.setPrimaryRange(range);
+    }
+}
+
+void CodeEditor::applyPrimaryCursor() {
+    const CursorRange range = cursors_.primaryRange();
+    if (cursors_.size() <= 1) cursors_.clear();
+    QTextCursor cursor(document());
+    cursor.setPosition(range.anchor);
+    cursor.setPosition(range.position, QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+    viewport()->update();
+}
+
+void CodeEditor::clearExtraCursors() {
+    word_needle_.clear();
+    if (cursors_.empty()) return;
+    cursors_.clear();
+    viewport()->update();
+}
+
+void CodeEditor::applyEdits(const std::vector<TextEdit>& edits) {
+    // Back to front, so each edit's offsets are still those of the text
+    // it was worked out on; one edit block is one undo step and one
+    // contentsChange over the span of all of them
+    applying_edits_ = true;
+    QTextCursor cursor(document());
+    cursor.beginEditBlock();
+    for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit) {
+        cursor.setPosition(edit->start);
+        cursor.setPosition(edit->end, QTextCursor::KeepAnchor);
+        if (edit->text.empty()) {
+            cursor.removeSelectedText();
+        } else {
+            cursor.insertText(QString::fromUtf16(edit->text.data(), static_cast<qsizetype>(edit->text.size())));
+        }
+    }
+    cursor.endEditBlock();
+    applying_edits_ = false;
+    applyPrimaryCursor();
+}
+
+void CodeEditor::moveCursors(QTextCursor::MoveOperation operation, QTextCursor::MoveMode mode) {
+    // One cursor is moved to each position in turn, as the view would move
+    // it; the moves that need a layout lay out the lines they cross
+    std::vector<CursorRange> moved;
+    moved.reserve(cursors_.size());
+    QTextCursor cursor(document());
+    for (const CursorRange& range : cursors_.ranges()) {
+        cursor.setPosition(range.anchor);
+        cursor.setPosition(range.position, QTextCursor::KeepAnchor);
+        if (mode == QTextCursor::MoveAnchor && cursor.hasSelection() &&
+            (operation == QTextCursor::Left || operation == QTextCursor::Right)) {
+            // Collapses to the side it would move to
+            cursor.setPosition(operation == QTextCursor::Left ? range.start() : range.end());
+        } else {
+            cursor.movePosition(operation, mode);
+        }
+        moved.push_back({cursor.anchor(), cursor.position()});
+    }
+    cursors_.set(std::move(moved), cursors_.primary());
+    applyPrimaryCursor();
+}
+
+void CodeEditor::addCursorVertically(int direction) {
+    syncPrimaryCursor();
+    const CursorRange edge = direction < 0 ? cursors_.ranges().front() : cursors_.ranges().back();
+    QTextCursor cursor(document());
+    cursor.setPosition(edge.position);
+    if (cursor.movePosition(direction < 0 ? QTextCursor::Up : QTextCursor::Down)) {
+        cursors_.add({cursor.position(), cursor.position()});
+    }
+    applyPrimaryCursor();
+}
+
+void CodeEditor::addNextOccurrence() {
+    QTextCursor cursor = textCursor();
+    if (!cursor.hasSelection()) {
+        cursor.select(QTextCursor::WordUnderCursor);
+        setTextCursor(cursor);
+        word_needle_ = cursor.selectedText();
+        return;
+    }
+
+    syncPrimaryCursor();
+    const QString needle = cursor.selectedText();
+    const bool wholeWord = !needle.isEmpty() && needle == word_needle_;
+
+    // The first match from `from` that starts before limit, skipping the
+    // ones inside longer words when the needle is a word
+    auto findFrom = [&](int from, int limit) {
+        for (QTextCursor found = document()->find(needle, from, QTextDocument::FindCaseSensitively);
+             !found.isNull() && found.selectionStart() < limit;
+             found = document()->find(needle, found.selectionStart() + 1, QTextDocument::FindCaseSensitively)) {
+            if (!wholeWord || isWholeWord(document()->characterAt(found.selectionStart() - 1),
+                                          document()->characterAt(found.selectionEnd()))) {
+                return found;
+            }
+        }
+        return QTextCursor();
+    };
+    const int end = cursors_.primaryRange().end();
+    QTextCursor found = findFrom(end, std::numeric_limits<int>::max());
+    if (found.isNull()) found = findFrom(0, end);
+    if (!found.isNull()) cursors_.add({found.anchor(), found.position()});
+    applyPrimaryCursor();
+}
+
+void CodeEditor::selectAllOccurrences() {
+    QTextCursor cursor = textCursor();
+    if (!cursor.hasSelection()) {
+        cursor.select(QTextCursor::WordUnderCursor);
+        word_needle_ = cursor.selectedText();
+    }
+    const QString needle = cursor.selectedText();
+    if (needle.isEmpty() || needle.contains(QChar::ParagraphSeparator)) return;
+    const bool wholeWord = needle == word_needle_;
+
+    // One pass over the text, however many matches there are
+    const QString text = toPlainText();
+    std::vector<CursorRange> ranges;
+    size_t primary = 0;
+    for (qsizetype at = text.indexOf(needle); at >= 0; at = text.indexOf(needle, at + needle.size())) {
+        const qsizetype after = at + needle.size();
+        if (wholeWord && !isWholeWord(at > 0 ? text[at - 1] : QChar(), after < text.size() ? text[after] : QChar())) {
+            continue;
+        }
+        if (at == cursor.selectionStart()) primary = ranges.size();
+        ranges.push_back({static_cast<int>(at), static_cast<int>(after)});
+    }
+    if (ranges.empty()) return;
+    cursors_.set(std::move(ranges), primary);
+    applyPrimaryCursor();
+}
+
+QString CodeEditor::selectedTexts() const {
+    QStringList texts;
+    QTextCursor cursor(document());
+    for (const CursorRange& range : cursors_.ranges()) {
+        if (range.empty()) continue;
+        cursor.setPosition(range.start());
+        cursor.setPosition(range.end(), QTextCursor::KeepAnchor);
+        texts << cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    }
+    return texts.join(QLatin1Char('\n'));
+}
+
+void CodeEditor::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton && (event->modifiers() & Qt::AltModifier)) {
+        const QPoint position = event->position().toPoint();
+        if (event->modifiers() & Qt::ShiftModifier) {
+            column_selecting_ = true;
+            column_line_ = cursorForPosition(position).blockNumber();
+            column_x_ = position.x() - contentOffset().x();
+            selectColumn(position);
+        } else {
+            syncPrimaryCursor();
+            const int at = cursorForPosition(position).position();
+            cursors_.add({at, at});
+            applyPrimaryCursor();
+        }
+        return;
+    }
+    if (event->button() == Qt::LeftButton) clearExtraCursors();
+    QPlainTextEdit::mousePressEvent(event);
+}
+
+void CodeEditor::mouseMoveEvent(QMouseEvent* event) {
+    if (column_selecting_) {
+        selectColumn(event->position().toPoint());
+        return;
+    }
+    QPlainTextEdit::mouseMoveEvent(event);
+}
+
+void CodeEditor::mouseReleaseEvent(QMouseEvent* event) {
+    if (column_selecting_) {
+        column_selecting_ = false;
+        return;
+    }
+    QPlainTextEdit::mouseReleaseEvent(event);
+}
+
+void CodeEditor::selectColumn(const QPoint& position) {
+    const int line = cursorForPosition(position).blockNumber();
+    const qreal x = position.x() - contentOffset().x();
+    const qreal charWidth = fontMetrics().horizontalAdvance(QLatin1Char(' '));
+    auto columnAt = [charWidth](const QTextBlock& block, qreal at) {
+        const QTextLayout* layout = block.layout();
+        if (layout && layout->lineCount() > 0) return layout->lineAt(0).xToCursor(at);
+        return std::clamp(qRound(at / charWidth), 0, block.length() - 1);
+    };
 
+    // The same columns on each shown line between where the drag began
+    // and where it is
+    std::vector<CursorRange> ranges;
+    size_t primary = 0;
+    QTextBlock block = document()->findBlockByNumber(std::min(column_line_, line));
+    for (; block.isValid() && block.blockNumber() <= std::max(column_line_, line); block = block.next()) {
+        if (!block.isVisible()) continue;
+        if (block.blockNumber() == line) primary = ranges.size();
+        ranges.push_back({block.position() + columnAt(block, column_x_), block.position() + columnAt(block, x)});
+    }
+    if (ranges.empty()) return;
+    cursors_.set(std::move(ranges), primary);
+    applyPrimaryCursor();
+}
+
+std::pair<int, int> CodeEditor::positionsIn(const QRect& area) const {
+    const QTextBlock first = cursorForPosition(QPoint(0, area.top())).block();
+    const QTextBlock last = cursorForPosition(QPoint(0, area.bottom())).block();
+    return {first.position(), last.position() + last.length()};
+}
+
+QRectF CodeEditor::caretRect(int position) const {
+    const QTextBlock block = document()->findBlock(position);
+    if (!block.isValid() || !block.isVisible() || !block.layout()) return {};
+    const QTextLine row = block.layout()->lineForTextPosition(position - block.position());
+    if (!row.isValid()) return {};
+    const QPointF origin = blockBoundingGeometry(block).translated(contentOffset()).topLeft();
+    return QRectF(origin.x() + row.cursorToX(position - block.position()), origin.y() + row.y(),
+                  cursorWidth(), row.height());
+}
+
+QRect CodeEditor::rowRect(int position) const {
+    const QRectF caret = caretRect(position);
+    if (caret.isNull()) return {};
+    return QRectF(0, caret.top(), viewport()->width(), caret.height()).toAlignedRect();
+}
+
+std::vector<QRectF> CodeEditor::rangeRects(int start, int end) const {
+    std::vector<QRectF> rects;
+    const QPointF offset = contentOffset();
+    for (QTextBlock block = document()->findBlock(start); block.isValid() && block.position() < end;
+         block = block.next()) {
+        if (!block.isVisible() || !block.layout() || block.layout()->lineCount() == 0) continue;
+        const QTextLayout* layout = block.layout();
+        const QPointF origin = blockBoundingGeometry(block).translated(offset).topLeft();
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            const QTextLine row = layout->lineAt(i);
+            const int rowStart = block.position() + row.textStart();
+            const int from = std::max(start, rowStart);
+            const int to = std::min(end, rowStart + row.textLength());
+            if (from >= to) continue;
+            const qreal left = row.cursorToX(from - block.position());
+            const qreal right = row.cursorToX(to - block.position());
+            rects.emplace_back(origin.x() + left, origin.y() + row.y(), right - left, row.height());
+        }
+    }
+    return rects;
+}
+
+void CodeEditor::paintExtraCursors(QPaintEvent* event) {
+    if (!hasMultipleCursors()) return;
+
+    // Only the cursors in the painted area are looked at, found by binary
+    // search
+    const auto [first, last] = positionsIn(event->rect());
+    QPainter painter(viewport());
+    QColor selectionColor = palette().color(QPalette::Highlight);
+    selectionColor.setAlpha(110);
+    const QColor caretColor = palette().color(QPalette::Text);
+
+    const std::vector<CursorRange>& ranges = cursors_.ranges();
+    for (size_t i = cursors_.lowerBound(first); i < ranges.size() && ranges[i].start() <= last; ++i) {
+        // The view draws the primary cursor itself
+        if (i == cursors_.primary()) continue;
+        const CursorRange& range = ranges[i];
+        for (const QRectF& rect : rangeRects(std::max(range.start(), first), std::min(range.end(), last))) {
+            painter.fillRect(rect, selectionColor);
+        }
+        const QRectF caret = caretRect(range.position);
+        if (!caret.isNull()) painter.fillRect(caret, caretColor);
+    }
+}
+
+void CodeEditor::setDecorations(DecorationKind kind, std::vector<DecorationRange> ranges) {
+    const xenon::features::DecorationSet& set = decorations_.get(kind);
+    if (ranges.empty() && set.empty()) return;
+    updateDecorationRows(set);
+    decorations_.set(kind, std::move(ranges));
+    updateDecorationRows(set);
+}
+
+void CodeEditor::updateDecorationRows(const xenon::features::DecorationSet& set) {
+    const auto [first, last] = positionsIn(viewport()->rect());
+    const auto [begin, end] = set.overlapping(first, last);
+    for (size_t i = begin; i < end; ++i) {
+        const DecorationRange& range = set.ranges()[i];
+        const QRect top = rowRect(std::max(range.start, first));
+        const QRect bottom = rowRect(std::min(range.end, last - 1));
+        viewport()->update(top.united(bottom));
+    }
+}
+
+void CodeEditor::paintDecorations(QPaintEvent* event) {
+    QPainter painter(viewport());
     if (!isReadOnly()) {
-        QTextEdit::ExtraSelection selection;
+        const QRect row = rowRect(textCursor().position());
+        if (row.intersects(event->rect())) painter.fillRect(row, kCurrentLineColor);
+    }
+    if (decorations_.empty()) return;
 
-        QColor lineColor = QColor(Qt::white).lighter(160);
-        lineColor.setAlpha(15);
+    const auto [first, last] = positionsIn(event->rect());
+    for (size_t kind = 0; kind < DecorationLayer::kKindCount; ++kind) {
+        const xenon::features::DecorationSet& set = decorations_.get(static_cast<DecorationKind>(kind));
+        const QColor color = decorationColor(static_cast<DecorationKind>(kind));
+        const auto [begin, end] = set.overlapping(first, last);
+        for (size_t i = begin; i < end; ++i) {
+            const DecorationRange& range = set.ranges()[i];
+            for (const QRectF& rect : rangeRects(std::max(range.start, first), std::min(range.end, last))) {
+                painter.fillRect(rect, color);
+            }
+        }
+    }
+}
 
-        selection.format.setBackground(lineColor);
-        selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-        selection.cursor = textCursor();
-        selection.cursor.clearSelection();
-        extraSelections.append(selection);
+void CodeEditor::paintEvent(QPaintEvent* event) {
+    // Backgrounds, under the text and the selection
+    paintDecorations(event);
+    QPlainTextEdit::paintEvent(event);
+    paintExtraCursors(event);
+    paintDiagnostics(event);
+    paintFoldMarkers(event);
+    if (latency_) latency_->painted();
+}
+
+void CodeEditor::setDiagnostics(std::vector<Diagnostic> diagnostics) {
+    if (diagnostics.empty() && diagnostics_.empty()) return;
+    diagnostics_.assign(std::move(diagnostics));
+    viewport()->update();
+    line_number_area_->update();
+}
+
+void CodeEditor::paintDiagnostics(QPaintEvent* event) {
+    if (diagnostics_.empty()) return;
+    const int firstLine = firstVisibleBlock().blockNumber();
+    const int lastLine = cursorForPosition(QPoint(0, event->rect().bottom())).blockNumber();
+    const std::vector<size_t> visible = diagnostics_.overlapping(firstLine, lastLine);
+    if (visible.empty()) return;
+
+    QPainter painter(viewport());
+    painter.setRenderHint(QPainter::Antialiasing);
+    const QPointF offset = contentOffset();
+    const qreal charWidth = fontMetrics().horizontalAdvance(QLatin1Char(' '));
+
+    // A wave under columns start..end of each row of the line, drawn from
+    // the rows the view has laid out
+    auto underline = [&](const QTextBlock& block, int start, int end, const QColor& color) {
+        const QTextLayout* layout = block.layout();
+        const QPointF origin = blockBoundingGeometry(block).translated(offset).topLeft();
+        painter.setPen(QPen(color, 1));
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            const QTextLine row = layout->lineAt(i);
+            const int rowStart = row.textStart();
+            const int rowEnd = rowStart + row.textLength();
+            qreal left = 0;
+            qreal right = 0;
+            if (start == end) {
+                // An empty range still gets a character's width
+                if (start < rowStart || (start >= rowEnd && i != layout->lineCount() - 1)) continue;
+                left = origin.x() + row.cursorToX(start);
+                right = left + charWidth;
+            } else {
+                const int from = std::max(start, rowStart);
+                const int to = std::min(end, rowEnd);
+                if (from >= to) continue;
+                left = origin.x() + row.cursorToX(from);
+                right = origin.x() + row.cursorToX(to);
+            }
+            const qreal y = origin.y() + row.y() + row.height() - 2;
+
+            QPainterPath wave(QPointF(left, y));
+            bool up = true;
+            for (qreal x = left + 2; x < right + 2; x += 2, up = !up) {
+                wave.lineTo(x, up ? y - 2 : y);
+            }
+            painter.drawPath(wave);
+        }
+    };
+
+    // Least severe first, so errors end up on top
+    std::vector<size_t> order = visible;
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return diagnostics_.all()[a].severity > diagnostics_.all()[b].severity;
+    });
+    for (const size_t index : order) {
+        const Diagnostic& d = diagnostics_.all()[index];
+        const QColor color = diagnosticColor(d.severity);
+        for (int line = std::max(d.line, firstLine); line <= std::min(d.endLine, lastLine); ++line) {
+            const QTextBlock block = document()->findBlockByNumber(line);
+            if (!block.isValid() || !block.isVisible() || !block.layout() || block.layout()->lineCount() == 0) continue;
+            const int length = block.length() - 1;
+            const int start = line == d.line ? std::min(d.col, length) : 0;
+            const int end = line == d.endLine ? std::clamp(d.endCol, start, length) : length;
+            // Rows past the first of a range are only underlined where it
+            // has text on them
+            if (line != d.line && end == 0) continue;
+            underline(block, start, end, color);
+        }
+    }
+}
+
+bool CodeEditor::viewportEvent(QEvent* event) {
+    if (event->type() == QEvent::ToolTip && !diagnostics_.empty()) {
+        auto* helpEvent = static_cast<QHelpEvent*>(event);
+        const QTextCursor cursor = cursorForPosition(helpEvent->pos());
+        const int line = cursor.blockNumber();
+        const int column = cursor.positionInBlock();
+
+        QStringList messages;
+        for (const size_t index : diagnostics_.overlapping(line, line)) {
+            const Diagnostic& d = diagnostics_.all()[index];
+            const bool after = line > d.line || column >= d.col;
+            const bool before = line < d.endLine || column <= std::max(d.endCol, d.col + 1);
+            if (after && before) messages << QString::fromStdString(d.message);
+        }
+        if (messages.isEmpty()) {
+            QToolTip::hideText();
+            event->ignore();
+        } else {
+            QToolTip::showText(helpEvent->globalPos(), messages.join(QLatin1Char('\n')), viewport());
+        }
+        return true;
     }
+    return QPlainTextEdit::viewportEvent(event);
+}
+
+void CodeEditor::paintFoldMarkers(QPaintEvent* event) {
+    if (folding_.hiddenSpans().empty()) return;
+
+    // A marker after the text of each line whose fold is collapsed
+    QPainter painter(viewport());
+    const QPointF offset = contentOffset();
+    const QString ellipsis = QStringLiteral("\u22ef");
+    const int markerWidth = fontMetrics().horizontalAdvance(ellipsis) + 8;
+    for (QTextBlock block = firstVisibleBlock(); block.isValid(); block = nextShownBlock(block)) {
+        const QRectF rect = blockBoundingGeometry(block).translated(offset);
+        if (rect.top() > event->rect().bottom()) break;
+        const int index = folding_.rangeAt(block.blockNumber());
+        if (index < 0 || !folding_.isCollapsed(index) || !block.layout() || block.layout()->lineCount() == 0) continue;
 
-    setExtraSelections(extraSelections);
+        const QTextLine line = block.layout()->lineAt(block.layout()->lineCount() - 1);
+        const QRectF marker(rect.left() + line.naturalTextWidth() + 6, rect.top() + line.y() + 2, markerWidth,
+                            line.height() - 4);
+        painter.fillRect(marker, QColor(255, 255, 255, 30));
+        painter.setPen(QColor("#858585"));
+        painter.drawText(marker, Qt::AlignCenter, ellipsis);
+    }
 }
 
 void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent* event) {
     QPainter painter(line_number_area_);
     painter.fillRect(event->rect(), QColor("#1e1e1e"));
+    gutter_digits_.prepare(line_number_area_->font(), QColor("#858585"), line_number_area_->devicePixelRatioF());
+    const int right = line_number_area_->width() - kFoldColumnWidth - 5;
+    const int foldLeft = line_number_area_->width() - kFoldColumnWidth;
 
+    // Only the first block's position is looked up; the rest follow from
+    // the heights. Folded blocks are stepped over in one go.
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
     int top = qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
     int bottom = top + qRound(blockBoundingRect(block).height());
 
+    // The worst diagnostic starting on each line in view
+    std::vector<int> marks;
+    if (!diagnostics_.empty()) {
+        const int lastLine = cursorForPosition(QPoint(0, event->rect().bottom())).blockNumber();
+        marks.assign(static_cast<size_t>(std::max(0, lastLine - blockNumber + 1)), 0);
+        for (const size_t index : diagnostics_.overlapping(blockNumber, lastLine)) {
+            const Diagnostic& d = diagnostics_.all()[index];
+            if (d.line < blockNumber) continue;
+            int& mark = marks[static_cast<size_t>(d.line - blockNumber)];
+            const int severity = static_cast<int>(d.severity);
+            if (mark == 0 || severity < mark) mark = severity;
+        }
+    }
+    const int firstLine = blockNumber;
+
     while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-            painter.setPen(QColor("#858585"));
-            painter.drawText(0, top, line_number_area_->width() - 5, fontMetrics().height(),
-                             Qt::AlignRight, number);
+        if (bottom >= event->rect().top()) {
+            gutter_digits_.drawNumber(painter, right, top, blockNumber + 1);
+
+            const auto mark = static_cast<size_t>(blockNumber - firstLine);
+            if (mark < marks.size() && marks[mark] != 0) {
+                const int row = std::min(bottom - top, fontMetrics().height());
+                painter.save();
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(diagnosticColor(static_cast<DiagnosticSeverity>(marks[mark])));
+                painter.drawEllipse(QPointF(kDiagnosticColumnWidth / 2.0 + 1, top + row / 2.0), 3, 3);
+                painter.restore();
+            }
+
+            const int fold = folding_.rangeAt(blockNumber);
+            if (fold >= 0) {
+                // Points right when collapsed, down when expanded; on the
+                // first row of a wrapped line
+                const int row = std::min(bottom - top, fontMetrics().height());
+                const QPointF center(foldLeft + kFoldColumnWidth / 2.0, top + row / 2.0);
+                QPolygonF triangle;
+                if (folding_.isCollapsed(fold)) {
+                    triangle << center + QPointF(-2, -4) << center + QPointF(3, 0) << center + QPointF(-2, 4);
+                } else {
+                    triangle << center + QPointF(-4, -2) << center + QPointF(4, -2) << center + QPointF(0, 3);
+                }
+                painter.save();
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(QColor("#858585"));
+                painter.drawPolygon(triangle);
+                painter.restore();
+            }
         }
 
-        block = block.next();
+        block = nextShownBlock(block);
         top = bottom;
-        bottom = top + qRound(blockBoundingRect(block).height());
-        ++blockNumber;
+        if (block.isValid()) {
+            bottom = top + qRound(blockBoundingRect(block).height());
+            blockNumber = block.blockNumber();
+        }
     }
 }
 
+void CodeEditor::lineNumberAreaMousePressEvent(QMouseEvent* event) {
+    if (event->button() != Qt::LeftButton) return;
+    if (event->position().x() < line_number_area_->width() - kFoldColumnWidth) return;
+
+    // The gutter and the viewport share their top edge
+    const int line = cursorForPosition(QPoint(0, qRound(event->position().y()))).blockNumber();
+    const int index = folding_.rangeAt(line);
+    if (index >= 0) setFoldCollapsed(index, !folding_.isCollapsed(index));
+}
+
 } // namespace xenon::ui
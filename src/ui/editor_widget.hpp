@@ -1,31 +1,200 @@
 #pragma once
 
+#include <QFutureWatcher>
 #include <QPlainTextEdit>
+#include <QTimer>
 #include <QWidget>
+#include "features/decorations.hpp"
+#include "features/diagnostics.hpp"
+#include "features/folding.hpp"
+#include "features/multi_cursor.hpp"
+#include "ui/digit_atlas.hpp"
+#include "ui/latency_monitor.hpp"
 #include "ui/syntax_highlighter.hpp"
+#include "ui/wrap_layout.hpp"
 
 namespace xenon::ui {
 
+class Minimap;
+
 class CodeEditor : public QPlainTextEdit {
     Q_OBJECT
 
 public:
     explicit CodeEditor(QWidget* parent = nullptr);
 
+    void setGrammar(std::shared_ptr<const xenon::features::Grammar> grammar) { highlighter_->setGrammar(std::move(grammar)); }
+    std::shared_ptr<const xenon::features::Grammar> grammar() const { return highlighter_->grammar(); }
+    SyntaxHighlighter* highlighter() const { return highlighter_; }
+
+    void setMinimapVisible(bool visible);
+    bool isMinimapVisible() const;
+
+    // Wraps long lines at the view's width; off by default
+    void setSoftWrap(bool wrap);
+    bool softWrap() const { return wrap_layout_->isEnabled(); }
+
+    // The language server's diagnostics for the current text. They move
+    // with edits until the server sends the next set; only those on the
+    // lines in view are painted.
+    void setDiagnostics(std::vector<xenon::features::Diagnostic> diagnostics);
+    const xenon::features::DiagnosticSet& diagnostics() const { return diagnostics_; }
+
+    // Key presses in this editor are timed into monitor, which may be
+    // shared between editors; null stops timing
+    void setLatencyMonitor(LatencyMonitor* monitor);
+    void setLatencyOverlayVisible(bool visible);
+
+    // Fold ranges from the language server for the document at revision;
+    // once the server has sent any, they replace the ones guessed from
+    // brackets and indentation
+    void setFoldRanges(int revision, std::vector<xenon::features::FoldRange> ranges);
+    // Back to the guessed folds, for when the server went away, was
+    // restarted or failed to answer
+    void resetServerFolds();
+    // Collapses the innermost expanded range around line
+    void foldAt(int line);
+    // Expands the range starting on line
+    void unfoldAt(int line);
+    void setAllFolded(bool folded);
+    // Replaces the decorations of a kind, repainting the rows in view that
+    // gain or lose one. They follow edits until replaced again.
+    void setDecorations(xenon::features::DecorationKind kind, std::vector<xenon::features::DecorationRange> ranges);
+    // The language server's uses of the symbol under the cursor, for the
+    // document at revision with the cursor at position; once the server has
+    // found any, they replace the editor's own scan for the word
+    void setServerOccurrences(int revision, int position, std::vector<xenon::features::DecorationRange> reads,
+                              std::vector<xenon::features::DecorationRange> writes);
+    // Back to the editor's own scan, for when the server went away, was
+    // restarted or failed to answer
+    void resetServerOccurrences();
+    // Multi-cursor editing. The primary cursor is textCursor(); the others
+    // move and edit with it, each key applied at all of them as one
+    // batched, undoable edit. Alt+click adds a cursor, Alt+Shift+drag
+    // selects a column and Escape goes back to one cursor.
+    bool hasMultipleCursors() const { return cursors_.size() > 1; }
+    void addCursorVertically(int direction);
+    // Selects the word at the cursor, or adds a cursor at the next
+    // occurrence of the selection. Once a word has been picked this way,
+    // both only match it where it is a whole word.
+    void addNextOccurrence();
+    void selectAllOccurrences();
+    void clearExtraCursors();
+
+    // Between buffer lines and the rows the vertical scroll bar counts,
+    // which leave out folded lines and add wrapped ones
+    int rowForLine(int line) const;
+    int lineForRow(int row) const;
+
     void lineNumberAreaPaintEvent(QPaintEvent* event);
+    void lineNumberAreaMousePressEvent(QMouseEvent* event);
     int lineNumberAreaWidth();
 
+signals:
+    // The cursor has rested somewhere; asks for the language server's
+    // occurrences of the symbol there
+    void occurrencesRequested();
+
 protected:
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
+    bool viewportEvent(QEvent* event) override;
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void highlightCurrentLine();
     void updateLineNumberArea(const QRect& rect, int dy);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void revealCursor();
+    void computeFolds();
+    void scheduleOccurrences();
+    void computeOccurrences();
+    void onOccurrencesComputed();
 
 private:
+    struct OccurrenceResult {
+        int revision = 0;
+        int position = 0; // the cursor's when the scan started
+        std::vector<xenon::features::DecorationRange> ranges;
+    };
+
+    void updateVisibleLines();
+    void layoutMinimap();
+    void paintFoldMarkers(QPaintEvent* event);
+    void paintDiagnostics(QPaintEvent* event);
+    void paintDecorations(QPaintEvent* event);
+    void paintExtraCursors(QPaintEvent* event);
+    // Document positions from the first to past the last line in area
+    std::pair<int, int> positionsIn(const QRect& area) const;
+    // In viewport coordinates; null when position's line is hidden or not
+    // laid out. The row is the full width of the view.
+    QRectF caretRect(int position) const;
+    QRect rowRect(int position) const;
+    // One rectangle per laid-out row that start..end covers
+    std::vector<QRectF> rangeRects(int start, int end) const;
+    void updateDecorationRows(const xenon::features::DecorationSet& set);
+    void scanOccurrences();
+    void clearOccurrences();
+    // Keys that act on every cursor; false for the ones left to the base
+    bool multiCursorKeyPress(QKeyEvent* event);
+    // Takes the primary cursor from textCursor(), which the view may have
+    // moved, and back; applying leaves multi-cursor mode when one is left
+    void syncPrimaryCursor();
+    void applyPrimaryCursor();
+    void applyEdits(const std::vector<xenon::features::TextEdit>& edits);
+    void moveCursors(QTextCursor::MoveOperation operation, QTextCursor::MoveMode mode);
+    void selectColumn(const QPoint& position);
+    QString selectedTexts() const;
+    void setFoldCollapsed(int index, bool collapsed);
+    void updateFoldRanges(std::vector<xenon::features::FoldRange> ranges);
+    // Shows and hides blocks to match the model where it changed from before
+    void applyFolds(const std::vector<xenon::features::LineSpan>& before);
+    void applyHidden(const std::vector<xenon::features::LineSpan>& spans);
+    void moveCursorOutOfFolds();
+    // The bracket next to the cursor and the one it pairs with; invalid
+    // when neither side of the cursor has a matched bracket
+    xenon::features::BracketPair bracketMatchAtCursor() const;
+    // The block after block that isn't folded away
+    QTextBlock nextShownBlock(const QTextBlock& block) const;
+
     QWidget* line_number_area_;
     SyntaxHighlighter* highlighter_;
+    WrapLayout* wrap_layout_;
+    Minimap* minimap_;
+    DigitAtlas gutter_digits_;
+    LatencyMonitor* latency_ = nullptr;
+    LatencyOverlay* latency_overlay_ = nullptr;
+
+    xenon::features::DiagnosticSet diagnostics_;
+    xenon::features::BracketPair bracket_match_;
+    xenon::features::DecorationLayer decorations_;
+    // Where the cursor was when the current line was last highlighted
+    int current_line_position_ = 0;
+    // Empty while there is a single cursor
+    xenon::features::CursorSet cursors_;
+    bool applying_edits_ = false;
+    // The word addNextOccurrence() or selectAllOccurrences() took from under
+    // the cursor; while it is what's selected, matches inside longer words
+    // are skipped
+    QString word_needle_;
+    // Alt+Shift+drag: the line and x (in document coordinates) it began at
+    bool column_selecting_ = false;
+    int column_line_ = 0;
+    qreal column_x_ = 0;
+    xenon::features::FoldingModel folding_;
+    int line_count_ = 1;
+    bool server_folds_ = false;
+    QTimer fold_timer_;
+    bool server_occurrences_ = false;
+    // The positions the last word scan covered
+    int occurrence_first_ = 0;
+    int occurrence_last_ = 0;
+    QTimer occurrence_timer_;
+    QFutureWatcher<OccurrenceResult> occurrence_watcher_;
 };
 
 class LineNumberArea : public QWidget {
@@ -41,6 +210,10 @@ protected:
         editor_->lineNumberAreaPaintEvent(event);
     }
 
+    void mousePressEvent(QMouseEvent* event) override {
+        editor_->lineNumberAreaMousePressEvent(event);
+    }
+
 private:
     CodeEditor* editor_;
 };
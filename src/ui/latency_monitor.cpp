@@ -0,0 +1,150 @@
+#include "ui/latency_monitor.hpp"
+#include <QFontDatabase>
+#include <QJsonArray>
+#include <QPainter>
+#include <algorithm>
+
+namespace xenon::ui {
+
+namespace {
+
+constexpr int kRefreshInterval = 500;
+constexpr int kPadding = 6;
+
+} // anonymous namespace
+
+const char* LatencyMonitor::stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Input: return "input";
+    case Stage::Highlight: return "highlight";
+    case Stage::Document: return "document";
+    case Stage::Lsp: return "lsp";
+    case Stage::Paint: return "paint";
+    case Stage::Total: return "total";
+    }
+    return "";
+}
+
+LatencyMonitor::LatencyMonitor(QObject* parent) : QObject(parent) {
+    clock_.start();
+}
+
+void LatencyMonitor::keyPressed() {
+    Sample sample;
+    sample.start = now();
+    sample.marks.fill(-1);
+    pending_.push_back(sample);
+}
+
+void LatencyMonitor::cancelKey() {
+    if (!pending_.empty()) pending_.pop_back();
+}
+
+void LatencyMonitor::mark(Stage stage) {
+    if (pending_.empty() || stage >= Stage::Paint) return;
+    qint64& mark = pending_.back().marks[static_cast<size_t>(stage)];
+    // A key that edits twice (auto-indent, say) gets input on the first
+    if (stage != Stage::Input || mark < 0) mark = now();
+}
+
+void LatencyMonitor::painted() {
+    if (pending_.empty()) return;
+    const qint64 end = now();
+    auto record = [this](Stage stage, qint64 micros) {
+        histograms_[static_cast<size_t>(stage)].record(static_cast<uint64_t>(std::max<qint64>(0, micros)));
+    };
+
+    // Keys typed faster than the editor paints all end at this paint
+    for (const Sample& sample : pending_) {
+        qint64 previous = sample.start;
+        for (size_t stage = 0; stage < sample.marks.size(); ++stage) {
+            if (sample.marks[stage] < 0) continue;
+            record(static_cast<Stage>(stage), sample.marks[stage] - previous);
+            previous = sample.marks[stage];
+        }
+        record(Stage::Paint, end - previous);
+        record(Stage::Total, end - sample.start);
+    }
+    pending_.clear();
+}
+
+void LatencyMonitor::clear() {
+    pending_.clear();
+    for (auto& histogram : histograms_) histogram.clear();
+}
+
+QJsonObject LatencyMonitor::toJson() const {
+    QJsonObject stages;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const xenon::features::LatencyHistogram& h = histograms_[i];
+        QJsonArray buckets;
+        for (const auto& [upper, count] : h.buckets()) {
+            buckets.append(QJsonArray{static_cast<qint64>(upper), static_cast<qint64>(count)});
+        }
+        stages[QString::fromLatin1(stageName(static_cast<Stage>(i)))] = QJsonObject{
+            {"count", static_cast<qint64>(h.count())},
+            {"p50", static_cast<qint64>(h.percentile(0.5))},
+            {"p90", static_cast<qint64>(h.percentile(0.9))},
+            {"p99", static_cast<qint64>(h.percentile(0.99))},
+            {"max", static_cast<qint64>(h.max())},
+            {"buckets", buckets},
+        };
+    }
+    return QJsonObject{{"unit", "us"}, {"stages", stages}};
+}
+
+LatencyOverlay::LatencyOverlay(LatencyMonitor* monitor, QWidget* parent) : QWidget(parent), monitor_(monitor) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPointSizeF(font.pointSizeF() * 0.85);
+    setFont(font);
+
+    refresh_timer_.setInterval(kRefreshInterval);
+    connect(&refresh_timer_, &QTimer::timeout, this, qOverload<>(&QWidget::update));
+}
+
+QSize LatencyOverlay::sizeHint() const {
+    const QFontMetrics metrics(font());
+    // A header and a row per stage
+    return QSize(metrics.horizontalAdvance(QLatin1Char('0')) * 36 + 2 * kPadding,
+                 metrics.height() * static_cast<int>(LatencyMonitor::kStageCount + 1) + 2 * kPadding);
+}
+
+void LatencyOverlay::paintEvent(QPaintEvent* /* event */) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#252526"));
+    painter.setPen(QColor("#3c3c3c"));
+    painter.drawRect(rect().adjusted(0, 0, -1, -1));
+
+    auto ms = [](uint64_t micros) { return QString::number(static_cast<double>(micros) / 1000.0, 'f', 2); };
+    QStringList lines;
+    lines << QStringLiteral("%1 %2 %3 %4").arg("ms", -9).arg("p50", 7).arg("p99", 7).arg("n", 10);
+    for (size_t i = 0; i < LatencyMonitor::kStageCount; ++i) {
+        const auto stage = static_cast<LatencyMonitor::Stage>(i);
+        const xenon::features::LatencyHistogram& h = monitor_->histogram(stage);
+        lines << QStringLiteral("%1 %2 %3 %4")
+                     .arg(LatencyMonitor::stageName(stage), -9)
+                     .arg(ms(h.percentile(0.5)), 7)
+                     .arg(ms(h.percentile(0.99)), 7)
+                     .arg(h.count(), 10);
+    }
+
+    painter.setPen(QColor("#d4d4d4"));
+    const int lineHeight = fontMetrics().height();
+    for (int i = 0; i < lines.size(); ++i) {
+        painter.drawText(kPadding, kPadding + i * lineHeight + fontMetrics().ascent(), lines[i]);
+    }
+}
+
+void LatencyOverlay::showEvent(QShowEvent* event) {
+    QWidget::showEvent(event);
+    refresh_timer_.start();
+}
+
+void LatencyOverlay::hideEvent(QHideEvent* event) {
+    QWidget::hideEvent(event);
+    refresh_timer_.stop();
+}
+
+} // namespace xenon::ui
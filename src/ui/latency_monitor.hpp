@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+#include <QTimer>
+#include <QWidget>
+#include <array>
+#include <vector>
+#include "features/latency_histogram.hpp"
+
+namespace xenon::ui {
+
+// Times key presses through to the paint that shows their effect. Each
+// press starts a sample; the subsystems it passes through mark when they
+// are done, and the next paint of the editor closes every open sample.
+// A stage lasts from the previous mark the sample got to its own, so a
+// stage that didn't run for a key (no LSP server, a cursor move) is left
+// out rather than counted as zero.
+//
+// The paint stage ends when the editor has painted into its backing
+// store; the compositor's part is not visible from here. The stamps are
+// taken on the GUI thread and cost a clock read each.
+class LatencyMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Stage {
+        Input,     // key event to the document being edited
+        Highlight, // synchronous re-lexing of the edited lines
+        Document,  // layout and the other views of the document
+        Lsp,       // sending the change to the language server
+        Paint,     // until the editor has painted
+        Total,     // key event to paint
+    };
+    static constexpr size_t kStageCount = static_cast<size_t>(Stage::Total) + 1;
+    static const char* stageName(Stage stage);
+
+    explicit LatencyMonitor(QObject* parent = nullptr);
+
+    void keyPressed();
+    // The key changed nothing that needs painting
+    void cancelKey();
+    // The stage ends now for the latest key
+    void mark(Stage stage);
+    void painted();
+
+    const xenon::features::LatencyHistogram& histogram(Stage stage) const {
+        return histograms_[static_cast<size_t>(stage)];
+    }
+    void clear();
+    // Counts, percentiles and buckets of every stage, in microseconds
+    QJsonObject toJson() const;
+
+private:
+    struct Sample {
+        qint64 start = 0;
+        // Per stage up to Lsp, -1 until marked
+        std::array<qint64, static_cast<size_t>(Stage::Paint)> marks;
+    };
+
+    qint64 now() const { return clock_.nsecsElapsed() / 1000; }
+
+    QElapsedTimer clock_;
+    std::vector<Sample> pending_;
+    std::array<xenon::features::LatencyHistogram, kStageCount> histograms_;
+};
+
+// p50/p99 of each stage in a small table, refreshed while shown. Opaque,
+// so refreshing it doesn't repaint the editor under it.
+class LatencyOverlay : public QWidget {
+    Q_OBJECT
+
+public:
+    LatencyOverlay(LatencyMonitor* monitor, QWidget* parent);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    LatencyMonitor* monitor_;
+    QTimer refresh_timer_;
+};
+
+} // namespace xenon::ui
@@ -10,14 +10,42 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QUrl>
+#include <QTextBlock>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 #include <QMessageBox>
+#include <QStandardPaths>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
 
 #include "features/search_engine.hpp"
+#include "features/replace_engine.hpp"
+#include "features/workspace_replace.hpp"
+#include "ui/replace_preview_dialog.hpp"
 
 namespace xenon::ui {
 
+namespace {
+
+// Semantic tokens and folding ranges are asked for once typing pauses
+// this long
+constexpr int kLspRefreshDelay = 250;
+// A document highlight request still unanswered after this long is given
+// up on, and the editor goes back to its own occurrence scan
+constexpr int kDocumentHighlightTimeout = 2000;
+// Likewise for folding ranges, after which the editor guesses its own
+constexpr int kFoldingRangesTimeout = 5000;
+// The LSP error for a request overtaken by an edit
+constexpr int kContentModified = -32801;
+
+} // anonymous namespace
+
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent) {
     
@@ -27,6 +55,8 @@ MainWindow::MainWindow(QWidget* parent)
     git_manager_ = std::make_unique<xenon::git::GitManager>(this);
     connect(git_manager_.get(), &xenon::git::GitManager::branchChanged, this, &MainWindow::updateGitBranch);
 
+    latency_monitor_ = std::make_unique<LatencyMonitor>(this);
+
     lsp_client_ = std::make_unique<xenon::lsp::LspClient>(this);
     // Start clangd by default if available
     lsp_client_->start({"clangd"}, QDir::currentPath());
@@ -85,7 +115,12 @@ void MainWindow::setupUI() {
     connect(find_replace_widget_, &FindReplaceWidget::findPrevious, this, &MainWindow::onFindPrevious);
     connect(find_replace_widget_, &FindReplaceWidget::replace, this, &MainWindow::onReplace);
     connect(find_replace_widget_, &FindReplaceWidget::replaceAll, this, &MainWindow::onReplaceAll);
-    connect(find_replace_widget_, &FindReplaceWidget::closeRequested, find_replace_widget_, &FindReplaceWidget::hide);
+    connect(find_replace_widget_, &FindReplaceWidget::closeRequested, this, [this]() {
+        find_replace_widget_->hide();
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) {
+            editor->setDecorations(xenon::features::DecorationKind::SearchMatch, {});
+        }
+    });
 
     editor_layout->addWidget(find_replace_widget_);
     editor_layout->addWidget(editor_tabs_);
@@ -103,13 +138,55 @@ void MainWindow::setupUI() {
     main_layout->addWidget(activity_bar_);
     main_layout->addWidget(main_splitter_);
 
+    loadGrammars();
+
+    // Usage history is read from disk on first use, not here
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    file_frecency_ = std::make_unique<xenon::features::FrecencyStore>(
+        QDir(dataDir).filePath("frecency-files.bin").toStdString());
+    command_frecency_ = std::make_unique<xenon::features::FrecencyStore>(
+        QDir(dataDir).filePath("frecency-commands.bin").toStdString());
+
     command_palette_ = new CommandPalette(this);
+    command_palette_->setFrecencyStore(command_frecency_.get());
+    file_index_service_ = new xenon::services::FileIndexService(this);
+    // In a git work tree the index lists tracked files without a disk walk
+    file_index_service_->setFileListSource([](const std::string& root, std::vector<std::string>& files,
+                                              const std::atomic<bool>& cancelled) {
+        return xenon::git::GitManager::listFiles(QString::fromStdString(root), files, cancelled);
+    });
+    file_index_service_->setRootPath(QDir::currentPath());
+
     quick_open_dialog_ = new QuickOpenDialog(this);
+    quick_open_dialog_->setFrecencyStore(file_frecency_.get());
+    quick_open_dialog_->setFileIndex(file_index_service_);
     connect(quick_open_dialog_, &QuickOpenDialog::fileSelected, this, &MainWindow::onFileOpen);
 
     completion_widget_ = new CompletionWidget(this);
     connect(lsp_client_.get(), &xenon::lsp::LspClient::completionReceived, this, &MainWindow::onCompletionReceived);
     connect(lsp_client_.get(), &xenon::lsp::LspClient::definitionReceived, this, &MainWindow::onDefinitionReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::semanticTokensReceived, this, &MainWindow::onSemanticTokensReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::semanticTokensDeltaReceived, this, &MainWindow::onSemanticTokensDeltaReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::foldingRangesReceived, this, &MainWindow::onFoldingRangesReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::documentHighlightsReceived, this,
+            &MainWindow::onDocumentHighlightsReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::diagnosticsReceived, this, &MainWindow::onDiagnosticsReceived);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::requestFailed, this, &MainWindow::onLspRequestFailed);
+    // Occurrences and folds from a server that went away or restarted
+    // would never be updated again
+    auto resetServerResults = [this]() {
+        highlight_requests_.clear();
+        folding_requests_.clear();
+        for (int i = 0; i < editor_tabs_->count(); ++i) {
+            if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i))) {
+                editor->resetServerOccurrences();
+                editor->resetServerFolds();
+            }
+        }
+    };
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::initialized, this, resetServerResults);
+    connect(lsp_client_.get(), &xenon::lsp::LspClient::stopped, this, resetServerResults);
     connect(completion_widget_, &CompletionWidget::completionSelected, this, &MainWindow::onCompletionSelected);
 
     branch_label_ = new QLabel(this);
@@ -154,9 +231,17 @@ void MainWindow::setupActivityBar() {
         sidebar_stack_->setVisible(true);
     });
 
+    auto* problems_action = activity_bar_->addAction(style()->standardIcon(QStyle::SP_MessageBoxWarning), "Problems");
+    problems_action->setCheckable(true);
+    connect(problems_action, &QAction::triggered, [this]() {
+        sidebar_stack_->setCurrentIndex(2);
+        sidebar_stack_->setVisible(true);
+    });
+
     auto* group = new QActionGroup(this);
     group->addAction(explorer_action);
     group->addAction(search_action);
+    group->addAction(problems_action);
     group->setExclusive(true);
 
     activity_bar_->addSeparator();
@@ -173,15 +258,18 @@ void MainWindow::setupSidebar() {
     file_explorer_->setRootPath(QDir::currentPath());
     connect(file_explorer_, &FileExplorer::fileActivated, this, &MainWindow::onFileOpen);
     
-    auto* search_placeholder = new QWidget();
-    auto* search_layout = new QVBoxLayout(search_placeholder);
-    auto* search_label = new QLabel("Search (Coming Soon)", search_placeholder);
-    search_label->setStyleSheet("color: #858585;");
-    search_layout->addWidget(search_label);
-    search_layout->addStretch();
+    search_panel_ = new SearchPanel(this);
+    search_panel_->setRootPath(QDir::currentPath());
+    connect(search_panel_, &SearchPanel::matchActivated, this, &MainWindow::onSearchMatchActivated);
+    connect(search_panel_, &SearchPanel::replaceAllRequested, this, &MainWindow::onReplaceInFiles);
+
+    problems_panel_ = new ProblemsPanel(this);
+    problems_panel_->setRootPath(QDir::currentPath());
+    connect(problems_panel_, &ProblemsPanel::problemActivated, this, &MainWindow::onSearchMatchActivated);
 
     sidebar_stack_->addWidget(file_explorer_);
-    sidebar_stack_->addWidget(search_placeholder);
+    sidebar_stack_->addWidget(search_panel_);
+    sidebar_stack_->addWidget(problems_panel_);
 }
 
 void MainWindow::onEditFind() {
@@ -196,6 +284,7 @@ void MainWindow::onFindNext() {
     auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget());
     if (!editor) return;
 
+    highlightSearchMatches(editor);
     QString pattern = find_replace_widget_->findText();
     if (pattern.isEmpty()) return;
 
@@ -234,6 +323,7 @@ void MainWindow::onFindPrevious() {
     auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget());
     if (!editor) return;
 
+    highlightSearchMatches(editor);
     QString pattern = find_replace_widget_->findText();
     if (pattern.isEmpty()) return;
 
@@ -272,26 +362,182 @@ void MainWindow::onReplaceAll() {
     QString pattern = find_replace_widget_->findText();
     if (pattern.isEmpty()) return;
 
-    auto results = xenon::features::SearchEngine::findAll(
-        editor->toPlainText().toStdString(),
+    const xenon::features::Replacer replacer(
         pattern.toStdString(),
+        find_replace_widget_->replaceText().toStdString(),
         find_replace_widget_->isCaseSensitive(),
         find_replace_widget_->isRegex()
     );
 
-    if (results.empty()) return;
+    size_t skippedLines = 0;
+    const size_t count = replaceInEditor(editor, replacer, &skippedLines);
+    if (skippedLines > 0) {
+        statusBar()->showMessage(QString("Replaced %1 occurrences; %2 lines too long or complex for the regex "
+                                         "were left unchanged").arg(count).arg(skippedLines), 3000);
+        return;
+    }
+    if (count == 0) return;
 
-    QTextCursor cursor = editor->textCursor();
-    cursor.beginEditBlock();
-    
-    // Replace from end to start to maintain offsets
-    for (auto it = results.rbegin(); it != results.rend(); ++it) {
-        cursor.setPosition(static_cast<int>(it->offset));
-        cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, static_cast<int>(it->length));
-        cursor.insertText(find_replace_widget_->replaceText());
+    statusBar()->showMessage(QString("Replaced %1 occurrences").arg(count), 3000);
+}
+
+void MainWindow::highlightSearchMatches(CodeEditor* editor) {
+    const QString pattern = find_replace_widget_->findText();
+    if (pattern.isEmpty()) {
+        editor->setDecorations(xenon::features::DecorationKind::SearchMatch, {});
+        return;
     }
-    
+
+    const std::string text = editor->toPlainText().toStdString();
+    size_t skippedLines = 0;
+    const auto matches = xenon::features::SearchEngine::findAll(
+        text, pattern.toStdString(), find_replace_widget_->isCaseSensitive(), find_replace_widget_->isRegex(),
+        &skippedLines);
+    if (skippedLines > 0) {
+        statusBar()->showMessage(
+            QString("%1 lines too long or complex for the regex were not searched").arg(skippedLines), 3000);
+    }
+
+    // The engine works on UTF-8 byte offsets, the document on UTF-16
+    // positions; the matches are in order, so one walk converts them all.
+    // Literal matches can overlap, and overlapping ones become one range.
+    size_t byte = 0;
+    int position = 0;
+    auto advance = [&](size_t to) {
+        for (; byte < to; ++byte) {
+            const auto c = static_cast<unsigned char>(text[byte]);
+            if ((c & 0xC0) != 0x80) position += c >= 0xF0 ? 2 : 1;
+        }
+        return position;
+    };
+    std::vector<xenon::features::DecorationRange> ranges;
+    ranges.reserve(matches.size());
+    for (const auto& match : matches) {
+        if (match.offset < byte && !ranges.empty()) {
+            ranges.back().end = advance(match.offset + match.length);
+            continue;
+        }
+        const int start = advance(match.offset);
+        ranges.push_back({start, advance(match.offset + match.length)});
+    }
+    editor->setDecorations(xenon::features::DecorationKind::SearchMatch, std::move(ranges));
+}
+
+size_t MainWindow::replaceInEditor(CodeEditor* editor, const xenon::features::Replacer& replacer,
+                                   size_t* skippedLines) {
+    const std::string text = editor->toPlainText().toStdString();
+    auto result = replacer.replaceAll(text);
+    if (skippedLines) *skippedLines = result.skippedLines;
+    if (result.count == 0) return 0;
+
+    // The engine works on UTF-8 byte offsets, the document on UTF-16 positions.
+    const auto start = QString::fromUtf8(text.data(), static_cast<qsizetype>(result.spanStart)).size();
+    const auto length = QString::fromUtf8(text.data() + result.spanStart,
+                                          static_cast<qsizetype>(result.spanEnd - result.spanStart)).size();
+
+    // Commit the whole span as one edit: one relayout, one undo step
+    QTextCursor cursor(editor->document());
+    cursor.beginEditBlock();
+    cursor.setPosition(static_cast<int>(start));
+    cursor.setPosition(static_cast<int>(start + length), QTextCursor::KeepAnchor);
+    cursor.insertText(QString::fromStdString(result.text));
     cursor.endEditBlock();
+
+    return result.count;
+}
+
+void MainWindow::onReplaceInFiles(const QString& pattern, const QString& replacement,
+                                  bool caseSensitive, bool useRegex) {
+    const QDir root(search_panel_->rootPath());
+
+    xenon::features::WorkspaceReplaceOptions options;
+    options.pattern = pattern.toStdString();
+    options.replacement = replacement.toStdString();
+    options.caseSensitive = caseSensitive;
+    options.useRegex = useRegex;
+    options.index = search_panel_->index();
+
+    const xenon::features::Replacer replacer(options.pattern, options.replacement, caseSensitive, useRegex);
+    if (!replacer.isValid()) {
+        statusBar()->showMessage("Invalid search pattern", 3000);
+        return;
+    }
+
+    // Open files are replaced in their buffers, not on disk, so unsaved
+    // edits are kept and the change stays undoable
+    std::unordered_map<std::string, CodeEditor*> openEditors;
+    std::vector<xenon::features::FileReplacement> bufferPlans;
+    for (int i = 0; i < editor_tabs_->count(); ++i) {
+        auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i));
+        const QString path = editor_tabs_->tabToolTip(i);
+        if (!editor || !QDir::isAbsolutePath(path)) continue; // Untitled buffers
+
+        const QString relative = root.relativeFilePath(path);
+        if (relative.startsWith("..") || QDir::isAbsolutePath(relative)) continue;
+
+        const std::string relativePath = relative.toStdString();
+        openEditors[relativePath] = editor;
+        options.excluded.insert(relativePath);
+
+        auto plan = xenon::features::WorkspaceReplace::planBuffer(
+            editor->toPlainText().toStdString(), replacer, options.maxPreviewLines);
+        if (plan.count == 0 && plan.skippedLines == 0) continue;
+        plan.relativePath = relativePath;
+        bufferPlans.push_back(std::move(plan));
+    }
+
+    ReplacePreviewDialog dialog(root.absolutePath(), options, std::move(bufferPlans), this);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    size_t bufferCount = 0;
+    std::vector<xenon::features::FileReplacement> diskFiles;
+    for (auto& file : dialog.selectedFiles()) {
+        auto it = openEditors.find(file.relativePath);
+        if (it != openEditors.end()) {
+            bufferCount += replaceInEditor(it->second, replacer);
+        } else {
+            diskFiles.push_back(std::move(file));
+        }
+    }
+
+    if (diskFiles.empty()) {
+        statusBar()->showMessage(QString("Replaced %1 occurrences").arg(bufferCount), 3000);
+        return;
+    }
+
+    statusBar()->showMessage(QString("Replacing in %1 files...").arg(diskFiles.size()));
+    const QString rootPath = root.absolutePath();
+    auto* watcher = new QFutureWatcher<std::vector<xenon::features::ReplaceFailure>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, rootPath, diskFiles, bufferCount]() {
+        const auto failures = watcher->result();
+        watcher->deleteLater();
+
+        size_t count = bufferCount;
+        std::unordered_set<std::string> failed;
+        for (const auto& failure : failures) {
+            failed.insert(failure.relativePath);
+        }
+        for (const auto& file : diskFiles) {
+            if (failed.count(file.relativePath)) continue;
+            count += file.count;
+            search_panel_->notifyFileChanged(QDir(rootPath).absoluteFilePath(QString::fromStdString(file.relativePath)));
+        }
+
+        statusBar()->showMessage(QString("Replaced %1 occurrences").arg(count), 3000);
+        if (!failures.empty()) {
+            QStringList lines;
+            for (size_t i = 0; i < failures.size() && i < 20; ++i) {
+                lines << QString::fromStdString(failures[i].relativePath + ": " + failures[i].reason);
+            }
+            QMessageBox::warning(this, "Replace in Files",
+                QString("%1 files were not changed:\n%2").arg(failures.size()).arg(lines.join("\n")));
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([rootPath, options, diskFiles]() {
+        // A replace is never abandoned half way, so nothing cancels it
+        const std::atomic<bool> cancelled{false};
+        return xenon::features::WorkspaceReplace::apply(rootPath.toStdString(), options, diskFiles, cancelled);
+    }));
 }
 
 void MainWindow::onFileNew() {
@@ -309,6 +555,9 @@ void MainWindow::onFileOpenFolderDialog() {
     QString dirName = QFileDialog::getExistingDirectory(this, "Open Project", QDir::currentPath());
     if (!dirName.isEmpty()) {
         file_explorer_->setRootPath(dirName);
+        search_panel_->setRootPath(dirName);
+        problems_panel_->setRootPath(dirName);
+        file_index_service_->setRootPath(dirName);
         git_manager_->setWorkingDirectory(dirName);
         
         // Restart LSP for new root
@@ -336,7 +585,10 @@ void MainWindow::onFileSave() {
     if (file.open(QFile::WriteOnly | QFile::Text)) {
         QTextStream out(&file);
         out << editor->toPlainText();
+        out.flush();
+        file.close();
         editor->document()->setModified(false);
+        search_panel_->notifyFileChanged(path);
         if (lsp_client_->isInitialized()) {
             lsp_client_->didSave(QUrl::fromLocalFile(path).toString());
         }
@@ -354,7 +606,10 @@ void MainWindow::onFileSaveAs() {
         if (file.open(QFile::WriteOnly | QFile::Text)) {
             QTextStream out(&file);
             out << editor->toPlainText();
-            
+            out.flush();
+            file.close();
+            search_panel_->notifyFileChanged(fileName);
+
             QFileInfo fi(fileName);
             int index = editor_tabs_->currentIndex();
             editor_tabs_->setTabText(index, fi.fileName());
@@ -383,10 +638,13 @@ void MainWindow::onEditRedo() {
 }
 
 void MainWindow::onFileOpen(const QString& path) {
+    const std::string frecencyKey = QFileInfo(path).absoluteFilePath().toStdString();
+
     // Check if already open
     for (int i = 0; i < editor_tabs_->count(); ++i) {
         if (editor_tabs_->tabToolTip(i) == path) {
             editor_tabs_->setCurrentIndex(i);
+            file_frecency_->record(frecencyKey);
             return;
         }
     }
@@ -394,11 +652,40 @@ void MainWindow::onFileOpen(const QString& path) {
     QFile file(path);
     if (file.open(QFile::ReadOnly | QFile::Text)) {
         createNewEditor(path, QString::fromUtf8(file.readAll()));
+        file_frecency_->record(frecencyKey);
+    }
+}
+
+void MainWindow::loadGrammars() {
+    // Built-in grammars first, then the user's, which replace built-ins
+    // with the same id
+    const QString userDir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("grammars");
+    for (const QString& dirPath : {QStringLiteral(":/grammars"), userDir}) {
+        const QDir dir(dirPath);
+        for (const QString& name : dir.entryList({"*.grammar"}, QDir::Files, QDir::Name)) {
+            QFile file(dir.filePath(name));
+            if (!file.open(QFile::ReadOnly)) continue;
+
+            const QByteArray text = file.readAll();
+            std::string error;
+            auto grammar = xenon::features::Grammar::parse(std::string_view(text.constData(), static_cast<size_t>(text.size())), &error);
+            if (grammar) {
+                grammars_.add(std::move(grammar));
+            } else {
+                qWarning() << "Invalid grammar" << file.fileName() << QString::fromStdString(error);
+            }
+        }
     }
 }
 
 void MainWindow::createNewEditor(const QString& path, const QString& content) {
     auto* editor = new CodeEditor(this);
+    editor->setMinimapVisible(minimap_visible_);
+    editor->setSoftWrap(soft_wrap_);
+    editor->setLatencyMonitor(latency_monitor_.get());
+    editor->setLatencyOverlayVisible(latency_overlay_visible_);
+    const auto grammar = grammars_.forFile(path.toStdString());
+    editor->setGrammar(grammar);
     editor->setPlainText(content);
     editor->document()->setModified(false);
     
@@ -409,15 +696,28 @@ void MainWindow::createNewEditor(const QString& path, const QString& content) {
 
     // LSP: notify file open
     if (lsp_client_->isInitialized()) {
-        lsp_client_->didOpen(QUrl::fromLocalFile(path).toString(), "cpp", content);
+        const QString languageId = grammar ? QString::fromStdString(grammar->id()) : QStringLiteral("plaintext");
+        lsp_client_->didOpen(QUrl::fromLocalFile(path).toString(), languageId, content);
     }
 
     static std::unordered_map<CodeEditor*, int> versions;
     versions[editor] = 1;
 
-    connect(editor->document(), &QTextDocument::contentsChanged, [this, editor, path]() {
+    auto* refresh_timer = new QTimer(editor);
+    refresh_timer->setSingleShot(true);
+    refresh_timer->setInterval(kLspRefreshDelay);
+    connect(refresh_timer, &QTimer::timeout, this, [this, editor]() {
+        requestSemanticTokens(editor);
+        requestFoldingRanges(editor);
+    });
+    refresh_timer->start();
+    connect(editor, &CodeEditor::occurrencesRequested, this, [this, editor]() { requestDocumentHighlights(editor); });
+
+    connect(editor->document(), &QTextDocument::contentsChanged, [this, editor, path, refresh_timer]() {
         if (lsp_client_->isInitialized()) {
             lsp_client_->didChange(QUrl::fromLocalFile(path).toString(), editor->toPlainText(), ++versions[editor]);
+            refresh_timer->start();
+            latency_monitor_->mark(LatencyMonitor::Stage::Lsp);
         }
     });
 
@@ -468,6 +768,8 @@ void MainWindow::closeEvent(QCloseEvent* event) {
             return;
         }
     }
+    file_frecency_->save();
+    command_frecency_->save();
     event->accept();
 }
 
@@ -476,7 +778,35 @@ void MainWindow::onCommandPalette() {
 }
 
 void MainWindow::onQuickOpen() {
-    quick_open_dialog_->showDialog(QDir::currentPath());
+    quick_open_dialog_->showDialog();
+}
+
+void MainWindow::onFindInFiles() {
+    sidebar_stack_->setCurrentWidget(search_panel_);
+    sidebar_stack_->setVisible(true);
+    search_panel_->focusSearch();
+}
+
+void MainWindow::onSearchMatchActivated(const QString& path, int line, int column) {
+    onFileOpen(path);
+
+    auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget());
+    if (editor && editor_tabs_->tabToolTip(editor_tabs_->currentIndex()) == path) {
+        goToPosition(editor, line, column);
+        editor->setFocus();
+    }
+}
+
+void MainWindow::goToPosition(CodeEditor* editor, int line, int column) {
+    QTextBlock block = editor->document()->findBlockByNumber(line);
+    if (!block.isValid()) {
+        block = editor->document()->lastBlock();
+    }
+
+    QTextCursor cursor(block);
+    cursor.setPosition(block.position() + qBound(0, column, block.length() - 1));
+    editor->setTextCursor(cursor);
+    editor->centerCursor();
 }
 
 void MainWindow::onCompletionRequested() {
@@ -545,6 +875,211 @@ void MainWindow::onDefinitionReceived(int id, const QString& uri, int line, int
     }
 }
 
+void MainWindow::requestSemanticTokens(CodeEditor* editor, bool forceFull) {
+    const auto& provider = lsp_client_->semanticTokensProvider();
+    if (!lsp_client_->isInitialized() || !(provider.full || provider.range)) return;
+    const int index = editor_tabs_->indexOf(editor);
+    if (index == -1) return;
+
+    SyntaxHighlighter* highlighter = editor->highlighter();
+    highlighter->setSemanticLegend(provider.tokenTypes, provider.tokenModifiers);
+    const QString uri = QUrl::fromLocalFile(editor_tabs_->tabToolTip(index)).toString();
+
+    SemanticTokensRequest request;
+    request.editor = editor;
+    request.revision = highlighter->revision();
+
+    // Until the first full result, the visible lines come separately so
+    // they color without waiting for the whole file
+    const QString resultId = QString::fromStdString(highlighter->semanticResultId());
+    if (provider.range && (resultId.isEmpty() || !provider.full) && highlighter->lastVisibleLine() >= 0) {
+        SemanticTokensRequest range = request;
+        range.firstLine = highlighter->firstVisibleLine();
+        range.lastLine = highlighter->lastVisibleLine();
+        semantic_requests_[lsp_client_->semanticTokensRange(uri, range.firstLine, range.lastLine)] = range;
+    }
+    if (provider.full) {
+        request.delta = provider.delta && !resultId.isEmpty() && !forceFull;
+        if (request.delta) request.previousResultId = highlighter->semanticResultId();
+        const int id = request.delta ? lsp_client_->semanticTokensDelta(uri, resultId)
+                                     : lsp_client_->semanticTokensFull(uri);
+        semantic_requests_[id] = request;
+    }
+}
+
+void MainWindow::onSemanticTokensReceived(int id, const QString& resultId, const std::vector<uint32_t>& data) {
+    auto it = semantic_requests_.find(id);
+    if (it == semantic_requests_.end()) return;
+    const SemanticTokensRequest request = it->second;
+    semantic_requests_.erase(it);
+    if (!request.editor) return;
+
+    SyntaxHighlighter* highlighter = request.editor->highlighter();
+    if (request.firstLine >= 0) {
+        highlighter->setSemanticRange(request.revision, request.firstLine, request.lastLine, data);
+    } else {
+        highlighter->setSemanticTokens(request.revision, resultId.toStdString(), data);
+    }
+}
+
+void MainWindow::onSemanticTokensDeltaReceived(int id, const QString& resultId,
+                                               const std::vector<xenon::lsp::SemanticTokensEdit>& edits) {
+    auto it = semantic_requests_.find(id);
+    if (it == semantic_requests_.end()) return;
+    const SemanticTokensRequest request = it->second;
+    semantic_requests_.erase(it);
+    if (!request.editor) return;
+
+    // Another result landed while this delta was in flight, so its edits
+    // are relative to tokens we no longer have
+    SyntaxHighlighter* highlighter = request.editor->highlighter();
+    if (highlighter->semanticResultId() != request.previousResultId) {
+        requestSemanticTokens(request.editor, true);
+        return;
+    }
+
+    std::vector<xenon::features::SemanticTokensEdit> converted;
+    converted.reserve(edits.size());
+    for (const auto& edit : edits) {
+        converted.push_back({edit.start, edit.deleteCount, edit.data});
+    }
+
+    if (!highlighter->applySemanticEdits(request.revision, resultId.toStdString(), std::move(converted))) {
+        // Not against the result we have. A full result is still compared
+        // with the cached tokens, so only lines that differ are redrawn.
+        requestSemanticTokens(request.editor, true);
+    }
+}
+
+void MainWindow::requestFoldingRanges(CodeEditor* editor) {
+    if (!lsp_client_->isInitialized() || !lsp_client_->hasFoldingRangeProvider()) return;
+    const int index = editor_tabs_->indexOf(editor);
+    if (index == -1) return;
+
+    const QString uri = QUrl::fromLocalFile(editor_tabs_->tabToolTip(index)).toString();
+    const int id = lsp_client_->foldingRanges(uri);
+    folding_requests_[id] = {editor, editor->document()->revision()};
+    QTimer::singleShot(kFoldingRangesTimeout, this, [this, id]() {
+        auto it = folding_requests_.find(id);
+        if (it == folding_requests_.end()) return;
+        const QPointer<CodeEditor> editor = it->second.editor;
+        folding_requests_.erase(it);
+        if (editor) editor->resetServerFolds();
+    });
+}
+
+void MainWindow::onFoldingRangesReceived(int id, const std::vector<xenon::lsp::FoldingRange>& ranges) {
+    auto it = folding_requests_.find(id);
+    if (it == folding_requests_.end()) return;
+    const FoldingRangesRequest request = it->second;
+    folding_requests_.erase(it);
+    if (!request.editor) return;
+
+    std::vector<xenon::features::FoldRange> converted;
+    converted.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        converted.push_back({range.startLine, range.endLine});
+    }
+    request.editor->setFoldRanges(request.revision, std::move(converted));
+}
+
+void MainWindow::requestDocumentHighlights(CodeEditor* editor) {
+    if (!lsp_client_->isInitialized() || !lsp_client_->hasDocumentHighlightProvider()) return;
+    const int index = editor_tabs_->indexOf(editor);
+    if (index == -1) return;
+
+    const QString uri = QUrl::fromLocalFile(editor_tabs_->tabToolTip(index)).toString();
+    const QTextCursor cursor = editor->textCursor();
+    const int id = lsp_client_->documentHighlight(uri, cursor.blockNumber(), cursor.positionInBlock());
+    highlight_requests_[id] = {editor, editor->document()->revision(), cursor.position()};
+    QTimer::singleShot(kDocumentHighlightTimeout, this, [this, id]() {
+        auto it = highlight_requests_.find(id);
+        if (it == highlight_requests_.end()) return;
+        const QPointer<CodeEditor> editor = it->second.editor;
+        highlight_requests_.erase(it);
+        if (editor) editor->resetServerOccurrences();
+    });
+}
+
+void MainWindow::onDocumentHighlightsReceived(int id, const std::vector<xenon::lsp::DocumentHighlight>& highlights) {
+    auto it = highlight_requests_.find(id);
+    if (it == highlight_requests_.end()) return;
+    const DocumentHighlightsRequest request = it->second;
+    highlight_requests_.erase(it);
+    if (!request.editor) return;
+
+    // Writes are told apart from reads and plain text uses
+    constexpr int kWrite = 3;
+    const QTextDocument* document = request.editor->document();
+    std::vector<xenon::features::DecorationRange> reads;
+    std::vector<xenon::features::DecorationRange> writes;
+    for (const auto& h : highlights) {
+        const QTextBlock start = document->findBlockByNumber(h.line);
+        const QTextBlock end = document->findBlockByNumber(h.endLine);
+        if (!start.isValid() || !end.isValid()) continue;
+        const xenon::features::DecorationRange range{start.position() + h.col, end.position() + h.endCol};
+        (h.kind == kWrite ? writes : reads).push_back(range);
+    }
+    request.editor->setServerOccurrences(request.revision, request.position, std::move(reads), std::move(writes));
+}
+
+void MainWindow::onDiagnosticsReceived(const QString& uri, const QList<xenon::lsp::Diagnostic>& diagnostics) {
+    std::vector<xenon::features::Diagnostic> converted;
+    converted.reserve(static_cast<size_t>(diagnostics.size()));
+    for (const auto& diagnostic : diagnostics) {
+        xenon::features::Diagnostic d;
+        d.line = diagnostic.line;
+        d.col = diagnostic.col;
+        d.endLine = diagnostic.endLine;
+        d.endCol = diagnostic.endCol;
+        d.severity = static_cast<xenon::features::DiagnosticSeverity>(std::clamp(diagnostic.severity, 1, 4));
+        d.message = diagnostic.message.toStdString();
+        d.source = diagnostic.source.toStdString();
+        converted.push_back(std::move(d));
+    }
+
+    const QString path = QUrl(uri).toLocalFile();
+    for (int i = 0; i < editor_tabs_->count(); ++i) {
+        if (editor_tabs_->tabToolTip(i) != path) continue;
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i))) {
+            editor->setDiagnostics(converted);
+        }
+        break;
+    }
+    problems_panel_->setDiagnostics(path, std::move(converted));
+}
+
+void MainWindow::onLspRequestFailed(int id, int code) {
+    // The editor goes back to its own folds and occurrences unless the
+    // request was only overtaken by an edit
+    auto folding = folding_requests_.find(id);
+    if (folding != folding_requests_.end()) {
+        const QPointer<CodeEditor> editor = folding->second.editor;
+        folding_requests_.erase(folding);
+        if (editor && code != kContentModified) editor->resetServerFolds();
+        return;
+    }
+
+    auto highlight = highlight_requests_.find(id);
+    if (highlight != highlight_requests_.end()) {
+        const QPointer<CodeEditor> editor = highlight->second.editor;
+        highlight_requests_.erase(highlight);
+        if (editor && code != kContentModified) editor->resetServerOccurrences();
+        return;
+    }
+
+    auto it = semantic_requests_.find(id);
+    if (it == semantic_requests_.end()) return;
+    const SemanticTokensRequest request = it->second;
+    semantic_requests_.erase(it);
+
+    // A server that lost the previous result rejects the delta. Requests
+    // overtaken by an edit are not retried; the edit sends a new one.
+    if (request.delta && request.editor && code != kContentModified) {
+        requestSemanticTokens(request.editor, true);
+    }
+}
+
 void MainWindow::setupMenus() {
     auto* file_menu = menuBar()->addMenu("&File");
     file_menu->addAction("&New File", QKeySequence::New, this, &MainWindow::onFileNew);
@@ -563,6 +1098,7 @@ void MainWindow::setupMenus() {
     edit_menu->addSeparator();
     edit_menu->addAction("&Find", QKeySequence::Find, this, &MainWindow::onEditFind);
     edit_menu->addAction("&Replace", QKeySequence::Replace, this, &MainWindow::onEditReplace);
+    edit_menu->addAction("Find in Files", QKeySequence("Ctrl+Shift+F"), this, &MainWindow::onFindInFiles);
     edit_menu->addSeparator();
     edit_menu->addAction("Go to Definition", QKeySequence(Qt::Key_F12), [this]() {
         auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget());
@@ -572,6 +1108,19 @@ void MainWindow::setupMenus() {
             lsp_client_->definition(QUrl::fromLocalFile(path).toString(), cursor.blockNumber(), cursor.columnNumber());
         }
     });
+    edit_menu->addSeparator();
+    edit_menu->addAction("Add Cursor Above", QKeySequence("Ctrl+Alt+Up"), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->addCursorVertically(-1);
+    });
+    edit_menu->addAction("Add Cursor Below", QKeySequence("Ctrl+Alt+Down"), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->addCursorVertically(1);
+    });
+    edit_menu->addAction("Add Next Occurrence", QKeySequence("Ctrl+D"), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->addNextOccurrence();
+    });
+    edit_menu->addAction("Select All Occurrences", QKeySequence("Ctrl+Shift+L"), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->selectAllOccurrences();
+    });
 #ifdef Q_OS_MAC
     edit_menu->addAction("Show Completions", QKeySequence(Qt::MetaModifier | Qt::Key_Space), this, &MainWindow::onCompletionRequested);
 #else
@@ -587,6 +1136,62 @@ void MainWindow::setupMenus() {
     view_menu->addAction("Toggle Terminal", QKeySequence("Ctrl+`"), [this]() {
         terminal_widget_->setVisible(!terminal_widget_->isVisible());
     });
+    view_menu->addSeparator();
+    view_menu->addAction("Fold", QKeySequence("Ctrl+Shift+["), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) {
+            editor->foldAt(editor->textCursor().blockNumber());
+        }
+    });
+    view_menu->addAction("Unfold", QKeySequence("Ctrl+Shift+]"), [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) {
+            editor->unfoldAt(editor->textCursor().blockNumber());
+        }
+    });
+    view_menu->addAction("Fold All", [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->setAllFolded(true);
+    });
+    view_menu->addAction("Unfold All", [this]() {
+        if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->currentWidget())) editor->setAllFolded(false);
+    });
+    view_menu->addSeparator();
+    view_menu->addAction("Toggle Word Wrap", QKeySequence("Alt+Z"), [this]() {
+        soft_wrap_ = !soft_wrap_;
+        for (int i = 0; i < editor_tabs_->count(); ++i) {
+            if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i))) {
+                editor->setSoftWrap(soft_wrap_);
+            }
+        }
+    });
+    view_menu->addAction("Toggle Minimap", [this]() {
+        minimap_visible_ = !minimap_visible_;
+        for (int i = 0; i < editor_tabs_->count(); ++i) {
+            if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i))) {
+                editor->setMinimapVisible(minimap_visible_);
+            }
+        }
+    });
+    view_menu->addSeparator();
+    view_menu->addAction("Toggle Latency Overlay", QKeySequence("Ctrl+Alt+L"), [this]() {
+        latency_overlay_visible_ = !latency_overlay_visible_;
+        for (int i = 0; i < editor_tabs_->count(); ++i) {
+            if (auto* editor = qobject_cast<CodeEditor*>(editor_tabs_->widget(i))) {
+                editor->setLatencyOverlayVisible(latency_overlay_visible_);
+            }
+        }
+    });
+    view_menu->addAction("Export Typing Latency...", [this]() {
+        const QString fileName = QFileDialog::getSaveFileName(this, "Export Typing Latency",
+                                                              QDir::current().filePath("latency.json"), "JSON (*.json)");
+        if (fileName.isEmpty()) return;
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QMessageBox::warning(this, "Export Typing Latency", "Could not write " + fileName);
+            return;
+        }
+        file.write(QJsonDocument(latency_monitor_->toJson()).toJson());
+        statusBar()->showMessage("Typing latency written to " + fileName, 3000);
+    });
+    view_menu->addAction("Reset Typing Latency", [this]() { latency_monitor_->clear(); });
 }
 
 } // namespace xenon::ui
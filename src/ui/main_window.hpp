@@ -8,7 +8,10 @@
 #include <QToolBar>
 #include <QLabel>
 #include <QCloseEvent>
+#include <QPointer>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "ui/file_explorer.hpp"
 #include "ui/editor_widget.hpp"
@@ -17,7 +20,14 @@
 #include "ui/find_replace_widget.hpp"
 #include "ui/quick_open_dialog.hpp"
 #include "ui/completion_widget.hpp"
+#include "ui/search_panel.hpp"
+#include "ui/problems_panel.hpp"
+#include "ui/latency_monitor.hpp"
+#include "features/frecency_store.hpp"
+#include "features/grammar.hpp"
+#include "features/replace_engine.hpp"
 #include "git/git_manager.hpp"
+#include "services/file_index_service.hpp"
 #include "lsp/lsp_client.hpp"
 
 namespace xenon::ui {
@@ -47,6 +57,9 @@ private slots:
     void onReplace();
     void onReplaceAll();
     void onQuickOpen();
+    void onFindInFiles();
+    void onSearchMatchActivated(const QString& path, int line, int column);
+    void onReplaceInFiles(const QString& pattern, const QString& replacement, bool caseSensitive, bool useRegex);
     void onFileOpen(const QString& path);
     void onEditorTabClosed(int index);
     void updateGitBranch(const QString& branch);
@@ -57,6 +70,12 @@ private slots:
     void onCompletionReceived(int id, const QList<xenon::lsp::CompletionItem>& items);
     void onCompletionSelected(const QString& text);
     void onDefinitionReceived(int id, const QString& uri, int line, int col);
+    void onSemanticTokensReceived(int id, const QString& resultId, const std::vector<uint32_t>& data);
+    void onSemanticTokensDeltaReceived(int id, const QString& resultId, const std::vector<xenon::lsp::SemanticTokensEdit>& edits);
+    void onFoldingRangesReceived(int id, const std::vector<xenon::lsp::FoldingRange>& ranges);
+    void onDocumentHighlightsReceived(int id, const std::vector<xenon::lsp::DocumentHighlight>& highlights);
+    void onDiagnosticsReceived(const QString& uri, const QList<xenon::lsp::Diagnostic>& diagnostics);
+    void onLspRequestFailed(int id, int code);
 
 private:
     void setupUI();
@@ -64,6 +83,18 @@ private:
     void setupActivityBar();
     void setupSidebar();
     void createNewEditor(const QString& path, const QString& content);
+    void loadGrammars();
+    void goToPosition(CodeEditor* editor, int line, int column);
+    // Asks for the tokens of the visible lines until a full result is in,
+    // then for deltas against the last result unless forceFull
+    void requestSemanticTokens(CodeEditor* editor, bool forceFull = false);
+    void requestFoldingRanges(CodeEditor* editor);
+    void requestDocumentHighlights(CodeEditor* editor);
+    // Marks every match of the find pattern in the buffer
+    void highlightSearchMatches(CodeEditor* editor);
+    // Replaces every match in the buffer as one edit (one undo step)
+    size_t replaceInEditor(CodeEditor* editor, const xenon::features::Replacer& replacer,
+                           size_t* skippedLines = nullptr);
 
     QToolBar* activity_bar_;
     QStackedWidget* sidebar_stack_;
@@ -71,15 +102,48 @@ private:
     QSplitter* content_splitter_;
     QTabWidget* editor_tabs_;
     FileExplorer* file_explorer_;
+    SearchPanel* search_panel_;
+    ProblemsPanel* problems_panel_;
     TerminalWidget* terminal_widget_;
     CommandPalette* command_palette_;
     FindReplaceWidget* find_replace_widget_;
     QuickOpenDialog* quick_open_dialog_;
+    xenon::services::FileIndexService* file_index_service_;
     CompletionWidget* completion_widget_;
     
     QLabel* branch_label_;
     std::unique_ptr<xenon::git::GitManager> git_manager_;
     std::unique_ptr<xenon::lsp::LspClient> lsp_client_;
+    std::unique_ptr<LatencyMonitor> latency_monitor_;
+    std::unique_ptr<xenon::features::FrecencyStore> file_frecency_;
+    std::unique_ptr<xenon::features::FrecencyStore> command_frecency_;
+    xenon::features::GrammarRegistry grammars_;
+    bool minimap_visible_ = true;
+    bool soft_wrap_ = false;
+    bool latency_overlay_visible_ = false;
+
+    struct SemanticTokensRequest {
+        QPointer<CodeEditor> editor;
+        uint64_t revision = 0; // the highlighter's when the request was sent
+        bool delta = false;
+        std::string previousResultId; // the result a delta's edits apply to
+        int firstLine = -1; // set for range requests
+        int lastLine = -1;
+    };
+    std::unordered_map<int, SemanticTokensRequest> semantic_requests_;
+
+    struct FoldingRangesRequest {
+        QPointer<CodeEditor> editor;
+        int revision = 0; // the document's when the request was sent
+    };
+    std::unordered_map<int, FoldingRangesRequest> folding_requests_;
+
+    struct DocumentHighlightsRequest {
+        QPointer<CodeEditor> editor;
+        int revision = 0; // the document's when the request was sent
+        int position = 0; // the cursor's
+    };
+    std::unordered_map<int, DocumentHighlightsRequest> highlight_requests_;
 };
 
 } // namespace xenon::ui
@@ -0,0 +1,303 @@
+#include "ui/minimap.hpp"
+#include "ui/editor_widget.hpp"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+namespace xenon::ui {
+
+namespace {
+
+// Pixel rows per line while the whole document fits
+constexpr int kLineRows = 2;
+constexpr int kTabWidth = 4;
+constexpr int kCharacterAlpha = 0xa0;
+// Rows snapshotted per job, so the first paint of a tall minimap doesn't
+// hold the GUI thread in one go
+constexpr size_t kMaxRowsPerJob = 512;
+
+} // anonymous namespace
+
+Minimap::Minimap(CodeEditor* editor)
+    : QWidget(editor), editor_(editor), document_(editor->document()) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::PointingHandCursor);
+
+    connect(document_, &QTextDocument::contentsChange, this, &Minimap::onContentsChange);
+    connect(editor->highlighter(), &SyntaxHighlighter::linesHighlighted, this, &Minimap::onLinesHighlighted);
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, qOverload<>(&QWidget::update));
+    connect(&watcher_, &QFutureWatcherBase::finished, this, &Minimap::onRenderFinished);
+    relayout();
+}
+
+Minimap::~Minimap() {
+    watcher_.waitForFinished();
+}
+
+void Minimap::relayout() {
+    const int height = std::max(1, this->height());
+    line_count_ = document_->blockCount();
+    if (line_count_ * kLineRows <= height) {
+        row_height_ = kLineRows;
+        row_count_ = line_count_;
+    } else {
+        row_height_ = 1;
+        row_count_ = height;
+    }
+    generation_++;
+    shifts_.clear();
+
+    // The old picture stays up until rows are repainted
+    if (image_.height() != height) {
+        QImage image(kWidth, height, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        if (!image_.isNull()) {
+            const int rows = std::min(image_.height(), height);
+            std::memcpy(image.bits(), image_.constBits(), static_cast<size_t>(rows) * static_cast<size_t>(image.bytesPerLine()));
+        }
+        image_ = std::move(image);
+    }
+    const int used = row_count_ * row_height_;
+    if (used < image_.height()) {
+        std::memset(image_.scanLine(used), 0, static_cast<size_t>(image_.height() - used) * static_cast<size_t>(image_.bytesPerLine()));
+    }
+    markAll();
+}
+
+int Minimap::lineForRow(int row) const {
+    if (row_height_ == kLineRows) return row;
+    return static_cast<int>(static_cast<int64_t>(row) * line_count_ / row_count_);
+}
+
+int Minimap::rowForLine(int line) const {
+    if (row_height_ == kLineRows) return line;
+    // The first row whose line is at or after line
+    return static_cast<int>((static_cast<int64_t>(line) * row_count_ + line_count_ - 1) / line_count_);
+}
+
+void Minimap::markLines(int firstLine, int lastLine) {
+    for (int row = std::max(0, rowForLine(firstLine)); row < row_count_ && lineForRow(row) <= lastLine; ++row) {
+        dirty_rows_[static_cast<size_t>(row)] = true;
+        has_dirty_ = true;
+    }
+    schedule();
+}
+
+void Minimap::markAll() {
+    dirty_rows_.assign(static_cast<size_t>(row_count_), true);
+    has_dirty_ = row_count_ > 0;
+    schedule();
+}
+
+void Minimap::schedule() {
+    if (!has_dirty_ || render_scheduled_) return;
+    render_scheduled_ = true;
+    QTimer::singleShot(0, this, &Minimap::startRender);
+}
+
+void Minimap::onContentsChange(int position, int /* charsRemoved */, int charsAdded) {
+    const QTextBlock first = document_->findBlock(position);
+    QTextBlock last = document_->findBlock(position + charsAdded);
+    if (!last.isValid()) last = document_->lastBlock();
+    const int firstLine = first.isValid() ? first.blockNumber() : 0;
+    const int lastLine = last.blockNumber();
+
+    const int count = document_->blockCount();
+    const int delta = count - line_count_;
+    if (delta != 0) {
+        if (row_height_ != kLineRows || count * kLineRows > height()) {
+            // Sampled rows all show different lines now
+            pending_first_ = pending_last_ = -1;
+            relayout();
+            return;
+        }
+
+        // Lines below the edit keep their pictures, moved with them. The
+        // first of them was at line `from` before the edit.
+        const int from = std::clamp(lastLine + 1 - delta, 0, line_count_);
+        const size_t stride = static_cast<size_t>(image_.bytesPerLine()) * kLineRows;
+        const int moved = line_count_ - from;
+        if (moved > 0) {
+            std::memmove(image_.scanLine((from + delta) * kLineRows), image_.constScanLine(from * kLineRows),
+                         static_cast<size_t>(moved) * stride);
+        }
+        if (delta < 0) {
+            std::memset(image_.scanLine(count * kLineRows), 0, static_cast<size_t>(-delta) * stride);
+            dirty_rows_.erase(dirty_rows_.begin() + from + delta, dirty_rows_.begin() + from);
+        } else {
+            dirty_rows_.insert(dirty_rows_.begin() + from, static_cast<size_t>(delta), false);
+        }
+        shifts_.push_back({firstLine, from, delta});
+        line_count_ = row_count_ = count;
+    }
+
+    markLines(firstLine, lastLine);
+    if (pending_first_ >= 0) {
+        markLines(pending_first_, pending_last_);
+        pending_first_ = pending_last_ = -1;
+    }
+}
+
+void Minimap::onLinesHighlighted(int firstLine, int lastLine) {
+    if (document_->blockCount() != line_count_) {
+        // The highlighter saw this edit first; the rows move once
+        // onContentsChange sees it too
+        pending_first_ = pending_first_ < 0 ? firstLine : std::min(pending_first_, firstLine);
+        pending_last_ = std::max(pending_last_, lastLine);
+        return;
+    }
+    markLines(firstLine, lastLine);
+}
+
+void Minimap::startRender() {
+    render_scheduled_ = false;
+    if (watcher_.isRunning() || !has_dirty_) return;
+
+    Job job;
+    job.generation = generation_;
+    job.rowHeight = row_height_;
+    job.textColor = qRgb(0xd4, 0xd4, 0xd4);
+
+    has_dirty_ = false;
+    for (int row = 0; row < row_count_; ++row) {
+        if (!dirty_rows_[static_cast<size_t>(row)]) continue;
+        if (job.rows.size() == kMaxRowsPerJob) {
+            has_dirty_ = true;
+            break;
+        }
+        dirty_rows_[static_cast<size_t>(row)] = false;
+
+        RowSource source;
+        source.row = row;
+        const QTextBlock block = document_->findBlockByNumber(lineForRow(row));
+        source.text = block.text().left(kWidth);
+        for (const QTextLayout::FormatRange& range : block.layout()->formats()) {
+            if (range.start >= kWidth || !range.format.hasProperty(QTextFormat::ForegroundBrush)) continue;
+            source.runs.push_back({range.start, range.length, range.format.foreground().color().rgb()});
+        }
+        job.rows.push_back(std::move(source));
+    }
+
+    shifts_.clear();
+    watcher_.setFuture(QtConcurrent::run(&Minimap::render, std::move(job)));
+}
+
+Minimap::Result Minimap::render(const Job& job) {
+    Result result;
+    result.generation = job.generation;
+    result.rowHeight = job.rowHeight;
+    result.image = QImage(kWidth, std::max<int>(1, static_cast<int>(job.rows.size()) * job.rowHeight),
+                          QImage::Format_ARGB32_Premultiplied);
+    result.image.fill(Qt::transparent);
+    result.rows.reserve(job.rows.size());
+
+    QRgb colors[kWidth];
+    for (size_t i = 0; i < job.rows.size(); ++i) {
+        const RowSource& source = job.rows[i];
+        result.rows.push_back(source.row);
+
+        // By character; later ranges win, as they do in the layout
+        std::fill(std::begin(colors), std::end(colors), job.textColor);
+        for (const ColorRun& run : source.runs) {
+            const int end = std::min(run.start + run.length, static_cast<int>(kWidth));
+            for (int c = std::max(0, run.start); c < end; ++c) colors[c] = run.color;
+        }
+
+        const int top = static_cast<int>(i) * job.rowHeight;
+        int x = 0;
+        for (int c = 0; c < source.text.size() && x < kWidth; ++c) {
+            const QChar ch = source.text[c];
+            if (ch == QLatin1Char('\t')) {
+                x += kTabWidth - x % kTabWidth;
+                continue;
+            }
+            if (!ch.isSpace()) {
+                const QRgb color = colors[c];
+                const QRgb pixel = qPremultiply(qRgba(qRed(color), qGreen(color), qBlue(color), kCharacterAlpha));
+                for (int dy = 0; dy < job.rowHeight; ++dy) {
+                    reinterpret_cast<QRgb*>(result.image.scanLine(top + dy))[x] = pixel;
+                }
+            }
+            ++x;
+        }
+    }
+    return result;
+}
+
+void Minimap::onRenderFinished() {
+    const Result result = watcher_.future().takeResult();
+    if (result.generation == generation_) {
+        const size_t rowBytes = static_cast<size_t>(kWidth) * sizeof(QRgb);
+        for (size_t i = 0; i < result.rows.size(); ++i) {
+            // Edits made meanwhile may have moved the row; rows of edited
+            // lines are dirty again and dropped here
+            int row = result.rows[i];
+            for (const Shift& shift : shifts_) {
+                if (row >= shift.from) {
+                    row += shift.delta;
+                } else if (row >= shift.first) {
+                    row = -1;
+                    break;
+                }
+            }
+            if (row < 0 || row >= row_count_) continue;
+
+            for (int dy = 0; dy < result.rowHeight; ++dy) {
+                std::memcpy(image_.scanLine(row * row_height_ + dy),
+                            result.image.constScanLine(static_cast<int>(i) * result.rowHeight + dy), rowBytes);
+            }
+        }
+        update();
+    }
+    shifts_.clear();
+    schedule();
+}
+
+void Minimap::paintEvent(QPaintEvent* /* event */) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#1e1e1e"));
+    painter.drawImage(0, 0, image_);
+
+    // The lines the editor shows. The scroll bar counts rows, without
+    // folded lines and with wrapped ones; the minimap shows lines.
+    if (line_count_ == 0) return;
+    const QScrollBar* scrollBar = editor_->verticalScrollBar();
+    auto yForLine = [this](int line) {
+        if (row_height_ == kLineRows) return line * kLineRows;
+        return static_cast<int>(static_cast<int64_t>(line) * row_count_ / line_count_);
+    };
+    const int top = yForLine(editor_->lineForRow(scrollBar->value()));
+    const int bottom =
+        yForLine(std::min(line_count_, editor_->lineForRow(scrollBar->value() + scrollBar->pageStep())));
+    painter.fillRect(QRect(0, top, width(), std::max(2, bottom - top)), QColor(255, 255, 255, 24));
+}
+
+void Minimap::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    relayout();
+}
+
+void Minimap::scrollTo(int y) {
+    if (row_count_ == 0) return;
+    const int line = row_height_ == kLineRows
+                         ? y / kLineRows
+                         : static_cast<int>(static_cast<int64_t>(std::max(0, y)) * line_count_ / row_count_);
+    QScrollBar* scrollBar = editor_->verticalScrollBar();
+    scrollBar->setValue(editor_->rowForLine(line) - scrollBar->pageStep() / 2);
+}
+
+void Minimap::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) scrollTo(event->position().toPoint().y());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* event) {
+    if (event->buttons() & Qt::LeftButton) scrollTo(event->position().toPoint().y());
+}
+
+} // namespace xenon::ui
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QFutureWatcher>
+#include <QImage>
+#include <QTextDocument>
+#include <QWidget>
+#include <vector>
+
+namespace xenon::ui {
+
+class CodeEditor;
+
+// A scaled-down picture of the whole document beside the editor. Each row
+// of pixels shows one line, one pixel per character in the line's colors.
+// While the document fits, a line gets two rows; past that each row
+// samples one line, so a million-line file costs no more than the
+// minimap's height in lines.
+//
+// Rows are painted on a worker thread from a snapshot of their lines'
+// text and format colors, taken on the GUI thread for just the rows that
+// need it. An edit repaints the rows of the edited lines and shifts the
+// ones below; recoloring by the highlighter repaints the rows it touched.
+class Minimap : public QWidget {
+    Q_OBJECT
+
+public:
+    static constexpr int kWidth = 100;
+
+    explicit Minimap(CodeEditor* editor);
+    ~Minimap() override;
+
+    QSize sizeHint() const override { return QSize(kWidth, 0); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void onLinesHighlighted(int firstLine, int lastLine);
+    void startRender();
+    void onRenderFinished();
+
+private:
+    struct ColorRun {
+        int start;
+        int length;
+        QRgb color;
+    };
+
+    struct RowSource {
+        int row = 0;
+        QString text; // at most kWidth characters
+        std::vector<ColorRun> runs;
+    };
+
+    struct Job {
+        uint64_t generation = 0;
+        int rowHeight = 1;
+        QRgb textColor = 0;
+        std::vector<RowSource> rows;
+    };
+
+    struct Result {
+        uint64_t generation = 0;
+        int rowHeight = 1;
+        std::vector<int> rows;
+        QImage image; // the rows in order, rowHeight pixels each
+    };
+
+    // A change in line count while a job was out: rows first..from-1 were
+    // edited, rows from on moved by delta
+    struct Shift {
+        int first;
+        int from;
+        int delta;
+    };
+
+    static Result render(const Job& job);
+
+    // Recomputes which line each row shows; everything is repainted
+    void relayout();
+    void markLines(int firstLine, int lastLine);
+    void markAll();
+    void schedule();
+    int lineForRow(int row) const;
+    int rowForLine(int line) const;
+    void scrollTo(int y);
+
+    CodeEditor* editor_;
+    QTextDocument* document_;
+    QImage image_;
+
+    int line_count_ = 0;
+    int row_count_ = 0;
+    int row_height_ = 1;
+    // Bumped whenever rows start showing different lines; results
+    // rendered for an older mapping are dropped
+    uint64_t generation_ = 0;
+
+    std::vector<bool> dirty_rows_;
+    bool has_dirty_ = false;
+    // Lines the highlighter recolored while an edit's line count change
+    // was not yet applied
+    int pending_first_ = -1;
+    int pending_last_ = -1;
+
+    std::vector<Shift> shifts_;
+
+    bool render_scheduled_ = false;
+    QFutureWatcher<Result> watcher_;
+};
+
+} // namespace xenon::ui
@@ -0,0 +1,177 @@
+#include "ui/problems_panel.hpp"
+#include <QColor>
+#include <QDir>
+#include <QFont>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace xenon::ui {
+
+using xenon::features::Diagnostic;
+using xenon::features::DiagnosticSeverity;
+
+namespace {
+
+// Long enough to catch a server publishing file after file
+constexpr int kFlushDelay = 50;
+
+} // anonymous namespace
+
+QColor diagnosticColor(DiagnosticSeverity severity) {
+    switch (severity) {
+    case DiagnosticSeverity::Error: return QColor("#f14c4c");
+    case DiagnosticSeverity::Warning: return QColor("#cca700");
+    case DiagnosticSeverity::Information: return QColor("#3794ff");
+    case DiagnosticSeverity::Hint: break;
+    }
+    return QColor("#858585");
+}
+
+ProblemsModel::ProblemsModel(QObject* parent)
+    : QAbstractListModel(parent), root_path_(QDir::currentPath()) {
+}
+
+void ProblemsModel::setRootPath(const QString& path) {
+    beginResetModel();
+    root_path_ = path;
+    endResetModel();
+}
+
+int ProblemsModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows_.size());
+}
+
+QVariant ProblemsModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(rows_.size())) {
+        return {};
+    }
+
+    const Row& row = rows_[static_cast<size_t>(index.row())];
+    const QString& path = row.file->first;
+
+    if (row.diagnostic < 0) {
+        switch (role) {
+            case Qt::DisplayRole: {
+                const QString relativePath = QDir(root_path_).relativeFilePath(path);
+                return QString("%1 (%2)").arg(relativePath.startsWith("..") ? path : relativePath)
+                    .arg(row.file->second.size());
+            }
+            case Qt::FontRole: {
+                QFont font;
+                font.setBold(true);
+                return font;
+            }
+            case PathRole:
+                return path;
+            case LineRole:
+            case ColumnRole:
+                return 0;
+            default:
+                return {};
+        }
+    }
+
+    const Diagnostic& d = row.file->second[static_cast<size_t>(row.diagnostic)];
+    switch (role) {
+        case Qt::DisplayRole: {
+            QString text = QString("  %1:%2  %3").arg(d.line + 1).arg(d.col + 1).arg(QString::fromStdString(d.message));
+            if (!d.source.empty()) text += QString("  (%1)").arg(QString::fromStdString(d.source));
+            // Messages can run to several lines; the list shows the first
+            return text.section(QLatin1Char('\n'), 0, 0);
+        }
+        case Qt::ToolTipRole:
+            return QString::fromStdString(d.message);
+        case Qt::ForegroundRole:
+            return diagnosticColor(d.severity);
+        case PathRole:
+            return path;
+        case LineRole:
+            return d.line;
+        case ColumnRole:
+            return d.col;
+        default:
+            return {};
+    }
+}
+
+void ProblemsModel::update(std::map<QString, Diagnostics> changed) {
+    beginResetModel();
+    for (auto& [path, diagnostics] : changed) {
+        if (diagnostics.empty()) {
+            files_.erase(path);
+            continue;
+        }
+        std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b) {
+            return a.line != b.line ? a.line < b.line : a.col < b.col;
+        });
+        files_[path] = std::move(diagnostics);
+    }
+
+    rows_.clear();
+    std::fill(std::begin(counts_), std::end(counts_), 0);
+    for (auto file = files_.cbegin(); file != files_.cend(); ++file) {
+        rows_.push_back(Row{file, -1});
+        for (size_t i = 0; i < file->second.size(); ++i) {
+            rows_.push_back(Row{file, static_cast<int>(i)});
+            counts_[static_cast<size_t>(file->second[i].severity) - 1]++;
+        }
+    }
+    endResetModel();
+}
+
+ProblemsPanel::ProblemsPanel(QWidget* parent)
+    : QWidget(parent) {
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(5, 5, 5, 5);
+    layout->setSpacing(5);
+
+    status_label_ = new QLabel("No problems", this);
+    status_label_->setStyleSheet("color: #858585;");
+    layout->addWidget(status_label_);
+
+    model_ = new ProblemsModel(this);
+    view_ = new QListView(this);
+    view_->setModel(model_);
+    view_->setUniformItemSizes(true);
+    view_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    view_->setStyleSheet(
+        "QListView { background-color: #252526; border: none; color: #ffffff; outline: none; }"
+        "QListView::item:selected { background-color: #094771; }"
+    );
+    layout->addWidget(view_);
+
+    connect(view_, &QListView::activated, this, &ProblemsPanel::onActivated);
+
+    flush_timer_.setSingleShot(true);
+    flush_timer_.setInterval(kFlushDelay);
+    connect(&flush_timer_, &QTimer::timeout, this, &ProblemsPanel::flush);
+}
+
+void ProblemsPanel::setDiagnostics(const QString& path, std::vector<Diagnostic> diagnostics) {
+    pending_[path] = std::move(diagnostics);
+    if (!flush_timer_.isActive()) flush_timer_.start();
+}
+
+void ProblemsPanel::flush() {
+    model_->update(std::move(pending_));
+    pending_.clear();
+
+    const size_t errors = model_->count(DiagnosticSeverity::Error);
+    const size_t warnings = model_->count(DiagnosticSeverity::Warning);
+    const size_t others = model_->count(DiagnosticSeverity::Information) + model_->count(DiagnosticSeverity::Hint);
+    if (errors + warnings + others == 0) {
+        status_label_->setText("No problems");
+    } else {
+        status_label_->setText(QString("%1 errors, %2 warnings, %3 other").arg(errors).arg(warnings).arg(others));
+    }
+}
+
+void ProblemsPanel::onActivated(const QModelIndex& index) {
+    if (!index.isValid()) return;
+
+    emit problemActivated(index.data(ProblemsModel::PathRole).toString(),
+                          index.data(ProblemsModel::LineRole).toInt(),
+                          index.data(ProblemsModel::ColumnRole).toInt());
+}
+
+} // namespace xenon::ui
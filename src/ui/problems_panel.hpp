@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QColor>
+#include <QLabel>
+#include <QListView>
+#include <QString>
+#include <QTimer>
+#include <QWidget>
+#include <map>
+#include <vector>
+#include "features/diagnostics.hpp"
+
+namespace xenon::ui {
+
+// Squiggles, gutter marks and list entries share these
+QColor diagnosticColor(xenon::features::DiagnosticSeverity severity);
+
+// One header row per file with diagnostics followed by a row per
+// diagnostic. Rows are formatted in data(), so the view only formats the
+// ones it shows.
+class ProblemsModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Roles {
+        PathRole = Qt::UserRole + 1,
+        LineRole,
+        ColumnRole,
+    };
+
+    using Diagnostics = std::vector<xenon::features::Diagnostic>;
+
+    explicit ProblemsModel(QObject* parent = nullptr);
+
+    // Headers show paths relative to this when they are under it
+    void setRootPath(const QString& path);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    // Replaces the diagnostics of each file in changed; an empty list
+    // removes the file
+    void update(std::map<QString, Diagnostics> changed);
+
+    size_t count(xenon::features::DiagnosticSeverity severity) const {
+        return counts_[static_cast<size_t>(severity) - 1];
+    }
+
+private:
+    using Files = std::map<QString, Diagnostics>;
+    struct Row {
+        Files::const_iterator file;
+        int diagnostic; // -1 for the file header row
+    };
+
+    QString root_path_;
+    Files files_; // by absolute path, so files are listed in order
+    std::vector<Row> rows_;
+    size_t counts_[4] = {};
+};
+
+class ProblemsPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ProblemsPanel(QWidget* parent = nullptr);
+
+    void setRootPath(const QString& path) { model_->setRootPath(path); }
+    // Replaces the diagnostics of path; none removes the file. Updates are
+    // gathered and shown together, so a server publishing for many files
+    // at once resets the list once.
+    void setDiagnostics(const QString& path, std::vector<xenon::features::Diagnostic> diagnostics);
+
+signals:
+    void problemActivated(const QString& path, int line, int column);
+
+private slots:
+    void flush();
+    void onActivated(const QModelIndex& index);
+
+private:
+    QLabel* status_label_;
+    QListView* view_;
+    ProblemsModel* model_;
+
+    std::map<QString, ProblemsModel::Diagnostics> pending_;
+    QTimer flush_timer_;
+};
+
+} // namespace xenon::ui
@@ -1,10 +1,16 @@
 #include "ui/quick_open_dialog.hpp"
 #include <QKeyEvent>
-#include <QDirIterator>
-#include <QFileInfo>
+#include <QDir>
+#include <QtConcurrent>
 
 namespace xenon::ui {
 
+namespace {
+
+constexpr size_t kMaxResults = 200;
+
+} // anonymous namespace
+
 QuickOpenDialog::QuickOpenDialog(QWidget* parent)
     : QDialog(parent, Qt::FramelessWindowHint | Qt::Popup) {
     
@@ -12,9 +18,9 @@ QuickOpenDialog::QuickOpenDialog(QWidget* parent)
     setStyleSheet(
         "QDialog { background-color: #252526; border: 1px solid #454545; border-radius: 6px; }"
         "QLineEdit { background-color: #3c3c3c; color: #ffffff; border: none; padding: 10px; font-size: 14pt; border-radius: 4px; margin: 5px; }"
-        "QListWidget { background-color: transparent; border: none; color: #cccccc; font-size: 12pt; outline: none; }"
-        "QListWidget::item { padding: 10px; border-bottom: 1px solid #2d2d2d; }"
-        "QListWidget::item:selected { background-color: #094771; color: #ffffff; }"
+        "QListView { background-color: transparent; border: none; color: #cccccc; font-size: 12pt; outline: none; }"
+        "QListView::item { padding: 10px; border-bottom: 1px solid #2d2d2d; }"
+        "QListView::item:selected { background-color: #094771; color: #ffffff; }"
     );
 
     auto* layout = new QVBoxLayout(this);
@@ -25,20 +31,48 @@ QuickOpenDialog::QuickOpenDialog(QWidget* parent)
     search_edit_->setPlaceholderText("Search files by name...");
     layout->addWidget(search_edit_);
 
-    list_widget_ = new QListWidget(this);
-    list_widget_->setMinimumHeight(300);
-    layout->addWidget(list_widget_);
+    // Rows are paths straight out of the ranked candidates; with uniform
+    // sizes the view only converts and lays out the rows it shows
+    model_ = new ResultListModel(this);
+    model_->setDataProvider([this](uint32_t index, int role) -> QVariant {
+        if (role != Qt::DisplayRole) return QVariant();
+        const auto path = candidates_.candidate(index);
+        return QString::fromUtf8(path.data(), static_cast<qsizetype>(path.size()));
+    });
+
+    list_view_ = new QListView(this);
+    list_view_->setModel(model_);
+    list_view_->setUniformItemSizes(true);
+    list_view_->setMinimumHeight(300);
+    layout->addWidget(list_view_);
 
     connect(search_edit_, &QLineEdit::textChanged, this, &QuickOpenDialog::onTextChanged);
-    connect(list_widget_, &QListWidget::itemDoubleClicked, this, &QuickOpenDialog::onItemSelected);
+    connect(list_view_, &QListView::doubleClicked, this, &QuickOpenDialog::onItemSelected);
     
     search_edit_->installEventFilter(this);
+
+    connect(&candidates_watcher_, &QFutureWatcherBase::finished, this, &QuickOpenDialog::onCandidatesBuilt);
+}
+
+void QuickOpenDialog::setFileIndex(xenon::services::FileIndexService* service) {
+    file_index_service_ = service;
+    connect(service, &xenon::services::FileIndexService::filesChanged, this, &QuickOpenDialog::rebuildCandidates);
+    rebuildCandidates();
+}
+
+void QuickOpenDialog::setFrecencyStore(xenon::features::FrecencyStore* store) {
+    frecency_ = store;
+    rebuildCandidates();
 }
 
-void QuickOpenDialog::showDialog(const QString& rootPath) {
-    root_path_ = rootPath;
-    refreshFiles(rootPath);
+void QuickOpenDialog::showDialog() {
+    // Files opened elsewhere since the last build change the boosts
+    if (frecency_ && frecency_->generation() != frecency_generation_) {
+        rebuildCandidates();
+    }
+
     search_edit_->clear();
+    onTextChanged(QString());
     
     // Position in top-center of parent
     QWidget* p = parentWidget();
@@ -54,21 +88,13 @@ bool QuickOpenDialog::eventFilter(QObject* obj, QEvent* event) {
     if (obj == search_edit_ && event->type() == QEvent::KeyPress) {
         auto* keyEvent = static_cast<QKeyEvent*>(event);
         if (keyEvent->key() == Qt::Key_Down) {
-            int row = (list_widget_->currentRow() + 1) % list_widget_->count();
-            while (row < list_widget_->count() && list_widget_->item(row)->isHidden()) {
-                row = (row + 1) % list_widget_->count();
-            }
-            list_widget_->setCurrentRow(row);
+            moveSelection(1);
             return true;
         } else if (keyEvent->key() == Qt::Key_Up) {
-            int row = (list_widget_->currentRow() - 1 + list_widget_->count()) % list_widget_->count();
-            while (row >= 0 && list_widget_->item(row)->isHidden()) {
-                row = (row - 1 + list_widget_->count()) % list_widget_->count();
-            }
-            list_widget_->setCurrentRow(row);
+            moveSelection(-1);
             return true;
         } else if (keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) {
-            onItemSelected(list_widget_->currentItem());
+            onItemSelected(list_view_->currentIndex());
             return true;
         } else if (keyEvent->key() == Qt::Key_Escape) {
             hide();
@@ -78,52 +104,96 @@ bool QuickOpenDialog::eventFilter(QObject* obj, QEvent* event) {
     return QDialog::eventFilter(obj, event);
 }
 
+void QuickOpenDialog::moveSelection(int delta) {
+    const int count = model_->rowCount();
+    if (count == 0) return;
+    const int row = (list_view_->currentIndex().row() + delta + count) % count;
+    list_view_->setCurrentIndex(model_->index(row));
+}
+
 void QuickOpenDialog::onTextChanged(const QString& text) {
-    list_widget_->clear();
-    if (text.isEmpty()) {
-        for (const auto& f : all_files_) {
-            list_widget_->addItem(f);
-        }
-    } else {
-        for (const auto& f : all_files_) {
-            if (f.contains(text, Qt::CaseInsensitive)) {
-                list_widget_->addItem(f);
-            }
-        }
+    // Only the best matches are listed, so a keystroke never ranks more
+    // than kMaxResults rows however large the workspace is
+    const auto matches = candidates_.rank(text.toStdString(), kMaxResults);
+    std::vector<uint32_t> results;
+    results.reserve(matches.size());
+    for (const auto& match : matches) {
+        results.push_back(match.index);
     }
-    list_widget_->setCurrentRow(0);
+    model_->setResults(std::move(results));
+    list_view_->setCurrentIndex(model_->index(0));
 }
 
-void QuickOpenDialog::onItemSelected(QListWidgetItem* item) {
-    if (item) {
-        QString relativePath = item->text();
+void QuickOpenDialog::onItemSelected(const QModelIndex& index) {
+    if (index.isValid()) {
+        QString relativePath = index.data().toString();
         QString absolutePath = QDir(root_path_).absoluteFilePath(relativePath);
+        const uint32_t candidate = model_->sourceIndex(index.row());
         emit fileSelected(absolutePath);
+
+        // Opening the file recorded it; pick up the new boost without a rebuild
+        if (frecency_ && candidate < candidates_.size()) {
+            candidates_.setBoost(candidate, frecency_->boost(absolutePath.toStdString()));
+            frecency_generation_ = frecency_->generation();
+        }
         hide();
     }
 }
 
-void QuickOpenDialog::refreshFiles(const QString& rootPath) {
-    all_files_.clear();
-    list_widget_->clear();
-    
-    QDir root(rootPath);
-    QDirIterator it(rootPath, QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString path = it.next();
-        
-        // Skip hidden and build directories
-        if (path.contains("/.git/") || path.contains("/build/") || path.contains("/node_modules/")) {
-            continue;
-        }
-        
-        all_files_.append(root.relativeFilePath(path));
+void QuickOpenDialog::rebuildCandidates() {
+    if (!file_index_service_) return;
+    if (candidates_watcher_.isRunning()) {
+        rebuild_pending_ = true;
+        return;
     }
-    
-    for (const auto& f : all_files_) {
-        list_widget_->addItem(f);
+
+    auto index = file_index_service_->index();
+    if (!index) return;
+
+    // Boosts are looked up by relative path while packing, so the store
+    // itself never leaves the GUI thread
+    const QString rootPath = file_index_service_->rootPath();
+    std::unordered_map<std::string, int> boosts;
+    uint64_t generation = 0;
+    if (frecency_) {
+        boosts = frecency_->boosts(QDir(rootPath).absolutePath().toStdString() + "/");
+        generation = frecency_->generation();
+    }
+
+    candidates_watcher_.setFuture(QtConcurrent::run([index, rootPath, generation, boosts = std::move(boosts)]() {
+        Candidates candidates;
+        candidates.rootPath = rootPath;
+        candidates.frecencyGeneration = generation;
+        candidates.index.reserve(index->fileCount(), 0);
+
+        std::unordered_map<uint32_t, int> boosted;
+        index->forEachFile([&](const std::string& path) {
+            if (!boosts.empty()) {
+                auto it = boosts.find(path);
+                if (it != boosts.end()) boosted.emplace(static_cast<uint32_t>(candidates.index.size()), it->second);
+            }
+            candidates.index.add(path);
+        });
+        candidates.index.setBoosts(std::move(boosted));
+        return candidates;
+    }));
+}
+
+void QuickOpenDialog::onCandidatesBuilt() {
+    // Rows index into the old candidates, so drop them before swapping
+    model_->clear();
+    Candidates candidates = candidates_watcher_.future().takeResult();
+    candidates_ = std::move(candidates.index);
+    root_path_ = candidates.rootPath;
+    frecency_generation_ = candidates.frecencyGeneration;
+    if (isVisible()) {
+        onTextChanged(search_edit_->text());
+    }
+
+    if (rebuild_pending_) {
+        rebuild_pending_ = false;
+        rebuildCandidates();
     }
-    list_widget_->setCurrentRow(0);
 }
 
 } // namespace xenon::ui
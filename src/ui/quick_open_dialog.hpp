@@ -1,10 +1,15 @@
 #pragma once
 
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QLineEdit>
-#include <QListWidget>
+#include <QListView>
 #include <QVBoxLayout>
 #include <QStringList>
+#include "features/frecency_store.hpp"
+#include "features/fuzzy_matcher.hpp"
+#include "services/file_index_service.hpp"
+#include "ui/result_list_model.hpp"
 
 namespace xenon::ui {
 
@@ -15,7 +20,13 @@ public:
     explicit QuickOpenDialog(QWidget* parent = nullptr);
     ~QuickOpenDialog() override = default;
 
-    void showDialog(const QString& rootPath);
+    // Candidates come from the service's index and are re-packed for
+    // ranking in the background whenever it reports changes.
+    void setFileIndex(xenon::services::FileIndexService* service);
+    // Recently and frequently opened files (keyed by absolute path) rank
+    // higher. The store must outlive the dialog.
+    void setFrecencyStore(xenon::features::FrecencyStore* store);
+    void showDialog();
 
 signals:
     void fileSelected(const QString& path);
@@ -25,15 +36,31 @@ protected:
 
 private slots:
     void onTextChanged(const QString& text);
-    void onItemSelected(QListWidgetItem* item);
+    void onItemSelected(const QModelIndex& index);
+    void rebuildCandidates();
+    void onCandidatesBuilt();
 
 private:
-    void refreshFiles(const QString& rootPath);
+    void moveSelection(int delta);
 
     QLineEdit* search_edit_;
-    QListWidget* list_widget_;
-    QStringList all_files_;
+    QListView* list_view_;
+    ResultListModel* model_;
+    xenon::features::FuzzyIndex candidates_;
+    // Root the candidate paths are relative to
     QString root_path_;
+
+    struct Candidates {
+        xenon::features::FuzzyIndex index;
+        QString rootPath;
+        uint64_t frecencyGeneration = 0;
+    };
+
+    xenon::services::FileIndexService* file_index_service_ = nullptr;
+    xenon::features::FrecencyStore* frecency_ = nullptr;
+    uint64_t frecency_generation_ = 0;
+    QFutureWatcher<Candidates> candidates_watcher_;
+    bool rebuild_pending_ = false;
 };
 
 } // namespace xenon::ui
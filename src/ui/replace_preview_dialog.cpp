@@ -0,0 +1,173 @@
+#include "ui/replace_preview_dialog.hpp"
+#include <QColor>
+#include <QFont>
+#include <QPushButton>
+#include <QSplitter>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QVBoxLayout>
+
+namespace xenon::ui {
+
+ReplacePreviewDialog::ReplacePreviewDialog(
+    const QString& rootPath,
+    const xenon::features::WorkspaceReplaceOptions& options,
+    std::vector<xenon::features::FileReplacement> bufferPlans,
+    QWidget* parent)
+    : QDialog(parent), preview_limit_(options.maxPreviewLines) {
+    setWindowTitle("Replace in Files");
+    resize(900, 560);
+    setStyleSheet(
+        "QDialog { background-color: #252526; }"
+        "QLabel { color: #cccccc; }"
+        "QListWidget { background-color: #1e1e1e; border: 1px solid #3c3c3c; color: #cccccc; outline: none; }"
+        "QListWidget::item:selected { background-color: #094771; color: #ffffff; }"
+        "QPlainTextEdit { background-color: #1e1e1e; border: 1px solid #3c3c3c; color: #d4d4d4; }"
+    );
+
+    auto* layout = new QVBoxLayout(this);
+
+    summary_label_ = new QLabel("Searching...", this);
+    layout->addWidget(summary_label_);
+
+    auto* splitter = new QSplitter(Qt::Horizontal, this);
+    file_list_ = new QListWidget(splitter);
+    file_list_->setUniformItemSizes(true);
+    preview_ = new QPlainTextEdit(splitter);
+    preview_->setReadOnly(true);
+    preview_->setLineWrapMode(QPlainTextEdit::NoWrap);
+    preview_->setFont(QFont("Monospace", 10));
+    splitter->setStretchFactor(0, 1);
+    splitter->setStretchFactor(1, 2);
+    layout->addWidget(splitter, 1);
+
+    buttons_ = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons_->button(QDialogButtonBox::Ok)->setText("Replace");
+    buttons_->button(QDialogButtonBox::Ok)->setEnabled(false);
+    layout->addWidget(buttons_);
+
+    connect(buttons_, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons_, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(file_list_, &QListWidget::currentRowChanged, this, &ReplacePreviewDialog::onCurrentFileChanged);
+    connect(file_list_, &QListWidget::itemChanged, this, &ReplacePreviewDialog::updateSummary);
+
+    appendPlans(std::move(bufferPlans));
+
+    flush_timer_.setInterval(30);
+    connect(&flush_timer_, &QTimer::timeout, this, &ReplacePreviewDialog::flushPlans);
+    flush_timer_.start();
+
+    planner_.plan(
+        rootPath.toStdString(),
+        options,
+        [this](xenon::features::FileReplacement&& file) {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.push_back(std::move(file));
+        },
+        [this](bool) { finished_ = true; }
+    );
+}
+
+ReplacePreviewDialog::~ReplacePreviewDialog() {
+    planner_.cancel();
+}
+
+std::vector<xenon::features::FileReplacement> ReplacePreviewDialog::selectedFiles() const {
+    std::vector<xenon::features::FileReplacement> selected;
+    for (int row = 0; row < file_list_->count(); ++row) {
+        if (file_list_->item(row)->checkState() == Qt::Checked) {
+            selected.push_back(files_[static_cast<size_t>(row)]);
+        }
+    }
+    return selected;
+}
+
+void ReplacePreviewDialog::flushPlans() {
+    // Read the flag before draining so no batch is left behind after the stop
+    const bool finished = finished_;
+
+    std::vector<xenon::features::FileReplacement> batch;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        batch.swap(pending_);
+    }
+    appendPlans(std::move(batch));
+
+    if (finished) {
+        flush_timer_.stop();
+        updateSummary();
+    }
+}
+
+void ReplacePreviewDialog::appendPlans(std::vector<xenon::features::FileReplacement>&& plans) {
+    if (plans.empty()) return;
+
+    const QSignalBlocker blocker(file_list_);
+    for (auto& plan : plans) {
+        skipped_lines_ += plan.skippedLines;
+        if (plan.count == 0) continue;
+        auto* item = new QListWidgetItem(
+            QString("%1 (%2)").arg(QString::fromStdString(plan.relativePath)).arg(plan.count), file_list_);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
+        match_count_ += plan.count;
+        files_.push_back(std::move(plan));
+    }
+
+    if (file_list_->currentRow() < 0) {
+        file_list_->setCurrentRow(0);
+        onCurrentFileChanged(0);
+    }
+    updateSummary();
+}
+
+void ReplacePreviewDialog::updateSummary() {
+    size_t checkedFiles = 0;
+    size_t checkedMatches = 0;
+    for (int row = 0; row < file_list_->count(); ++row) {
+        if (file_list_->item(row)->checkState() == Qt::Checked) {
+            checkedFiles++;
+            checkedMatches += files_[static_cast<size_t>(row)].count;
+        }
+    }
+
+    QString notes = finished_ ? "" : " (searching...)";
+    if (skipped_lines_ > 0) {
+        notes += QString(" - %1 lines too long or complex for the regex are left unchanged").arg(skipped_lines_);
+    }
+    summary_label_->setText(QString("%1 of %2 occurrences in %3 of %4 files%5")
+        .arg(checkedMatches)
+        .arg(match_count_)
+        .arg(checkedFiles)
+        .arg(files_.size())
+        .arg(notes));
+    buttons_->button(QDialogButtonBox::Ok)->setEnabled(finished_ && checkedFiles > 0);
+}
+
+void ReplacePreviewDialog::onCurrentFileChanged(int row) {
+    preview_->clear();
+    if (row < 0 || row >= static_cast<int>(files_.size())) return;
+
+    const auto& file = files_[static_cast<size_t>(row)];
+
+    QTextCharFormat removed;
+    removed.setBackground(QColor("#4b1818"));
+    QTextCharFormat added;
+    added.setBackground(QColor("#373d29"));
+    QTextCharFormat plain;
+
+    QTextCursor cursor(preview_->document());
+    for (const auto& line : file.preview) {
+        const QString number = QString::number(line.line + 1).rightJustified(6);
+        cursor.insertText(number + " - " + QString::fromStdString(line.before), removed);
+        cursor.insertBlock(QTextBlockFormat(), plain);
+        cursor.insertText(number + " + " + QString::fromStdString(line.after), added);
+        cursor.insertBlock(QTextBlockFormat(), plain);
+    }
+    if (file.preview.size() >= preview_limit_) {
+        cursor.insertText(QString("... preview limited to the first %1 changed lines").arg(preview_limit_), plain);
+    }
+    preview_->moveCursor(QTextCursor::Start);
+}
+
+} // namespace xenon::ui
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QLabel>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "features/workspace_replace.hpp"
+
+namespace xenon::ui {
+
+// Shows what a workspace replace would change before anything is written.
+// Files on disk are planned in the background and stream into the list as
+// they are read; open buffers are planned up front by the caller. Every
+// file starts checked and can be excluded before confirming.
+class ReplacePreviewDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    ReplacePreviewDialog(
+        const QString& rootPath,
+        const xenon::features::WorkspaceReplaceOptions& options,
+        std::vector<xenon::features::FileReplacement> bufferPlans,
+        QWidget* parent = nullptr
+    );
+    ~ReplacePreviewDialog() override;
+
+    // The checked files, valid once the dialog was accepted.
+    std::vector<xenon::features::FileReplacement> selectedFiles() const;
+
+private slots:
+    void flushPlans();
+    void onCurrentFileChanged(int row);
+
+private:
+    void appendPlans(std::vector<xenon::features::FileReplacement>&& plans);
+    void updateSummary();
+
+    QListWidget* file_list_;
+    QPlainTextEdit* preview_;
+    QLabel* summary_label_;
+    QDialogButtonBox* buttons_;
+
+    std::vector<xenon::features::FileReplacement> files_;
+    size_t match_count_ = 0;
+    size_t skipped_lines_ = 0;
+    size_t preview_limit_;
+
+    // Filled by the planner thread, drained on the GUI thread by flush_timer_
+    QTimer flush_timer_;
+    std::mutex pending_mutex_;
+    std::vector<xenon::features::FileReplacement> pending_;
+    std::atomic<bool> finished_{false};
+
+    xenon::features::WorkspaceReplace planner_;
+};
+
+} // namespace xenon::ui
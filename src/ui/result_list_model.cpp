@@ -0,0 +1,51 @@
+#include "ui/result_list_model.hpp"
+
+namespace xenon::ui {
+
+ResultListModel::ResultListModel(QObject* parent)
+    : QAbstractListModel(parent) {}
+
+void ResultListModel::setDataProvider(DataProvider provider) {
+    beginResetModel();
+    provider_ = std::move(provider);
+    endResetModel();
+}
+
+void ResultListModel::setResults(std::vector<uint32_t> results) {
+    beginResetModel();
+    results_ = std::move(results);
+    show_all_ = false;
+    all_count_ = 0;
+    endResetModel();
+}
+
+void ResultListModel::setAllResults(size_t count) {
+    beginResetModel();
+    results_.clear();
+    show_all_ = true;
+    all_count_ = count;
+    endResetModel();
+}
+
+void ResultListModel::clear() {
+    setResults({});
+}
+
+uint32_t ResultListModel::sourceIndex(int row) const {
+    if (row < 0 || row >= rowCount()) return UINT32_MAX;
+    return show_all_ ? static_cast<uint32_t>(row) : results_[static_cast<size_t>(row)];
+}
+
+int ResultListModel::rowCount(const QModelIndex& parent) const {
+    if (parent.isValid()) return 0;
+    return static_cast<int>(show_all_ ? all_count_ : results_.size());
+}
+
+QVariant ResultListModel::data(const QModelIndex& index, int role) const {
+    if (!provider_ || !index.isValid()) return QVariant();
+    const uint32_t source = sourceIndex(index.row());
+    if (source == UINT32_MAX) return QVariant();
+    return provider_(source, role);
+}
+
+} // namespace xenon::ui
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QVariant>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace xenon::ui {
+
+// A list model over results that live elsewhere (a FuzzyIndex, a completion
+// list). Rows hold only an index into that source, and every role is
+// computed on demand, so a view with uniform item sizes asks for the
+// visible rows only. Replacing the results is a model reset and costs the
+// same however many rows there are.
+class ResultListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    // Returns the value of role for the source entry at index
+    using DataProvider = std::function<QVariant(uint32_t index, int role)>;
+
+    explicit ResultListModel(QObject* parent = nullptr);
+
+    void setDataProvider(DataProvider provider);
+
+    // Shows the given source indices, in order
+    void setResults(std::vector<uint32_t> results);
+    // Shows source entries 0..count-1 without materialising the indices
+    void setAllResults(size_t count);
+    void clear();
+
+    // Source index for a row, or UINT32_MAX when out of range
+    uint32_t sourceIndex(int row) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    DataProvider provider_;
+    std::vector<uint32_t> results_;
+    size_t all_count_ = 0;
+    bool show_all_ = false;
+};
+
+} // namespace xenon::ui
@@ -0,0 +1,362 @@
+#include "ui/search_panel.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QFont>
+#include <QHBoxLayout>
+#include <QStandardPaths>
+#include <QVBoxLayout>
+#include <QColor>
+#include <QtConcurrent>
+
+namespace xenon::ui {
+
+namespace {
+
+// Overlay entries are cheap to query but live in memory; past this many the
+// index is rewritten so the next launch maps the merged file directly.
+constexpr size_t kMaxIndexOverlay = 2000;
+constexpr qint64 kIndexRefreshIntervalMs = 30000;
+
+} // anonymous namespace
+
+SearchResultsModel::SearchResultsModel(QObject* parent)
+    : QAbstractListModel(parent) {
+}
+
+int SearchResultsModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows_.size());
+}
+
+QVariant SearchResultsModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(rows_.size())) {
+        return {};
+    }
+
+    const Row& row = rows_[static_cast<size_t>(index.row())];
+    const auto& file = files_[static_cast<size_t>(row.file)];
+
+    if (row.match < 0) {
+        switch (role) {
+            case Qt::DisplayRole:
+                return QString("%1 (%2)").arg(QString::fromStdString(file.relativePath)).arg(file.matches.size());
+            case Qt::FontRole: {
+                QFont font;
+                font.setBold(true);
+                return font;
+            }
+            case PathRole:
+                return QString::fromStdString(file.relativePath);
+            case LineRole:
+            case ColumnRole:
+                return 0;
+            default:
+                return {};
+        }
+    }
+
+    const auto& match = file.matches[static_cast<size_t>(row.match)];
+    switch (role) {
+        case Qt::DisplayRole:
+            return QString("  %1: %2").arg(match.line + 1).arg(QString::fromStdString(match.lineText).trimmed());
+        case Qt::ForegroundRole:
+            return QColor("#cccccc");
+        case PathRole:
+            return QString::fromStdString(file.relativePath);
+        case LineRole:
+            return static_cast<int>(match.line);
+        case ColumnRole:
+            // Byte columns become UTF-16 columns when the whole line prefix is known
+            if (match.column == match.previewColumn) {
+                return static_cast<int>(QString::fromUtf8(match.lineText.data(),
+                                                          static_cast<qsizetype>(match.previewColumn)).size());
+            }
+            return static_cast<int>(match.column);
+        default:
+            return {};
+    }
+}
+
+void SearchResultsModel::clear() {
+    beginResetModel();
+    files_.clear();
+    rows_.clear();
+    match_count_ = 0;
+    endResetModel();
+}
+
+void SearchResultsModel::appendFiles(std::vector<xenon::features::FileMatches>&& files) {
+    size_t newRows = 0;
+    for (const auto& file : files) {
+        newRows += 1 + file.matches.size();
+    }
+    if (newRows == 0) return;
+
+    const int first = static_cast<int>(rows_.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(newRows) - 1);
+    rows_.reserve(rows_.size() + newRows);
+    for (auto& file : files) {
+        const int fileIndex = static_cast<int>(files_.size());
+        rows_.push_back(Row{fileIndex, -1});
+        for (size_t i = 0; i < file.matches.size(); ++i) {
+            rows_.push_back(Row{fileIndex, static_cast<int>(i)});
+        }
+        match_count_ += file.matches.size();
+        files_.push_back(std::move(file));
+    }
+    endInsertRows();
+}
+
+SearchPanel::SearchPanel(QWidget* parent)
+    : QWidget(parent), root_path_(QDir::currentPath()),
+      search_(std::make_unique<xenon::features::WorkspaceSearch>()) {
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(5, 5, 5, 5);
+    layout->setSpacing(5);
+
+    search_edit_ = new QLineEdit(this);
+    search_edit_->setPlaceholderText("Search");
+    search_edit_->setStyleSheet("background-color: #3c3c3c; color: white; border: 1px solid #555555; padding: 4px;");
+    layout->addWidget(search_edit_);
+
+    auto* replace_row = new QHBoxLayout();
+    replace_edit_ = new QLineEdit(this);
+    replace_edit_->setPlaceholderText("Replace");
+    replace_edit_->setStyleSheet("background-color: #3c3c3c; color: white; border: 1px solid #555555; padding: 4px;");
+    replace_button_ = new QPushButton("Replace All", this);
+    replace_button_->setToolTip("Preview and replace in all files");
+    replace_row->addWidget(replace_edit_);
+    replace_row->addWidget(replace_button_);
+    layout->addLayout(replace_row);
+
+    auto* options_row = new QHBoxLayout();
+    case_check_ = new QCheckBox("Aa", this);
+    case_check_->setToolTip("Case Sensitive");
+    regex_check_ = new QCheckBox(".*", this);
+    regex_check_->setToolTip("Use Regular Expression");
+    options_row->addWidget(case_check_);
+    options_row->addWidget(regex_check_);
+    options_row->addStretch();
+    layout->addLayout(options_row);
+
+    status_label_ = new QLabel(this);
+    status_label_->setStyleSheet("color: #858585;");
+    layout->addWidget(status_label_);
+
+    model_ = new SearchResultsModel(this);
+    results_view_ = new QListView(this);
+    results_view_->setModel(model_);
+    results_view_->setUniformItemSizes(true);
+    results_view_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    results_view_->setStyleSheet(
+        "QListView { background-color: #252526; border: none; color: #ffffff; outline: none; }"
+        "QListView::item:selected { background-color: #094771; }"
+    );
+    layout->addWidget(results_view_);
+
+    connect(search_edit_, &QLineEdit::returnPressed, this, &SearchPanel::startSearch);
+    connect(case_check_, &QCheckBox::toggled, this, &SearchPanel::startSearch);
+    connect(regex_check_, &QCheckBox::toggled, this, &SearchPanel::startSearch);
+    connect(results_view_, &QListView::activated, this, &SearchPanel::onResultActivated);
+    connect(replace_edit_, &QLineEdit::returnPressed, this, &SearchPanel::onReplaceAll);
+    connect(replace_button_, &QPushButton::clicked, this, &SearchPanel::onReplaceAll);
+
+    // Results are batched so a flood of hits costs one model insert per tick
+    flush_timer_.setInterval(30);
+    connect(&flush_timer_, &QTimer::timeout, this, &SearchPanel::flushResults);
+
+    // Files the editor writes reach the index through notifyFileChanged();
+    // this catches checkouts, builds and other editors in the background
+    index_timer_.setInterval(static_cast<int>(kIndexRefreshIntervalMs));
+    connect(&index_timer_, &QTimer::timeout, this, &SearchPanel::refreshIndex);
+}
+
+SearchPanel::~SearchPanel() {
+    search_->cancel();
+    cancelIndexJob();
+}
+
+void SearchPanel::setRootPath(const QString& path) {
+    search_->cancel();
+    root_path_ = path;
+    model_->clear();
+    status_label_->clear();
+    loadIndex();
+}
+
+void SearchPanel::notifyFileChanged(const QString& path) {
+    if (!index_) return;
+
+    const QString relativePath = QDir(root_path_).relativeFilePath(path);
+    if (relativePath.startsWith("..") || QDir::isAbsolutePath(relativePath)) return;
+    index_->updateFile(root_path_.toStdString(), relativePath.toStdString());
+}
+
+QString SearchPanel::indexPath() const {
+    const QByteArray key = QCryptographicHash::hash(QDir(root_path_).absolutePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + "/trigram/" + QString::fromLatin1(key) + ".idx";
+}
+
+void SearchPanel::cancelIndexJob() {
+    index_cancelled_ = true;
+    index_job_.waitForFinished();
+    index_cancelled_ = false;
+}
+
+void SearchPanel::loadIndex() {
+    cancelIndexJob();
+    index_timer_.stop();
+    index_.reset();
+
+    const QString path = indexPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    const QString root = root_path_;
+    index_job_ = QtConcurrent::run([this, root, path]() {
+        const std::string rootPath = root.toStdString();
+        const std::string filePath = path.toStdString();
+
+        auto index = std::make_shared<xenon::features::TrigramIndex>();
+        if (index->open(filePath)) {
+            // A previous session's index only needs the files changed since
+            index->refresh(rootPath, index_cancelled_);
+        } else if (!xenon::features::TrigramIndex::build(rootPath, filePath, index_cancelled_)
+                   || !index->open(filePath)) {
+            return;
+        }
+        if (index_cancelled_) return;
+
+        QMetaObject::invokeMethod(this, [this, root, index]() {
+            if (root != root_path_) return;
+            index_ = index;
+            index_refreshed_.start();
+            index_timer_.start();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SearchPanel::refreshIndex() {
+    if (!index_ || index_job_.isRunning()) return;
+    if (index_refreshed_.isValid() && index_refreshed_.elapsed() < kIndexRefreshIntervalMs) return;
+    index_refreshed_.start();
+
+    const QString root = root_path_;
+    const QString path = indexPath();
+    auto index = index_;
+    index_job_ = QtConcurrent::run([this, root, path, index]() {
+        index->refresh(root.toStdString(), index_cancelled_);
+        if (index_cancelled_ || index->overlaySize() < kMaxIndexOverlay) return;
+
+        // Swap in a freshly merged index rather than remapping the one that
+        // running searches may still be reading
+        auto merged = std::make_shared<xenon::features::TrigramIndex>();
+        if (!index->writeMerged(path.toStdString()) || !merged->open(path.toStdString())) return;
+
+        QMetaObject::invokeMethod(this, [this, root, merged]() {
+            if (root != root_path_) return;
+            index_ = merged;
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SearchPanel::focusSearch() {
+    search_edit_->setFocus();
+    search_edit_->selectAll();
+}
+
+void SearchPanel::startSearch() {
+    search_->cancel();
+    flush_timer_.stop();
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_.clear();
+    }
+    model_->clear();
+
+    const QString pattern = search_edit_->text();
+    if (pattern.isEmpty()) {
+        status_label_->clear();
+        return;
+    }
+
+    xenon::features::WorkspaceSearchOptions options;
+    options.pattern = pattern.toStdString();
+    options.caseSensitive = case_check_->isChecked();
+    options.useRegex = regex_check_->isChecked();
+    options.index = index_;
+
+    // Runs alongside the search, which queries the index as it stands
+    refreshIndex();
+
+    finished_ = false;
+    cancelled_ = false;
+    skipped_lines_ = 0;
+    elapsed_.start();
+    status_label_->setText("Searching...");
+    flush_timer_.start();
+
+    search_->start(
+        root_path_.toStdString(),
+        options,
+        [this](xenon::features::FileMatches&& file) {
+            skipped_lines_ += file.skippedLines;
+            if (file.matches.empty()) return;
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.push_back(std::move(file));
+        },
+        [this](bool cancelled) {
+            cancelled_ = cancelled;
+            finished_ = true;
+        }
+    );
+}
+
+void SearchPanel::flushResults() {
+    // Read the flag before draining so no batch is left behind after the stop
+    const bool finished = finished_;
+
+    std::vector<xenon::features::FileMatches> batch;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        batch.swap(pending_);
+    }
+    model_->appendFiles(std::move(batch));
+
+    if (finished) {
+        flush_timer_.stop();
+        QString notes = cancelled_ ? " - cancelled" : "";
+        if (const size_t skipped = skipped_lines_) {
+            notes += QString(" - %1 lines too long or complex for the regex, not searched").arg(skipped);
+        }
+        status_label_->setText(QString("%1 results in %2 files (%3 ms)%4")
+            .arg(model_->matchCount())
+            .arg(model_->fileCount())
+            .arg(elapsed_.elapsed())
+            .arg(notes));
+    } else if (model_->matchCount() > 0) {
+        status_label_->setText(QString("%1 results in %2 files...")
+            .arg(model_->matchCount())
+            .arg(model_->fileCount()));
+    }
+}
+
+void SearchPanel::onResultActivated(const QModelIndex& index) {
+    if (!index.isValid()) return;
+
+    const QString relativePath = index.data(SearchResultsModel::PathRole).toString();
+    emit matchActivated(QDir(root_path_).absoluteFilePath(relativePath),
+                        index.data(SearchResultsModel::LineRole).toInt(),
+                        index.data(SearchResultsModel::ColumnRole).toInt());
+}
+
+void SearchPanel::onReplaceAll() {
+    if (search_edit_->text().isEmpty()) return;
+
+    search_->cancel();
+    emit replaceAllRequested(search_edit_->text(), replace_edit_->text(),
+                             case_check_->isChecked(), regex_check_->isChecked());
+}
+
+} // namespace xenon::ui
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QCheckBox>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QTimer>
+#include <QWidget>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "features/trigram_index.hpp"
+#include "features/workspace_search.hpp"
+
+namespace xenon::ui {
+
+// Flat list model over search results: one header row per file followed by
+// one row per match. Row text is produced lazily in data(), so the view only
+// ever formats the rows it shows.
+class SearchResultsModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Roles {
+        PathRole = Qt::UserRole + 1,
+        LineRole,
+        ColumnRole,
+    };
+
+    explicit SearchResultsModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void clear();
+    void appendFiles(std::vector<xenon::features::FileMatches>&& files);
+
+    size_t fileCount() const { return files_.size(); }
+    size_t matchCount() const { return match_count_; }
+
+private:
+    struct Row {
+        int file;
+        int match; // -1 for the file header row
+    };
+
+    std::vector<xenon::features::FileMatches> files_;
+    std::vector<Row> rows_;
+    size_t match_count_ = 0;
+};
+
+class SearchPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit SearchPanel(QWidget* parent = nullptr);
+    ~SearchPanel() override;
+
+    void setRootPath(const QString& path);
+    void focusSearch();
+    // Re-indexes a file written by the editor so the next search sees it
+    void notifyFileChanged(const QString& path);
+
+    QString rootPath() const { return root_path_; }
+    std::shared_ptr<const xenon::features::TrigramIndex> index() const { return index_; }
+
+signals:
+    void matchActivated(const QString& path, int line, int column);
+    void replaceAllRequested(const QString& pattern, const QString& replacement, bool caseSensitive, bool useRegex);
+
+private slots:
+    void startSearch();
+    void flushResults();
+    void onResultActivated(const QModelIndex& index);
+    void onReplaceAll();
+
+private:
+    // Opens (or builds) the on-disk index for root_path_ in the background
+    void loadIndex();
+    // Picks up files changed outside the editor with a background stat walk,
+    // at most once per kIndexRefreshIntervalMs
+    void refreshIndex();
+    void cancelIndexJob();
+    QString indexPath() const;
+
+    QLineEdit* search_edit_;
+    QLineEdit* replace_edit_;
+    QPushButton* replace_button_;
+    QCheckBox* case_check_;
+    QCheckBox* regex_check_;
+    QLabel* status_label_;
+    QListView* results_view_;
+    SearchResultsModel* model_;
+
+    QString root_path_;
+    QTimer flush_timer_;
+    QElapsedTimer elapsed_;
+
+    // Filled by search worker threads, drained on the GUI thread by flush_timer_
+    std::mutex pending_mutex_;
+    std::vector<xenon::features::FileMatches> pending_;
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<size_t> skipped_lines_{0};
+
+    std::unique_ptr<xenon::features::WorkspaceSearch> search_;
+
+    // Published on the GUI thread once ready; searches walk the tree until then
+    std::shared_ptr<xenon::features::TrigramIndex> index_;
+    QFuture<void> index_job_;
+    std::atomic<bool> index_cancelled_{false};
+    QElapsedTimer index_refreshed_;
+    QTimer index_timer_;
+};
+
+} // namespace xenon::ui
@@ -1,87 +1,515 @@
 #include "ui/syntax_highlighter.hpp"
+#include <QHash>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QtConcurrent>
+#include <algorithm>
 
 namespace xenon::ui {
 
-SyntaxHighlighter::SyntaxHighlighter(QTextDocument* parent)
-    : QSyntaxHighlighter(parent) {
-    HighlightingRule rule;
-
-    keywordFormat.setForeground(QColor("#569cd6"));
-    keywordFormat.setFontWeight(QFont::Bold);
-    const QStringList keywordPatterns = {
-        QStringLiteral("\\bchar\\b"), QStringLiteral("\\bclass\\b"), QStringLiteral("\\bconst\\b"),
-        QStringLiteral("\\bdouble\\b"), QStringLiteral("\\benum\\b"), QStringLiteral("\\bexplicit\\b"),
-        QStringLiteral("\\bfriend\\b"), QStringLiteral("\\binline\\b"), QStringLiteral("\\bint\\b"),
-        QStringLiteral("\\blong\\b"), QStringLiteral("\\bnamespace\\b"), QStringLiteral("\\boperator\\b"),
-        QStringLiteral("\\bprivate\\b"), QStringLiteral("\\bprotected\\b"), QStringLiteral("\\bpublic\\b"),
-        QStringLiteral("\\bshort\\b"), QStringLiteral("\\bsignals\\b"), QStringLiteral("\\bsigned\\b"),
-        QStringLiteral("\\bslots\\b"), QStringLiteral("\\bstatic\\b"), QStringLiteral("\\bstruct\\b"),
-        QStringLiteral("\\btemplate\\b"), QStringLiteral("\\btypedef\\b"), QStringLiteral("\\btypename\\b"),
-        QStringLiteral("\\bunion\\b"), QStringLiteral("\\bunsigned\\b"), QStringLiteral("\\bvirtual\\b"),
-        QStringLiteral("\\bvoid\\b"), QStringLiteral("\\bvolatile\\b"), QStringLiteral("\\bbool\\b"),
-        QStringLiteral("\\bif\\b"), QStringLiteral("\\belse\\b"), QStringLiteral("\\bfor\\b"),
-        QStringLiteral("\\bwhile\\b"), QStringLiteral("\\breturn\\b"), QStringLiteral("\\bswitch\\b"),
-        QStringLiteral("\\bcase\\b")
-    };
-    for (const QString& pattern : keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = keywordFormat;
-        highlightingRules.append(rule);
+using xenon::features::Bracket;
+using xenon::features::measureIndent;
+using xenon::features::SemanticToken;
+using xenon::features::SemanticTokensUpdate;
+using xenon::features::Token;
+using xenon::features::TokenKind;
+
+namespace {
+
+// An edit re-lexes at most this many lines before deferring to the worker
+constexpr int kMaxSyncLines = 200;
+constexpr int kChunkLines = 2000;
+
+// Marks the format ranges that come from semantic tokens
+constexpr int kSemanticProperty = QTextFormat::UserProperty;
+
+std::u16string_view utf16View(const QString& text) {
+    return std::u16string_view(reinterpret_cast<const char16_t*>(text.utf16()), static_cast<size_t>(text.size()));
+}
+
+// What a block's layout was last given, so formats that come out the same
+// are not set again. Setting formats throws away the layout's shaped
+// glyphs, and the highlighter often arrives at the same tokens twice: a
+// speculative pass and the real one, or a state change that doesn't change
+// a line.
+class BlockData : public QTextBlockUserData {
+public:
+    std::vector<SemanticToken> semanticTokens;
+    uint64_t tokensHash = 0; // of the grammar's tokens
+    bool formatted = false;
+};
+
+BlockData* blockData(const QTextBlock& block) {
+    return static_cast<BlockData*>(block.userData());
+}
+
+BlockData* ensureBlockData(QTextBlock& block) {
+    if (!block.userData()) block.setUserData(new BlockData);
+    return blockData(block);
+}
+
+uint64_t hashTokens(const Token* begin, const Token* end) {
+    uint64_t hash = static_cast<uint64_t>(end - begin);
+    for (const Token* token = begin; token != end; ++token) {
+        const uint64_t packed = (uint64_t{token->start} << 32) ^ (uint64_t{token->length} << 8) ^
+                                static_cast<uint8_t>(token->kind);
+        hash = (hash ^ packed) * 0x100000001b3ULL;
     }
+    return hash;
+}
 
-    classFormat.setForeground(QColor("#4ec9b0"));
-    rule.pattern = QRegularExpression(QStringLiteral("\\b[A-Z][A-Za-z0-9_]*\\b"));
-    rule.format = classFormat;
-    highlightingRules.append(rule);
+bool sameTokens(const BlockData* data, const SemanticToken* begin, const SemanticToken* end) {
+    if (!data) return begin == end;
+    return std::equal(begin, end, data->semanticTokens.begin(), data->semanticTokens.end(),
+                      [](const SemanticToken& a, const SemanticToken& b) {
+                          return a.start == b.start && a.length == b.length && a.type == b.type &&
+                                 a.modifiers == b.modifiers;
+                      });
+}
 
-    singleLineCommentFormat.setForeground(QColor("#6a9955"));
-    rule.pattern = QRegularExpression(QStringLiteral("//[^\n]*"));
-    rule.format = singleLineCommentFormat;
-    highlightingRules.append(rule);
+// Collects the blocks whose formats changed into runs of adjacent blocks,
+// each relaid out with one call
+class DirtyRuns {
+public:
+    explicit DirtyRuns(QTextDocument* document) : document_(document) {}
 
-    multiLineCommentFormat.setForeground(QColor("#6a9955"));
+    void add(const QTextBlock& block) {
+        if (block.position() != to_) {
+            flush();
+            from_ = block.position();
+        }
+        to_ = block.position() + block.length();
+
+        const int line = block.blockNumber();
+        if (first_line_ < 0) first_line_ = line;
+        last_line_ = line;
+    }
+
+    void flush() {
+        if (to_ > from_) document_->markContentsDirty(from_, to_ - from_);
+        from_ = to_ = 0;
+    }
+
+    // The changed lines, -1 when none changed
+    int firstLine() const { return first_line_; }
+    int lastLine() const { return last_line_; }
+
+private:
+    QTextDocument* document_;
+    int from_ = 0;
+    int to_ = 0;
+    int first_line_ = -1;
+    int last_line_ = -1;
+};
 
-    quotationFormat.setForeground(QColor("#ce9178"));
-    rule.pattern = QRegularExpression(QStringLiteral("\".*\""));
-    rule.format = quotationFormat;
-    highlightingRules.append(rule);
+} // anonymous namespace
 
-    functionFormat.setForeground(QColor("#dcdcaa"));
-    rule.pattern = QRegularExpression(QStringLiteral("\\b[A-Za-z0-9_]+(?=\\()"));
-    rule.format = functionFormat;
-    highlightingRules.append(rule);
+SyntaxHighlighter::SyntaxHighlighter(QTextDocument* document)
+    : QObject(document), document_(document) {
+    auto format = [this](TokenKind kind) -> QTextCharFormat& { return formats_[static_cast<size_t>(kind)]; };
 
-    commentStartExpression = QRegularExpression(QStringLiteral("/\\*"));
-    commentEndExpression = QRegularExpression(QStringLiteral("\\*/"));
+    format(TokenKind::Keyword).setForeground(QColor("#569cd6"));
+    format(TokenKind::Keyword).setFontWeight(QFont::Bold);
+    format(TokenKind::Type).setForeground(QColor("#4ec9b0"));
+    format(TokenKind::Function).setForeground(QColor("#dcdcaa"));
+    format(TokenKind::String).setForeground(QColor("#ce9178"));
+    format(TokenKind::Number).setForeground(QColor("#b5cea8"));
+    format(TokenKind::Comment).setForeground(QColor("#6a9955"));
+    format(TokenKind::Preprocessor).setForeground(QColor("#c586c0"));
+
+    schedule_timer_.setSingleShot(true);
+    schedule_timer_.setInterval(0);
+    connect(&schedule_timer_, &QTimer::timeout, this, &SyntaxHighlighter::startNextJob);
+    connect(&watcher_, &QFutureWatcherBase::finished, this, &SyntaxHighlighter::onJobFinished);
+    connect(document_, &QTextDocument::contentsChange, this, &SyntaxHighlighter::onContentsChange);
+
+    line_count_ = document_->blockCount();
+    brackets_.replaceLines(0, 0, line_count_);
+    if (!document_->isEmpty()) {
+        rehighlight();
+    }
 }
 
-void SyntaxHighlighter::highlightBlock(const QString& text) {
-    for (const HighlightingRule& rule : std::as_const(highlightingRules)) {
-        QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(static_cast<int>(match.capturedStart()), static_cast<int>(match.capturedLength()), rule.format);
+SyntaxHighlighter::~SyntaxHighlighter() {
+    watcher_.waitForFinished();
+}
+
+void SyntaxHighlighter::setGrammar(std::shared_ptr<const xenon::features::Grammar> grammar) {
+    if (grammar == grammar_) return;
+    grammar_ = std::move(grammar);
+    rehighlight();
+}
+
+void SyntaxHighlighter::setVisibleLines(int first, int last) {
+    if (first == first_visible_ && last == last_visible_) return;
+    first_visible_ = first;
+    last_visible_ = last;
+    visible_done_ = false;
+    schedule();
+}
+
+void SyntaxHighlighter::rehighlight() {
+    revision_++;
+    markDirty(0, document_->blockCount() - 1);
+    schedule();
+}
+
+void SyntaxHighlighter::onContentsChange(int position, int /* charsRemoved */, int charsAdded) {
+    if (applying_) return;
+    revision_++;
+    visible_done_ = false;
+
+    QTextBlock block = document_->findBlock(position);
+    QTextBlock last = document_->findBlock(position + charsAdded);
+    if (!last.isValid()) last = document_->lastBlock();
+    const int lastLine = last.blockNumber();
+    if (!block.isValid()) return;
+
+    // The edited lines have no brackets until they are lexed below
+    const int lineDelta = document_->blockCount() - line_count_;
+    line_count_ = document_->blockCount();
+    const int editedLines = lastLine - block.blockNumber() + 1;
+    brackets_.replaceLines(block.blockNumber(), editedLines - lineDelta, editedLines);
+
+    // The semantic tokens of edited lines are out of date until the server
+    // sends new ones, and their layouts no longer match any tokens
+    for (QTextBlock edited = block; edited.isValid(); edited = edited.next()) {
+        edited.setUserData(nullptr);
+        if (edited == last) break;
+    }
+
+    int state = block.previous().isValid() ? block.previous().userState() : 0;
+    if (state < 0) {
+        // Nothing above has been lexed yet; the pending pass will get here
+        markDirty(block.blockNumber(), lastLine);
+        schedule();
+        return;
+    }
+
+    // The edited lines are lexed right away so typing never shows stale
+    // colors; only a change in the state carried out of them goes async
+    applying_ = true;
+    DirtyRuns dirty(document_);
+    bool stateChanged = false;
+    for (int lexed = 0; block.isValid() && lexed < kMaxSyncLines; ++lexed) {
+        const QString text = block.text();
+        tokens_.clear();
+        if (grammar_) state = grammar_->lexLine(utf16View(text), state, tokens_);
+        if (applyFormats(block, tokens_.data(), tokens_.data() + tokens_.size())) dirty.add(block);
+        std::vector<Bracket> brackets;
+        scanBrackets(utf16View(text), tokens_.data(), tokens_.data() + tokens_.size(), brackets);
+        brackets_.setLine(block.blockNumber(), std::move(brackets), measureIndent(utf16View(text)));
+        stateChanged = state != block.userState();
+        block.setUserState(state);
+
+        const bool pastEdit = block.blockNumber() >= lastLine;
+        block = block.next();
+        if (pastEdit) break;
+    }
+    dirty.flush();
+    applying_ = false;
+    if (dirty.firstLine() >= 0) emit linesHighlighted(dirty.firstLine(), dirty.lastLine());
+
+    if (block.isValid() && (stateChanged || block.blockNumber() <= lastLine)) {
+        markDirty(block.blockNumber(), std::max(block.blockNumber(), lastLine));
+    }
+    schedule();
+}
+
+void SyntaxHighlighter::markDirty(int firstLine, int lastLine) {
+    const QTextBlock first = document_->findBlockByNumber(firstLine);
+    const QTextBlock last = document_->findBlockByNumber(lastLine);
+    if (!first.isValid() || !last.isValid()) return;
+
+    if (!has_dirty_) {
+        dirty_begin_ = QTextCursor(first);
+        dirty_end_ = QTextCursor(last);
+        has_dirty_ = true;
+    } else {
+        if (firstLine < dirty_begin_.blockNumber()) dirty_begin_.setPosition(first.position());
+        if (lastLine > dirty_end_.blockNumber()) dirty_end_.setPosition(last.position());
+    }
+    visible_done_ = false;
+}
+
+void SyntaxHighlighter::clearDirty() {
+    has_dirty_ = false;
+    dirty_begin_ = QTextCursor();
+    dirty_end_ = QTextCursor();
+}
+
+void SyntaxHighlighter::schedule() {
+    if (has_dirty_ && !schedule_timer_.isActive()) {
+        schedule_timer_.start();
+    }
+}
+
+SyntaxHighlighter::Job SyntaxHighlighter::snapshot(int firstLine, int count, int startState) const {
+    Job job;
+    job.grammar = grammar_;
+    job.revision = revision_;
+    job.firstLine = firstLine;
+    job.startState = std::max(startState, 0);
+    job.lines.reserve(static_cast<size_t>(count));
+    job.cachedStates.reserve(static_cast<size_t>(count));
+
+    QTextBlock block = document_->findBlockByNumber(firstLine);
+    for (int i = 0; i < count && block.isValid(); ++i, block = block.next()) {
+        job.lines.push_back(block.text());
+        job.cachedStates.push_back(block.userState());
+    }
+    return job;
+}
+
+void SyntaxHighlighter::startNextJob() {
+    if (watcher_.isRunning() || !has_dirty_) return;
+
+    const int begin = dirty_begin_.blockNumber();
+    const int end = dirty_end_.blockNumber();
+
+    // The true start state of the visible lines is not known until the
+    // dirty region above them is done; the cached one is usually right
+    if (!visible_done_ && begin < first_visible_ && last_visible_ >= first_visible_) {
+        const QTextBlock before = document_->findBlockByNumber(first_visible_ - 1);
+        Job job = snapshot(first_visible_, last_visible_ - first_visible_ + 1, before.userState());
+        job.speculative = true;
+        watcher_.setFuture(QtConcurrent::run(&SyntaxHighlighter::lexLines, std::move(job)));
+        return;
+    }
+
+    const QTextBlock before = document_->findBlockByNumber(begin - 1);
+    Job job = snapshot(begin, kChunkLines, before.isValid() ? before.userState() : 0);
+    job.forcedLines = end - begin + 1;
+    watcher_.setFuture(QtConcurrent::run(&SyntaxHighlighter::lexLines, std::move(job)));
+}
+
+SyntaxHighlighter::Result SyntaxHighlighter::lexLines(const Job& job) {
+    Result result;
+    result.revision = job.revision;
+    result.firstLine = job.firstLine;
+    result.speculative = job.speculative;
+    result.endStates.reserve(job.lines.size());
+    result.lineTokens.reserve(job.lines.size() + 1);
+    result.lineTokens.push_back(0);
+    result.lineBrackets.reserve(job.lines.size() + 1);
+    result.lineBrackets.push_back(0);
+    result.indents.reserve(job.lines.size());
+
+    int state = job.startState;
+    for (size_t i = 0; i < job.lines.size(); ++i) {
+        const size_t firstToken = result.tokens.size();
+        if (job.grammar) state = job.grammar->lexLine(utf16View(job.lines[i]), state, result.tokens);
+        result.endStates.push_back(state);
+        result.lineTokens.push_back(static_cast<uint32_t>(result.tokens.size()));
+        scanBrackets(utf16View(job.lines[i]), result.tokens.data() + firstToken,
+                     result.tokens.data() + result.tokens.size(), result.brackets);
+        result.lineBrackets.push_back(static_cast<uint32_t>(result.brackets.size()));
+        result.indents.push_back(measureIndent(utf16View(job.lines[i])));
+
+        // Past the edited region, a line ending in its old state means
+        // everything below is already right
+        if (!job.speculative && static_cast<int>(i) + 1 >= job.forcedLines && state == job.cachedStates[i]) {
+            result.converged = true;
+            break;
         }
     }
-    setCurrentBlockState(0);
-
-    int startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = static_cast<int>(text.indexOf(commentStartExpression));
-
-    while (startIndex >= 0) {
-        QRegularExpressionMatch match = commentEndExpression.match(text, startIndex);
-        int endIndex = static_cast<int>(match.capturedStart());
-        int commentLength = 0;
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = static_cast<int>(text.length()) - startIndex;
-        } else {
-            commentLength = endIndex - startIndex + static_cast<int>(match.capturedLength());
+    return result;
+}
+
+void SyntaxHighlighter::onJobFinished() {
+    const Result result = watcher_.future().takeResult();
+    if (result.revision != revision_) {
+        // Lexed from text that has since changed; the dirty region still
+        // covers it
+        schedule();
+        return;
+    }
+
+    applying_ = true;
+    DirtyRuns dirty(document_);
+    QTextBlock block = document_->findBlockByNumber(result.firstLine);
+    for (size_t i = 0; i < result.endStates.size() && block.isValid(); ++i, block = block.next()) {
+        if (applyFormats(block, result.tokens.data() + result.lineTokens[i],
+                         result.tokens.data() + result.lineTokens[i + 1])) {
+            dirty.add(block);
         }
-        setFormat(startIndex, commentLength, multiLineCommentFormat);
-        startIndex = static_cast<int>(text.indexOf(commentStartExpression, startIndex + commentLength));
+        brackets_.setLine(block.blockNumber(),
+                          std::vector<Bracket>(result.brackets.begin() + result.lineBrackets[i],
+                                               result.brackets.begin() + result.lineBrackets[i + 1]),
+                          result.indents[i]);
+        // Speculative states may be wrong and would defeat the early stop
+        if (!result.speculative) block.setUserState(result.endStates[i]);
+    }
+    dirty.flush();
+    applying_ = false;
+    if (dirty.firstLine() >= 0) emit linesHighlighted(dirty.firstLine(), dirty.lastLine());
+
+    if (result.speculative) {
+        visible_done_ = true;
+    } else if (result.converged || !block.isValid()) {
+        clearDirty();
+    } else {
+        dirty_begin_.setPosition(block.position());
+        if (dirty_end_.blockNumber() < block.blockNumber()) dirty_end_.setPosition(block.position());
+    }
+    schedule();
+}
+
+bool SyntaxHighlighter::applyFormats(QTextBlock block, const Token* begin, const Token* end) {
+    const uint64_t hash = hashTokens(begin, end);
+    BlockData* data = blockData(block);
+    if (data && data->formatted && data->tokensHash == hash) return false;
+
+    QList<QTextLayout::FormatRange> ranges;
+    ranges.reserve(end - begin);
+    for (const Token* token = begin; token != end; ++token) {
+        QTextLayout::FormatRange range;
+        range.start = static_cast<int>(token->start);
+        range.length = static_cast<int>(token->length);
+        range.format = formats_[static_cast<size_t>(token->kind)];
+        ranges.append(range);
+    }
+    appendSemanticFormats(block, ranges);
+    block.layout()->setFormats(ranges);
+
+    data = ensureBlockData(block);
+    data->tokensHash = hash;
+    data->formatted = true;
+    return true;
+}
+
+void SyntaxHighlighter::appendSemanticFormats(const QTextBlock& block, QList<QTextLayout::FormatRange>& ranges) const {
+    const BlockData* data = blockData(block);
+    if (!data) return;
+
+    // Appended after the grammar's ranges, so they take precedence where
+    // both set a property
+    for (const SemanticToken& token : data->semanticTokens) {
+        if (token.type >= semantic_formats_.size() || semantic_formats_[token.type].isEmpty()) continue;
+        QTextLayout::FormatRange range;
+        range.start = static_cast<int>(token.start);
+        range.length = static_cast<int>(token.length);
+        range.format = semantic_formats_[token.type];
+        if (token.modifiers & deprecated_modifier_) range.format.setFontStrikeOut(true);
+        ranges.append(range);
+    }
+}
+
+void SyntaxHighlighter::setSemanticLegend(const QStringList& tokenTypes, const QStringList& tokenModifiers) {
+    if (tokenTypes == semantic_types_ && tokenModifiers == semantic_modifiers_) return;
+    semantic_types_ = tokenTypes;
+    semantic_modifiers_ = tokenModifiers;
+
+    auto format = [this](TokenKind kind) { return formats_[static_cast<size_t>(kind)]; };
+    QTextCharFormat variable;
+    variable.setForeground(QColor("#9cdcfe"));
+    QTextCharFormat enumMember;
+    enumMember.setForeground(QColor("#4fc1ff"));
+
+    const QHash<QString, QTextCharFormat> byName = {
+        {"namespace", format(TokenKind::Type)},
+        {"type", format(TokenKind::Type)},
+        {"class", format(TokenKind::Type)},
+        {"enum", format(TokenKind::Type)},
+        {"interface", format(TokenKind::Type)},
+        {"struct", format(TokenKind::Type)},
+        {"typeParameter", format(TokenKind::Type)},
+        {"parameter", variable},
+        {"variable", variable},
+        {"property", variable},
+        {"enumMember", enumMember},
+        {"function", format(TokenKind::Function)},
+        {"method", format(TokenKind::Function)},
+        {"macro", format(TokenKind::Preprocessor)},
+        {"keyword", format(TokenKind::Keyword)},
+        {"comment", format(TokenKind::Comment)},
+        {"string", format(TokenKind::String)},
+        {"number", format(TokenKind::Number)},
+    };
+
+    semantic_formats_.clear();
+    for (const QString& type : tokenTypes) {
+        QTextCharFormat f = byName.value(type);
+        if (!f.isEmpty()) f.setProperty(kSemanticProperty, true);
+        semantic_formats_.push_back(f);
+    }
+    const auto deprecated = tokenModifiers.indexOf("deprecated");
+    deprecated_modifier_ = deprecated >= 0 && deprecated < 32 ? 1u << deprecated : 0;
+
+    // Cached token types are indices into the old legend
+    clearSemanticTokens();
+}
+
+void SyntaxHighlighter::setSemanticTokens(uint64_t revision, std::string resultId, std::vector<uint32_t> data) {
+    applySemanticUpdate(revision, semantic_.setFull(std::move(resultId), std::move(data)));
+}
+
+bool SyntaxHighlighter::applySemanticEdits(uint64_t revision, std::string resultId,
+                                           std::vector<xenon::features::SemanticTokensEdit> edits) {
+    SemanticTokensUpdate update;
+    if (!semantic_.applyEdits(std::move(resultId), std::move(edits), &update)) return false;
+    applySemanticUpdate(revision, update);
+    return true;
+}
+
+void SyntaxHighlighter::setSemanticRange(uint64_t revision, int firstLine, int lastLine,
+                                         const std::vector<uint32_t>& data) {
+    // A range result is not built on by later ones, so one for older text
+    // is of no use
+    if (revision != revision_) return;
+    applySemanticUpdate(revision, semantic_.setRange(firstLine, lastLine, data));
+}
+
+void SyntaxHighlighter::clearSemanticTokens() {
+    semantic_.clear();
+    semantic_behind_ = true;
+    applySemanticUpdate(revision_, SemanticTokensUpdate());
+}
+
+void SyntaxHighlighter::applySemanticUpdate(uint64_t revision, SemanticTokensUpdate update) {
+    if (revision != revision_) {
+        // The text moved on since the request; its lines no longer line
+        // up with the tokens
+        semantic_behind_ = true;
+        return;
+    }
+    if (semantic_behind_) {
+        update.firstLine = 0;
+        update.lastLine = document_->blockCount() - 1;
+        semantic_behind_ = false;
+    }
+    if (update.empty()) return;
+
+    // Past the changed lines, tokens are as before but may have shifted by
+    // whole lines, as the blocks did with the edit. Once a line with tokens
+    // matches what its block shows, the two agree on the shift and the
+    // rest is already right.
+    const int lastTokenLine = semantic_.lastLine();
+    applying_ = true;
+    DirtyRuns dirty(document_);
+    QTextBlock block = document_->findBlockByNumber(update.firstLine);
+    for (int line = update.firstLine; block.isValid(); ++line, block = block.next()) {
+        const auto [begin, end] = semantic_.lineTokens(line);
+        const bool same = sameTokens(blockData(block), begin, end);
+        if (line > update.lastLine && ((same && begin != end) || line > lastTokenLine)) break;
+        if (same) continue;
+
+        ensureBlockData(block)->semanticTokens.assign(begin, end);
+
+        // The grammar's ranges stay; only the semantic ones are replaced
+        QList<QTextLayout::FormatRange> ranges = block.layout()->formats();
+        ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                    [](const QTextLayout::FormatRange& range) {
+                                        return range.format.hasProperty(kSemanticProperty);
+                                    }),
+                     ranges.end());
+        appendSemanticFormats(block, ranges);
+        block.layout()->setFormats(ranges);
+        dirty.add(block);
     }
+    dirty.flush();
+    applying_ = false;
+    if (dirty.firstLine() >= 0) emit linesHighlighted(dirty.firstLine(), dirty.lastLine());
 }
 
 } // namespace xenon::ui
@@ -1,36 +1,156 @@
 #pragma once
 
-#include <QSyntaxHighlighter>
-#include <QRegularExpression>
+#include <QFutureWatcher>
+#include <QObject>
 #include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextLayout>
+#include <QTextDocument>
+#include <QTimer>
+#include <array>
+#include <memory>
+#include <vector>
+#include "features/bracket_index.hpp"
+#include "features/grammar.hpp"
+#include "features/semantic_tokens.hpp"
 
 namespace xenon::ui {
 
-class SyntaxHighlighter : public QSyntaxHighlighter {
+// Highlights a document off the GUI thread. Each block's end state lives in
+// its userState. An edit re-lexes the edited lines at once (a few
+// microseconds), and if that changes the state carried into the next line
+// the remainder is marked dirty and lexed on a worker thread in chunks,
+// over a snapshot of the lines' text. A chunk stops early once a line ends
+// in the state it had before. While the dirty region starts above the
+// viewport, the visible lines are first lexed speculatively from their
+// cached start state so what is on screen settles first.
+//
+// Semantic tokens from the LSP server are drawn over the grammar's. Each
+// block keeps the semantic tokens it shows in its user data, so a server
+// update only touches lines whose tokens differ, and an edited line drops
+// its semantic tokens until the next update. The user data also holds a
+// hash of the grammar tokens last applied: formats are only set when they
+// change, since that discards the block's shaped text.
+class SyntaxHighlighter : public QObject {
     Q_OBJECT
 
 public:
-    explicit SyntaxHighlighter(QTextDocument* parent = nullptr);
+    explicit SyntaxHighlighter(QTextDocument* document);
+    ~SyntaxHighlighter() override;
 
-protected:
-    void highlightBlock(const QString& text) override;
+    // Null leaves the document uncolored
+    void setGrammar(std::shared_ptr<const xenon::features::Grammar> grammar);
+    std::shared_ptr<const xenon::features::Grammar> grammar() const { return grammar_; }
+
+    // Lines the editor currently shows; they are highlighted first
+    void setVisibleLines(int first, int last);
+    int firstVisibleLine() const { return first_visible_; }
+    int lastVisibleLine() const { return last_visible_; }
+    // Discards every cached state and highlights the whole document again
+    void rehighlight();
+    // True once every line has been highlighted since the last edit
+    bool isIdle() const { return !has_dirty_ && !watcher_.isRunning(); }
+    // The brackets outside strings and comments and each line's indent,
+    // kept as lines are lexed; lines not lexed since an edit have none
+    // until they are
+    const xenon::features::BracketIndex& brackets() const { return brackets_; }
+
+    // Bumped by every edit. Semantic tokens are applied with the revision
+    // they were requested at; tokens for older text are cached but not
+    // drawn until a result for the current text arrives.
+    uint64_t revision() const { return revision_; }
+    void setSemanticLegend(const QStringList& tokenTypes, const QStringList& tokenModifiers);
+    const std::string& semanticResultId() const { return semantic_.resultId(); }
+    void setSemanticTokens(uint64_t revision, std::string resultId, std::vector<uint32_t> data);
+    // False when the edits don't apply to the cached result
+    bool applySemanticEdits(uint64_t revision, std::string resultId, std::vector<xenon::features::SemanticTokensEdit> edits);
+    void setSemanticRange(uint64_t revision, int firstLine, int lastLine, const std::vector<uint32_t>& data);
+    void clearSemanticTokens();
+
+signals:
+    // Lines whose colors changed, for views that summarize them
+    void linesHighlighted(int firstLine, int lastLine);
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void startNextJob();
+    void onJobFinished();
 
 private:
-    struct HighlightingRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
+    struct Job {
+        std::shared_ptr<const xenon::features::Grammar> grammar;
+        uint64_t revision = 0;
+        int firstLine = 0;
+        int startState = 0;
+        // Lines below this index (relative to firstLine) are lexed even if
+        // their state is unchanged
+        int forcedLines = 0;
+        bool speculative = false;
+        std::vector<QString> lines;
+        std::vector<int> cachedStates;
     };
-    QVector<HighlightingRule> highlightingRules;
 
-    QRegularExpression commentStartExpression;
-    QRegularExpression commentEndExpression;
+    struct Result {
+        uint64_t revision = 0;
+        int firstLine = 0;
+        bool speculative = false;
+        bool converged = false; // stopped on a matching state
+        std::vector<int> endStates;
+        std::vector<xenon::features::Token> tokens;
+        std::vector<uint32_t> lineTokens; // offsets into tokens, one per line plus one
+        std::vector<xenon::features::Bracket> brackets;
+        std::vector<uint32_t> lineBrackets; // offsets into brackets, likewise
+        std::vector<xenon::features::LineIndent> indents;
+    };
+
+    static Result lexLines(const Job& job);
+
+    void markDirty(int firstLine, int lastLine);
+    void clearDirty();
+    void schedule();
+    Job snapshot(int firstLine, int count, int startState) const;
+    // False when the block already has these formats
+    bool applyFormats(QTextBlock block, const xenon::features::Token* begin, const xenon::features::Token* end);
+    void appendSemanticFormats(const QTextBlock& block, QList<QTextLayout::FormatRange>& ranges) const;
+    void applySemanticUpdate(uint64_t revision, xenon::features::SemanticTokensUpdate update);
+
+    static constexpr size_t kTokenKindCount = static_cast<size_t>(xenon::features::TokenKind::Preprocessor) + 1;
+
+    QTextDocument* document_;
+    std::shared_ptr<const xenon::features::Grammar> grammar_;
+    // Indexed by TokenKind
+    std::array<QTextCharFormat, kTokenKindCount> formats_;
+    std::vector<xenon::features::Token> tokens_;
+    xenon::features::BracketIndex brackets_;
+    int line_count_ = 0;
+
+    // Bumped by every edit; results lexed from an older snapshot are dropped
+    uint64_t revision_ = 0;
+    bool applying_ = false;
+
+    // The dirty region as cursors, so it moves with edits made while it
+    // is pending. Lines up to dirty_end_ are lexed regardless of state.
+    bool has_dirty_ = false;
+    QTextCursor dirty_begin_;
+    QTextCursor dirty_end_;
+
+    int first_visible_ = 0;
+    int last_visible_ = -1;
+    bool visible_done_ = false;
+
+    // Formats by index in the server's legend; empty for types drawn as
+    // the grammar has them
+    std::vector<QTextCharFormat> semantic_formats_;
+    QStringList semantic_types_;
+    QStringList semantic_modifiers_;
+    uint32_t deprecated_modifier_ = 0;
+    xenon::features::SemanticTokenCache semantic_;
+    // Set when a result was cached without being drawn; the next one
+    // compares every line
+    bool semantic_behind_ = false;
 
-    QTextCharFormat keywordFormat;
-    QTextCharFormat classFormat;
-    QTextCharFormat singleLineCommentFormat;
-    QTextCharFormat multiLineCommentFormat;
-    QTextCharFormat quotationFormat;
-    QTextCharFormat functionFormat;
+    QTimer schedule_timer_;
+    QFutureWatcher<Result> watcher_;
 };
 
 } // namespace xenon::ui
@@ -0,0 +1,211 @@
+#include "ui/wrap_layout.hpp"
+#include <QAbstractTextDocumentLayout>
+#include <QFontMetricsF>
+#include <QTextBlock>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace xenon::ui {
+
+namespace {
+
+constexpr int kChunkLines = 2000;
+// Resizing by dragging sends a stream of widths; only the last is counted
+constexpr int kRelayoutDelay = 100;
+
+} // anonymous namespace
+
+WrapLayout::WrapLayout(QTextDocument* document) : QObject(document), document_(document) {
+    schedule_timer_.setSingleShot(true);
+    schedule_timer_.setInterval(0);
+    connect(&schedule_timer_, &QTimer::timeout, this, &WrapLayout::startNextJob);
+
+    relayout_timer_.setSingleShot(true);
+    relayout_timer_.setInterval(kRelayoutDelay);
+    connect(&relayout_timer_, &QTimer::timeout, this, [this]() {
+        const int from = std::clamp(relayout_from_, 0, document_->blockCount() - 1);
+        pushDirty(from, document_->blockCount() - 1, false);
+        if (from > 0) pushDirty(0, from - 1, false);
+        schedule();
+    });
+
+    connect(&watcher_, &QFutureWatcherBase::finished, this, &WrapLayout::onJobFinished);
+    connect(document_, &QTextDocument::contentsChange, this, &WrapLayout::onContentsChange);
+}
+
+WrapLayout::~WrapLayout() {
+    watcher_.waitForFinished();
+}
+
+void WrapLayout::setEnabled(bool enabled) {
+    if (enabled == enabled_) return;
+    enabled_ = enabled;
+    revision_++;
+    dirty_.clear();
+    relayout_timer_.stop();
+}
+
+void WrapLayout::setWidth(qreal width, int firstLine) {
+    if (!enabled_) return;
+    // The view has just forgotten every row count, even at the same width
+    width_ = width;
+    revision_++;
+    dirty_.clear();
+    relayout_from_ = firstLine;
+    relayout_timer_.start();
+}
+
+void WrapLayout::markDirty(int firstLine, int lastLine) {
+    if (!enabled_) return;
+    // The job out may be for the range this lands in front of
+    revision_++;
+    pushDirty(firstLine, lastLine, true);
+    schedule();
+}
+
+void WrapLayout::onContentsChange(int position, int /* charsRemoved */, int charsAdded) {
+    if (!enabled_) return;
+    revision_++;
+
+    const QTextBlock first = document_->findBlock(position);
+    QTextBlock last = document_->findBlock(position + charsAdded);
+    if (!last.isValid()) last = document_->lastBlock();
+    pushDirty(first.isValid() ? first.blockNumber() : 0, last.blockNumber(), true);
+    schedule();
+}
+
+void WrapLayout::pushDirty(int firstLine, int lastLine, bool front) {
+    const QTextBlock first = document_->findBlockByNumber(firstLine);
+    const QTextBlock last = document_->findBlockByNumber(lastLine);
+    if (!first.isValid() || !last.isValid()) return;
+
+    // Typing keeps dirtying the same line
+    if (front && !dirty_.empty() && dirty_.front().first.blockNumber() <= lastLine + 1 &&
+        dirty_.front().last.blockNumber() + 1 >= firstLine) {
+        DirtyRange& range = dirty_.front();
+        if (firstLine < range.first.blockNumber()) range.first.setPosition(first.position());
+        if (lastLine > range.last.blockNumber()) range.last.setPosition(last.position());
+        return;
+    }
+
+    DirtyRange range{QTextCursor(first), QTextCursor(last)};
+    if (front) {
+        dirty_.insert(dirty_.begin(), std::move(range));
+    } else {
+        dirty_.push_back(std::move(range));
+    }
+}
+
+void WrapLayout::schedule() {
+    if (!dirty_.empty() && !schedule_timer_.isActive()) {
+        schedule_timer_.start();
+    }
+}
+
+void WrapLayout::startNextJob() {
+    if (!enabled_ || watcher_.isRunning()) return;
+    while (!dirty_.empty() && dirty_.front().last.blockNumber() < dirty_.front().first.blockNumber()) {
+        // Its lines were deleted
+        dirty_.erase(dirty_.begin());
+    }
+    if (dirty_.empty()) return;
+
+    const int first = dirty_.front().first.blockNumber();
+    const int count = std::min(kChunkLines, dirty_.front().last.blockNumber() - first + 1);
+
+    // Laid out as QPlainTextDocumentLayout does it
+    Job job;
+    job.revision = revision_;
+    job.firstLine = first;
+    job.font = document_->defaultFont();
+    job.option = document_->defaultTextOption();
+    qreal margin = 2 * document_->documentMargin();
+    if (job.option.flags() & QTextOption::AddSpaceForLineAndParagraphSeparators) {
+        margin += QFontMetricsF(job.font).horizontalAdvance(QChar(0x21B5));
+    }
+    job.width = std::max<qreal>(1, width_ - margin);
+
+    job.lines.reserve(static_cast<size_t>(count));
+    job.formats.reserve(static_cast<size_t>(count));
+    QTextBlock block = document_->findBlockByNumber(first);
+    for (int i = 0; i < count && block.isValid(); ++i, block = block.next()) {
+        // Lines the view has laid out or folded away are left as they are
+        const bool counted = !block.isVisible() || block.layout()->lineCount() > 0;
+        job.lines.push_back(counted ? QString() : block.text());
+        job.formats.push_back(counted ? QList<QTextLayout::FormatRange>() : block.layout()->formats());
+    }
+    watcher_.setFuture(QtConcurrent::run(&WrapLayout::countRows, std::move(job)));
+}
+
+WrapLayout::Result WrapLayout::countRows(const Job& job) {
+    Result result;
+    result.revision = job.revision;
+    result.firstLine = job.firstLine;
+    result.rows.reserve(job.lines.size());
+
+    // A line that fits even at the widest glyph of the regular and bold
+    // faces is a single row; most lines of code are, and are not shaped
+    QFont bold = job.font;
+    bold.setBold(true);
+    const qreal widest = std::max(QFontMetricsF(job.font).maxWidth(), QFontMetricsF(bold).maxWidth());
+    const qreal tabWidth = job.option.tabStopDistance();
+
+    for (size_t i = 0; i < job.lines.size(); ++i) {
+        const QString& text = job.lines[i];
+        const qsizetype tabs = text.count(QLatin1Char('\t'));
+        if (static_cast<qreal>(text.size() - tabs) * widest + static_cast<qreal>(tabs) * tabWidth <= job.width) {
+            result.rows.push_back(1);
+            continue;
+        }
+
+        QTextLayout layout(text, job.font);
+        layout.setTextOption(job.option);
+        layout.setFormats(job.formats[i]);
+        layout.beginLayout();
+        int rows = 0;
+        for (QTextLine line = layout.createLine(); line.isValid(); line = layout.createLine()) {
+            line.setLineWidth(job.width);
+            ++rows;
+        }
+        layout.endLayout();
+        result.rows.push_back(std::max(rows, 1));
+    }
+    return result;
+}
+
+void WrapLayout::onJobFinished() {
+    const Result result = watcher_.future().takeResult();
+    if (result.revision != revision_ || dirty_.empty()) {
+        // Counted from text or at a width that has since changed; the
+        // dirty ranges still cover it
+        schedule();
+        return;
+    }
+
+    bool changed = false;
+    QTextBlock block = document_->findBlockByNumber(result.firstLine);
+    for (size_t i = 0; i < result.rows.size() && block.isValid(); ++i, block = block.next()) {
+        // The view may have laid the block out meanwhile, exactly
+        if (!block.isVisible() || block.layout()->lineCount() > 0) continue;
+        if (block.lineCount() != result.rows[i]) {
+            block.setLineCount(result.rows[i]);
+            changed = true;
+        }
+    }
+
+    DirtyRange& range = dirty_.front();
+    if (!block.isValid() || block.blockNumber() > range.last.blockNumber()) {
+        dirty_.erase(dirty_.begin());
+    } else {
+        range.first.setPosition(block.position());
+    }
+
+    if (changed) {
+        // The view sizes its scroll bar from the document's line count
+        QAbstractTextDocumentLayout* layout = document_->documentLayout();
+        emit layout->documentSizeChanged(layout->documentSize());
+    }
+    schedule();
+}
+
+} // namespace xenon::ui
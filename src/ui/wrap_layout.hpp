@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QFont>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTextOption>
+#include <QTimer>
+#include <vector>
+
+namespace xenon::ui {
+
+// Soft-wrap row counts for the blocks a wrapping QPlainTextEdit has not
+// laid out yet. The view only lays out the blocks it paints and counts
+// every other block as one row, so without this the scroll bar is wrong
+// until the whole document has been scrolled through, and it jumps while
+// scrolling. Rows are counted on a worker thread by laying the lines out
+// with the view's font, formats and width, in chunks over a snapshot of
+// their text, and written into the blocks' line counts.
+//
+// The document's block map sums those line counts in a balanced tree, so
+// it is the prefix-sum index of rows per line: the scroll bar's range, the
+// block at a scroll position and the row of a block are all O(log n) in
+// the view. A width change starts again from the first visible line on,
+// after the view has laid out what it shows; edited and unfolded lines go
+// first.
+class WrapLayout : public QObject {
+    Q_OBJECT
+
+public:
+    explicit WrapLayout(QTextDocument* document);
+    ~WrapLayout() override;
+
+    // Off by default; the view must wrap at the same width
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled_; }
+    // The view's text width; every line is counted again, from firstLine on
+    void setWidth(qreal width, int firstLine);
+    // Lines whose row count the view forgot, e.g. on unfolding
+    void markDirty(int firstLine, int lastLine);
+    // True once every line has been counted since the last change
+    bool isIdle() const { return dirty_.empty() && !watcher_.isRunning(); }
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void startNextJob();
+    void onJobFinished();
+
+private:
+    struct Job {
+        uint64_t revision = 0;
+        int firstLine = 0;
+        qreal width = 0;
+        QFont font;
+        QTextOption option;
+        std::vector<QString> lines;
+        std::vector<QList<QTextLayout::FormatRange>> formats;
+    };
+
+    struct Result {
+        uint64_t revision = 0;
+        int firstLine = 0;
+        std::vector<int> rows;
+    };
+
+    // Lines first..last, as cursors so they move with edits
+    struct DirtyRange {
+        QTextCursor first;
+        QTextCursor last;
+    };
+
+    static Result countRows(const Job& job);
+
+    void pushDirty(int firstLine, int lastLine, bool front);
+    void schedule();
+
+    QTextDocument* document_;
+    bool enabled_ = false;
+    qreal width_ = 0;
+    // Bumped by every edit and width change; results for older text or
+    // another width are dropped
+    uint64_t revision_ = 0;
+
+    // Counted front to back
+    std::vector<DirtyRange> dirty_;
+
+    QTimer schedule_timer_;
+    QTimer relayout_timer_;
+    int relayout_from_ = 0;
+    QFutureWatcher<Result> watcher_;
+};
+
+} // namespace xenon::ui